@@ -74,6 +74,19 @@
 #define DEBUG_SEM_LAST_ACQUIRER			KDEBUG_LEVEL_1
 
 
+// locks
+
+// Lets a thread waiting for a contended mutex spin for a short while instead
+// of blocking, as long as the holder is running on another CPU. Enables the
+// "mutex_spinning" debugger command.
+#define KERNEL_MUTEX_SPINNING			1
+
+// Collects per lock class statistics (acquisitions, contention, wait and hold
+// times) for mutexes, rw_locks and spinlocks. The collection itself has to be
+// turned on at runtime, see the "lockstat" debugger command and tool.
+#define KERNEL_LOCK_STATISTICS			0
+
+
 // SMP
 
 // Enables spinlock caller debugging. When acquiring a spinlock twice on a
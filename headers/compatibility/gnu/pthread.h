@@ -34,6 +34,9 @@ extern int pthread_timedjoin_np(pthread_t thread, void** _value, const struct ti
 extern int pthread_setaffinity_np(pthread_t thread, size_t cpusetsize, const cpuset_t* mask);
 extern int pthread_getaffinity_np(pthread_t thread, size_t cpusetsize, cpuset_t* mask);
 
+extern int pthread_setdeadline_np(pthread_t thread, const struct timespec* runtime,
+	const struct timespec* deadline, const struct timespec* period);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2026, Haiku Inc. All Rights Reserved.
+ * Distributed under the terms of the MIT License.
+ *
+ * The Linux epoll interface, implemented on top of Haiku's event queues.
+ */
+#ifndef _GNU_SYS_EPOLL_H
+#define _GNU_SYS_EPOLL_H
+
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+
+/* flags for epoll_create1() */
+#define EPOLL_CLOEXEC	O_CLOEXEC
+
+/* operations for epoll_ctl() */
+#define EPOLL_CTL_ADD	1
+#define EPOLL_CTL_DEL	2
+#define EPOLL_CTL_MOD	3
+
+/* events */
+#define EPOLLIN			0x00000001
+#define EPOLLPRI		0x00000002
+#define EPOLLOUT		0x00000004
+#define EPOLLERR		0x00000008
+#define EPOLLHUP		0x00000010
+#define EPOLLRDNORM		0x00000040
+#define EPOLLRDBAND		0x00000080
+#define EPOLLWRNORM		0x00000100
+#define EPOLLWRBAND		0x00000200
+#define EPOLLMSG		0x00000400
+#define EPOLLRDHUP		0x00002000
+
+/* input flags */
+#define EPOLLEXCLUSIVE	(1U << 28)	/* accepted, but ignored */
+#define EPOLLWAKEUP		(1U << 29)	/* accepted, but ignored */
+#define EPOLLONESHOT	(1U << 30)
+#define EPOLLET			(1U << 31)
+
+
+typedef union epoll_data {
+	void*		ptr;
+	int			fd;
+	uint32_t	u32;
+	uint64_t	u64;		/* only pointer sized values are preserved */
+} epoll_data_t;
+
+struct epoll_event {
+	uint32_t		events;
+	epoll_data_t	data;
+};
+
+
+__BEGIN_DECLS
+
+
+int		epoll_create(int size);
+int		epoll_create1(int flags);
+int		epoll_ctl(int epfd, int op, int fd, struct epoll_event* event);
+int		epoll_wait(int epfd, struct epoll_event* events, int maxEvents,
+			int timeout);
+int		epoll_pwait(int epfd, struct epoll_event* events, int maxEvents,
+			int timeout, const sigset_t* sigMask);
+
+
+__END_DECLS
+
+
+#endif	/* _GNU_SYS_EPOLL_H */
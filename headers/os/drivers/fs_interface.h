@@ -251,6 +251,16 @@ struct fs_vnode_ops {
 				const struct flock* lock, bool wait);
 	status_t (*release_lock)(fs_volume* volume, fs_vnode* vnode, void* cookie,
 				const struct flock* lock);
+
+	/* batched directory operations */
+	status_t (*read_dir_stat)(fs_volume* volume, fs_vnode* vnode, void* cookie,
+				struct dirent* buffer, size_t bufferSize, struct stat* stats,
+				uint32* _num);
+
+	/* file data copying (both vnodes belong to this volume) */
+	status_t (*copy_file_range)(fs_volume* volume, fs_vnode* sourceVnode,
+				void* sourceCookie, off_t sourcePos, fs_vnode* targetVnode,
+				void* targetCookie, off_t targetPos, size_t* _length);
 };
 
 struct file_system_module_info {
@@ -52,6 +52,7 @@ enum be_task_flags {
 enum scheduler_mode {
 	SCHEDULER_MODE_LOW_LATENCY,
 	SCHEDULER_MODE_POWER_SAVING,
+	SCHEDULER_MODE_SERVER,
 };
 
 #if defined(__cplusplus)
@@ -66,6 +67,9 @@ bigtime_t estimate_max_scheduling_latency(thread_id th = -1);
 status_t set_scheduler_mode(int32 mode);
 int32 get_scheduler_mode(void);
 
+status_t set_thread_deadline(thread_id thread, bigtime_t runtime,
+	bigtime_t deadline, bigtime_t period);
+
 }
 #else
 
@@ -78,6 +82,9 @@ bigtime_t estimate_max_scheduling_latency(thread_id th);
 status_t set_scheduler_mode(int32 mode);
 int32 get_scheduler_mode(void);
 
+status_t set_thread_deadline(thread_id thread, bigtime_t runtime,
+	bigtime_t deadline, bigtime_t period);
+
 #endif
 
 #endif // SCHEDULER_H
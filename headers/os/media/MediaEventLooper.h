@@ -89,6 +89,12 @@ protected:
 			void				SetBufferDuration(bigtime_t duration);
 			void				SetOfflineTime(bigtime_t offTime);
 
+	// NOTE: Opts the control thread into deadline scheduling: it is then
+	// guaranteed the given runtime every BufferDuration(), independent of
+	// its priority. Pass 0 to go back to priority based scheduling.
+	// Fails if the system cannot give that guarantee.
+			status_t			SetDeadlineRuntime(bigtime_t runtime);
+
 	// Spawns and resumes the control thread - must be called from
 	// NodeRegistered().
 			void				Run();
@@ -107,6 +113,7 @@ private:
 									void* context);
 			void				_DispatchCleanUp(
 									const media_timed_event* event);
+			status_t			_UpdateDeadline();
 
 private:
 			BTimedEventQueue	fEventQueue;
@@ -155,7 +162,8 @@ private:
 	virtual	status_t 			_Reserved_BMediaEventLooper_23(int32 arg, ...);
 
 	bool						_reserved_bool_[4];
-	uint32						_reserved_BMediaEventLooper_[12];
+	uint32						fDeadlineRuntime;
+	uint32						_reserved_BMediaEventLooper_[11];
 };
 
 #endif // _MEDIA_EVENT_LOOPER_H
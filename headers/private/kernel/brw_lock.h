@@ -0,0 +1,124 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_BRW_LOCK_H
+#define _KERNEL_BRW_LOCK_H
+
+
+#include <arch/cpu.h>
+#include <lock.h>
+#include <smp.h>
+
+
+struct brw_lock_waiter;
+
+typedef struct CACHE_LINE_ALIGN brw_lock_reader_count {
+	int32					count;
+} brw_lock_reader_count;
+
+/*!	A "big reader" lock: an rw_lock variant for read-mostly data.
+
+	Readers only touch a counter of the CPU they are running on, so read
+	locking does not bounce a shared cache line between CPUs. Write locking
+	is correspondingly expensive, since the writer has to wait for the
+	readers on all CPUs to leave.
+	Unlike with rw_lock, read locks must not be nested, unless the thread
+	holds the write lock.
+*/
+typedef struct brw_lock {
+	rw_lock					lock;
+								// held by writers, and briefly by readers
+								// that could not take the fast path
+	struct brw_lock_waiter*	waiter;
+								// the writer waiting for the readers to leave
+	spinlock				waiter_lock;
+	int32					writer_count;
+								// > 0 while the write lock is held or
+								// acquired
+	brw_lock_reader_count	readers[SMP_MAX_CPUS];
+								// only the sum is meaningful, since a reader
+								// may unlock on another CPU than it locked on
+} brw_lock;
+
+#define BRW_LOCK_FLAG_CLONE_NAME	RW_LOCK_FLAG_CLONE_NAME
+
+
+#if KDEBUG
+	extern bool _brw_lock_is_read_locked(brw_lock* lock);
+#	define ASSERT_READ_LOCKED_BRW_LOCK(l) \
+		{ ASSERT_PRINT(_brw_lock_is_read_locked(l), "brw_lock %p", l); }
+#else
+#	define ASSERT_READ_LOCKED_BRW_LOCK(l)	do {} while (false)
+#endif
+#define ASSERT_WRITE_LOCKED_BRW_LOCK(l)	ASSERT_WRITE_LOCKED_RW_LOCK(&(l)->lock)
+
+
+// static initializer
+#define BRW_LOCK_INITIALIZER(name) \
+	{ RW_LOCK_INITIALIZER(name), NULL, B_SPINLOCK_INITIALIZER, 0 }
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void brw_lock_init(brw_lock* lock, const char* name);
+	// name is *not* cloned nor freed in brw_lock_destroy()
+extern void brw_lock_init_etc(brw_lock* lock, const char* name, uint32 flags);
+extern void brw_lock_destroy(brw_lock* lock);
+
+extern status_t brw_lock_read_lock(brw_lock* lock);
+extern void brw_lock_read_unlock(brw_lock* lock);
+extern status_t brw_lock_write_lock(brw_lock* lock);
+extern void brw_lock_write_unlock(brw_lock* lock);
+
+#ifdef __cplusplus
+}
+
+
+#include <shared/AutoLocker.h>
+
+
+namespace BPrivate {
+
+
+class BigReaderLockReadLocking {
+public:
+	inline bool Lock(brw_lock *lockable)
+	{
+		return brw_lock_read_lock(lockable) == B_OK;
+	}
+
+	inline void Unlock(brw_lock *lockable)
+	{
+		brw_lock_read_unlock(lockable);
+	}
+};
+
+class BigReaderLockWriteLocking {
+public:
+	inline bool Lock(brw_lock *lockable)
+	{
+		return brw_lock_write_lock(lockable) == B_OK;
+	}
+
+	inline void Unlock(brw_lock *lockable)
+	{
+		brw_lock_write_unlock(lockable);
+	}
+};
+
+typedef AutoLocker<brw_lock, BigReaderLockReadLocking> BigReadLocker;
+typedef AutoLocker<brw_lock, BigReaderLockWriteLocking> BigWriteLocker;
+
+
+}	// namespace BPrivate
+
+using BPrivate::BigReadLocker;
+using BPrivate::BigWriteLocker;
+
+
+#endif	// __cplusplus
+
+#endif	/* _KERNEL_BRW_LOCK_H */
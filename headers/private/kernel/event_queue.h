@@ -6,6 +6,8 @@
 #ifndef _KERNEL_EVENT_QUEUE_H
 #define _KERNEL_EVENT_QUEUE_H
 
+#include <signal.h>
+
 #include <OS.h>
 #include <event_queue_defs.h>
 
@@ -20,6 +22,10 @@ extern status_t	_user_event_queue_select(int queue,	event_wait_info* userInfos,
 					int numInfos);
 extern ssize_t	_user_event_queue_wait(int queue, event_wait_info* infos,
 					int numInfos, uint32 flags, bigtime_t timeout);
+extern ssize_t	_user_event_queue_submit(int queue,
+					event_queue_change* userChanges, int numChanges,
+					event_wait_info* userInfos, int numInfos, uint32 flags,
+					bigtime_t timeout, const sigset_t* userSigMask);
 
 
 #ifdef __cplusplus
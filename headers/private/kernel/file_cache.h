@@ -16,6 +16,8 @@
 
 #define CACHE_CLEAR			1	// takes no parameters
 #define CACHE_SET_MODULE	2	// gets the module name as parameter
+#define CACHE_GET_READ_AHEAD	3	// fills in a file_cache_read_ahead_info
+#define CACHE_SET_READ_AHEAD	4	// gets a file_cache_read_ahead_info
 
 #define CACHE_MODULES_NAME	"file_cache"
 
@@ -23,6 +25,23 @@
 #define FILE_CACHE_LOADED_COMPLETELY	0x02
 #define FILE_CACHE_NO_IO				0x04
 
+struct file_cache_read_ahead_info {
+	// tunables
+	uint32		min_window;
+		// the initial read-ahead window size of a stream, in bytes
+	uint32		max_window;
+		// the window doubles up to this size (at most 32 MB); 0 disables
+		// read-ahead
+
+	// statistics
+	uint64		sequential_reads;
+		// reads that continued a detected stream
+	uint64		random_reads;
+		// reads that did not match any stream of the file
+	uint64		read_ahead_requests;
+	uint64		read_ahead_bytes;
+};
+
 struct cache_module_info {
 	module_info	info;
 
@@ -31,6 +50,8 @@ struct cache_module_info {
 	void (*node_closed)(struct vnode *vnode, dev_t mountID,
 				ino_t vnodeID, int32 accessType);
 	void (*node_launched)(size_t argCount, char * const *args);
+	void (*node_read)(struct vnode *vnode, dev_t mountID, ino_t vnodeID,
+				off_t offset, size_t size);
 };
 
 #ifdef __cplusplus
@@ -42,6 +63,8 @@ extern void cache_node_opened(struct vnode *vnode, VMCache *cache,
 extern void cache_node_closed(struct vnode *vnode, VMCache *cache,
 				dev_t mountID, ino_t vnodeID);
 extern void cache_node_launched(size_t argCount, char * const *args);
+extern void cache_node_read(struct vnode *vnode, dev_t mountID, ino_t vnodeID,
+				off_t offset, size_t size);
 extern void cache_prefetch_vnode(struct vnode *vnode, off_t offset, size_t size);
 extern void cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size);
 
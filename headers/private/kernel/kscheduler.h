@@ -44,6 +44,17 @@ void scheduler_reschedule(int32 next_state);
 */
 int32 scheduler_set_thread_priority(Thread* thread, int32 priority);
 
+/*!	Moves the given thread into the deadline scheduling class: every \a period
+	it is guaranteed \a runtime of CPU time before \a deadline (relative to
+	the start of the period) has passed. A \a runtime of 0 moves the thread
+	back to priority based scheduling.
+	Fails with \c B_BUSY if the thread cannot be admitted without breaking
+	the guarantees given to the other deadline threads.
+	The caller must hold the thread's lock.
+*/
+status_t scheduler_set_thread_deadline(Thread* thread, bigtime_t runtime,
+	bigtime_t deadline, bigtime_t period);
+
 /*!	Called when the Thread structure is first created.
 	Per-thread housekeeping resources can be allocated.
 	Interrupts must be enabled.
@@ -14,6 +14,7 @@
 
 #include <arch/atomic.h>
 #include <debug.h>
+#include <lock_statistics.h>
 
 
 struct mutex_waiter;
@@ -26,8 +27,17 @@ typedef struct mutex {
 	thread_id				holder;
 #else
 	int32					count;
+#	if KERNEL_MUTEX_SPINNING
+	thread_id				holder;
+								// Only a hint for the spinning waiters, it
+								// is -1 while the lock is being released.
+#	endif
 #endif
 	uint8					flags;
+#if KERNEL_LOCK_STATISTICS
+	bigtime_t				acquire_time;
+								// used to compute the hold time, 0 if unknown
+#endif
 } mutex;
 
 #define MUTEX_FLAG_CLONE_NAME	0x1
@@ -62,6 +72,10 @@ typedef struct rw_lock {
 								// incremented "count", but have not yet started
 								// to wait at the time the last writer unlocked.
 	uint32					flags;
+#if KERNEL_LOCK_STATISTICS
+	bigtime_t				acquire_time;
+								// write lock acquisition, 0 if unknown
+#endif
 } rw_lock;
 
 #define RW_LOCK_WRITER_COUNT_BASE	0x10000
@@ -101,6 +115,10 @@ typedef struct rw_lock {
 #	define MUTEX_INITIALIZER(name) \
 	{ name, NULL, B_SPINLOCK_INITIALIZER, -1, 0 }
 #	define RECURSIVE_LOCK_INITIALIZER(name)	{ MUTEX_INITIALIZER(name), 0 }
+#elif KERNEL_MUTEX_SPINNING
+#	define MUTEX_INITIALIZER(name) \
+	{ name, NULL, B_SPINLOCK_INITIALIZER, 0, -1, 0 }
+#	define RECURSIVE_LOCK_INITIALIZER(name)	{ MUTEX_INITIALIZER(name), -1, 0 }
 #else
 #	define MUTEX_INITIALIZER(name) \
 	{ name, NULL, B_SPINLOCK_INITIALIZER, 0, 0 }
@@ -189,6 +207,59 @@ extern status_t _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags,
 #endif
 
 
+#if KERNEL_LOCK_STATISTICS
+
+static inline void
+_mutex_statistics_acquired(mutex* lock, bool contended, bigtime_t waitStart)
+{
+	if (!gLockStatisticsEnabled)
+		return;
+
+	bigtime_t now = system_time();
+	lock->acquire_time = now;
+	lock_statistics_acquired((addr_t)lock->name, LOCK_STATISTICS_TYPE_MUTEX,
+		lock->name, contended, waitStart != 0 ? now - waitStart : 0);
+}
+
+
+static inline void
+_mutex_statistics_released(mutex* lock)
+{
+	bigtime_t acquireTime = lock->acquire_time;
+	if (acquireTime == 0)
+		return;
+
+	lock->acquire_time = 0;
+	if (gLockStatisticsEnabled) {
+		lock_statistics_released((addr_t)lock->name, LOCK_STATISTICS_TYPE_MUTEX,
+			system_time() - acquireTime);
+	}
+}
+
+
+static inline void
+_rw_lock_statistics_read_acquired(rw_lock* lock)
+{
+	if (gLockStatisticsEnabled) {
+		lock_statistics_acquired((addr_t)lock->name,
+			LOCK_STATISTICS_TYPE_RW_LOCK, lock->name, false, 0);
+	}
+}
+
+#	define MUTEX_STATISTICS_ACQUIRED(lock, contended, waitStart) \
+		_mutex_statistics_acquired(lock, contended, waitStart)
+#	define MUTEX_STATISTICS_RELEASED(lock) \
+		_mutex_statistics_released(lock)
+#	define RW_LOCK_STATISTICS_READ_ACQUIRED(lock) \
+		_rw_lock_statistics_read_acquired(lock)
+#else
+#	define MUTEX_STATISTICS_ACQUIRED(lock, contended, waitStart) \
+		do {} while (false)
+#	define MUTEX_STATISTICS_RELEASED(lock)			do {} while (false)
+#	define RW_LOCK_STATISTICS_READ_ACQUIRED(lock)	do {} while (false)
+#endif
+
+
 static inline status_t
 rw_lock_read_lock(rw_lock* lock)
 {
@@ -198,6 +269,7 @@ rw_lock_read_lock(rw_lock* lock)
 	int32 oldCount = atomic_add(&lock->count, 1);
 	if (oldCount >= RW_LOCK_WRITER_COUNT_BASE)
 		return _rw_lock_read_lock(lock);
+	RW_LOCK_STATISTICS_READ_ACQUIRED(lock);
 	return B_OK;
 #endif
 }
@@ -213,6 +285,7 @@ rw_lock_read_lock_with_timeout(rw_lock* lock, uint32 timeoutFlags,
 	int32 oldCount = atomic_add(&lock->count, 1);
 	if (oldCount >= RW_LOCK_WRITER_COUNT_BASE)
 		return _rw_lock_read_lock_with_timeout(lock, timeoutFlags, timeout);
+	RW_LOCK_STATISTICS_READ_ACQUIRED(lock);
 	return B_OK;
 #endif
 }
@@ -244,6 +317,10 @@ mutex_lock(mutex* lock)
 {
 	if (atomic_add(&lock->count, -1) < 0)
 		return _mutex_lock(lock, NULL);
+#if KERNEL_MUTEX_SPINNING
+	lock->holder = find_thread(NULL);
+#endif
+	MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 	return B_OK;
 }
 
@@ -253,6 +330,10 @@ mutex_trylock(mutex* lock)
 {
 	if (atomic_test_and_set(&lock->count, -1, 0) != 0)
 		return B_WOULD_BLOCK;
+#if KERNEL_MUTEX_SPINNING
+	lock->holder = find_thread(NULL);
+#endif
+	MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 	return B_OK;
 }
 
@@ -262,6 +343,10 @@ mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 {
 	if (atomic_add(&lock->count, -1) < 0)
 		return _mutex_lock_with_timeout(lock, timeoutFlags, timeout);
+#if KERNEL_MUTEX_SPINNING
+	lock->holder = find_thread(NULL);
+#endif
+	MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 	return B_OK;
 }
 
@@ -269,6 +354,10 @@ mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 static inline void
 mutex_unlock(mutex* lock)
 {
+	MUTEX_STATISTICS_RELEASED(lock);
+#if KERNEL_MUTEX_SPINNING
+	lock->holder = -1;
+#endif
 	if (atomic_add(&lock->count, 1) < -1)
 		_mutex_unlock(lock);
 }
@@ -285,6 +374,9 @@ recursive_lock_transfer_lock(recursive_lock* lock, thread_id thread)
 	mutex_transfer_lock(&lock->lock, thread);
 #else
 	lock->holder = thread;
+#	if KERNEL_MUTEX_SPINNING
+	mutex_transfer_lock(&lock->lock, thread);
+#	endif
 #endif
 }
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_LOCK_STATISTICS_H
+#define _KERNEL_LOCK_STATISTICS_H
+
+
+#include <OS.h>
+
+#include <lock_statistics_defs.h>
+
+#include "kernel_debug_config.h"
+
+
+#if KERNEL_LOCK_STATISTICS
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern bool gLockStatisticsEnabled;
+
+void lock_statistics_acquired(addr_t key, uint32 type, const char* name,
+	bool contended, bigtime_t waitTime);
+	// "key" identifies the lock class: for spinlocks it is the address of
+	// the acquiring code, and "name" may be NULL; for the other types it is
+	// the lock's name, whose contents are compared.
+void lock_statistics_released(addr_t key, uint32 type, bigtime_t holdTime);
+
+status_t lock_statistics_init_post_generic_syscalls(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	// KERNEL_LOCK_STATISTICS
+
+#endif	/* _KERNEL_LOCK_STATISTICS_H */
@@ -57,6 +57,7 @@ public:
 
 	inline	bool		Matches(const CPUSet& mask) const;
 	inline	CPUSet		And(const CPUSet& mask) const;
+	inline	CPUSet		Or(const CPUSet& mask) const;
 
 	inline	bool		IsEmpty() const;
 
@@ -177,6 +178,16 @@ CPUSet::And(const CPUSet& mask) const
 }
 
 
+inline CPUSet
+CPUSet::Or(const CPUSet& mask) const
+{
+	CPUSet orSet;
+	for (int i = 0; i < kArraySize; i++)
+		orSet.fBitmap[i] = fBitmap[i] | mask.fBitmap[i];
+	return orSet;
+}
+
+
 inline bool
 CPUSet::Matches(const CPUSet& mask) const
 {
@@ -203,7 +214,7 @@ CPUSet::IsEmpty() const
 
 // Unless spinlock debug features are enabled, try to inline
 // {acquire,release}_spinlock().
-#if !DEBUG_SPINLOCKS && !B_DEBUG_SPINLOCK_CONTENTION
+#if !DEBUG_SPINLOCKS && !B_DEBUG_SPINLOCK_CONTENTION && !KERNEL_LOCK_STATISTICS
 
 
 static inline bool
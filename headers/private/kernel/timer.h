@@ -15,6 +15,10 @@ extern "C" {
 
 struct kernel_args;
 
+#define B_TIMER_ALLOW_SLACK				0x1000
+	// For one-shot timers: The timer may expire a little later than requested
+	// (at most 1/32 of the timeout), so that it can be coalesced with other
+	// timers.
 #define B_TIMER_REAL_TIME_BASE			0x2000
 	// For an absolute timer the given time is interpreted as a real-time, not
 	// as a system time. Note that setting the real-time clock will cause the
@@ -24,7 +28,8 @@ struct kernel_args;
 	// For add_timer(): Use the timer::schedule_time (absolute time) and
 	// timer::period values instead of the period parameter.
 #define B_TIMER_FLAGS	\
-	(B_TIMER_USE_TIMER_STRUCT_TIMES | B_TIMER_REAL_TIME_BASE)
+	(B_TIMER_USE_TIMER_STRUCT_TIMES | B_TIMER_REAL_TIME_BASE \
+		| B_TIMER_ALLOW_SLACK)
 
 /* Timer info structure */
 struct timer_info {
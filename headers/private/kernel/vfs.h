@@ -188,6 +188,9 @@ status_t	_user_fsync(int fd);
 status_t	_user_flock(int fd, int op);
 status_t	_user_read_stat(int fd, const char *path, bool traverseLink,
 				struct stat *stat, size_t statSize);
+ssize_t		_user_read_dir_stat(int fd, struct dirent *buffer,
+				size_t bufferSize, struct stat *stats, size_t statSize,
+				uint32 maxCount);
 status_t	_user_write_stat(int fd, const char *path, bool traverseLink,
 				const struct stat *stat, size_t statSize, int statMask);
 off_t		_user_seek(int fd, off_t pos, int seekType);
@@ -254,6 +257,10 @@ int			_user_dup2(int ofd, int nfd, int flags);
 status_t	_user_lock_node(int fd);
 status_t	_user_unlock_node(int fd);
 status_t	_user_preallocate(int fd, off_t offset, off_t length);
+ssize_t		_user_copy_file_range(int sourceFD, off_t *sourcePos, int targetFD,
+				off_t *targetPos, size_t length, uint32 flags);
+ssize_t		_user_sendfile(int targetFD, int sourceFD, off_t *sourcePos,
+				size_t length);
 
 /* socket user prototypes (implementation in socket.cpp) */
 int			_user_socket(int family, int type, int protocol);
@@ -185,6 +185,9 @@ public:
 	inline	void				IncrementCopiedPagesCount()
 									{ fCopiedPagesCount++; }
 
+			void				AccountReferencedPage(uint32 generation);
+			uint32				WorkingSetPages(uint32 generation);
+
 	virtual	void				Merge(VMCache* source);
 
 	virtual	status_t			AcquireUnreferencedStoreRef();
@@ -233,6 +236,8 @@ private:
 			bool				_FreePageRange(VMCachePagesTree::Iterator it,
 									page_num_t* toPage, page_num_t* freedPages);
 
+			void				_UpdateWorkingSet(uint32 generation);
+
 private:
 			int32				fRefCount;
 			mutex				fLock;
@@ -243,6 +248,10 @@ private:
 			page_num_t			fWiredPagesCount;
 			uint64				fFaultCount;
 			uint64				fCopiedPagesCount;
+
+			uint32				fWorkingSetGeneration;
+			uint32				fWorkingSetPages;
+			uint32				fReferencedPages;
 };
 
 
@@ -154,6 +154,8 @@ status_t vm_memcpy_from_physical(void* to, phys_addr_t from, size_t length,
 status_t vm_memcpy_to_physical(phys_addr_t to, const void* from, size_t length,
 			bool user);
 void vm_memcpy_physical_page(phys_addr_t to, phys_addr_t from);
+status_t vm_insert_user_pages(void* address, struct vm_page** pages,
+			page_num_t count);
 
 status_t vm_debug_copy_page_memory(team_id teamID, void* unsafeMemory,
 			void* buffer, size_t size, bool copyToUnsafe);
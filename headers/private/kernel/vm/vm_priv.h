@@ -37,6 +37,11 @@ status_t vm_daemon_init(void);
 
 const char *page_state_to_string(int state);
 	// for debugging purposes only
+void vm_get_large_page_stats(int64 *_mapped, int64 *_fallbacks);
+	// for debugging purposes only
+void vm_get_fault_around_stats(uint32 *_windowPages, int64 *_faults,
+	int64 *_pagesMapped);
+	// for debugging purposes only
 
 #ifdef __cplusplus
 }
@@ -152,6 +152,9 @@ public:
 	uint8					_unused : 1;
 
 	uint8					usage_count;
+	uint8					generation;
+								// low bits of the page daemon generation the
+								// page was last found referenced in
 
 	inline void Init(page_num_t pageNumber);
 
@@ -197,6 +200,8 @@ enum {
 #define VM_PAGE_ALLOC_STATE	0x00000007
 #define VM_PAGE_ALLOC_CLEAR	0x00000010
 #define VM_PAGE_ALLOC_BUSY	0x00000020
+#define VM_PAGE_ALLOC_DONT_WAIT	0x00000040
+	// vm_page_allocate_page_run() only: fail instead of waiting for pages
 
 
 inline void
@@ -211,6 +216,7 @@ vm_page::Init(page_num_t pageNumber)
 	accessed = modified = false;
 	_unused = 0;
 	usage_count = 0;
+	generation = 0;
 
 	fWiredCount = 0;
 
@@ -8,12 +8,18 @@
 #include <sys/cdefs.h>
 
 #include <dirent.h>
+#include <stdint.h>
+#include <sys/stat.h>
 
 
 __BEGIN_DECLS
 
 DIR*	__create_dir_struct(int fd);
 
+ssize_t	__read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+			struct stat* stats, uint32_t maxCount);
+struct dirent*	__readdir_stat(DIR* dir, struct stat* stat);
+
 
 __END_DECLS
 
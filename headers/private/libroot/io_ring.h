@@ -0,0 +1,149 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LIBROOT_IO_RING_H
+#define _LIBROOT_IO_RING_H
+
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <OS.h>
+
+#include <io_ring_defs.h>
+
+
+/*!	Userland side of an asynchronous I/O ring.
+
+	Entries are obtained via io_ring_get_sqe(), filled in with one of the
+	io_ring_prep_*() functions, and handed to the kernel with io_ring_submit().
+	The results show up in the completion queue; they can be retrieved with
+	io_ring_peek_cqe() or io_ring_wait_cqe(), and must be released with
+	io_ring_cqe_seen() afterwards.
+	A ring must only be used by one thread at a time, and only by the team that
+	created it.
+*/
+typedef struct io_ring {
+	int					fd;
+	io_ring_header*		header;
+	io_ring_sqe*		sqes;
+	io_ring_cqe*		cqes;
+	uint32				sq_tail;	/* includes entries not yet submitted */
+	uint32				sq_mask;
+	uint32				cq_mask;
+} io_ring;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+status_t		io_ring_init(io_ring* ring, uint32 entries, uint32 workers);
+void			io_ring_exit(io_ring* ring);
+
+io_ring_sqe*	io_ring_get_sqe(io_ring* ring);
+ssize_t			io_ring_submit(io_ring* ring);
+ssize_t			io_ring_submit_and_wait(io_ring* ring, uint32 waitCount,
+					uint32 flags, bigtime_t timeout);
+
+status_t		io_ring_peek_cqe(io_ring* ring, io_ring_cqe** _cqe);
+status_t		io_ring_wait_cqe(io_ring* ring, io_ring_cqe** _cqe);
+void			io_ring_cqe_seen(io_ring* ring, io_ring_cqe* cqe);
+
+
+static inline void
+io_ring_prep_rw(io_ring_sqe* sqe, uint8 opcode, int fd, const void* address,
+	uint64 length, off_t offset)
+{
+	memset(sqe, 0, sizeof(io_ring_sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->offset = offset;
+	sqe->address = (addr_t)address;
+	sqe->length = length;
+}
+
+
+static inline void
+io_ring_prep_nop(io_ring_sqe* sqe)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_NOP, -1, NULL, 0, -1);
+}
+
+
+static inline void
+io_ring_prep_read(io_ring_sqe* sqe, int fd, void* buffer, size_t length,
+	off_t offset)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_READ, fd, buffer, length, offset);
+}
+
+
+static inline void
+io_ring_prep_write(io_ring_sqe* sqe, int fd, const void* buffer,
+	size_t length, off_t offset)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_WRITE, fd, buffer, length, offset);
+}
+
+
+static inline void
+io_ring_prep_readv(io_ring_sqe* sqe, int fd, const struct iovec* vecs,
+	size_t count, off_t offset)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_READV, fd, vecs, count, offset);
+}
+
+
+static inline void
+io_ring_prep_writev(io_ring_sqe* sqe, int fd, const struct iovec* vecs,
+	size_t count, off_t offset)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_WRITEV, fd, vecs, count, offset);
+}
+
+
+static inline void
+io_ring_prep_fsync(io_ring_sqe* sqe, int fd)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_FSYNC, fd, NULL, 0, -1);
+}
+
+
+static inline void
+io_ring_prep_accept(io_ring_sqe* sqe, int fd, struct sockaddr* address,
+	socklen_t* _addressLength, int flags)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_ACCEPT, fd, address, 0, -1);
+	sqe->address_length = (addr_t)_addressLength;
+	sqe->flags = flags;
+}
+
+
+static inline void
+io_ring_prep_send(io_ring_sqe* sqe, int fd, const void* buffer,
+	size_t length, int flags)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_SEND, fd, buffer, length, -1);
+	sqe->flags = flags;
+}
+
+
+static inline void
+io_ring_prep_recv(io_ring_sqe* sqe, int fd, void* buffer, size_t length,
+	int flags)
+{
+	io_ring_prep_rw(sqe, IO_RING_OP_RECV, fd, buffer, length, -1);
+	sqe->flags = flags;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _LIBROOT_IO_RING_H */
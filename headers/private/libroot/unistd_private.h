@@ -8,6 +8,7 @@
 
 #include <sys/cdefs.h>
 #include <sys/times.h>
+#include <sys/types.h>
 
 
 __BEGIN_DECLS
@@ -16,6 +17,11 @@ __BEGIN_DECLS
 long	__sysconf_beos(int name);
 long	__sysconf(int name);
 
+ssize_t	__copy_file_range(int sourceFD, off_t* sourcePos, int targetFD,
+			off_t* targetPos, size_t length, unsigned int flags);
+ssize_t	__sendfile(int targetFD, int sourceFD, off_t* sourcePos,
+			size_t length);
+
 
 __END_DECLS
 
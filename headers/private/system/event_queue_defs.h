@@ -23,4 +23,22 @@ typedef struct event_wait_info {
 } event_wait_info;
 
 
+// operations for event_queue_change::operation
+enum {
+	EVENT_QUEUE_CHANGE_ADD		= 1,	/* fails, if the object is already selected */
+	EVENT_QUEUE_CHANGE_MODIFY	= 2,	/* selects, replacing a previous selection */
+	EVENT_QUEUE_CHANGE_DELETE	= 3
+};
+
+
+typedef struct event_queue_change {
+	int32		object;
+	uint16		type;
+	uint16		operation;
+	int32		events;		/* for adding and modifying, must be > 0 */
+	status_t	status;		/* out: the result of the change */
+	void*		user_data;
+} event_queue_change;
+
+
 #endif	/* _SYSTEM_EVENT_QUEUE_DEFS_H */
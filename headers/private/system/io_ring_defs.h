@@ -0,0 +1,94 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_IO_RING_DEFS_H
+#define _SYSTEM_IO_RING_DEFS_H
+
+
+#include <SupportDefs.h>
+
+
+#define IO_RING_MAX_ENTRIES		4096
+#define IO_RING_MAX_WORKERS		64
+#define IO_RING_DEFAULT_WORKERS	4
+
+
+// operations for io_ring_sqe::opcode
+enum {
+	IO_RING_OP_NOP		= 0,
+	IO_RING_OP_READ,		/* address: buffer, length: buffer size */
+	IO_RING_OP_WRITE,		/* address: buffer, length: buffer size */
+	IO_RING_OP_READV,		/* address: iovec array, length: vector count */
+	IO_RING_OP_WRITEV,		/* address: iovec array, length: vector count */
+	IO_RING_OP_FSYNC,
+	IO_RING_OP_ACCEPT,		/* address: sockaddr, address_length: socklen_t*,
+							   flags: accept4() flags */
+	IO_RING_OP_SEND,		/* address: buffer, length: buffer size,
+							   flags: send() flags */
+	IO_RING_OP_RECV,		/* address: buffer, length: buffer size,
+							   flags: recv() flags */
+
+	IO_RING_OP_COUNT
+};
+
+
+/*!	A submission queue entry. All pointers are passed as 64 bit values, so
+	that the layout is the same for all architectures.
+*/
+typedef struct io_ring_sqe {
+	int32		fd;
+	uint8		opcode;
+	uint8		_reserved0;
+	uint16		_reserved1;
+	int64		offset;			/* -1 to use the current file position */
+	uint64		address;
+	uint64		length;
+	uint64		address_length;
+	int32		flags;
+	uint32		_reserved2;
+	uint64		user_data;		/* passed through to the completion */
+} io_ring_sqe;
+
+/*!	A completion queue entry. */
+typedef struct io_ring_cqe {
+	uint64		user_data;
+	int64		result;			/* the return value of the operation */
+} io_ring_cqe;
+
+
+/*!	Indices of one of the queues. For the submission queue, userland owns the
+	tail and the kernel the head; for the completion queue it is the other way
+	around. The indices run freely and are masked to get the array index.
+*/
+typedef struct io_ring_queue {
+	uint32		head;
+	uint32		tail;
+	uint32		mask;
+	uint32		entries;
+	uint32		overflow;		/* completion queue only: dropped entries */
+	uint32		_reserved[11];
+} io_ring_queue;
+
+/*!	The beginning of the memory shared between kernel and userland. It is
+	followed by the submission queue entries, and then the completion queue
+	entries, at the offsets given in io_ring_params.
+*/
+typedef struct io_ring_header {
+	io_ring_queue	sq;
+	io_ring_queue	cq;
+} io_ring_header;
+
+
+typedef struct io_ring_params {
+	uint32		workers;		/* in: number of worker threads, 0 for default */
+	uint32		sq_entries;		/* out */
+	uint32		cq_entries;		/* out */
+	uint32		sqes_offset;	/* out */
+	uint32		cqes_offset;	/* out */
+	area_id		area;			/* out: the shared memory, already mapped */
+	void*		address;		/* out */
+} io_ring_params;
+
+
+#endif	/* _SYSTEM_IO_RING_DEFS_H */
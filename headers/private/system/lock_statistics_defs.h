@@ -0,0 +1,58 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_LOCK_STATISTICS_DEFS_H
+#define _SYSTEM_LOCK_STATISTICS_DEFS_H
+
+
+#include <OS.h>
+
+
+// generic syscall interface
+#define LOCK_STATISTICS						"lock statistics"
+
+#define LOCK_STATISTICS_GET					0x01
+#define LOCK_STATISTICS_RESET				0x02
+#define LOCK_STATISTICS_ENABLE				0x03
+#define LOCK_STATISTICS_DISABLE				0x04
+
+
+enum {
+	LOCK_STATISTICS_TYPE_MUTEX				= 0,
+	LOCK_STATISTICS_TYPE_RW_LOCK			= 1,
+	LOCK_STATISTICS_TYPE_SPINLOCK			= 2
+};
+
+#define LOCK_STATISTICS_NAME_LENGTH			64
+
+
+typedef struct lock_class_info {
+	char		name[LOCK_STATISTICS_NAME_LENGTH];
+					// the lock name, for spinlocks the acquiring function
+	uint32		type;
+	uint32		_reserved;
+	int64		acquisitions;
+	int64		contended;
+	bigtime_t	total_wait_time;
+	bigtime_t	max_wait_time;
+	bigtime_t	total_hold_time;
+	bigtime_t	max_hold_time;
+					// hold times are only tracked for exclusive holders of
+					// mutexes and rw_locks
+} lock_class_info;
+
+typedef struct lock_statistics_request {
+	lock_class_info*	classes;
+	uint32				class_count;
+							// in: size of the classes array, out: number of
+							// entries filled in
+	uint32				total_class_count;
+	int64				dropped;
+							// number of events that were not accounted,
+							// because the class table was full
+	bool				enabled;
+} lock_statistics_request;
+
+
+#endif	/* _SYSTEM_LOCK_STATISTICS_DEFS_H */
@@ -23,11 +23,13 @@ extern "C" {
 
 struct attr_info;
 struct dirent;
+struct event_queue_change;
 struct event_wait_info;
 struct fd_info;
 struct fd_set;
 struct fs_info;
 struct iovec;
+struct io_ring_params;
 struct loadavg;
 struct msqid_ds;
 struct net_stat;
@@ -81,6 +83,16 @@ extern status_t		_kern_event_queue_select(int queue,
 						struct event_wait_info* userInfos, int numInfos);
 extern ssize_t		_kern_event_queue_wait(int queue, struct event_wait_info* infos,
 						int numInfos, uint32 flags, bigtime_t timeout);
+extern ssize_t		_kern_event_queue_submit(int queue,
+						struct event_queue_change* changes, int numChanges,
+						struct event_wait_info* infos, int numInfos,
+						uint32 flags, bigtime_t timeout,
+						const sigset_t* sigMask);
+
+extern int			_kern_io_ring_create(uint32 entries,
+						struct io_ring_params* params);
+extern ssize_t		_kern_io_ring_enter(int ring, uint32 toSubmit,
+						uint32 minComplete, uint32 flags, bigtime_t timeout);
 
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
@@ -213,6 +225,9 @@ extern bigtime_t	_kern_estimate_max_scheduling_latency(thread_id thread);
 
 extern status_t		_kern_set_scheduler_mode(int32 mode);
 extern int32		_kern_get_scheduler_mode(void);
+extern status_t		_kern_set_thread_deadline(thread_id thread,
+						bigtime_t runtime, bigtime_t deadline,
+						bigtime_t period);
 extern status_t		_kern_get_loadavg(struct loadavg* info, size_t size);
 
 // user/group functions
@@ -344,6 +359,9 @@ extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 extern status_t		_kern_rewind_dir(int fd);
 extern status_t		_kern_read_stat(int fd, const char *path, bool traverseLink,
 						struct stat *stat, size_t statSize);
+extern ssize_t		_kern_read_dir_stat(int fd, struct dirent *buffer,
+						size_t bufferSize, struct stat *stats, size_t statSize,
+						uint32 maxCount);
 extern status_t		_kern_write_stat(int fd, const char *path,
 						bool traverseLink, const struct stat *stat,
 						size_t statSize, int statMask);
@@ -355,6 +373,11 @@ extern status_t		_kern_unlock_node(int fd);
 extern status_t		_kern_get_next_fd_info(team_id team, uint32 *_cookie,
 						struct fd_info *info, size_t infoSize);
 extern status_t		_kern_preallocate(int fd, off_t offset, off_t length);
+extern ssize_t		_kern_copy_file_range(int sourceFD, off_t *sourcePos,
+						int targetFD, off_t *targetPos, size_t length,
+						uint32 flags);
+extern ssize_t		_kern_sendfile(int targetFD, int sourceFD, off_t *sourcePos,
+						size_t length);
 
 // socket functions
 extern int			_kern_socket(int family, int type, int protocol);
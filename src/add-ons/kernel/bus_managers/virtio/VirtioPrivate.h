@@ -154,6 +154,7 @@ private:
 			struct vring		fRing;
 			uint16				fRingHeadIndex;
 			uint16				fRingUsedIndex;
+			uint16				fNotifiedIndex;
 			status_t			fStatus;
 			size_t 				fAreaSize;
 			area_id				fArea;
@@ -142,6 +142,7 @@ VirtioQueue::VirtioQueue(VirtioDevice* device, uint16 queueNumber,
 	fRingFree(ringSize),
 	fRingHeadIndex(0),
 	fRingUsedIndex(0),
+	fNotifiedIndex(0),
 	fStatus(B_OK),
 	fIndirectMaxSize(0),
 	fCallback(NULL),
@@ -212,6 +213,8 @@ VirtioQueue::SetupInterrupt(virtio_callback_func handler, void *cookie)
 void
 VirtioQueue::DisableInterrupt()
 {
+	// With event indices, the host only interrupts us when it passes the
+	// used event index, which we only move forward in EnableInterrupt().
 	if ((fDevice->Features() & VIRTIO_FEATURE_RING_EVENT_IDX) == 0)
 		fRing.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
 }
@@ -220,14 +223,33 @@ VirtioQueue::DisableInterrupt()
 void
 VirtioQueue::EnableInterrupt()
 {
-	if ((fDevice->Features() & VIRTIO_FEATURE_RING_EVENT_IDX) == 0)
+	if ((fDevice->Features() & VIRTIO_FEATURE_RING_EVENT_IDX) != 0) {
+		// ask for an interrupt as soon as the next buffer is used
+		vring_used_event(&fRing) = fRingUsedIndex;
+	} else
 		fRing.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+
+	memory_full_barrier();
 }
 
 
+/*!	Notifies the host about new available buffers, unless it told us that it
+	doesn't need to be notified, as it is still processing the ring anyway.
+*/
 void
 VirtioQueue::NotifyHost()
 {
+	uint16 available = fRing.avail->idx;
+	memory_full_barrier();
+
+	if ((fDevice->Features() & VIRTIO_FEATURE_RING_EVENT_IDX) != 0) {
+		uint16 previous = fNotifiedIndex;
+		fNotifiedIndex = available;
+		if (!vring_need_event(vring_avail_event(&fRing), available, previous))
+			return;
+	} else if ((fRing.used->flags & VRING_USED_F_NO_NOTIFY) != 0)
+		return;
+
 	fDevice->NotifyQueue(fQueueNumber);
 }
 
@@ -239,10 +261,21 @@ VirtioQueue::Interrupt()
 
 	DisableInterrupt();
 
-	if (fCallback != NULL)
-		fCallback(Device()->DriverCookie(), fCookie);
+	if (fCallback != NULL) {
+		while (true) {
+			fCallback(Device()->DriverCookie(), fCookie);
+
+			// Buffers that were used after the callback returned, but before
+			// interrupts were enabled again, would not cause an interrupt.
+			EnableInterrupt();
+			if (fRingUsedIndex == fRing.used->idx)
+				break;
+
+			DisableInterrupt();
+		}
+	} else
+		EnableInterrupt();
 
-	EnableInterrupt();
 	return B_OK;
 }
 
@@ -378,9 +378,10 @@ virtio_device_negotiate_features(virtio_device cookie, uint64 supported,
 	virtio_dump_features("read features", features, get_feature_name);
 	features &= supported;
 
-	// filter our own features
+	// filter our own features; event indices are not implemented by our
+	// queues
 	features &= (VIRTIO_FEATURE_TRANSPORT_MASK
-		| VIRTIO_FEATURE_RING_INDIRECT_DESC | VIRTIO_FEATURE_RING_EVENT_IDX);
+		| VIRTIO_FEATURE_RING_INDIRECT_DESC);
 	*negotiated = features;
 
 	virtio_dump_features("negotiated features", features, get_feature_name);
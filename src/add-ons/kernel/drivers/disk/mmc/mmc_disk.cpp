@@ -27,6 +27,8 @@
 
 #include <AutoDeleter.h>
 
+#include "IOSchedulerRoster.h"
+
 
 #define TRACE_MMC_DISK
 #ifdef TRACE_MMC_DISK
@@ -263,18 +265,22 @@ mmc_disk_init_driver(device_node* node, void** cookie)
 		return error;
 	}
 
-	info->scheduler = new(std::nothrow) IOSchedulerSimple(info->dmaResource);
-	if (info->scheduler == NULL) {
-		TRACE("Failed to allocate scheduler");
+	// The device ID is needed to name the I/O scheduler, so it is already
+	// picked here rather than when the device is published.
+	int32 id = sDeviceManager->create_id(MMC_DEVICE_ID_GENERATOR);
+	if (id < 0) {
 		delete info->dmaResource;
 		free(info);
-		return B_NO_MEMORY;
+		return id;
 	}
 
-	error = info->scheduler->Init("mmc storage");
+	snprintf(info->name, sizeof(info->name), "disk/mmc/%" B_PRId32 "/raw", id);
+
+	error = IOSchedulerRoster::Default()->CreateScheduler(info->dmaResource,
+		info->name, 0, info->scheduler);
 	if (error != B_OK) {
-		TRACE("Failed to init scheduler");
-		delete info->scheduler;
+		TRACE("Failed to create scheduler");
+		sDeviceManager->free_id(MMC_DEVICE_ID_GENERATOR, id);
 		delete info->dmaResource;
 		free(info);
 		return error;
@@ -306,19 +312,9 @@ mmc_disk_register_child_devices(void* _cookie)
 {
 	CALLED();
 	mmc_disk_driver_info* info = (mmc_disk_driver_info*)_cookie;
-	status_t status;
 
-	int32 id = sDeviceManager->create_id(MMC_DEVICE_ID_GENERATOR);
-	if (id < 0)
-		return id;
-
-	char name[64];
-	snprintf(name, sizeof(name), "disk/mmc/%" B_PRId32 "/raw", id);
-
-	status = sDeviceManager->publish_device(info->node, name,
+	return sDeviceManager->publish_device(info->node, info->name,
 		MMC_DISK_DEVICE_MODULE_NAME);
-
-	return status;
 }
 
 
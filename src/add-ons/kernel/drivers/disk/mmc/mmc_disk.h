@@ -17,7 +17,7 @@
 
 #include <mmc.h>
 
-#include "IOSchedulerSimple.h"
+#include "IOScheduler.h"
 
 
 enum MMCDiskFlags {
@@ -34,6 +34,8 @@ typedef struct {
 	mmc_device_interface* mmc;
 	uint16_t rca;
 	uint32_t flags;
+	char name[64];
+		// the published device path, also names the I/O scheduler
 
 	device_geometry geometry;
 
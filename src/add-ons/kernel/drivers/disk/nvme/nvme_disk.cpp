@@ -13,6 +13,8 @@
 #include <algorithm>
 #include <condition_variable.h>
 #include <AutoDeleter.h>
+#include <cpu.h>
+#include <driver_settings.h>
 #include <kernel.h>
 #include <smp.h>
 #include <util/AutoLock.h>
@@ -72,6 +74,26 @@ static const uint8 kDriveIcon[] = {
 #define NVME_DISK_DEVICE_ID_GENERATOR	"nvme_disk/device_id"
 
 #define NVME_MAX_QPAIRS					(16)
+#define NVME_MAX_DEVICES				(16)
+
+// Defaults for the "nvme_disk" driver settings:
+//	interrupt_coalescing_time <us>
+//		Time the controller may delay an interrupt to aggregate completions,
+//		in 100 us steps. 0 disables coalescing.
+//	interrupt_coalescing_threshold <count>
+//		Number of completions after which an interrupt is triggered anyway.
+//	polling_max_size <bytes>
+//		Requests up to this size poll for their completion on the qpair they
+//		were submitted to before waiting for an interrupt. 0 disables
+//		polling.
+//	polling_time <us>
+//		How long to poll before falling back to waiting for an interrupt.
+#define NVME_DEFAULT_COALESCING_TIME		0
+#define NVME_DEFAULT_COALESCING_THRESHOLD	0
+#define NVME_DEFAULT_POLLING_MAX_SIZE		(16 * 1024)
+#define NVME_DEFAULT_POLLING_TIME			50
+
+#define NVME_MIN_POLLING_SLEEP_TIME			20
 
 
 static device_manager_info* sDeviceManager;
@@ -96,14 +118,26 @@ typedef struct {
 	ConditionVariable		interrupt;
 	int32					polling;
 
+	uint32					polling_max_size;
+	bigtime_t				polling_time;
+
 	struct qpair_info {
 		struct nvme_qpair*	qpair;
+		bigtime_t			poll_latency;
+			// moving average of the completion time of polled requests
+		int64				polled_completions;
+		int64				interrupt_completions;
 	}						qpairs[NVME_MAX_QPAIRS];
 	uint32					qpair_count;
 } nvme_disk_driver_info;
 typedef nvme_disk_driver_info::qpair_info qpair_info;
 
 
+static mutex sDevicesLock = MUTEX_INITIALIZER("nvme_disk devices");
+static nvme_disk_driver_info* sDevices[NVME_MAX_DEVICES];
+static int32 sDeviceCount;
+
+
 typedef struct {
 	nvme_disk_driver_info*		info;
 } nvme_disk_handle;
@@ -144,6 +178,102 @@ nvme_disk_set_capacity(nvme_disk_driver_info* info, uint64 capacity,
 }
 
 
+static void
+nvme_disk_load_settings(nvme_disk_driver_info* info, uint32& coalescingTime,
+	uint32& coalescingThreshold)
+{
+	coalescingTime = NVME_DEFAULT_COALESCING_TIME;
+	coalescingThreshold = NVME_DEFAULT_COALESCING_THRESHOLD;
+	info->polling_max_size = NVME_DEFAULT_POLLING_MAX_SIZE;
+	info->polling_time = NVME_DEFAULT_POLLING_TIME;
+
+	void* settings = load_driver_settings("nvme_disk");
+	if (settings == NULL)
+		return;
+
+	const char* value = get_driver_parameter(settings,
+		"interrupt_coalescing_time", NULL, NULL);
+	if (value != NULL)
+		coalescingTime = strtoul(value, NULL, 0);
+
+	value = get_driver_parameter(settings, "interrupt_coalescing_threshold",
+		NULL, NULL);
+	if (value != NULL)
+		coalescingThreshold = strtoul(value, NULL, 0);
+
+	value = get_driver_parameter(settings, "polling_max_size", NULL, NULL);
+	if (value != NULL)
+		info->polling_max_size = strtoul(value, NULL, 0);
+
+	value = get_driver_parameter(settings, "polling_time", NULL, NULL);
+	if (value != NULL)
+		info->polling_time = strtoul(value, NULL, 0);
+
+	unload_driver_settings(settings);
+}
+
+
+static int
+dump_nvme_qpairs(int argc, char** argv)
+{
+	for (int32 i = 0; i < NVME_MAX_DEVICES; i++) {
+		nvme_disk_driver_info* info = sDevices[i];
+		if (info == NULL)
+			continue;
+
+		kprintf("NVMe disk %p: polling up to %" B_PRIu32 " bytes for %"
+			B_PRId64 " us\n", info, info->polling_max_size,
+			info->polling_time);
+		kprintf("  qpair      polled  interrupted  poll latency\n");
+
+		for (uint32 k = 0; k < info->qpair_count; k++) {
+			const qpair_info& qpinfo = info->qpairs[k];
+			kprintf("  %5" B_PRIu32 " %11" B_PRId64 " %12" B_PRId64 " %10"
+				B_PRId64 " us\n", k, qpinfo.polled_completions,
+				qpinfo.interrupt_completions, qpinfo.poll_latency);
+		}
+	}
+
+	return 0;
+}
+
+
+static void
+nvme_disk_add_device(nvme_disk_driver_info* info)
+{
+	MutexLocker _(sDevicesLock);
+
+	for (int32 i = 0; i < NVME_MAX_DEVICES; i++) {
+		if (sDevices[i] != NULL)
+			continue;
+
+		sDevices[i] = info;
+		if (sDeviceCount++ == 0) {
+			add_debugger_command("nvme_qpairs", &dump_nvme_qpairs,
+				"Dump the completion counters of all NVMe qpairs");
+		}
+		return;
+	}
+}
+
+
+static void
+nvme_disk_remove_device(nvme_disk_driver_info* info)
+{
+	MutexLocker _(sDevicesLock);
+
+	for (int32 i = 0; i < NVME_MAX_DEVICES; i++) {
+		if (sDevices[i] != info)
+			continue;
+
+		sDevices[i] = NULL;
+		if (--sDeviceCount == 0)
+			remove_debugger_command("nvme_qpairs", &dump_nvme_qpairs);
+		return;
+	}
+}
+
+
 //	#pragma mark - device module API
 
 
@@ -263,10 +393,25 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	info->interrupt.Init(info, "nvme_disk interrupt");
 	install_io_interrupt_handler(irq, nvme_interrupt_handler, (void*)info, B_NO_HANDLED_INFO);
 
+	uint32 coalescingTime, coalescingThreshold;
+	nvme_disk_load_settings(info, coalescingTime, coalescingThreshold);
+
 	if (info->ctrlr->feature_supported[NVME_FEAT_INTERRUPT_COALESCING]) {
-		uint32 microseconds = 16, threshold = 32;
-		nvme_ctrlr_set_feature(info->ctrlr, false, NVME_FEAT_INTERRUPT_COALESCING,
-			((microseconds / 100) << 8) | threshold, 0, NULL, 0, NULL);
+		// The aggregation time is specified in 100 us steps, the threshold is
+		// 0's based.
+		uint32 time = min_c(coalescingTime / 100, 0xff);
+		uint32 threshold = min_c(max_c(coalescingThreshold, 1) - 1, 0xff);
+		if (time == 0)
+			threshold = 0;
+
+		if (nvme_ctrlr_set_feature(info->ctrlr, false,
+				NVME_FEAT_INTERRUPT_COALESCING, (time << 8) | threshold, 0,
+				NULL, 0, NULL) != 0) {
+			TRACE_ERROR("failed to set interrupt coalescing!\n");
+		} else if (time != 0) {
+			TRACE_ALWAYS("\tinterrupt coalescing: %" B_PRIu32 " us, %" B_PRIu32
+				" completions\n", time * 100, threshold + 1);
+		}
 	}
 
 	if (info->ctrlr->feature_supported[NVME_FEAT_AUTONOMOUS_POWER_STATE_TRANSITION]) {
@@ -355,6 +500,9 @@ nvme_disk_init_device(void* _info, void** _cookie)
 		if (info->qpairs[i].qpair == NULL)
 			break;
 
+		info->qpairs[i].poll_latency = 0;
+		info->qpairs[i].polled_completions = 0;
+		info->qpairs[i].interrupt_completions = 0;
 		info->qpair_count++;
 	}
 	if (info->qpair_count == 0) {
@@ -395,6 +543,8 @@ nvme_disk_init_device(void* _info, void** _cookie)
 	// set up rounded-write lock
 	rw_lock_init(&info->rounded_write_lock, "nvme rounded writes");
 
+	nvme_disk_add_device(info);
+
 	*_cookie = info;
 	return B_OK;
 }
@@ -406,6 +556,8 @@ nvme_disk_uninit_device(void* _cookie)
 	CALLED();
 	nvme_disk_driver_info* info = (nvme_disk_driver_info*)_cookie;
 
+	nvme_disk_remove_device(info);
+
 	remove_io_interrupt_handler(info->info.u.h0.interrupt_line,
 		nvme_interrupt_handler, (void*)info);
 
@@ -485,11 +637,57 @@ io_finished_callback(status_t* status, const struct nvme_cpl* cpl)
 }
 
 
+/*!	Hybrid polling: sleeps for half of the average completion time of the
+	qpair first, and then polls it until the request is done, or the
+	polling time has passed. Returns \c false in the latter case.
+*/
+static bool
+poll_status(nvme_disk_driver_info* info, qpair_info* qpinfo, status_t& status)
+{
+	bigtime_t start = system_time();
+
+	bigtime_t sleepTime = atomic_get64(&qpinfo->poll_latency) / 2;
+	if (sleepTime >= NVME_MIN_POLLING_SLEEP_TIME)
+		snooze(sleepTime);
+
+	bigtime_t timeout = start + info->polling_time;
+	while (true) {
+		nvme_qpair_poll(qpinfo->qpair, 0);
+		if (status != EINPROGRESS)
+			break;
+
+		if (system_time() >= timeout)
+			return false;
+
+		cpu_pause();
+	}
+
+	// several requests may be polled on the same qpair at the same time
+	bigtime_t latency = system_time() - start;
+	bigtime_t average = atomic_get64(&qpinfo->poll_latency);
+	while (true) {
+		bigtime_t previous = atomic_test_and_set64(&qpinfo->poll_latency,
+			(average * 7 + latency) / 8, average);
+		if (previous == average)
+			break;
+		average = previous;
+	}
+	return true;
+}
+
+
 static void
-await_status(nvme_disk_driver_info* info, struct nvme_qpair* qpair, status_t& status)
+await_status(nvme_disk_driver_info* info, qpair_info* qpinfo, status_t& status,
+	bool poll = false)
 {
 	CALLED();
 
+	if (poll && info->polling_time > 0 && poll_status(info, qpinfo, status)) {
+		atomic_add64(&qpinfo->polled_completions, 1);
+		return;
+	}
+
+	struct nvme_qpair* qpair = qpinfo->qpair;
 	ConditionVariableEntry entry;
 	int timeouts = 0;
 	while (status == EINPROGRESS) {
@@ -498,7 +696,7 @@ await_status(nvme_disk_driver_info* info, struct nvme_qpair* qpair, status_t& st
 		nvme_qpair_poll(qpair, 0);
 
 		if (status != EINPROGRESS)
-			return;
+			break;
 
 		if (info->polling > 0) {
 			entry.Wait(B_RELATIVE_TIMEOUT, min_c(5 * 1000 * 1000,
@@ -525,6 +723,8 @@ await_status(nvme_disk_driver_info* info, struct nvme_qpair* qpair, status_t& st
 
 		nvme_qpair_poll(qpair, 0);
 	}
+
+	atomic_add64(&qpinfo->interrupt_completions, 1);
 }
 
 
@@ -605,7 +805,10 @@ do_nvme_io_request(nvme_disk_driver_info* info, nvme_io_request* request)
 		return ret;
 	}
 
-	await_status(info, qpinfo->qpair, request->status);
+	// latency sensitive requests poll for their completion
+	bool poll = request->lba_count * info->block_size
+		<= info->polling_max_size;
+	await_status(info, qpinfo, request->status, poll);
 
 	if (request->status != B_OK) {
 		TRACE_ERROR("%s at LBA %" B_PRIdOFF " of %" B_PRIuSIZE
@@ -918,7 +1121,7 @@ nvme_disk_flush(nvme_disk_driver_info* info)
 	if (ret != 0)
 		return ret;
 
-	await_status(info, qpinfo->qpair, status);
+	await_status(info, qpinfo, status);
 	return status;
 }
 
@@ -985,7 +1188,7 @@ nvme_disk_trim(nvme_disk_driver_info* info, fs_trim_data* trimData)
 			(nvme_cmd_cb)io_finished_callback, &status) != 0)
 		return B_IO_ERROR;
 
-	await_status(info, qpair->qpair, status);
+	await_status(info, qpair, status);
 	if (status != B_OK)
 		return status;
 
@@ -29,7 +29,7 @@
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_SCSI_DISK
@@ -426,15 +426,15 @@ das_set_capacity(das_driver_info* info, uint64 capacity, uint32 blockSize, uint3
 		if (status != B_OK)
 			panic("initializing DMAResource failed: %s", strerror(status));
 
-		info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-			info->dma_resource);
-		if (info->io_scheduler == NULL)
-			panic("allocating IOScheduler failed.");
+		char* name = sSCSIPeripheral->compose_device_name(info->node,
+			"disk/scsi");
+		MemoryDeleter nameDeleter(name);
 
-		// TODO: use whole device name here
-		status = info->io_scheduler->Init("scsi");
+		status = IOSchedulerRoster::Default()->CreateScheduler(
+			info->dma_resource, name != NULL ? name : "scsi", 0,
+			info->io_scheduler);
 		if (status != B_OK)
-			panic("initializing IOScheduler failed: %s", strerror(status));
+			panic("creating IOScheduler failed: %s", strerror(status));
 
 		info->io_scheduler->SetCallback(do_io, info);
 	}
@@ -33,7 +33,7 @@
 #include "cache_support.h"
 #include "dma_resources.h"
 #include "io_requests.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_RAM_DISK
@@ -353,13 +353,8 @@ struct RawDevice : Device, DoublyLinkedListLinkImpl<RawDevice> {
 			return error;
 		}
 
-		fIOScheduler = new(std::nothrow) IOSchedulerSimple(fDMAResource);
-		if (fIOScheduler == NULL) {
-			Unprepare();
-			return B_NO_MEMORY;
-		}
-
-		error = fIOScheduler->Init("ram disk device scheduler");
+		error = IOSchedulerRoster::Default()->CreateScheduler(fDMAResource,
+			fDeviceName, 0, fIOScheduler);
 		if (error != B_OK) {
 			Unprepare();
 			return error;
@@ -6,6 +6,7 @@
 
 #include <condition_variable.h>
 #include <lock.h>
+#include <smp.h>
 #include <StackOrHeapArray.h>
 #include <util/AutoLock.h>
 #include <virtio.h>
@@ -14,6 +15,7 @@
 
 
 class DMAResource;
+class IOOperation;
 class IOScheduler;
 
 
@@ -49,11 +51,47 @@ static const uint8 kDriveIcon[] = {
 #define VIRTIO_BLOCK_DEVICE_ID_GENERATOR	"virtio_block/device_id"
 
 
+#define VIRTIO_BLOCK_MAX_QUEUES		VIRTIO_VIRTQUEUES_MAX_COUNT
+
+
+// The part of a request the device accesses; they all live in the command
+// buffer.
+typedef struct {
+	struct virtio_blk_outhdr	header;
+	uint8					status;
+	uint8					_reserved[15];
+} virtio_block_request_buffer;
+
+#define VIRTIO_BLOCK_REQUEST_COUNT	\
+	(B_PAGE_SIZE / sizeof(virtio_block_request_buffer))
+
+
+typedef struct virtio_block_request {
+	IOOperation*			operation;
+	virtio_block_request_buffer* buffer;
+	phys_addr_t				buffer_physical_address;
+	virtio_block_request*	next;
+} virtio_block_request;
+
+
+struct virtio_block_driver_info;
+
 typedef struct {
+	virtio_block_driver_info*	info;
+	::virtio_queue			virtio_queue;
+	spinlock				lock;
+} virtio_block_queue;
+
+
+typedef struct virtio_block_driver_info {
 	device_node*			node;
+	char					name[64];
+		// the published device path, also names the I/O scheduler
 	::virtio_device			virtio_device;
 	virtio_device_interface*	virtio;
-	::virtio_queue			virtio_queue;
+	virtio_block_queue		queues[VIRTIO_BLOCK_MAX_QUEUES];
+	uint32					queue_count;
+	int32					next_queue;
 	IOScheduler*			io_scheduler;
 	DMAResource*			dma_resource;
 
@@ -69,9 +107,11 @@ typedef struct {
 	uint32					physical_block_size;
 	status_t				media_status;
 
-	mutex					lock;
-	int32					currentRequest;
-	ConditionVariable		interruptCondition;
+	spinlock				request_lock;
+	virtio_block_request*	free_requests;
+	virtio_block_request	requests[VIRTIO_BLOCK_REQUEST_COUNT];
+	ConditionVariable		request_condition;
+		// notified whenever a request completes
 } virtio_block_driver_info;
 
 
@@ -80,6 +120,7 @@ typedef struct {
 } virtio_block_handle;
 
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -88,7 +129,7 @@ typedef struct {
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerRoster.h"
 
 
 //#define TRACE_VIRTIO_BLOCK
@@ -131,6 +172,8 @@ get_feature_name(uint64 feature)
 			return "topology";
 		case VIRTIO_BLK_F_CONFIG_WCE:
 			return "config wce";
+		case VIRTIO_BLK_F_MQ:
+			return "multiqueue";
 	}
 	return NULL;
 }
@@ -174,81 +217,157 @@ virtio_block_config_callback(void* driverCookie)
 }
 
 
+/*!	Returns a free request, waiting for one to become available if
+	necessary.
+*/
+static virtio_block_request*
+get_request(virtio_block_driver_info* info)
+{
+	InterruptsSpinLocker locker(info->request_lock);
+
+	while (info->free_requests == NULL) {
+		ConditionVariableEntry entry;
+		info->request_condition.Add(&entry);
+
+		locker.Unlock();
+		entry.Wait();
+		locker.Lock();
+	}
+
+	virtio_block_request* request = info->free_requests;
+	info->free_requests = request->next;
+	return request;
+}
+
+
+static void
+put_request(virtio_block_driver_info* info, virtio_block_request* request)
+{
+	InterruptsSpinLocker locker(info->request_lock);
+
+	request->operation = NULL;
+	request->next = info->free_requests;
+	info->free_requests = request;
+}
+
+
+static void
+complete_request(virtio_block_driver_info* info,
+	virtio_block_request* request)
+{
+	IOOperation* operation = request->operation;
+
+	size_t bytesTransferred = 0;
+	status_t status;
+	switch (request->buffer->status) {
+		case VIRTIO_BLK_S_OK:
+			status = B_OK;
+			bytesTransferred = operation->Length();
+			break;
+		case VIRTIO_BLK_S_UNSUPP:
+			status = ENOTSUP;
+			break;
+		default:
+			status = EIO;
+			break;
+	}
+
+	put_request(info, request);
+
+	info->io_scheduler->OperationCompleted(operation, status,
+		bytesTransferred);
+}
+
+
 static void
 virtio_block_callback(void* driverCookie, void* _cookie)
 {
-	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
+	virtio_block_queue* queue = (virtio_block_queue*)_cookie;
+	virtio_block_driver_info* info = queue->info;
+
+	bool completed = false;
+	while (true) {
+		void* cookie = NULL;
+		{
+			InterruptsSpinLocker locker(queue->lock);
+			if (!info->virtio->queue_dequeue(queue->virtio_queue, &cookie,
+					NULL)) {
+				break;
+			}
+		}
 
-	void* cookie = NULL;
-	while (info->virtio->queue_dequeue(info->virtio_queue, &cookie, NULL)) {
-		if ((int32)(addr_t)cookie == atomic_get(&info->currentRequest))
-			info->interruptCondition.NotifyAll();
+		complete_request(info, (virtio_block_request*)cookie);
+		completed = true;
 	}
+
+	// wake up anyone waiting for a request or for space in a ring
+	if (completed)
+		info->request_condition.NotifyAll();
 }
 
 
+/*!	Passes the operation on to the device, and returns without waiting for
+	it to complete; the operation is finished from the interrupt handler.
+	As many operations can be in flight as there are requests.
+*/
 static status_t
 do_io(void* cookie, IOOperation* operation)
 {
 	virtio_block_driver_info* info = (virtio_block_driver_info*)cookie;
 
-	MutexTryLocker locker(&info->lock);
-	if (!locker.IsLocked())
-		return B_BUSY;
-
-	BStackOrHeapArray<physical_entry, 16> entries(operation->VecCount() + 2);
+	virtio_block_request* request = get_request(info);
+	request->operation = operation;
 
-	struct virtio_blk_outhdr *header = (struct virtio_blk_outhdr*)info->bufferAddr;
+	struct virtio_blk_outhdr* header = &request->buffer->header;
 	header->type = operation->IsWrite() ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
 	header->sector = operation->Offset() / 512;
 	header->ioprio = 1;
+	request->buffer->status = 0xff;
 
-	uint8* ack = (uint8*)info->bufferAddr + sizeof(struct virtio_blk_outhdr);
-	*ack = 0xff;
+	BStackOrHeapArray<physical_entry, 16> entries(operation->VecCount() + 2);
 
-	entries[0].address = info->bufferPhysAddr;
+	entries[0].address = request->buffer_physical_address;
 	entries[0].size = sizeof(struct virtio_blk_outhdr);
-	entries[operation->VecCount() + 1].address = entries[0].address
-		+ sizeof(struct virtio_blk_outhdr);
+	entries[operation->VecCount() + 1].address
+		= request->buffer_physical_address
+			+ offsetof(virtio_block_request_buffer, status);
 	entries[operation->VecCount() + 1].size = sizeof(uint8);
 
 	memcpy(entries + 1, operation->Vecs(), operation->VecCount()
 		* sizeof(physical_entry));
 
-	atomic_add(&info->currentRequest, 1);
+	// Spread the requests over all queues, so that the device can work on
+	// them in parallel, and their interrupts can go to different CPUs.
+	virtio_block_queue* queue = &info->queues[
+		(uint32)atomic_add(&info->next_queue, 1) % info->queue_count];
 
-	ConditionVariableEntry entry;
-	info->interruptCondition.Add(&entry);
+	status_t status;
+	while (true) {
+		InterruptsSpinLocker locker(queue->lock);
+
+		status = info->virtio->queue_request_v(queue->virtio_queue, entries,
+			1 + (operation->IsWrite() ? operation->VecCount() : 0 ),
+			1 + (operation->IsWrite() ? 0 : operation->VecCount()),
+			request);
+		if (status != B_BUSY
+			|| info->virtio->queue_is_empty(queue->virtio_queue)) {
+			break;
+		}
 
-	status_t result = info->virtio->queue_request_v(info->virtio_queue, entries,
-		1 + (operation->IsWrite() ? operation->VecCount() : 0 ),
-		1 + (operation->IsWrite() ? 0 : operation->VecCount()),
-		(void *)(addr_t)info->currentRequest);
+		// the ring is full, wait until a request completes
+		ConditionVariableEntry entry;
+		info->request_condition.Add(&entry);
 
-	if (result == B_OK)
-		result = entry.Wait(B_RELATIVE_TIMEOUT, 10 * 1000 * 1000);
+		locker.Unlock();
+		entry.Wait();
+	}
 
-	size_t bytesTransferred = 0;
-	status_t status = B_OK;
-	if (result != B_OK) {
-		status = EIO;
-	} else {
-		switch (*ack) {
-			case VIRTIO_BLK_S_OK:
-				status = B_OK;
-				bytesTransferred = operation->Length();
-				break;
-			case VIRTIO_BLK_S_UNSUPP:
-				status = ENOTSUP;
-				break;
-			default:
-				status = EIO;
-				break;
-		}
+	if (status != B_OK) {
+		put_request(info, request);
+		info->request_condition.NotifyAll();
+		info->io_scheduler->OperationCompleted(operation, status, 0);
 	}
 
-	info->io_scheduler->OperationCompleted(operation, status,
-		bytesTransferred);
 	return status;
 }
 
@@ -272,7 +391,8 @@ virtio_block_init_device(void* _info, void** _cookie)
 			| VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_GEOMETRY
 			| VIRTIO_BLK_F_RO | VIRTIO_BLK_F_BLK_SIZE
 			| VIRTIO_BLK_F_FLUSH | VIRTIO_BLK_F_TOPOLOGY
-			| VIRTIO_FEATURE_RING_INDIRECT_DESC,
+			| VIRTIO_BLK_F_MQ | VIRTIO_FEATURE_RING_INDIRECT_DESC
+			| VIRTIO_FEATURE_RING_EVENT_IDX,
 		&info->features, &get_feature_name);
 
 	status_t status = info->virtio->read_device_config(
@@ -291,19 +411,42 @@ virtio_block_init_device(void* _info, void** _cookie)
 		requestedSize = info->config.seg_max + 2;
 			// two entries are taken up by the header and result
 
-	status = info->virtio->alloc_queues(info->virtio_device, 1,
-		&info->virtio_queue, &requestedSize);
+	// use one queue per CPU, if the device supports that many
+	uint32 queueCount = 1;
+	if ((info->features & VIRTIO_BLK_F_MQ) != 0) {
+		queueCount = min_c(info->config.num_queues, VIRTIO_BLOCK_MAX_QUEUES);
+		queueCount = min_c(queueCount, (uint32)smp_get_num_cpus());
+		queueCount = max_c(queueCount, 1);
+	}
+
+	::virtio_queue virtioQueues[VIRTIO_BLOCK_MAX_QUEUES];
+	uint16 requestedSizes[VIRTIO_BLOCK_MAX_QUEUES];
+	for (uint32 i = 0; i < queueCount; i++)
+		requestedSizes[i] = requestedSize;
+
+	status = info->virtio->alloc_queues(info->virtio_device, queueCount,
+		virtioQueues, requestedSizes);
 	if (status != B_OK) {
 		ERROR("queue allocation failed (%s)\n", strerror(status));
 		return status;
 	}
 
+	info->queue_count = queueCount;
+	for (uint32 i = 0; i < queueCount; i++) {
+		info->queues[i].info = info;
+		info->queues[i].virtio_queue = virtioQueues[i];
+		B_INITIALIZE_SPINLOCK(&info->queues[i].lock);
+	}
+
+	TRACE("using %" B_PRIu32 " queues\n", queueCount);
+
 	status = info->virtio->setup_interrupt(info->virtio_device,
 		virtio_block_config_callback, info);
 
-	if (status == B_OK) {
-		status = info->virtio->queue_setup_interrupt(info->virtio_queue,
-			virtio_block_callback, info);
+	for (uint32 i = 0; status == B_OK && i < queueCount; i++) {
+		status = info->virtio->queue_setup_interrupt(
+			info->queues[i].virtio_queue, virtio_block_callback,
+			&info->queues[i]);
 	}
 
 	*_cookie = info;
@@ -481,15 +624,10 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 	if (status != B_OK)
 		panic("initializing DMAResource failed: %s", strerror(status));
 
-	info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-		info->dma_resource);
-	if (info->io_scheduler == NULL)
-		panic("allocating IOScheduler failed.");
-
-	// TODO: use whole device name here
-	status = info->io_scheduler->Init("virtio");
+	status = IOSchedulerRoster::Default()->CreateScheduler(info->dma_resource,
+		info->name, VIRTIO_BLOCK_REQUEST_COUNT, info->io_scheduler);
 	if (status != B_OK)
-		panic("initializing IOScheduler failed: %s", strerror(status));
+		panic("creating IOScheduler failed: %s", strerror(status));
 
 	info->io_scheduler->SetCallback(do_io, info);
 
@@ -582,9 +720,20 @@ virtio_block_init_driver(device_node *node, void **cookie)
 	}
 
 	info->bufferPhysAddr = entry.address;
-	info->interruptCondition.Init(info, "virtio block transfer");
-	info->currentRequest = 0;
-	mutex_init(&info->lock, "virtio block request");
+
+	// the command buffer is split into one slot per request
+	B_INITIALIZE_SPINLOCK(&info->request_lock);
+	info->free_requests = NULL;
+	for (uint32 i = 0; i < VIRTIO_BLOCK_REQUEST_COUNT; i++) {
+		virtio_block_request* request = &info->requests[i];
+		request->operation = NULL;
+		request->buffer = (virtio_block_request_buffer*)info->bufferAddr + i;
+		request->buffer_physical_address = info->bufferPhysAddr
+			+ i * sizeof(virtio_block_request_buffer);
+		request->next = info->free_requests;
+		info->free_requests = request;
+	}
+	info->request_condition.Init(info, "virtio block request");
 
 	info->node = node;
 
@@ -598,7 +747,6 @@ virtio_block_uninit_driver(void *_cookie)
 {
 	CALLED();
 	virtio_block_driver_info* info = (virtio_block_driver_info*)_cookie;
-	mutex_destroy(&info->lock);
 	delete_area(info->bufferArea);
 	free(info);
 }
@@ -615,11 +763,10 @@ virtio_block_register_child_devices(void* _cookie)
 	if (id < 0)
 		return id;
 
-	char name[64];
-	snprintf(name, sizeof(name), "disk/virtual/virtio_block/%" B_PRId32 "/raw",
-		id);
+	snprintf(info->name, sizeof(info->name),
+		"disk/virtual/virtio_block/%" B_PRId32 "/raw", id);
 
-	status = sDeviceManager->publish_device(info->node, name,
+	status = sDeviceManager->publish_device(info->node, info->name,
 		VIRTIO_BLOCK_DEVICE_MODULE_NAME);
 
 	return status;
@@ -5,8 +5,12 @@
 
 /** This module memorizes all opened files for a certain session. A session
  *	can be the start of an application or the boot process.
- *	When a session is started, it will prefetch all files from an earlier
- *	session in order to speed up the launching or booting process.
+ *	For every file, it also records which ranges of it have been read during
+ *	the session.
+ *	When a session is started, it will prefetch all recorded ranges from an
+ *	earlier session in order to speed up the launching or booting process.
+ *	Files that are no longer used by a session age out of its profile after
+ *	a few sessions.
  *
  *	Note: this module is using private kernel API and is definitely not
  *		meant to be an example on how to write modules.
@@ -22,6 +26,7 @@
 #include <util/AutoLock.h>
 #include <thread.h>
 #include <team.h>
+#include <vfs.h>
 #include <file_cache.h>
 #include <generic_syscall.h>
 #include <syscalls.h>
@@ -32,11 +37,11 @@
 #include <stdio.h>
 #include <errno.h>
 #include <ctype.h>
+#include <limits.h>
 
 extern dev_t gBootDevice;
 
 
-// ToDo: combine the last 3-5 sessions to their intersection
 // ToDo: maybe ignore sessions if the node count is < 3 (without system libs)
 
 #define TRACE_CACHE_MODULE
@@ -49,6 +54,15 @@ extern dev_t gBootDevice;
 #define VNODE_HASH(mountid, vnodeid) (((uint32)((vnodeid) >> 32) \
 	+ (uint32)(vnodeid)) ^ (uint32)(mountid))
 
+#define MAX_DATA_PARTS		8
+	// number of distinct ranges recorded per file
+#define DATA_PART_SLACK		(64 * 1024)
+	// ranges closer to each other than this are merged
+#define MAX_PROFILE_AGE		3
+	// number of sessions a file may be unused before it is dropped
+
+#define MAX_PROFILE_SIZE	(256 * 1024)
+
 struct data_part {
 	off_t		offset;
 	off_t		size;
@@ -59,8 +73,17 @@ struct node {
 	node_ref	ref;
 	int32		ref_count;
 	bigtime_t	timestamp;
-	data_part	parts[5];
+	data_part	parts[MAX_DATA_PARTS];
 	size_t		part_count;
+		// 0 means that the whole file is to be prefetched
+	int32		age;
+		// number of sessions this node was not used in
+};
+
+struct prefetch_range {
+	node_ref	ref;
+	off_t		offset;
+	off_t		size;
 };
 
 struct NodeHash {
@@ -108,6 +131,10 @@ class Session {
 
 		void AddNode(dev_t device, ino_t node);
 		void RemoveNode(dev_t device, ino_t node);
+		void AddRange(dev_t device, ino_t node, off_t offset, size_t size);
+
+		void SetPrefetchSession(Session *session)
+			{ fPrefetchSession = session; }
 
 		void Lock() { mutex_lock(&fLock); }
 		void Unlock() { mutex_unlock(&fLock); }
@@ -123,6 +150,9 @@ class Session {
 
 	private:
 		struct node *_FindNode(dev_t device, ino_t node);
+		struct node *_FindPrefetchNode(const node_ref &ref);
+		status_t _WriteNode(int fd, const struct node *node,
+			const struct node *parts, int32 age);
 
 		Session		*fNext;
 		char		fName[B_OS_NAME_LENGTH];
@@ -130,6 +160,7 @@ class Session {
 		NodeTable	*fNodeHash;
 		struct node	*fNodes;
 		int32		fNodeCount;
+		Session		*fPrefetchSession;
 		team_id		fTeam;
 		node_ref	fNodeRef;
 		bigtime_t	fActiveUntil;
@@ -151,14 +182,6 @@ class SessionGetter {
 		Session	*fSession;
 };
 
-static Session *sMainSession;
-static SessionTable *sTeamHash;
-static PrefetchTable *sPrefetchHash;
-static Session *sMainPrefetchSessions;
-	// singly-linked list
-static recursive_lock sLock;
-
-
 node_ref::node_ref()
 {
 	// part of libbe.so
@@ -210,7 +233,7 @@ struct SessionHash {
 
 	bool Compare(KeyType key, ValueType* session) const
 	{
-		return session->Team == key;
+		return session->Team() == key;
 	}
 
 	ValueType*& GetLink(ValueType* value) const
@@ -222,6 +245,14 @@ struct SessionHash {
 typedef BOpenHashTable<SessionHash> SessionTable;
 
 
+static Session *sMainSession;
+static SessionTable *sTeamHash;
+static PrefetchTable *sPrefetchHash;
+static Session *sMainPrefetchSessions;
+	// singly-linked list
+static recursive_lock sLock;
+
+
 static void
 stop_session(Session *session)
 {
@@ -276,11 +307,14 @@ start_session(team_id team, dev_t device, ino_t node, const char *name,
 			}
 		}
 	} else {
-		// ToDo: search for session by device/node ID
-		prefetchSession = NULL;
+		node_ref key;
+		key.device = device;
+		key.node = node;
+		prefetchSession = sPrefetchHash->Lookup(key);
 	}
 	if (prefetchSession != NULL) {
 		TRACE(("found prefetch session %s\n", prefetchSession->Name()));
+		session->SetPrefetchSession(prefetchSession);
 		prefetchSession->Prefetch();
 	}
 
@@ -326,14 +360,82 @@ new_node(dev_t device, ino_t id)
 	if (node == NULL)
 		return NULL;
 
+	node->next = NULL;
 	node->ref.device = device;
 	node->ref.node = id;
+	node->ref_count = 1;
 	node->timestamp = system_time();
+	node->part_count = 0;
+	node->age = 0;
 
 	return node;
 }
 
 
+/*!	Adds the range to the node's parts, merging it with any part it overlaps
+	or comes close to. If the node has no room left for another part, the
+	range is merged with the part closest to it.
+*/
+static void
+add_node_part(struct node *node, off_t offset, off_t size)
+{
+	off_t end = offset + size;
+
+	for (size_t i = 0; i < node->part_count; i++) {
+		data_part &part = node->parts[i];
+		if (offset > part.offset + part.size + DATA_PART_SLACK
+			|| end + DATA_PART_SLACK < part.offset)
+			continue;
+
+		off_t partEnd = max_c(part.offset + part.size, end);
+		part.offset = min_c(part.offset, offset);
+		part.size = partEnd - part.offset;
+		return;
+	}
+
+	if (node->part_count < MAX_DATA_PARTS) {
+		node->parts[node->part_count].offset = offset;
+		node->parts[node->part_count].size = size;
+		node->part_count++;
+		return;
+	}
+
+	// find the closest part, and extend it
+	size_t closest = 0;
+	off_t closestDistance = -1;
+	for (size_t i = 0; i < node->part_count; i++) {
+		data_part &part = node->parts[i];
+		off_t distance = offset > part.offset
+			? offset - (part.offset + part.size) : part.offset - end;
+		if (closestDistance < 0 || distance < closestDistance) {
+			closest = i;
+			closestDistance = distance;
+		}
+	}
+
+	data_part &part = node->parts[closest];
+	off_t partEnd = max_c(part.offset + part.size, end);
+	part.offset = min_c(part.offset, offset);
+	part.size = partEnd - part.offset;
+}
+
+
+static int
+compare_prefetch_ranges(const void *_a, const void *_b)
+{
+	const prefetch_range *a = (const prefetch_range *)_a;
+	const prefetch_range *b = (const prefetch_range *)_b;
+
+	if (a->ref.device != b->ref.device)
+		return a->ref.device < b->ref.device ? -1 : 1;
+	if (a->ref.node != b->ref.node)
+		return a->ref.node < b->ref.node ? -1 : 1;
+	if (a->offset != b->offset)
+		return a->offset < b->offset ? -1 : 1;
+	return 0;
+}
+
+
 static void
 load_prefetch_data()
 {
@@ -373,6 +475,7 @@ Session::Session(team_id team, const char *name, dev_t device,
 	:
 	fNodes(NULL),
 	fNodeCount(0),
+	fPrefetchSession(NULL),
 	fTeam(team),
 	fClosing(false),
 	fIsWatchingTeam(false)
@@ -407,6 +510,8 @@ Session::Session(const char *name)
 	:
 	fNodeHash(NULL),
 	fNodes(NULL),
+	fNodeCount(0),
+	fPrefetchSession(NULL),
 	fClosing(false),
 	fIsWatchingTeam(false)
 {
@@ -496,6 +601,17 @@ Session::RemoveNode(dev_t device, ino_t id)
 }
 
 
+void
+Session::AddRange(dev_t device, ino_t id, off_t offset, size_t size)
+{
+	struct node *node = _FindNode(device, id);
+	if (node == NULL || size == 0)
+		return;
+
+	add_node_part(node, offset, size);
+}
+
+
 status_t
 Session::StartWatchingTeam()
 {
@@ -518,15 +634,86 @@ Session::StopWatchingTeam()
 }
 
 
+/*!	Prefetches all ranges recorded in this session. The ranges are sorted
+	by device, node, and offset first, so that they are issued in roughly
+	on-disk order, and every vnode only needs to be looked up once.
+*/
 void
 Session::Prefetch()
 {
 	if (fNodes == NULL || fNodeHash != NULL)
 		return;
 
+	int32 count = 0;
+	for (struct node *node = fNodes; node != NULL; node = node->next)
+		count += node->part_count > 0 ? node->part_count : 1;
+
+	prefetch_range *ranges
+		= (prefetch_range *)malloc(count * sizeof(prefetch_range));
+	if (ranges == NULL) {
+		for (struct node *node = fNodes; node != NULL; node = node->next)
+			cache_prefetch(node->ref.device, node->ref.node, 0, SIZE_MAX);
+		return;
+	}
+
+	int32 index = 0;
 	for (struct node *node = fNodes; node != NULL; node = node->next) {
-		cache_prefetch(node->ref.device, node->ref.node, 0, ~0UL);
+		if (node->part_count == 0) {
+			ranges[index].ref = node->ref;
+			ranges[index].offset = 0;
+			ranges[index].size = LLONG_MAX;
+			index++;
+			continue;
+		}
+
+		for (size_t i = 0; i < node->part_count; i++) {
+			ranges[index].ref = node->ref;
+			ranges[index].offset = node->parts[i].offset;
+			ranges[index].size = node->parts[i].size;
+			index++;
+		}
 	}
+
+	qsort(ranges, count, sizeof(prefetch_range), &compare_prefetch_ranges);
+
+	struct vnode *vnode = NULL;
+	node_ref current;
+	current.device = -1;
+	current.node = -1;
+
+	for (index = 0; index < count; index++) {
+		prefetch_range &range = ranges[index];
+		if (range.ref.device != current.device
+			|| range.ref.node != current.node) {
+			if (vnode != NULL)
+				vfs_put_vnode(vnode);
+
+			current = range.ref;
+			if (vfs_get_vnode(current.device, current.node, true, &vnode)
+					!= B_OK)
+				vnode = NULL;
+		}
+		if (vnode == NULL)
+			continue;
+
+		// coalesce with the following ranges of the same node
+		off_t end = range.offset + range.size;
+		while (index + 1 < count
+			&& ranges[index + 1].ref.device == current.device
+			&& ranges[index + 1].ref.node == current.node
+			&& ranges[index + 1].offset <= end + DATA_PART_SLACK) {
+			index++;
+			end = max_c(end, ranges[index].offset + ranges[index].size);
+		}
+
+		cache_prefetch_vnode(vnode, range.offset,
+			min_c((uint64)(end - range.offset), (uint64)SIZE_MAX));
+	}
+
+	if (vnode != NULL)
+		vfs_put_vnode(vnode);
+
+	free(ranges);
 }
 
 
@@ -545,14 +732,13 @@ Session::LoadFromDirectory(int directoryFD)
 		return errno;
 	}
 
-	if (stat.st_size > 32768) {
+	if (stat.st_size > MAX_PROFILE_SIZE) {
 		// for safety reasons
-		// ToDo: make a bit larger later
 		close(fd);
 		return B_BAD_DATA;
 	}
 
-	char *buffer = (char *)malloc(stat.st_size);
+	char *buffer = (char *)malloc(stat.st_size + 1);
 	if (buffer == NULL) {
 		close(fd);
 		return B_NO_MEMORY;
@@ -563,16 +749,47 @@ Session::LoadFromDirectory(int directoryFD)
 		close(fd);
 		return B_ERROR;
 	}
+	buffer[stat.st_size] = '\0';
+
+	// Every line has the format "<device>:<node> [<age> [<offset>:<size>]*]";
+	// a line without any ranges stands for the whole file.
 
 	const char *line = buffer;
 	node_ref nodeRef;
 	while (parse_node_ref(line, nodeRef, &line)) {
 		struct node *node = new_node(nodeRef.device, nodeRef.node);
+
+		char *end;
+		if (line[0] == ' ') {
+			int32 age = strtol(line + 1, &end, 0);
+			if (node != NULL)
+				node->age = age;
+			line = end;
+		}
+
+		while (line[0] == ' ') {
+			off_t offset = strtoll(line + 1, &end, 0);
+			if (end[0] != ':')
+				break;
+			off_t size = strtoll(end + 1, &end, 0);
+			line = end;
+
+			if (node != NULL && offset >= 0 && size > 0)
+				add_node_part(node, offset, size);
+		}
+
 		if (node != NULL) {
 			// note: this reverses the order of the nodes in the file
 			node->next = fNodes;
 			fNodes = node;
+			fNodeCount++;
 		}
+
+		// skip to the next line
+		while (line[0] != '\n' && line[0] != '\0')
+			line++;
+		if (line[0] == '\0')
+			break;
 		line++;
 	}
 
@@ -582,6 +799,51 @@ Session::LoadFromDirectory(int directoryFD)
 }
 
 
+node *
+Session::_FindPrefetchNode(const node_ref &ref)
+{
+	if (fPrefetchSession == NULL)
+		return NULL;
+
+	for (struct node *node = fPrefetchSession->fNodes; node != NULL;
+			node = node->next) {
+		if (node->ref.device == ref.device && node->ref.node == ref.node)
+			return node;
+	}
+
+	return NULL;
+}
+
+
+/*!	Writes a line for \a node with the ranges of \a parts to the profile.
+*/
+status_t
+Session::_WriteNode(int fd, const struct node *node, const struct node *parts,
+	int32 age)
+{
+	char line[64 + MAX_DATA_PARTS * 48];
+	int length = snprintf(line, sizeof(line), "%ld:%lld %ld",
+		node->ref.device, node->ref.node, age);
+
+	for (size_t i = 0; parts != NULL && i < parts->part_count; i++) {
+		length += snprintf(line + length, sizeof(line) - length,
+			" %lld:%lld", parts->parts[i].offset, parts->parts[i].size);
+	}
+	line[length++] = '\n';
+
+	ssize_t bytesWritten = write(fd, line, length);
+	if (bytesWritten < B_OK)
+		return bytesWritten;
+
+	return B_OK;
+}
+
+
+/*!	Writes the profile of this session to disk. It contains all nodes that
+	have been used in this session, with the ranges that were read from them.
+	Nodes of the previous profile that were not used again are kept with an
+	increased age, until they reach MAX_PROFILE_AGE.
+*/
 status_t
 Session::Save()
 {
@@ -599,29 +861,37 @@ Session::Save()
 		return errno;
 
 	status_t status = B_OK;
-	off_t fileSize = 0;
 
 	// ToDo: order nodes by timestamp... (should improve launch speed)
-	// ToDo: test which parts of a file have been read (and save that as well)
 
 	// enlarge file, so that it can be written faster
-	ftruncate(fd, 512 * 1024);
+	ftruncate(fd, MAX_PROFILE_SIZE);
 
 	NodeTable::Iterator iterator(fNodeHash);
-	while (iterator.HasNext()) {
+	while (status == B_OK && iterator.HasNext()) {
 		struct node *node = iterator.Next();
-		snprintf(name, sizeof(name), "%ld:%lld\n", node->ref.device, node->ref.node);
 
-		ssize_t bytesWritten = write(fd, name, strlen(name));
-		if (bytesWritten < B_OK) {
-			status = bytesWritten;
-			break;
-		}
+		// if nothing has been read from the node, it might have been
+		// prefetched completely, so we keep the ranges of the last profile
+		const struct node *parts = node;
+		if (node->part_count == 0)
+			parts = _FindPrefetchNode(node->ref);
+
+		status = _WriteNode(fd, node, parts, 0);
+	}
+
+	if (fPrefetchSession != NULL) {
+		for (struct node *node = fPrefetchSession->fNodes;
+				status == B_OK && node != NULL; node = node->next) {
+			if (node->age + 1 >= MAX_PROFILE_AGE
+				|| _FindNode(node->ref.device, node->ref.node) != NULL)
+				continue;
 
-		fileSize += bytesWritten;
+			status = _WriteNode(fd, node, node, node->age + 1);
+		}
 	}
 
-	ftruncate(fd, fileSize);
+	ftruncate(fd, lseek(fd, 0, SEEK_CUR));
 	close(fd);
 
 	return status;
@@ -758,6 +1028,23 @@ node_closed(struct vnode *vnode, dev_t device, ino_t node,
 }
 
 
+static void
+node_read(struct vnode *vnode, dev_t device, ino_t node, off_t offset,
+	size_t size)
+{
+	if (device < gBootDevice)
+		return;
+
+	Session *session;
+	SessionGetter getter(team_get_current_team_id(), &session);
+
+	if (session == NULL || !session->IsActive())
+		return;
+
+	session->AddRange(device, node, offset, size);
+}
+
+
 static status_t
 launch_speedup_control(const char *subsystem, uint32 function,
 	void *buffer, size_t bufferSize)
@@ -814,13 +1101,13 @@ uninit()
 
 	Session *session = sTeamHash->Clear(true);
 	while (session != NULL) {
-		Session *next = session->next;
+		Session *next = session->Next();
 		delete session;
 		session = next;
 	}
 	session = sPrefetchHash->Clear(true);
 	while (session != NULL) {
-		Session *next = session->next;
+		Session *next = session->Next();
 		delete session;
 		session = next;
 	}
@@ -910,6 +1197,7 @@ static struct cache_module_info sLaunchSpeedupModule = {
 	node_opened,
 	node_closed,
 	NULL,
+	node_read,
 };
 
 
@@ -428,6 +428,7 @@ static struct cache_module_info sLogCacheModule = {
 	log_node_opened,
 	log_node_closed,
 	log_node_launched,
+	NULL,
 };
 
 
@@ -798,6 +798,7 @@ static struct cache_module_info sRuleBasedPrefetcherModule = {
 	node_opened,
 	NULL,
 	node_launched,
+	NULL,
 };
 
 
@@ -1428,20 +1428,30 @@ Inode::ContainerContentsChanged(Transaction& transaction)
 off_t
 Inode::AllocatedSize() const
 {
-	if (IsSymLink() && (Flags() & INODE_LONG_SYMLINK) == 0) {
+	return AllocatedSize(fVolume, Node());
+}
+
+
+/*!	Computes the allocated size of the given inode, which does not need to
+	be loaded, ie. it can be read directly from the block cache.
+*/
+/*static*/ off_t
+Inode::AllocatedSize(Volume* volume, const bfs_inode& node)
+{
+	if (S_ISLNK(node.Mode()) && (node.Flags() & INODE_LONG_SYMLINK) == 0) {
 		// This symlink does not have a data stream
-		return Node().InodeSize();
+		return node.InodeSize();
 	}
 
-	const data_stream& data = Node().data;
-	uint32 blockSize = fVolume->BlockSize();
+	const data_stream& data = node.data;
+	uint32 blockSize = volume->BlockSize();
 	off_t size = blockSize;
 
 	if (data.MaxDoubleIndirectRange() != 0) {
 		off_t doubleIndirectSize = data.MaxDoubleIndirectRange()
 			- data.MaxIndirectRange();
 		int32 indirectSize = double_indirect_max_indirect_size(
-			data.double_indirect.Length(), fVolume->BlockSize());
+			data.double_indirect.Length(), volume->BlockSize());
 
 		size += (2 * data.double_indirect.Length()
 				+ doubleIndirectSize / indirectSize)
@@ -1451,7 +1461,7 @@ Inode::AllocatedSize() const
 	else
 		size += data.MaxDirectRange();
 
-	if (!Node().attributes.IsZero()) {
+	if (!node.attributes.IsZero()) {
 		// TODO: to make this exact, we'd had to count all attributes
 		size += 2 * blockSize;
 			// 2 blocks, one for the attributes inode, one for its B+tree
@@ -2308,6 +2318,29 @@ Inode::Append(Transaction& transaction, off_t bytes)
 }
 
 
+/*!	Allocates the blocks needed to grow the file to \a size without changing
+	its size; the file will grow into them with the data written later on.
+	Unused blocks are trimmed when the file is closed.
+*/
+status_t
+Inode::Preallocate(Transaction& transaction, off_t size)
+{
+	off_t oldSize = Size();
+	if (size <= oldSize)
+		return B_OK;
+
+	status_t status = _GrowStream(transaction, size);
+	if (status != B_OK) {
+		_ShrinkStream(transaction, oldSize);
+		return status;
+	}
+
+	Node().data.size = HOST_ENDIAN_TO_BFS_INT64(oldSize);
+
+	return WriteBack(transaction);
+}
+
+
 /*!	Checks whether or not this inode's data stream needs to be trimmed
 	because of an earlier preallocation.
 	Returns true if there are any blocks to be trimmed.
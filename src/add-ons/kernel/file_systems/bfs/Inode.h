@@ -93,6 +93,8 @@ public:
 
 			off_t				Size() const { return fNode.data.Size(); }
 			off_t				AllocatedSize() const;
+	static	off_t				AllocatedSize(Volume* volume,
+									const bfs_inode& node);
 			off_t				LastModified() const
 									{ return fNode.LastModifiedTime(); }
 
@@ -153,6 +155,8 @@ public:
 			status_t			SetFileSize(Transaction& transaction,
 									off_t size);
 			status_t			Append(Transaction& transaction, off_t bytes);
+			status_t			Preallocate(Transaction& transaction,
+									off_t size);
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
 
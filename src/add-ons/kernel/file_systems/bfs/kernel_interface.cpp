@@ -67,13 +67,12 @@ fill_stat_time(const bfs_inode& node, struct stat& stat)
 }
 
 
-void
-fill_stat_buffer(Inode* inode, struct stat& stat)
+static void
+fill_stat_buffer(Volume* volume, ino_t id, const bfs_inode& node,
+	struct stat& stat)
 {
-	const bfs_inode& node = inode->Node();
-
-	stat.st_dev = inode->GetVolume()->ID();
-	stat.st_ino = inode->ID();
+	stat.st_dev = volume->ID();
+	stat.st_ino = id;
 	stat.st_nlink = 1;
 	stat.st_blksize = BFS_IO_SIZE;
 
@@ -84,13 +83,20 @@ fill_stat_buffer(Inode* inode, struct stat& stat)
 
 	fill_stat_time(node, stat);
 
-	if (inode->IsSymLink() && (inode->Flags() & INODE_LONG_SYMLINK) == 0) {
+	if (S_ISLNK(node.Mode()) && (node.Flags() & INODE_LONG_SYMLINK) == 0) {
 		// symlinks report the size of the link here
 		stat.st_size = strlen(node.short_symlink);
 	} else
-		stat.st_size = inode->Size();
+		stat.st_size = node.data.Size();
 
-	stat.st_blocks = inode->AllocatedSize() / 512;
+	stat.st_blocks = Inode::AllocatedSize(volume, node) / 512;
+}
+
+
+void
+fill_stat_buffer(Inode* inode, struct stat& stat)
+{
+	fill_stat_buffer(inode->GetVolume(), inode->ID(), inode->Node(), stat);
 }
 
 
@@ -1481,6 +1487,56 @@ bfs_write(fs_volume* _volume, fs_vnode* _node, void* _cookie, off_t pos,
 }
 
 
+#ifndef FS_SHELL
+/*!	Prepares copying file data within the volume: the blocks for the target
+	range are allocated all at once up front, so that the target is not grown
+	(and fragmented) chunk by chunk as the data is written. The copying itself
+	is left to the VFS, as the data would have to pass through a buffer here
+	just the same.
+*/
+static status_t
+bfs_copy_file_range(fs_volume* _volume, fs_vnode* _sourceNode,
+	void* _sourceCookie, off_t sourcePos, fs_vnode* _targetNode,
+	void* _targetCookie, off_t targetPos, size_t* _length)
+{
+	FUNCTION();
+
+	Volume* volume = (Volume*)_volume->private_volume;
+	Inode* source = (Inode*)_sourceNode->private_node;
+	Inode* target = (Inode*)_targetNode->private_node;
+
+	if (volume->IsReadOnly())
+		return B_READ_ONLY_DEVICE;
+	if (!source->HasUserAccessableStream() || !target->HasUserAccessableStream())
+		return B_UNSUPPORTED;
+
+	off_t sourceSize;
+	{
+		InodeReadLocker locker(source);
+		sourceSize = source->Size();
+	}
+
+	size_t length = *_length;
+	if (sourcePos >= sourceSize)
+		length = 0;
+	else if ((off_t)length > sourceSize - sourcePos)
+		length = sourceSize - sourcePos;
+
+	if (length > 0 && targetPos + (off_t)length > target->Size()) {
+		Transaction transaction(volume, target->BlockNumber());
+		target->WriteLockInTransaction(transaction);
+
+		// If this fails, the writes will run into the same problem, and
+		// report it.
+		if (target->Preallocate(transaction, targetPos + length) == B_OK)
+			transaction.Done();
+	}
+
+	return B_UNSUPPORTED;
+}
+#endif
+
+
 static status_t
 bfs_close(fs_volume* _volume, fs_vnode* _node, void* _cookie)
 {
@@ -1779,6 +1835,45 @@ bfs_read_dir(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 }
 
 
+#ifndef FS_SHELL
+/*!	Reads the directory entries like bfs_read_dir(), and fills in the stat
+	data of their nodes directly from the inode blocks, without having to
+	load the nodes as vnodes. The VFS replaces the stat data of nodes that
+	are in use, as their in-memory inode might be newer.
+*/
+static status_t
+bfs_read_dir_stat(fs_volume* _volume, fs_vnode* _node, void* _cookie,
+	struct dirent* dirent, size_t bufferSize, struct stat* stats,
+	uint32* _num)
+{
+	FUNCTION();
+
+	status_t status = bfs_read_dir(_volume, _node, _cookie, dirent,
+		bufferSize, _num);
+	if (status != B_OK)
+		return status;
+
+	Volume* volume = (Volume*)_volume->private_volume;
+	CachedBlock cached(volume);
+
+	for (uint32 i = 0; i < *_num; i++) {
+		const bfs_inode* node = NULL;
+		if (cached.SetTo(volume->VnodeToBlock(dirent->d_ino)) == B_OK)
+			node = (const bfs_inode*)cached.Block();
+
+		// leave the stat cleared if the inode is not valid, so that the VFS
+		// will retrieve it the usual way
+		if (node != NULL && node->InitCheck(volume) == B_OK)
+			fill_stat_buffer(volume, dirent->d_ino, *node, stats[i]);
+
+		dirent = (struct dirent*)((uint8*)dirent + dirent->d_reclen);
+	}
+
+	return B_OK;
+}
+#endif
+
+
 /*!	Sets the TreeIterator back to the beginning of the directory. */
 static status_t
 bfs_rewind_dir(fs_volume* /*_volume*/, fs_vnode* /*node*/, void* _cookie)
@@ -2544,7 +2639,21 @@ fs_vnode_ops gBFSVnodeOps = {
 	&bfs_remove_attr,
 
 	/* special nodes */
-	&bfs_create_special_node
+	&bfs_create_special_node,
+	NULL,	// get_super_vnode
+
+#ifndef FS_SHELL
+	/* lock operations */
+	NULL,	// test_lock
+	NULL,	// acquire_lock
+	NULL,	// release_lock
+
+	/* batched directory operations */
+	&bfs_read_dir_stat,
+
+	/* file data copying */
+	&bfs_copy_file_range
+#endif
 };
 
 static file_system_module_info sBeFileSystem = {
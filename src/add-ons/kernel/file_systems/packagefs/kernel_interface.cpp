@@ -360,20 +360,12 @@ packagefs_access(fs_volume* fsVolume, fs_vnode* fsNode, int mode)
 }
 
 
-static status_t
-packagefs_read_stat(fs_volume* fsVolume, fs_vnode* fsNode, struct stat* st)
+/*!	Fills in the stat data of \a node. The caller must hold the lock of
+	the node's parent directory.
+*/
+static void
+fill_stat(Node* node, struct stat* st)
 {
-	Volume* volume = (Volume*)fsVolume->private_volume;
-	Node* node = (Node*)fsNode->private_node;
-
-	FUNCTION("volume: %p, node: %p (%" B_PRId64 ")\n", volume, node,
-		node->ID());
-	TOUCH(volume);
-
-	DirectoryReadLocker dirLocker;
-	if (!lock_directory_for_node(volume, node, dirLocker))
-		return B_NO_INIT;
-
 	st->st_mode = node->Mode();
 	st->st_nlink = 1;
 	st->st_uid = node->UserID();
@@ -386,7 +378,24 @@ packagefs_read_stat(fs_volume* fsVolume, fs_vnode* fsNode, struct stat* st)
 		// TODO: Perhaps manage a changed time (particularly for directories)?
 	st->st_crtim = st->st_mtim;
 	st->st_blocks = (st->st_size + 511) / 512;
+}
+
+
+static status_t
+packagefs_read_stat(fs_volume* fsVolume, fs_vnode* fsNode, struct stat* st)
+{
+	Volume* volume = (Volume*)fsVolume->private_volume;
+	Node* node = (Node*)fsNode->private_node;
+
+	FUNCTION("volume: %p, node: %p (%" B_PRId64 ")\n", volume, node,
+		node->ID());
+	TOUCH(volume);
+
+	DirectoryReadLocker dirLocker;
+	if (!lock_directory_for_node(volume, node, dirLocker))
+		return B_NO_INIT;
 
+	fill_stat(node, st);
 	return B_OK;
 }
 
@@ -630,19 +639,16 @@ packagefs_free_dir_cookie(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie)
 }
 
 
+/*!	Reads the next entries of the directory the \a cookie belongs to. If
+	\a stats is not \c NULL, the stat data of the directory's children is
+	filled in as well; "." and ".." are left to the VFS, since their stat
+	would require the lock of another directory.
+*/
 static status_t
-packagefs_read_dir(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie,
-	struct dirent* buffer, size_t bufferSize, uint32* _count)
+read_directory_entries(Volume* volume, DirectoryCookie* cookie,
+	struct dirent* buffer, size_t bufferSize, struct stat* stats,
+	uint32* _count)
 {
-	Volume* volume = (Volume*)fsVolume->private_volume;
-	Node* node = (Node*)fsNode->private_node;
-	DirectoryCookie* cookie = (DirectoryCookie*)_cookie;
-
-	FUNCTION("volume: %p, node: %p (%" B_PRId64 "), cookie: %p\n", volume, node,
-		node->ID(), cookie);
-	TOUCH(volume);
-	TOUCH(node);
-
 	DirectoryWriteLocker dirLocker(cookie->directory);
 
 	uint32 maxCount = *_count;
@@ -682,6 +688,9 @@ packagefs_read_dir(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie,
 		buffer->d_dev = volume->ID();
 		buffer->d_ino = child->ID();
 
+		if (stats != NULL && cookie->state >= 2)
+			fill_stat(child, &stats[count]);
+
 		count++;
 		previousEntry = buffer;
 		bufferSize -= buffer->d_reclen;
@@ -695,6 +704,41 @@ packagefs_read_dir(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie,
 }
 
 
+static status_t
+packagefs_read_dir(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie,
+	struct dirent* buffer, size_t bufferSize, uint32* _count)
+{
+	Volume* volume = (Volume*)fsVolume->private_volume;
+	Node* node = (Node*)fsNode->private_node;
+	DirectoryCookie* cookie = (DirectoryCookie*)_cookie;
+
+	FUNCTION("volume: %p, node: %p (%" B_PRId64 "), cookie: %p\n", volume, node,
+		node->ID(), cookie);
+	TOUCH(node);
+
+	return read_directory_entries(volume, cookie, buffer, bufferSize, NULL,
+		_count);
+}
+
+
+static status_t
+packagefs_read_dir_stat(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie,
+	struct dirent* buffer, size_t bufferSize, struct stat* stats,
+	uint32* _count)
+{
+	Volume* volume = (Volume*)fsVolume->private_volume;
+	Node* node = (Node*)fsNode->private_node;
+	DirectoryCookie* cookie = (DirectoryCookie*)_cookie;
+
+	FUNCTION("volume: %p, node: %p (%" B_PRId64 "), cookie: %p\n", volume, node,
+		node->ID(), cookie);
+	TOUCH(node);
+
+	return read_directory_entries(volume, cookie, buffer, bufferSize, stats,
+		_count);
+}
+
+
 static status_t
 packagefs_rewind_dir(fs_volume* fsVolume, fs_vnode* fsNode, void* _cookie)
 {
@@ -1314,9 +1358,17 @@ fs_vnode_ops gPackageFSVnodeOps = {
 	&packagefs_read_attr_stat,
 	NULL,	// write_attr_stat,
 	NULL,	// rename_attr,
-	NULL	// remove_attr,
+	NULL,	// remove_attr,
 
 	// TODO: FS layer operations
+	NULL,	// create_special_node,
+	NULL,	// get_super_vnode,
+
+	NULL,	// test_lock,
+	NULL,	// acquire_lock,
+	NULL,	// release_lock,
+
+	&packagefs_read_dir_stat
 };
 
 
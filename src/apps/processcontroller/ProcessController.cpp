@@ -466,10 +466,12 @@ ProcessController::MessageReceived(BMessage *message)
 		case 'Schd':
 		{
 			BMenuItem* source;
-			if (message->FindPointer("source", (void**)&source) != B_OK)
+			int32 mode;
+			if (message->FindPointer("source", (void**)&source) != B_OK
+				|| message->FindInt32("mode", &mode) != B_OK)
 				break;
 			if (!source->IsMarked())
-				set_scheduler_mode(SCHEDULER_MODE_POWER_SAVING);
+				set_scheduler_mode(mode);
 			else
 				set_scheduler_mode(SCHEDULER_MODE_LOW_LATENCY);
 			Preferences preferences(kPreferencesFileName);
@@ -850,11 +852,19 @@ thread_popup(void *arg)
 		currentMode = get_scheduler_mode();
 	}
 	BMessage* msg = new BMessage('Schd');
+	msg->AddInt32("mode", SCHEDULER_MODE_POWER_SAVING);
 	item = new BMenuItem(B_TRANSLATE("Power saving"), msg);
 	if ((uint32)currentMode == SCHEDULER_MODE_POWER_SAVING)
 		item->SetMarked(true);
 	item->SetTarget(gPCView);
 	addtopbottom(item);
+	msg = new BMessage('Schd');
+	msg->AddInt32("mode", SCHEDULER_MODE_SERVER);
+	item = new BMenuItem(B_TRANSLATE("Server"), msg);
+	if ((uint32)currentMode == SCHEDULER_MODE_SERVER)
+		item->SetMarked(true);
+	item->SetTarget(gPCView);
+	addtopbottom(item);
 	addtopbottom(new BSeparatorItem());
 
 	if (!be_roster->IsRunning(kTrackerSig)) {
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <OS.h>
+
+#include <lock_statistics_defs.h>
+#include <syscalls.h>
+
+
+extern const char* __progname;
+
+static const char* kUsage =
+	"Usage: %s [ <options> ] [ <interval> ]\n"
+	"Collects kernel lock statistics for <interval> seconds (default 5) and\n"
+	"prints the most contended lock classes. This requires a kernel built\n"
+	"with KERNEL_LOCK_STATISTICS enabled.\n"
+	"\n"
+	"Options:\n"
+	"  -c           - Don't collect over an interval, but print the\n"
+	"                 statistics collected so far.\n"
+	"  -h, --help   - Print this usage info.\n"
+	"  -n <count>   - Print the <count> top lock classes (default 20).\n"
+	"  -s <key>     - Sort by <key>, one of \"contended\" (default),\n"
+	"                 \"wait\", \"maxwait\", \"hold\", or \"acquired\".\n"
+;
+
+
+enum sort_key {
+	SORT_BY_CONTENDED,
+	SORT_BY_WAIT_TIME,
+	SORT_BY_MAX_WAIT_TIME,
+	SORT_BY_HOLD_TIME,
+	SORT_BY_ACQUISITIONS
+};
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, __progname);
+	exit(error ? 1 : 0);
+}
+
+
+static status_t
+lock_statistics_call(uint32 function, void* buffer = NULL, size_t size = 0)
+{
+	return _kern_generic_syscall(LOCK_STATISTICS, function, buffer, size);
+}
+
+
+static status_t
+get_lock_statistics(std::vector<lock_class_info>& classes, bool& enabled,
+	int64& dropped)
+{
+	lock_statistics_request request;
+	memset(&request, 0, sizeof(request));
+
+	while (true) {
+		status_t error = lock_statistics_call(LOCK_STATISTICS_GET, &request,
+			sizeof(request));
+		if (error != B_OK)
+			return error;
+
+		if (request.class_count >= request.total_class_count)
+			break;
+
+		// the buffer was too small, try again with some headroom
+		classes.resize(request.total_class_count + 64);
+		request.classes = &classes[0];
+		request.class_count = classes.size();
+	}
+
+	classes.resize(request.class_count);
+	enabled = request.enabled;
+	dropped = request.dropped;
+	return B_OK;
+}
+
+
+/*!	Folds classes with the same type and name into one. Locks with cloned
+	names end up in a class of their own each.
+*/
+static void
+merge_lock_classes(std::vector<lock_class_info>& classes)
+{
+	std::vector<lock_class_info> merged;
+	for (size_t i = 0; i < classes.size(); i++) {
+		const lock_class_info& info = classes[i];
+
+		size_t j = 0;
+		for (; j < merged.size(); j++) {
+			if (merged[j].type == info.type
+				&& strcmp(merged[j].name, info.name) == 0) {
+				break;
+			}
+		}
+
+		if (j == merged.size()) {
+			merged.push_back(info);
+			continue;
+		}
+
+		lock_class_info& target = merged[j];
+		target.acquisitions += info.acquisitions;
+		target.contended += info.contended;
+		target.total_wait_time += info.total_wait_time;
+		target.max_wait_time = std::max(target.max_wait_time,
+			info.max_wait_time);
+		target.total_hold_time += info.total_hold_time;
+		target.max_hold_time = std::max(target.max_hold_time,
+			info.max_hold_time);
+	}
+
+	classes.swap(merged);
+}
+
+
+static int64
+sort_value(const lock_class_info& info, sort_key key)
+{
+	switch (key) {
+		case SORT_BY_CONTENDED:
+			return info.contended;
+		case SORT_BY_WAIT_TIME:
+			return info.total_wait_time;
+		case SORT_BY_MAX_WAIT_TIME:
+			return info.max_wait_time;
+		case SORT_BY_HOLD_TIME:
+			return info.total_hold_time;
+		case SORT_BY_ACQUISITIONS:
+			return info.acquisitions;
+	}
+
+	return 0;
+}
+
+
+struct LockClassComparator {
+	LockClassComparator(sort_key key)
+		:
+		fKey(key)
+	{
+	}
+
+	bool operator()(const lock_class_info& a, const lock_class_info& b) const
+	{
+		return sort_value(a, fKey) > sort_value(b, fKey);
+	}
+
+private:
+	sort_key	fKey;
+};
+
+
+static const char*
+lock_type_name(uint32 type)
+{
+	switch (type) {
+		case LOCK_STATISTICS_TYPE_MUTEX:
+			return "mutex";
+		case LOCK_STATISTICS_TYPE_RW_LOCK:
+			return "rw_lock";
+		case LOCK_STATISTICS_TYPE_SPINLOCK:
+			return "spinlock";
+		default:
+			return "?";
+	}
+}
+
+
+static void
+print_lock_classes(const std::vector<lock_class_info>& classes, size_t count)
+{
+	printf("%-8s %-40s %10s %10s %6s %12s %10s %12s %10s\n", "type", "name",
+		"acquired", "contended", "%", "wait (us)", "max wait", "hold (us)",
+		"max hold");
+
+	for (size_t i = 0; i < classes.size() && i < count; i++) {
+		const lock_class_info& info = classes[i];
+		double percentage = info.acquisitions > 0
+			? 100.0 * info.contended / info.acquisitions : 0.0;
+
+		printf("%-8s %-40.40s %10" B_PRId64 " %10" B_PRId64 " %6.2f %12"
+			B_PRId64 " %10" B_PRId64 " %12" B_PRId64 " %10" B_PRId64 "\n",
+			lock_type_name(info.type), info.name, info.acquisitions,
+			info.contended, percentage, info.total_wait_time,
+			info.max_wait_time, info.total_hold_time, info.max_hold_time);
+	}
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	bool cumulative = false;
+	size_t count = 20;
+	sort_key sortKey = SORT_BY_CONTENDED;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+chn:s:", sLongOptions, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'c':
+				cumulative = true;
+				break;
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+			case 'n':
+				count = strtoul(optarg, NULL, 0);
+				if (count == 0)
+					print_usage_and_exit(true);
+				break;
+			case 's':
+				if (strcmp(optarg, "contended") == 0)
+					sortKey = SORT_BY_CONTENDED;
+				else if (strcmp(optarg, "wait") == 0)
+					sortKey = SORT_BY_WAIT_TIME;
+				else if (strcmp(optarg, "maxwait") == 0)
+					sortKey = SORT_BY_MAX_WAIT_TIME;
+				else if (strcmp(optarg, "hold") == 0)
+					sortKey = SORT_BY_HOLD_TIME;
+				else if (strcmp(optarg, "acquired") == 0)
+					sortKey = SORT_BY_ACQUISITIONS;
+				else
+					print_usage_and_exit(true);
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	double interval = 5;
+	if (optind < argc) {
+		interval = atof(argv[optind++]);
+		if (interval <= 0 || optind < argc)
+			print_usage_and_exit(true);
+	}
+
+	std::vector<lock_class_info> classes;
+	bool enabled;
+	int64 dropped;
+
+	status_t error = get_lock_statistics(classes, enabled, dropped);
+	if (error != B_OK) {
+		fprintf(stderr, "%s: Failed to get the lock statistics: %s\n",
+			__progname, strerror(error));
+		if (error == B_BAD_VALUE || error == B_NAME_NOT_FOUND) {
+			fprintf(stderr, "The kernel was probably built without "
+				"KERNEL_LOCK_STATISTICS.\n");
+		}
+		exit(1);
+	}
+
+	if (!cumulative) {
+		error = lock_statistics_call(LOCK_STATISTICS_RESET);
+		if (error == B_OK && !enabled)
+			error = lock_statistics_call(LOCK_STATISTICS_ENABLE);
+		if (error != B_OK) {
+			fprintf(stderr, "%s: Failed to start collecting: %s\n",
+				__progname, strerror(error));
+			exit(1);
+		}
+
+		snooze((bigtime_t)(interval * 1000000));
+
+		bool wasEnabled = enabled;
+		error = get_lock_statistics(classes, enabled, dropped);
+
+		if (!wasEnabled)
+			lock_statistics_call(LOCK_STATISTICS_DISABLE);
+
+		if (error != B_OK) {
+			fprintf(stderr, "%s: Failed to get the lock statistics: %s\n",
+				__progname, strerror(error));
+			exit(1);
+		}
+	}
+
+	merge_lock_classes(classes);
+	std::sort(classes.begin(), classes.end(), LockClassComparator(sortKey));
+
+	print_lock_classes(classes, count);
+
+	if (dropped > 0) {
+		printf("\n%" B_PRId64 " events were dropped, because the lock class "
+			"table was full.\n", dropped);
+	}
+
+	return 0;
+}
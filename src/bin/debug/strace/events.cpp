@@ -387,6 +387,9 @@ patch_events()
 	Syscall *event_queue_wait = get_syscall("_kern_event_queue_wait");
 	event_queue_wait->ParameterAt(1)->SetOut(true);
 
+	Syscall *event_queue_submit = get_syscall("_kern_event_queue_submit");
+	event_queue_submit->ParameterAt(3)->SetOut(true);
+
 	Syscall *wait_for_child = get_syscall("_kern_wait_for_child");
 	wait_for_child->ParameterAt(2)->SetOut(true);
 	wait_for_child->ParameterAt(3)->SetOut(true);
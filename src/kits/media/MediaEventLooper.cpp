@@ -28,6 +28,8 @@
  *
  */
 
+#include <string.h>
+
 #include <MediaEventLooper.h>
 #include <TimeSource.h>
 #include <scheduler.h>
@@ -62,7 +64,8 @@ BMediaEventLooper::BMediaEventLooper(uint32 apiVersion) :
 	fSchedulingLatency(0),
 	fBufferDuration(0),
 	fOfflineTime(0),
-	fApiVersion(apiVersion)
+	fApiVersion(apiVersion),
+	fDeadlineRuntime(0)
 {
 	CALLED();
 	fEventQueue.SetCleanupHook(BMediaEventLooper::_CleanUpEntry, this);
@@ -187,6 +190,10 @@ BMediaEventLooper::SetRunMode(run_mode mode)
 	}
 
 	BMediaNode::SetRunMode(mode);
+
+	// offline nodes have no deadlines to meet
+	if (fDeadlineRuntime != 0)
+		_UpdateDeadline();
 }
 
 
@@ -411,6 +418,8 @@ BMediaEventLooper::SetBufferDuration(bigtime_t duration)
 		duration = 0;
 
 	fBufferDuration = duration;
+	if (fDeadlineRuntime != 0)
+		_UpdateDeadline();
 }
 
 
@@ -422,6 +431,19 @@ BMediaEventLooper::SetOfflineTime(bigtime_t offTime)
 }
 
 
+status_t
+BMediaEventLooper::SetDeadlineRuntime(bigtime_t runtime)
+{
+	CALLED();
+
+	if (runtime < 0 || runtime > UINT32_MAX)
+		return B_BAD_VALUE;
+
+	fDeadlineRuntime = (uint32)runtime;
+	return _UpdateDeadline();
+}
+
+
 void
 BMediaEventLooper::Run()
 {
@@ -436,6 +458,8 @@ BMediaEventLooper::Run()
 	char threadName[32];
 	sprintf(threadName, "%.20s control", Name());
 	fControlThread = spawn_thread(_ControlThreadStart, threadName, fCurrentPriority, this);
+	if (fDeadlineRuntime != 0)
+		_UpdateDeadline();
 	resume_thread(fControlThread);
 
 	// get latency information
@@ -534,6 +558,36 @@ BMediaEventLooper::_DispatchCleanUp(const media_timed_event *event)
 		CleanUpEvent(event);
 }
 
+
+status_t
+BMediaEventLooper::_UpdateDeadline()
+{
+	if (fControlThread < 0)
+		return B_OK;
+			// will be applied by Run()
+
+	// The control thread has to handle one buffer per buffer duration, so
+	// that's the period and deadline it needs its runtime in.
+	bigtime_t period = fBufferDuration;
+	if (fDeadlineRuntime == 0 || period <= 0 || RunMode() == B_OFFLINE) {
+		set_thread_deadline(fControlThread, 0, 0, 0);
+		return B_OK;
+	}
+
+	if ((bigtime_t)fDeadlineRuntime > period) {
+		set_thread_deadline(fControlThread, 0, 0, 0);
+		return B_BAD_VALUE;
+	}
+
+	status_t status = set_thread_deadline(fControlThread, fDeadlineRuntime,
+		period, period);
+	if (status != B_OK) {
+		printf("BMediaEventLooper: could not reserve %" B_PRIu32 " us every %"
+			B_PRId64 " us: %s\n", fDeadlineRuntime, period, strerror(status));
+	}
+	return status;
+}
+
 /*
 // unimplemented
 BMediaEventLooper::BMediaEventLooper(const BMediaEventLooper &)
@@ -23,12 +23,18 @@
 #include <SymLink.h>
 #include <TypeConstants.h>
 
+#include <AutoDeleter.h>
+#include <unistd_private.h>
+
 
 namespace BPrivate {
 
 
 static const size_t kDefaultBufferSize = 1024 * 1024;
 static const size_t kSmallBufferSize = 64 * 1024;
+static const size_t kCopyRangeSize = 64 * 1024 * 1024;
+	// copy_file_range() is called in chunks, so that the copy can be
+	// interrupted
 
 
 // #pragma mark - BCopyEngine
@@ -339,6 +345,28 @@ BCopyEngine::_CopyFileData(const char* sourcePath, BFile& source,
 	const char* destPath, BFile& destination)
 {
 	off_t offset = 0;
+
+	// Let the kernel copy the data, so that it doesn't have to pass through
+	// our buffer. If that fails, we continue with reading and writing the
+	// data ourselves, which will also report the error, if any.
+	FileDescriptorCloser sourceFD(source.Dup());
+	FileDescriptorCloser destinationFD(destination.Dup());
+	if (sourceFD.IsSet() && destinationFD.IsSet()) {
+		while (true) {
+			off_t sourceOffset = offset;
+			off_t destinationOffset = offset;
+			ssize_t bytesCopied = __copy_file_range(sourceFD.Get(),
+				&sourceOffset, destinationFD.Get(), &destinationOffset,
+				kCopyRangeSize, 0);
+			if (bytesCopied == 0)
+				return B_OK;
+			if (bytesCopied < 0)
+				break;
+
+			offset += bytesCopied;
+		}
+	}
+
 	while (true) {
 		// read
 		ssize_t bytesRead = source.ReadAt(offset, fBuffer, fBufferSize);
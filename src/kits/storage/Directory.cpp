@@ -463,6 +463,38 @@ BDirectory::GetNextDirents(dirent* buf, size_t bufSize, int32 count)
 	return BPrivate::Storage::read_dir(fDirFd, &fDir, buf, bufSize, count);
 }
 
+/*!	\brief Returns the BDirectory's next entries as dirent structures,
+	together with the stat data of the nodes they refer to.
+	This is cheaper than calling GetNextDirents() and then stat'ing every
+	entry, since the entries are read from the file system in batches
+	along with their stat data.
+	\param buf a pointer to a buffer to be filled with dirent structures of
+		   the found entries
+	\param stats a pointer to an array of \a count stat structures to be
+		   filled in. An entry whose node could not be stat'ed gets a
+		   \c st_mode of \c 0.
+	\param count the maximal number of entries to be returned.
+	\note The iterator used by this method is the same one used by
+		  GetNextDirents().
+	\return
+	- The number of dirent structures stored in the buffer, 0 when there are
+	  no more entries to be returned.
+	- \c B_BAD_VALUE: \c NULL \a buf or \a stats.
+	- \c B_FILE_ERROR: A general file error.
+	- Any other error code GetNextDirents() returns.
+*/
+int32
+BDirectory::GetNextDirentsAndStats(dirent* buf, size_t bufSize,
+	struct stat* stats, int32 count)
+{
+	if (buf == NULL || stats == NULL)
+		return B_BAD_VALUE;
+	if (InitCheck() != B_OK)
+		return B_FILE_ERROR;
+	return BPrivate::Storage::read_dir_stat(fDirFd, &fDir, buf, bufSize,
+		stats, count);
+}
+
 
 status_t
 BDirectory::Rewind()
@@ -18,6 +18,7 @@
 #include <fs_query.h>	//  BeOS's C-based query functions
 #include <Entry.h>		// entry_ref
 #include <dirent.h>
+#include <dirent_private.h>
 
 #include <fsproto.h>
 
@@ -776,6 +777,46 @@ BPrivate::Storage::read_dir( int dir, DIR** dirDir, DirEntry *buffer, size_t len
 	return result;
 }
 
+/*!	Works like read_dir(), but additionally fills in the stat data of the
+	nodes the entries refer to. Entries whose node could not be stat'ed have
+	a \c st_mode of \c 0.
+	\param dir the directory
+	\param buffer the dirent structure to be filled
+	\param length the size of the dirent structure
+	\param stats the stat structures to be filled, one per entry
+	\param count the maximal number of entries to be read
+	\return
+	- the number of entries stored in the supplied buffer,
+	- \c 0, if at the end of the entry list,
+	- \c B_BAD_VALUE, if \a buffer or \a stats is NULL, or the supplied
+	  buffer is too small
+*/
+int32
+BPrivate::Storage::read_dir_stat( int dir, DIR** dirDir, DirEntry *buffer,
+					  size_t length, struct stat *stats, int32 count )
+{
+	// init a DIR structure
+	if (*dirDir == NULL)
+		*dirDir = opendirfd(dir);
+	// check parameters
+	int32 result = (buffer == NULL || stats == NULL ? B_BAD_VALUE : 0);
+	if (result == 0 && count > 0) {
+		// read one entry and its stat data, and copy them into the buffers
+		errno = 0;
+		if (dirent *entry = __readdir_stat(*dirDir, stats)) {
+			// see read_dir() on why d_reclen can't be trusted
+			size_t entryLen = entry->d_name + strlen(entry->d_name) + 1
+							  - (char*)entry;
+			if (length >= entryLen) {
+				memcpy(buffer, entry, entryLen);
+				result = 1;
+			} else	// buffer too small
+				result = B_BAD_VALUE;
+		}
+	}
+	return result;
+}
+
 status_t
 BPrivate::Storage::rewind_dir( DIR* dir )
 {
@@ -195,6 +195,10 @@ status_t create_dir(const char *path, int &result,
 int32 read_dir(int dir, DIR** dirDir, DirEntry *buffer, size_t length,
 				int32 count = INT_MAX);
 
+//! Returns the next entries in the given directory and their stat data.
+int32 read_dir_stat(int dir, DIR** dirDir, DirEntry *buffer, size_t length,
+				struct stat *stats, int32 count = INT_MAX);
+
 /*! Rewindes the directory to the first entry in the list. */
 status_t rewind_dir(DIR* dir);
 
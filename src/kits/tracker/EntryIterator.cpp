@@ -39,7 +39,9 @@ All rights reserved.
 #include <Path.h>
 
 #include <new>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "EntryIterator.h"
 
@@ -128,6 +130,17 @@ EntryListBase::InitCheck() const
 }
 
 
+int32
+EntryListBase::GetNextDirentsAndStats(struct dirent* buffer, size_t length,
+	struct stat* stats, int32 count)
+{
+	int32 result = GetNextDirents(buffer, length, count);
+	SetUnknownStats(buffer, stats, result);
+
+	return result;
+}
+
+
 dirent*
 EntryListBase::Next(dirent* ent)
 {
@@ -135,6 +148,39 @@ EntryListBase::Next(dirent* ent)
 }
 
 
+/*static*/ int32
+EntryListBase::GetNextDirentsAndStats(BEntryList* list, struct dirent* buffer,
+	size_t length, struct stat* stats, int32 count)
+{
+	BDirectory* directory = dynamic_cast<BDirectory*>(list);
+	if (directory != NULL)
+		return directory->GetNextDirentsAndStats(buffer, length, stats, count);
+
+	EntryListBase* entryList = dynamic_cast<EntryListBase*>(list);
+	if (entryList != NULL)
+		return entryList->GetNextDirentsAndStats(buffer, length, stats, count);
+
+	int32 result = list->GetNextDirents(buffer, length, count);
+	SetUnknownStats(buffer, stats, result);
+
+	return result;
+}
+
+
+/*static*/ void
+EntryListBase::SetUnknownStats(const dirent* buffer, struct stat* stats,
+	int32 count)
+{
+	// only the node is known, a zero st_mode tells the caller to stat it
+	for (int32 index = 0; index < count; index++) {
+		memset(&stats[index], 0, sizeof(struct stat));
+		stats[index].st_dev = buffer->d_dev;
+		stats[index].st_ino = buffer->d_ino;
+		buffer = (const dirent*)((const char*)buffer + buffer->d_reclen);
+	}
+}
+
+
 //	#pragma mark - CachedEntryIterator
 
 
@@ -150,6 +196,8 @@ CachedEntryIterator::CachedEntryIterator(BEntryList* iterator,
 	fCurrentDirent(NULL),
 	fSortInodes(sortInodes),
 	fSortedList(NULL),
+	fStatBuffer(NULL),
+	fHasStats(false),
 	fEntryBuffer(NULL)
 {
 }
@@ -160,6 +208,7 @@ CachedEntryIterator::~CachedEntryIterator()
 	delete[] fEntryRefBuffer;
 	free(fDirentBuffer);
 	delete fSortedList;
+	delete[] fStatBuffer;
 	delete[] fEntryBuffer;
 }
 
@@ -239,8 +288,35 @@ CachedEntryIterator::_CompareInodes(const dirent* ent1, const dirent* ent2)
 	if (ent1->d_ino < ent2->d_ino)
 		return -1;
 
-	if (ent1->d_ino == ent2->d_ino)
-		return 0;
+	if (ent1->d_ino == ent2->d_ino) {
+		// the device breaks ties, so that the order matches the one of
+		// _CompareStatInodes()
+		if (ent1->d_dev < ent2->d_dev)
+			return -1;
+
+		return ent1->d_dev == ent2->d_dev ? 0 : 1;
+	}
+
+	return 1;
+}
+
+
+/*static*/ int
+CachedEntryIterator::_CompareStatInodes(const void* _stat1,
+	const void* _stat2)
+{
+	const struct stat* stat1 = (const struct stat*)_stat1;
+	const struct stat* stat2 = (const struct stat*)_stat2;
+
+	if (stat1->st_ino < stat2->st_ino)
+		return -1;
+
+	if (stat1->st_ino == stat2->st_ino) {
+		if (stat1->st_dev < stat2->st_dev)
+			return -1;
+
+		return stat1->st_dev == stat2->st_dev ? 0 : 1;
+	}
 
 	return 1;
 }
@@ -249,6 +325,22 @@ CachedEntryIterator::_CompareInodes(const dirent* ent1, const dirent* ent2)
 int32
 CachedEntryIterator::GetNextDirents(struct dirent* ent, size_t size,
 	int32 count)
+{
+	return _GetNextDirent(ent, size, NULL, count);
+}
+
+
+int32
+CachedEntryIterator::GetNextDirentsAndStats(struct dirent* ent, size_t size,
+	struct stat* stats, int32 count)
+{
+	return _GetNextDirent(ent, size, stats, count);
+}
+
+
+int32
+CachedEntryIterator::_GetNextDirent(struct dirent* ent, size_t size,
+	struct stat* stat, int32 count)
 {
 	ASSERT(fEntryRefBuffer == NULL);
 	if (fDirentBuffer == NULL) {
@@ -262,11 +354,17 @@ CachedEntryIterator::GetNextDirents(struct dirent* ent, size_t size,
 
 	if (fIndex >= fNumEntries) {
 		// we are out of stock, cache em up
+		if (stat != NULL && fStatBuffer == NULL)
+			fStatBuffer = new struct stat[fCacheSize];
+		fHasStats = stat != NULL;
+
 		fCurrentDirent = fDirentBuffer;
 		int32 bufferRemain = kDirentBufferSize;
 		for (fNumEntries = 0; fNumEntries < fCacheSize; ) {
-			int32 count = fIterator->GetNextDirents(fCurrentDirent,
-				bufferRemain, 1);
+			int32 count = fHasStats
+				? EntryListBase::GetNextDirentsAndStats(fIterator,
+					fCurrentDirent, bufferRemain, &fStatBuffer[fNumEntries], 1)
+				: fIterator->GetNextDirents(fCurrentDirent, bufferRemain, 1);
 
 			if (count <= 0)
 				break;
@@ -300,6 +398,13 @@ CachedEntryIterator::GetNextDirents(struct dirent* ent, size_t size,
 			}
 			fSortedList->SortItems(&_CompareInodes);
 			fCurrentDirent = fDirentBuffer;
+
+			// sorting the stats the same way keeps them in line with the
+			// dirents; entries with equal nodes have equal stats, too
+			if (fHasStats) {
+				qsort(fStatBuffer, fNumEntries, sizeof(struct stat),
+					&_CompareStatInodes);
+			}
 		}
 		fIndex = 0;
 	}
@@ -311,6 +416,13 @@ CachedEntryIterator::GetNextDirents(struct dirent* ent, size_t size,
 	if (fSortInodes)
 		fCurrentDirent = fSortedList->ItemAt(fIndex);
 
+	if (stat != NULL) {
+		if (fHasStats)
+			*stat = fStatBuffer[fIndex];
+		else
+			SetUnknownStats(fCurrentDirent, stat, 1);
+	}
+
 	fIndex++;
 	uint32 currentDirentSize = fCurrentDirent->d_reclen;
 	ASSERT(currentDirentSize <= size);
@@ -412,6 +524,15 @@ DirectoryEntryList::GetNextDirents(struct dirent* buffer, size_t length,
 }
 
 
+int32
+DirectoryEntryList::GetNextDirentsAndStats(struct dirent* buffer,
+	size_t length, struct stat* stats, int32 count)
+{
+	fStatus = fDirectory.GetNextDirentsAndStats(buffer, length, stats, count);
+	return fStatus;
+}
+
+
 status_t
 DirectoryEntryList::Rewind()
 {
@@ -522,6 +643,30 @@ EntryIteratorList::GetNextDirents(struct dirent* buffer, size_t length,
 }
 
 
+int32
+EntryIteratorList::GetNextDirentsAndStats(struct dirent* buffer,
+	size_t length, struct stat* stats, int32 count)
+{
+	int32 result = 0;
+	while (true) {
+		if (fCurrentIndex >= fList.CountItems()) {
+			fStatus = B_ENTRY_NOT_FOUND;
+			break;
+		}
+
+		result = EntryListBase::GetNextDirentsAndStats(
+			fList.ItemAt(fCurrentIndex), buffer, length, stats, count);
+		if (result > 0) {
+			fStatus = B_OK;
+			break;
+		}
+
+		fCurrentIndex++;
+	}
+	return result;
+}
+
+
 status_t
 EntryIteratorList::Rewind()
 {
@@ -61,12 +61,23 @@ public:
 	virtual status_t GetNextRef(entry_ref* ref) = 0;
 	virtual int32 GetNextDirents(struct dirent* buffer, size_t length,
 		int32 count = INT_MAX) = 0;
+	virtual int32 GetNextDirentsAndStats(struct dirent* buffer,
+		size_t length, struct stat* stats, int32 count = INT_MAX);
+		// like GetNextDirents(), but also returns the stat data of the
+		// entries; stats that could not be retrieved have a zero st_mode
 
 	virtual status_t Rewind() = 0;
 	virtual int32 CountEntries() = 0;
 
 	static dirent* Next(dirent*);
 
+	static int32 GetNextDirentsAndStats(BEntryList* list,
+		struct dirent* buffer, size_t length, struct stat* stats,
+		int32 count = INT_MAX);
+		// uses the batched variant if <list> supports it
+	static void SetUnknownStats(const dirent* buffer, struct stat* stats,
+		int32 count);
+
 protected:
 	status_t fStatus;
 };
@@ -114,6 +125,8 @@ public:
 	virtual status_t GetNextRef(entry_ref* ref);
 	virtual int32 GetNextDirents(struct dirent* buffer, size_t length,
 		int32 count = INT_MAX);
+	virtual int32 GetNextDirentsAndStats(struct dirent* buffer,
+		size_t length, struct stat* stats, int32 count = INT_MAX);
 
 	virtual status_t Rewind();
 	virtual int32 CountEntries();
@@ -122,7 +135,11 @@ public:
 		// CachedEntryIterator does not get to own the <iterator>
 
 private:
+	int32 _GetNextDirent(struct dirent* buffer, size_t length,
+		struct stat* stat, int32 count);
+
 	static int _CompareInodes(const dirent* ent1, const dirent* ent2);
+	static int _CompareStatInodes(const void* stat1, const void* stat2);
 
 	BEntryList* fIterator;
 	entry_ref* fEntryRefBuffer;
@@ -135,6 +152,10 @@ private:
 	bool fSortInodes;
 	BObjectList<dirent>* fSortedList;
 
+	struct stat* fStatBuffer;
+		// stats of the cached dirents, in the same order
+	bool fHasStats;
+
 	BEntry* fEntryBuffer;
 };
 
@@ -147,6 +168,8 @@ public:
 	virtual status_t GetNextRef(entry_ref* ref);
 	virtual int32 GetNextDirents(struct dirent* buffer, size_t length,
 		int32 count = INT_MAX);
+	virtual int32 GetNextDirentsAndStats(struct dirent* buffer,
+		size_t length, struct stat* stats, int32 count = INT_MAX);
 
 	virtual status_t Rewind();
 	virtual int32 CountEntries();
@@ -184,6 +207,8 @@ public:
 	virtual status_t GetNextRef(entry_ref* ref);
 	virtual int32 GetNextDirents(struct dirent* buffer, size_t length,
 		int32 count = INT_MAX);
+	virtual int32 GetNextDirentsAndStats(struct dirent* buffer,
+		size_t length, struct stat* stats, int32 count = INT_MAX);
 
 	virtual status_t Rewind();
 	virtual int32 CountEntries();
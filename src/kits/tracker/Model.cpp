@@ -145,6 +145,19 @@ Model::Model(const node_ref* dirNode, const node_ref* node, const char* name,
 }
 
 
+Model::Model(const node_ref* dirNode, const node_ref* node, const char* name,
+	const StatStruct* stat, bool open, bool writable)
+	:
+	fPreferredAppName(NULL),
+	fWritable(false),
+	fNode(NULL),
+	fHasLocalizedName(false),
+	fLocalizedNameIsCached(false)
+{
+	SetTo(dirNode, node, name, stat, open, writable);
+}
+
+
 Model::Model(const BEntry* entry, bool open, bool writable)
 	:
 	fPreferredAppName(NULL),
@@ -277,6 +290,14 @@ Model::SetTo(const entry_ref* newRef, bool traverse, bool open, bool writable)
 status_t
 Model::SetTo(const node_ref* dirNode, const node_ref* nodeRef,
 	const char* name, bool open, bool writable)
+{
+	return SetTo(dirNode, nodeRef, name, NULL, open, writable);
+}
+
+
+status_t
+Model::SetTo(const node_ref* dirNode, const node_ref* nodeRef,
+	const char* name, const StatStruct* stat, bool open, bool writable)
 {
 	delete fNode;
 	fNode = NULL;
@@ -291,14 +312,19 @@ Model::SetTo(const node_ref* dirNode, const node_ref* nodeRef,
 	fEntryRef.directory = dirNode->node;
 	fEntryRef.name = strdup(name);
 
-	BEntry tmpNode(&fEntryRef);
-	fStatus = tmpNode.InitCheck();
-	if (fStatus != B_OK)
-		return fStatus;
-
-	fStatus = tmpNode.GetStat(&fStatBuf);
-	if (fStatus != B_OK)
-		return fStatus;
+	if (stat != NULL && stat->st_mode != 0) {
+		// the stat came along with the directory entry
+		fStatBuf = *stat;
+	} else {
+		BEntry tmpNode(&fEntryRef);
+		fStatus = tmpNode.InitCheck();
+		if (fStatus != B_OK)
+			return fStatus;
+
+		fStatus = tmpNode.GetStat(&fStatBuf);
+		if (fStatus != B_OK)
+			return fStatus;
+	}
 
 	fStatus = OpenNode(writable);
 
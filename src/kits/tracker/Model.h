@@ -84,6 +84,8 @@ public:
 		bool writable = false);
 	Model(const node_ref* dirNode, const node_ref* node, const char* name,
 		bool open = false, bool writable = false);
+	Model(const node_ref* dirNode, const node_ref* node, const char* name,
+		const StatStruct* stat, bool open = false, bool writable = false);
 	~Model();
 
 	Model& operator=(const Model&);
@@ -96,6 +98,11 @@ public:
 		bool open = false, bool writable = false);
 	status_t SetTo(const node_ref* dirNode, const node_ref* node,
 		const char* name, bool open = false, bool writable = false);
+	status_t SetTo(const node_ref* dirNode, const node_ref* node,
+		const char* name, const StatStruct* stat, bool open = false,
+		bool writable = false);
+		// uses the already known <stat> instead of reading it again,
+		// unless its st_mode is zero
 
 	int CompareFolderNamesFirst(const Model* compareModel) const;
 
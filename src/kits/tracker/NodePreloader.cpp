@@ -36,6 +36,8 @@ All rights reserved.
 //	fast display
 //
 
+#include <string.h>
+
 #include <Debug.h>
 #include <Directory.h>
 #include <Entry.h>
@@ -176,18 +178,28 @@ NodePreloader::PreloadOne(const char* dirPath)
 	// have to node monitor the whole directory
 	TTracker::WatchNode(&nodeRef, B_WATCH_DIRECTORY, this);
 
+	// read the entries together with their stat data, so that files can be
+	// told apart from other nodes without stat'ing each of them
+	char buffer[sizeof(dirent) + B_FILE_NAME_LENGTH];
+	dirent* entry = (dirent*)buffer;
+	StatStruct stat;
+
 	dir.Rewind();
-	for (;;) {
-		entry_ref ref;
-		if (dir.GetNextRef(&ref) != B_OK)
-			break;
+	while (dir.GetNextDirentsAndStats(entry, sizeof(buffer), &stat, 1) == 1) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+			continue;
+
+		node_ref itemNode(entry->d_dev, entry->d_ino);
+		if (stat.st_mode == 0) {
+			// the stat could not be read along with the entry
+			BEntry(&dir, entry->d_name).GetStat(&stat);
+		}
 
-		BEntry entry(&ref);
-		if (!entry.IsFile())
+		if (!S_ISREG(stat.st_mode))
 			// only interrested in files
 			continue;
 
-		Model* model = new Model(&ref, true);
+		Model* model = new Model(&nodeRef, &itemNode, entry->d_name, &stat);
 		if (model->InitCheck() == B_OK && model->IconFrom() == kUnknownSource) {
 			TTracker::WatchNode(model->NodeRef(),
 				B_WATCH_STAT | B_WATCH_ATTR, this);
@@ -1443,11 +1443,15 @@ BPoseView::AddPosesTask(void* castToParams)
 			status_t result = B_OK;
 			char entBuf[1024];
 			dirent* eptr = (dirent*)entBuf;
+			StatStruct stat;
 			Model* model = 0;
 			node_ref dirNode;
 			node_ref itemNode;
 
-			int32 count = container->GetNextDirents(eptr, 1024, 1);
+			// the stat data is read along with the entries, saving a
+			// separate stat() for every new model
+			int32 count = container->GetNextDirentsAndStats(eptr, 1024,
+				&stat, 1);
 			if (count <= 0 && modelChunkIndex == -1)
 				break;
 
@@ -1470,7 +1474,8 @@ BPoseView::AddPosesTask(void* castToParams)
 					// cache up the file type and preferred app
 					// OK to call when poseView is not locked
 
-				model = new Model(&dirNode, &itemNode, eptr->d_name, false);
+				model = new Model(&dirNode, &itemNode, eptr->d_name, &stat,
+					false);
 				result = model->InitCheck();
 				modelChunkIndex++;
 				posesResult->fModels[modelChunkIndex] = model;
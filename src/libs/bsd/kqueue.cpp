@@ -25,11 +25,11 @@ kqueue()
 
 
 static short
-filter_from_info(const event_wait_info& info)
+filter_from_info(uint16 type, int32 events)
 {
-	switch (info.type) {
+	switch (type) {
 		case B_OBJECT_TYPE_FD:
-			if (info.events > 0 && (info.events & B_EVENT_WRITE) != 0)
+			if (events > 0 && (events & B_EVENT_WRITE) != 0)
 				return EVFILT_WRITE;
 			return EVFILT_READ;
 
@@ -47,30 +47,40 @@ kevent(int kq,
 	struct kevent *eventlist, int nevents,
 	const struct timespec *tspec)
 {
-	BStackOrHeapArray<event_wait_info, 16> waitInfos(max_c(nchanges, nevents));
+	// The changes are applied and the events waited for in a single syscall.
+	// Since a descriptor might produce both a read and a write event, we
+	// only ask for half as many events as we can return.
+	const int waitInfoCount = nevents != 0 ? max_c(1, nevents / 2) : 0;
+
+	BStackOrHeapArray<event_queue_change, 16> changes(nchanges);
+	BStackOrHeapArray<event_wait_info, 16> waitInfos(waitInfoCount);
+	if (!changes.IsValid() || !waitInfos.IsValid()) {
+		__set_errno(ENOMEM);
+		return -1;
+	}
 
-	event_wait_info* waitInfo = waitInfos;
+	event_queue_change* change = changes;
 	int changedInfos = 0;
 
 	for (int i = 0; i < nchanges; i++) {
-		waitInfo->object = changelist[i].ident;
-		waitInfo->events = 0;
-		waitInfo->user_data = changelist[i].udata;
+		change->object = changelist[i].ident;
+		change->events = 0;
+		change->user_data = changelist[i].udata;
 
 		int32 events = 0, behavior = 0;
 		switch (changelist[i].filter) {
 			case EVFILT_READ:
-				waitInfo->type = B_OBJECT_TYPE_FD;
+				change->type = B_OBJECT_TYPE_FD;
 				events = B_EVENT_READ;
 				break;
 
 			case EVFILT_WRITE:
-				waitInfo->type = B_OBJECT_TYPE_FD;
+				change->type = B_OBJECT_TYPE_FD;
 				events = B_EVENT_WRITE;
 				break;
 
 			case EVFILT_PROC:
-				waitInfo->type = B_OBJECT_TYPE_THREAD;
+				change->type = B_OBJECT_TYPE_THREAD;
 				if ((changelist[i].fflags & NOTE_EXIT) != 0)
 					events |= B_EVENT_INVALID;
 				break;
@@ -120,83 +130,93 @@ kevent(int kq,
 
 				// Fold it into this one.
 				if ((changelist[j].flags & EV_ADD) != 0) {
-					waitInfo->events |= otherEvents;
+					change->events |= otherEvents;
 				} else if ((changelist[j].flags & EV_DELETE) != 0) {
-					waitInfo->events &= ~otherEvents;
+					change->events &= ~otherEvents;
 				}
 			} else {
 				// It is not in the list. See if it's already set.
 				event_wait_info info;
 				info.type = B_OBJECT_TYPE_FD;
-				info.object = waitInfo->object;
+				info.object = change->object;
 				info.events = -1;
 
 				status_t status = _kern_event_queue_select(kq, &info, 1);
 				if (status == B_OK)
-					waitInfo->events |= (info.events & otherEvents);
+					change->events |= (info.events & otherEvents);
 			}
 		}
 
 		if ((changelist[i].flags & EV_ADD) != 0) {
-			waitInfo->events |= events;
+			change->events |= events;
 		} else if ((changelist[i].flags & EV_DELETE) != 0) {
-			waitInfo->events &= ~events;
+			change->events &= ~events;
 		}
 
-		if (waitInfo->events != 0)
-			waitInfo->events |= behavior;
+		if (change->events != 0) {
+			change->events |= behavior;
+			change->operation = EVENT_QUEUE_CHANGE_MODIFY;
+		} else
+			change->operation = EVENT_QUEUE_CHANGE_DELETE;
+		change->status = B_OK;
 
 		changedInfos++;
-		waitInfo++;
+		change++;
 	}
-	if (changedInfos != 0) {
-		status_t status = _kern_event_queue_select(kq, waitInfos, changedInfos);
-		if (status != B_OK) {
-			if (nchanges == 1 && nevents == 0) {
-				// Special case: return the lone error directly.
-				__set_errno(waitInfos[0].events);
-				return -1;
-			}
 
-			// Report problems as error events.
-			int errors = 0;
-			for (int i = 0; i < changedInfos; i++) {
-				if (waitInfos[i].events > 0)
-					continue;
-				if (nevents == 0) {
-					errors = -1;
-					break;
-				}
+	bigtime_t timeout = 0;
+	uint32 waitFlags = 0;
+	if (nevents != 0 && tspec != NULL) {
+		if (!timespec_to_bigtime(*tspec, timeout)) {
+			__set_errno(EINVAL);
+			return -1;
+		}
+		waitFlags |= B_RELATIVE_TIMEOUT;
+	}
 
-				short filter = filter_from_info(waitInfos[i]);
-				int64_t data = waitInfos[i].events;
-				EV_SET(eventlist, waitInfos[i].object,
-					filter, EV_ERROR, 0, data, waitInfos[i].user_data);
-				eventlist++;
-				nevents--;
-				errors++;
-			}
+	ssize_t events = _kern_event_queue_submit(kq, changes, changedInfos,
+		waitInfos, waitInfoCount, waitFlags, timeout, NULL);
 
-			if (errors > 0)
-				return errors;
-			__set_errno(status);
+	bool changeFailed = false;
+	for (int i = 0; i < changedInfos; i++) {
+		if (changes[i].status != B_OK)
+			changeFailed = true;
+	}
+
+	if (changeFailed) {
+		if (nchanges == 1 && nevents == 0) {
+			// Special case: return the lone error directly.
+			__set_errno(changes[0].status);
 			return -1;
 		}
-	}
 
-	if (nevents != 0) {
-		bigtime_t timeout = 0;
-		uint32 waitFlags = 0;
-		if (tspec != NULL) {
-			if (!timespec_to_bigtime(*tspec, timeout)) {
-				__set_errno(EINVAL);
-				return -1;
+		// Report problems as error events.
+		int errors = 0;
+		for (int i = 0; i < changedInfos; i++) {
+			if (changes[i].status == B_OK)
+				continue;
+			if (nevents == 0) {
+				errors = -1;
+				break;
 			}
-			waitFlags |= B_RELATIVE_TIMEOUT;
+
+			short filter = filter_from_info(changes[i].type,
+				changes[i].events);
+			int64_t data = changes[i].status;
+			EV_SET(eventlist, changes[i].object,
+				filter, EV_ERROR, 0, data, changes[i].user_data);
+			eventlist++;
+			nevents--;
+			errors++;
 		}
 
-		ssize_t events = _kern_event_queue_wait(kq, waitInfos,
-			max_c(1, nevents / 2), waitFlags, timeout);
+		if (errors > 0)
+			return errors;
+		__set_errno(events);
+		return -1;
+	}
+
+	if (nevents != 0) {
 		if (events > 0) {
 			int returnedEvents = 0;
 			for (ssize_t i = 0; i < events; i++) {
@@ -232,7 +252,8 @@ kevent(int kq,
 					data = EINVAL;
 				}
 
-				short filter = filter_from_info(waitInfos[i]);
+				short filter = filter_from_info(waitInfos[i].type,
+					waitInfos[i].events);
 				if (waitInfos[i].type == B_OBJECT_TYPE_FD && (flags & (EV_ERROR | EV_EOF)) == 0) {
 					// Do we have both a read and a write event?
 					if ((waitInfos[i].events & (B_EVENT_READ | B_EVENT_WRITE))
@@ -266,5 +287,10 @@ kevent(int kq,
 		return 0;
 	}
 
+	if (events < 0) {
+		__set_errno(events);
+		return -1;
+	}
+
 	return 0;
 }
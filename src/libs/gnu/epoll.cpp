@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <sys/epoll.h>
+
+#include <errno.h>
+
+#include <OS.h>
+#include <StackOrHeapArray.h>
+
+#include <event_queue_defs.h>
+#include <syscalls.h>
+#include <syscall_utils.h>
+
+
+/*!	Unlike on Linux, a one-shot event is removed from the queue after it has
+	been delivered, instead of just being disabled. Since EPOLL_CTL_MOD is
+	mapped to EVENT_QUEUE_CHANGE_MODIFY, which selects an object even when it
+	has no selection yet, re-arming works nevertheless.
+*/
+
+
+static int32
+events_from_epoll(uint32_t epollEvents)
+{
+	int32 events = 0;
+	if ((epollEvents & (EPOLLIN | EPOLLRDNORM)) != 0)
+		events |= B_EVENT_READ;
+	if ((epollEvents & (EPOLLOUT | EPOLLWRNORM)) != 0)
+		events |= B_EVENT_WRITE;
+	if ((epollEvents & (EPOLLPRI | EPOLLRDBAND)) != 0)
+		events |= B_EVENT_PRIORITY_READ;
+	if ((epollEvents & EPOLLWRBAND) != 0)
+		events |= B_EVENT_PRIORITY_WRITE;
+
+	// Errors and hang-ups are always reported. Make sure we select at least
+	// those, if nothing else has been asked for.
+	events |= B_EVENT_ERROR | B_EVENT_DISCONNECTED;
+
+	if ((epollEvents & EPOLLET) == 0)
+		events |= B_EVENT_LEVEL_TRIGGERED;
+	if ((epollEvents & EPOLLONESHOT) != 0)
+		events |= B_EVENT_ONE_SHOT;
+
+	return events;
+}
+
+
+static uint32_t
+events_to_epoll(int32 events)
+{
+	if (events < 0)
+		return EPOLLERR;
+
+	uint32_t epollEvents = 0;
+	if ((events & B_EVENT_READ) != 0)
+		epollEvents |= EPOLLIN | EPOLLRDNORM;
+	if ((events & B_EVENT_WRITE) != 0)
+		epollEvents |= EPOLLOUT | EPOLLWRNORM;
+	if ((events & B_EVENT_PRIORITY_READ) != 0)
+		epollEvents |= EPOLLPRI | EPOLLRDBAND;
+	if ((events & B_EVENT_PRIORITY_WRITE) != 0)
+		epollEvents |= EPOLLWRBAND;
+	if ((events & B_EVENT_ERROR) != 0)
+		epollEvents |= EPOLLERR;
+	if ((events & B_EVENT_DISCONNECTED) != 0)
+		epollEvents |= EPOLLHUP | EPOLLRDHUP;
+
+	return epollEvents;
+}
+
+
+extern "C" int
+epoll_create1(int flags)
+{
+	if ((flags & ~EPOLL_CLOEXEC) != 0)
+		RETURN_AND_SET_ERRNO(B_BAD_VALUE);
+
+	RETURN_AND_SET_ERRNO(_kern_event_queue_create(
+		(flags & EPOLL_CLOEXEC) != 0 ? O_CLOEXEC : 0));
+}
+
+
+extern "C" int
+epoll_create(int size)
+{
+	if (size <= 0)
+		RETURN_AND_SET_ERRNO(B_BAD_VALUE);
+
+	return epoll_create1(0);
+}
+
+
+extern "C" int
+epoll_ctl(int epfd, int op, int fd, struct epoll_event* event)
+{
+	if (fd == epfd)
+		RETURN_AND_SET_ERRNO(B_BAD_VALUE);
+
+	event_queue_change change;
+	change.object = fd;
+	change.type = B_OBJECT_TYPE_FD;
+	change.events = 0;
+	change.status = B_OK;
+	change.user_data = NULL;
+
+	switch (op) {
+		case EPOLL_CTL_ADD:
+			change.operation = EVENT_QUEUE_CHANGE_ADD;
+			break;
+		case EPOLL_CTL_MOD:
+			change.operation = EVENT_QUEUE_CHANGE_MODIFY;
+			break;
+		case EPOLL_CTL_DEL:
+			change.operation = EVENT_QUEUE_CHANGE_DELETE;
+			break;
+		default:
+			RETURN_AND_SET_ERRNO(B_BAD_VALUE);
+	}
+
+	if (op != EPOLL_CTL_DEL) {
+		if (event == NULL)
+			RETURN_AND_SET_ERRNO(B_BAD_ADDRESS);
+
+		change.events = events_from_epoll(event->events);
+		change.user_data = (void*)(addr_t)event->data.u64;
+	}
+
+	status_t status = _kern_event_queue_submit(epfd, &change, 1, NULL, 0, 0,
+		0, NULL);
+	if (status == B_ERROR && change.status != B_OK)
+		status = change.status;
+
+	RETURN_AND_SET_ERRNO(status);
+}
+
+
+extern "C" int
+epoll_pwait(int epfd, struct epoll_event* events, int maxEvents, int timeout,
+	const sigset_t* sigMask)
+{
+	if (maxEvents <= 0)
+		RETURN_AND_SET_ERRNO(B_BAD_VALUE);
+
+	BStackOrHeapArray<event_wait_info, 16> infos(maxEvents);
+	if (!infos.IsValid())
+		RETURN_AND_SET_ERRNO(B_NO_MEMORY);
+
+	uint32 flags = 0;
+	bigtime_t waitTimeout = 0;
+	if (timeout >= 0) {
+		flags = B_RELATIVE_TIMEOUT;
+		waitTimeout = (bigtime_t)timeout * 1000;
+	}
+
+	while (true) {
+		ssize_t count = _kern_event_queue_submit(epfd, NULL, 0, infos,
+			maxEvents, flags, waitTimeout, sigMask);
+		if (count == B_WOULD_BLOCK || count == B_TIMED_OUT)
+			return 0;
+		if (count < 0)
+			RETURN_AND_SET_ERRNO_TEST_CANCEL(count);
+
+		int returned = 0;
+		for (ssize_t i = 0; i < count; i++) {
+			// Closed descriptors silently leave the set, as on Linux.
+			if (infos[i].events > 0
+				&& (infos[i].events & ~B_EVENT_INVALID) == 0) {
+				continue;
+			}
+
+			events[returned].events = events_to_epoll(infos[i].events);
+			events[returned].data.u64 = (addr_t)infos[i].user_data;
+			returned++;
+		}
+
+		// Only wait again, if we would otherwise return nothing, although we
+		// were asked to wait forever.
+		if (returned > 0 || timeout >= 0)
+			RETURN_AND_TEST_CANCEL(returned);
+	}
+}
+
+
+extern "C" int
+epoll_wait(int epfd, struct epoll_event* events, int maxEvents, int timeout)
+{
+	return epoll_pwait(epfd, events, maxEvents, timeout, NULL);
+}
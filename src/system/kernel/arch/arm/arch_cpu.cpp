@@ -10,6 +10,8 @@
  */
 
 
+#include <string.h>
+
 #include <KernelExport.h>
 
 #include <arch/cpu.h>
@@ -74,6 +76,14 @@ arch_cpu_sync_icache(void *address, size_t len)
 }
 
 
+void
+arch_cpu_clear_page_nontemporal(void* address)
+{
+	// no cache bypassing stores available -- just clear the page
+	memset(address, 0, B_PAGE_SIZE);
+}
+
+
 void
 arch_cpu_invalidate_TLB_page(addr_t page)
 {
@@ -86,6 +86,20 @@ arch_cpu_sync_icache(void *address, size_t len)
 }
 
 
+void
+arch_cpu_clear_page_nontemporal(void* address)
+{
+	// stnp hints that the data won't be accessed soon, so that clearing pages
+	// ahead of time doesn't evict anything useful from the caches.
+	uint64* word = (uint64*)address;
+	uint64* end = word + B_PAGE_SIZE / sizeof(uint64);
+	for (; word < end; word += 2)
+		asm volatile("stnp xzr, xzr, [%0]" : : "r" (word) : "memory");
+
+	asm volatile("dmb ishst" : : : "memory");
+}
+
+
 void
 arch_cpu_invalidate_TLB_range(addr_t start, addr_t end)
 {
@@ -2050,3 +2050,29 @@ arch_cpu_sync_icache(void* address, size_t length)
 	// instruction cache is always consistent on x86
 }
 
+
+void
+arch_cpu_clear_page_nontemporal(void* address)
+{
+#ifndef __x86_64__
+	if (!x86_check_feature(IA32_FEATURE_SSE2, FEATURE_COMMON)) {
+		memset(address, 0, B_PAGE_SIZE);
+		return;
+	}
+#endif
+
+	// movnti bypasses the caches, so that clearing pages ahead of time
+	// doesn't evict anything useful.
+	addr_t* word = (addr_t*)address;
+	addr_t* end = word + B_PAGE_SIZE / sizeof(addr_t);
+	for (; word < end; word += 4) {
+		asm volatile("movnti %1, %0" : "=m" (word[0]) : "r" ((addr_t)0));
+		asm volatile("movnti %1, %0" : "=m" (word[1]) : "r" ((addr_t)0));
+		asm volatile("movnti %1, %0" : "=m" (word[2]) : "r" ((addr_t)0));
+		asm volatile("movnti %1, %0" : "=m" (word[3]) : "r" ((addr_t)0));
+	}
+
+	// order the weakly ordered stores before anyone can get hold of the page
+	asm volatile("sfence" : : : "memory");
+}
+
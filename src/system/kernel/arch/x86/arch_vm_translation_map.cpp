@@ -19,6 +19,7 @@
 #	include "paging/32bit/X86PagingMethod32Bit.h"
 #	include "paging/pae/X86PagingMethodPAE.h"
 #endif
+#include "paging/X86VMTranslationMap.h"
 
 
 //#define TRACE_VM_TMAP
@@ -137,6 +138,8 @@ arch_vm_translation_map_init_post_area(kernel_args *args)
 {
 	TRACE("vm_translation_map_init_post_area: entry\n");
 
+	x86_vm_translation_map_init_post_area();
+
 	return gX86PagingMethod->InitPostArea(args);
 }
 
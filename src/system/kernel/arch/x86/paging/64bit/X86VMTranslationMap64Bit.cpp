@@ -94,6 +94,12 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
 						continue;
 
+					if ((virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
+						// The pages belong to the area's cache, the page table
+						// kept for the large page is freed below.
+						continue;
+					}
+
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
 					if (page == NULL) {
@@ -142,6 +148,17 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		}
 	}
 
+	// Free the page tables kept for large pages that were never split.
+	page = fLargePageTables.Clear(true);
+	while (page != NULL) {
+		vm_page* next = page->cache_next;
+		page->cache_next = NULL;
+
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_free_etc(NULL, page, &reservation);
+		page = next;
+	}
+
 	vm_page_unreserve_pages(&reservation);
 
 	fPageMapper->Delete();
@@ -280,6 +297,8 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -303,10 +322,9 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 				&pageTable[index]);
 			fMapCount--;
 
-			if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
+			if (NeedsInvalidation((oldEntry & X86_64_PTE_ACCESSED) != 0)) {
 				// Note, that we only need to invalidate the address, if the
-				// accessed flags was set, since only then the entry could have
-				// been in any TLB.
+				// entry could have been in any TLB.
 				InvalidatePage(start);
 			}
 		}
@@ -316,6 +334,115 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	return fIsKernelMap ? 0 : k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	TRACE("X86VMTranslationMap64Bit::MapLargePage(%#" B_PRIxADDR ", %#"
+		B_PRIxPHYSADDR ")\n", virtualAddress, physicalAddress);
+
+	ASSERT(virtualAddress % k64BitPageTableRange == 0);
+	ASSERT(physicalAddress % k64BitPageTableRange == 0);
+
+	if (fIsKernelMap)
+		return B_NOT_SUPPORTED;
+
+	// The PAT bit is at a different position in a large page entry.
+	if ((X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(memoryType)
+			& X86_64_PTE_PAT) != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		true, reservation, fPageMapper, fMapCount);
+	ASSERT(pde != NULL);
+
+	// We need a page table to split the large page later on. If there is one
+	// already, we can keep that one, as long as it is empty.
+	vm_page* tablePage;
+	bool tableAllocated = false;
+	if ((*pde & X86_64_PDE_PRESENT) != 0) {
+		if ((*pde & X86_64_PDE_LARGE_PAGE) != 0)
+			return B_BUSY;
+
+		phys_addr_t physicalTable = *pde & X86_64_PDE_ADDRESS_MASK;
+		uint64* pageTable
+			= (uint64*)fPageMapper->GetPageTableAt(physicalTable);
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			if ((pageTable[i] & X86_64_PTE_PRESENT) != 0)
+				return B_BUSY;
+		}
+
+		tablePage = vm_lookup_page(physicalTable / B_PAGE_SIZE);
+	} else {
+		tablePage = vm_page_allocate_page(reservation,
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+		DEBUG_PAGE_ACCESS_END(tablePage);
+		tableAllocated = true;
+	}
+
+	tablePage->cache_offset = virtualAddress / k64BitPageTableRange;
+	if (fLargePageTables.Insert(tablePage) != B_OK) {
+		if (tableAllocated) {
+			DEBUG_PAGE_ACCESS_START(tablePage);
+			vm_page_free_etc(NULL, tablePage, reservation);
+		}
+		return B_NO_MEMORY;
+	}
+
+	uint64 entry;
+	X86PagingMethod64Bit::PutPageTableEntryInTable(&entry, physicalAddress,
+		attributes, memoryType, false);
+	X86PagingMethod64Bit::SetTableEntry(pde, entry | X86_64_PDE_LARGE_PAGE);
+
+	if (!tableAllocated) {
+		// The page table might still be in the paging structure caches.
+		InvalidatePage(virtualAddress);
+	} else
+		fMapCount++;
+
+	fMapCount += k64BitTableEntryCount;
+
+	return B_OK;
+}
+
+
+int32
+X86VMTranslationMap64Bit::CountLargePages(addr_t start, addr_t end)
+{
+	if (fIsKernelMap)
+		return 0;
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	int32 count = 0;
+	for (start = ROUNDUP(start, k64BitPageTableRange);
+			start != 0 && start + k64BitPageTableRange <= end;
+			start += k64BitPageTableRange) {
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
+			NULL, fPageMapper, fMapCount);
+		if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+			&& (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
 status_t
 X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	bool markPresent)
@@ -330,6 +457,8 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -355,10 +484,9 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 				uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntryFlags(
 					&pageTable[index], X86_64_PTE_PRESENT);
 
-				if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
+				if (NeedsInvalidation((oldEntry & X86_64_PTE_ACCESSED) != 0)) {
 					// Note, that we only need to invalidate the address, if the
-					// accessed flags was set, since only then the entry could
-					// have been in any TLB.
+					// entry could have been in any TLB.
 					InvalidatePage(start);
 				}
 			}
@@ -380,6 +508,8 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	_SplitLargePage(address);
+
 	// Look up the page table for the virtual address.
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
@@ -398,10 +528,9 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	fMapCount--;
 
-	if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
+	if (NeedsInvalidation((oldEntry & X86_64_PTE_ACCESSED) != 0)) {
 		// Note, that we only need to invalidate the address, if the
-		// accessed flags was set, since only then the entry could have been
-		// in any TLB.
+		// entry could have been in any TLB.
 		if (!deletingAddressSpace)
 			InvalidatePage(address);
 
@@ -461,6 +590,8 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -480,10 +611,9 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 
 			fMapCount--;
 
-			if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
+			if (NeedsInvalidation((oldEntry & X86_64_PTE_ACCESSED) != 0)) {
 				// Note, that we only need to invalidate the address, if the
-				// accessed flags was set, since only then the entry could have
-				// been in any TLB.
+				// entry could have been in any TLB.
 				if (!deletingAddressSpace)
 					InvalidatePage(start);
 			}
@@ -603,9 +733,46 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	} else if ((attributes & B_KERNEL_WRITE_AREA) != 0)
 		newProtectionFlags = X86_64_PTE_WRITABLE;
 
+	uint64 memoryTypeFlags
+		= X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(memoryType);
+
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		// Large pages that are completely covered by the range are changed
+		// as a whole, all others need to be split.
+		uint64* pde = NULL;
+		if (!fIsKernelMap && start % k64BitPageTableRange == 0
+			&& end - start >= k64BitPageTableRange - 1
+			&& (memoryTypeFlags & X86_64_PTE_PAT) == 0) {
+			pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+				fPagingStructures->VirtualPMLTop(), start, fIsKernelMap,
+				false, NULL, fPageMapper, fMapCount);
+		}
+		if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+			&& (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+			uint64 entry = *pde;
+			uint64 oldEntry;
+			while (true) {
+				oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+					(entry & ~(X86_64_PTE_PROTECTION_MASK
+							| X86_64_PTE_MEMORY_TYPE_MASK))
+						| newProtectionFlags | memoryTypeFlags,
+					entry);
+				if (oldEntry == entry)
+					break;
+				entry = oldEntry;
+			}
+
+			if (NeedsInvalidation((oldEntry & X86_64_PDE_ACCESSED) != 0))
+				InvalidatePage(start);
+
+			start += k64BitPageTableRange;
+			continue;
+		}
+
+		_SplitLargePage(start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -633,19 +800,16 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 					&pageTable[index],
 					(entry & ~(X86_64_PTE_PROTECTION_MASK
 							| X86_64_PTE_MEMORY_TYPE_MASK))
-						| newProtectionFlags
-						| X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(
-							memoryType),
+						| newProtectionFlags | memoryTypeFlags,
 					entry);
 				if (oldEntry == entry)
 					break;
 				entry = oldEntry;
 			}
 
-			if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
+			if (NeedsInvalidation((oldEntry & X86_64_PTE_ACCESSED) != 0)) {
 				// Note, that we only need to invalidate the address, if the
-				// accessed flag was set, since only then the entry could have
-				// been in any TLB.
+				// entry could have been in any TLB.
 				InvalidatePage(start);
 			}
 		}
@@ -663,6 +827,24 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (!fIsKernelMap && flags == PAGE_ACCESSED) {
+		// The accessed flag can be cleared for a large page as a whole, the
+		// modified flag has to be tracked per page, though.
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+			fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
+			false, NULL, fPageMapper, fMapCount);
+		if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+			&& (*pde & X86_64_PDE_LARGE_PAGE) != 0) {
+			uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntryFlags(pde,
+				X86_64_PDE_ACCESSED);
+			if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+				InvalidatePage(address);
+			return B_OK;
+		}
+	}
+
+	_SplitLargePage(address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -694,6 +876,41 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (!fIsKernelMap) {
+		uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+			fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
+			false, NULL, fPageMapper, fMapCount);
+		if (pde != NULL && (*pde & X86_64_PDE_PRESENT) != 0
+			&& (*pde & X86_64_PDE_LARGE_PAGE) != 0
+			&& (!unmapIfUnaccessed || (*pde & X86_64_PDE_ACCESSED) != 0)) {
+			// A large page is tracked as a whole: all of its pages report
+			// its flags, its accessed flag is only cleared when looking at
+			// its first page, and its dirty flag is never cleared here, as
+			// it applies to all pages. Only an unaccessed large page that
+			// is to be unmapped needs to be split.
+			uint64 entry = *pde;
+			if ((entry & X86_64_PDE_ACCESSED) != 0
+				&& address % k64BitPageTableRange == 0) {
+				entry = X86PagingMethod64Bit::ClearTableEntryFlags(pde,
+					X86_64_PDE_ACCESSED);
+
+				// Unlike for small pages, the invalidation cannot be
+				// deferred: as long as a CPU caches the entry, accesses to
+				// any of the 512 pages would go unnoticed, and the whole
+				// large page would look unused.
+				if ((entry & X86_64_PDE_ACCESSED) != 0) {
+					InvalidatePage(address);
+					Flush();
+				}
+			}
+
+			_modified = (entry & X86_64_PDE_DIRTY) != 0;
+			return (entry & X86_64_PDE_ACCESSED) != 0;
+		}
+	}
+
+	_SplitLargePage(address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -734,18 +951,22 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 
 	_modified = (oldEntry & X86_64_PTE_DIRTY) != 0;
 
-	if ((oldEntry & X86_64_PTE_ACCESSED) != 0) {
-		// Note, that we only need to invalidate the address, if the
-		// accessed flags was set, since only then the entry could have been
-		// in any TLB.
+	const bool accessed = (oldEntry & X86_64_PTE_ACCESSED) != 0;
+	const bool unmapped = unmapIfUnaccessed && !accessed;
+
+	if (accessed && !_modified && !fIsKernelMap) {
+		// Only the accessed flag has been cleared, and the page stays
+		// mapped -- other CPUs may continue to use their cached entry, so
+		// we can spare them the shootdown.
+		DeferAccessedInvalidation();
+	} else if ((accessed || _modified || unmapped)
+		&& NeedsInvalidation(accessed)) {
 		InvalidatePage(address);
 		Flush();
-
-		return true;
 	}
 
-	if (!unmapIfUnaccessed)
-		return false;
+	if (!unmapped)
+		return accessed;
 
 	// We have unmapped the address. Do the "high level" stuff.
 
@@ -852,6 +1073,69 @@ X86VMTranslationMap64Bit::DebugGetReverseMappingInfo(phys_addr_t physicalAddress
 }
 
 
+/*!	If \a address is mapped by a large page, the large page is replaced by
+	the page table that was kept for it, with equivalent entries for all of
+	its pages. The thread must be pinned.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(addr_t address)
+{
+	if (fIsKernelMap)
+		return;
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap, false, NULL,
+		fPageMapper, fMapCount);
+	if (pde == NULL || (*pde & X86_64_PDE_PRESENT) == 0
+		|| (*pde & X86_64_PDE_LARGE_PAGE) == 0) {
+		return;
+	}
+
+	RecursiveLocker locker(fLock);
+
+	address = ROUNDDOWN(address, k64BitPageTableRange);
+
+	vm_page* tablePage = fLargePageTables.Lookup(address);
+	if (tablePage == NULL) {
+		panic("X86VMTranslationMap64Bit::_SplitLargePage(): no page table "
+			"for large page at %#" B_PRIxADDR, address);
+		return;
+	}
+
+	fLargePageTables.RemoveUnchecked(tablePage);
+	tablePage->cache_next = NULL;
+	tablePage->cache_offset = 0;
+
+	// Make the large page entry non-present and flush the TLBs first, so
+	// that no CPU can set its accessed or dirty flags anymore while they are
+	// transferred to the page table. Anyone accessing the range meanwhile
+	// will fault and wait for the map lock.
+	uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntry(pde);
+	InvalidatePage(address);
+	Flush();
+
+	phys_addr_t physicalAddress = oldEntry & X86_64_PDE_ADDRESS_MASK
+		& ~(phys_addr_t)(k64BitPageTableRange - 1);
+	uint64 flags = oldEntry & (X86_64_PTE_PRESENT | X86_64_PTE_WRITABLE
+		| X86_64_PTE_USER | X86_64_PTE_MEMORY_TYPE_MASK | X86_64_PTE_ACCESSED
+		| X86_64_PTE_DIRTY | X86_64_PTE_NOT_EXECUTABLE);
+
+	phys_addr_t physicalTable
+		= (phys_addr_t)tablePage->physical_page_number * B_PAGE_SIZE;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(physicalTable);
+	for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+		X86PagingMethod64Bit::SetTableEntry(&pageTable[i],
+			(physicalAddress + i * B_PAGE_SIZE) | flags);
+	}
+
+	X86PagingMethod64Bit::SetTableEntry(pde,
+		(physicalTable & X86_64_PDE_ADDRESS_MASK)
+			| X86_64_PDE_PRESENT
+			| X86_64_PDE_WRITABLE
+			| X86_64_PDE_USER);
+}
+
+
 X86PagingStructures*
 X86VMTranslationMap64Bit::PagingStructures() const
 {
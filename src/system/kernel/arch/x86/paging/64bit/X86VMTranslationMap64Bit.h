@@ -7,12 +7,48 @@
 #define KERNEL_ARCH_X86_PAGING_64BIT_X86_VM_TRANSLATION_MAP_64BIT_H
 
 
+#include <util/OpenHashTable.h>
+#include <vm/vm_types.h>
+
 #include "paging/X86VMTranslationMap.h"
+#include "paging/64bit/paging.h"
 
 
 struct X86PagingStructures64Bit;
 
 
+// Page tables kept around for large pages, so that those can be split
+// without allocating memory. As page table pages don't belong to any cache,
+// their cache_offset is used for the large page's virtual page number, and
+// cache_next for the hash link.
+struct LargePageTableHashDefinition {
+	typedef addr_t		KeyType;
+	typedef vm_page		ValueType;
+
+	size_t HashKey(addr_t key) const
+	{
+		return key / k64BitPageTableRange;
+	}
+
+	size_t Hash(vm_page* value) const
+	{
+		return value->cache_offset;
+	}
+
+	bool Compare(addr_t key, vm_page* value) const
+	{
+		return value->cache_offset == key / k64BitPageTableRange;
+	}
+
+	vm_page*& GetLink(vm_page* value) const
+	{
+		return value->cache_next;
+	}
+};
+
+typedef BOpenHashTable<LargePageTableHashDefinition> LargePageTableTable;
+
+
 struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 								X86VMTranslationMap64Bit(bool la57);
 	virtual						~X86VMTranslationMap64Bit();
@@ -28,6 +64,13 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 									vm_page_reservation* reservation);
 	virtual	status_t			Unmap(addr_t start, addr_t end);
 
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			MapLargePage(addr_t virtualAddress,
+									phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									vm_page_reservation* reservation);
+	virtual	int32				CountLargePages(addr_t start, addr_t end);
+
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
@@ -64,8 +107,12 @@ struct X86VMTranslationMap64Bit final : X86VMTranslationMap {
 	inline	X86PagingStructures64Bit* PagingStructures64Bit() const
 									{ return fPagingStructures; }
 
+private:
+			void				_SplitLargePage(addr_t address);
+
 private:
 			X86PagingStructures64Bit* fPagingStructures;
+			LargePageTableTable	fLargePageTables;
 			bool				fLA57;
 };
 
@@ -10,6 +10,7 @@
 
 #include "paging/X86VMTranslationMap.h"
 
+#include <debug.h>
 #include <thread.h>
 #include <smp.h>
 
@@ -24,6 +25,71 @@
 #endif
 
 
+static int64 sTLBShootdowns = 0;
+static int64 sTLBShootdownIPIs = 0;
+static int64 sTLBShootdownsDeferred = 0;
+static int64 sTLBShootdownIPIsSaved = 0;
+
+
+static int32
+count_cpus(const CPUSet& cpuMask)
+{
+	int32 count = 0;
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		if (cpuMask.GetBit(i))
+			count++;
+	}
+	return count;
+}
+
+
+static void
+send_invalidation_ici(const CPUSet& cpuMask, int32 message, addr_t data,
+	addr_t data2)
+{
+	atomic_add64(&sTLBShootdowns, 1);
+	atomic_add64(&sTLBShootdownIPIs, count_cpus(cpuMask));
+
+	CPUSet mask = cpuMask;
+	smp_send_multicast_ici(mask, message, data, data2, 0, NULL,
+		SMP_MSG_FLAG_SYNC);
+}
+
+
+static void
+send_broadcast_invalidation_ici(int32 message, addr_t data, addr_t data2)
+{
+	if (smp_get_num_cpus() > 1) {
+		atomic_add64(&sTLBShootdowns, 1);
+		atomic_add64(&sTLBShootdownIPIs, smp_get_num_cpus() - 1);
+	}
+
+	smp_send_broadcast_ici(message, data, data2, 0, NULL, SMP_MSG_FLAG_SYNC);
+}
+
+
+static int
+dump_tlb_shootdown_stats(int argc, char** argv)
+{
+	kprintf("TLB shootdowns:     %" B_PRId64 " (%" B_PRId64 " IPIs)\n",
+		sTLBShootdowns, sTLBShootdownIPIs);
+	kprintf("deferred:           %" B_PRId64 " (%" B_PRId64 " IPIs saved)\n",
+		sTLBShootdownsDeferred, sTLBShootdownIPIsSaved);
+	return 0;
+}
+
+
+void
+x86_vm_translation_map_init_post_area()
+{
+	add_debugger_command_etc("tlb_shootdowns", &dump_tlb_shootdown_stats,
+		"Print TLB shootdown statistics",
+		"\n"
+		"Prints the number of TLB shootdowns that have been sent to other\n"
+		"CPUs, and the number of those that could be avoided.\n", 0);
+}
+
+
 X86VMTranslationMap::X86VMTranslationMap()
 	:
 	fPageMapper(NULL),
@@ -105,8 +171,8 @@ X86VMTranslationMap::Flush()
 
 		if (fIsKernelMap) {
 			arch_cpu_global_TLB_invalidate();
-			smp_send_broadcast_ici(SMP_MSG_GLOBAL_INVALIDATE_PAGES, 0, 0, 0,
-				NULL, SMP_MSG_FLAG_SYNC);
+			send_broadcast_invalidation_ici(SMP_MSG_GLOBAL_INVALIDATE_PAGES, 0,
+				0);
 		} else {
 			cpu_status state = disable_interrupts();
 			arch_cpu_user_TLB_invalidate();
@@ -117,9 +183,13 @@ X86VMTranslationMap::Flush()
 			cpuMask.ClearBit(cpu);
 
 			if (!cpuMask.IsEmpty()) {
-				smp_send_multicast_ici(cpuMask, SMP_MSG_USER_INVALIDATE_PAGES,
-					0, 0, 0, NULL, SMP_MSG_FLAG_SYNC);
+				send_invalidation_ici(cpuMask, SMP_MSG_USER_INVALIDATE_PAGES,
+					0, 0);
 			}
+
+			// All CPUs that still use the map have flushed their TLB now, the
+			// others have done so when switching to another map.
+			fStaleTLBCPUs.ClearAll();
 		}
 	} else {
 		TRACE("flush_tmap: %d pages to invalidate, invalidate list\n",
@@ -128,18 +198,16 @@ X86VMTranslationMap::Flush()
 		arch_cpu_invalidate_TLB_list(fInvalidPages, fInvalidPagesCount);
 
 		if (fIsKernelMap) {
-			smp_send_broadcast_ici(SMP_MSG_INVALIDATE_PAGE_LIST,
-				(addr_t)fInvalidPages, fInvalidPagesCount, 0, NULL,
-				SMP_MSG_FLAG_SYNC);
+			send_broadcast_invalidation_ici(SMP_MSG_INVALIDATE_PAGE_LIST,
+				(addr_t)fInvalidPages, fInvalidPagesCount);
 		} else {
 			int cpu = smp_get_current_cpu();
 			CPUSet cpuMask = PagingStructures()->active_on_cpus;
 			cpuMask.ClearBit(cpu);
 
 			if (!cpuMask.IsEmpty()) {
-				smp_send_multicast_ici(cpuMask, SMP_MSG_INVALIDATE_PAGE_LIST,
-					(addr_t)fInvalidPages, fInvalidPagesCount, 0, NULL,
-					SMP_MSG_FLAG_SYNC);
+				send_invalidation_ici(cpuMask, SMP_MSG_INVALIDATE_PAGE_LIST,
+					(addr_t)fInvalidPages, fInvalidPagesCount);
 			}
 		}
 	}
@@ -147,3 +215,54 @@ X86VMTranslationMap::Flush()
 
 	thread_unpin_from_current_cpu(thread);
 }
+
+
+/*!	Records that the accessed flag of a mapped entry has been cleared without
+	invalidating it.
+	Other CPUs may continue to use the entry from their TLB without setting
+	the flag again, which merely makes the page look less recently used than
+	it is. Since clearing the flag requires no shootdown otherwise, this saves
+	an IPI to every CPU the map is active on. The CPUs that may still cache
+	such an entry are remembered, though, so that changes to entries that
+	don't have their accessed flag set are invalidated as long as any of them
+	still uses the map.
+	Must not be used for the kernel map, nor when the modified flag of the
+	entry is cleared as well. The map must be locked.
+*/
+void
+X86VMTranslationMap::DeferAccessedInvalidation()
+{
+	ASSERT(!fIsKernelMap);
+
+	const CPUSet& activeCPUs = PagingStructures()->active_on_cpus;
+	fStaleTLBCPUs = fStaleTLBCPUs.Or(activeCPUs);
+
+	int32 cpuCount = count_cpus(activeCPUs);
+	if (activeCPUs.GetBit(smp_get_current_cpu()))
+		cpuCount--;
+
+	atomic_add64(&sTLBShootdownsDeferred, 1);
+	if (cpuCount > 0)
+		atomic_add64(&sTLBShootdownIPIsSaved, cpuCount);
+}
+
+
+/*!	Returns whether any CPU still using the map may cache entries of it whose
+	accessed flag has been cleared by DeferAccessedInvalidation().
+	The map must be locked.
+*/
+bool
+X86VMTranslationMap::MayHaveStaleEntries()
+{
+	if (fStaleTLBCPUs.IsEmpty())
+		return false;
+
+	// CPUs that have switched to another map in the meantime have flushed
+	// their TLB.
+	if (fStaleTLBCPUs.And(PagingStructures()->active_on_cpus).IsEmpty()) {
+		fStaleTLBCPUs.ClearAll();
+		return false;
+	}
+
+	return true;
+}
@@ -6,6 +6,7 @@
 #define KERNEL_ARCH_X86_X86_VM_TRANSLATION_MAP_H
 
 
+#include <smp.h>
 #include <vm/VMTranslationMap.h>
 
 
@@ -33,14 +34,23 @@ struct X86VMTranslationMap : VMTranslationMap {
 
 	inline	void				InvalidatePage(addr_t address);
 
+protected:
+			void				DeferAccessedInvalidation();
+			bool				MayHaveStaleEntries();
+	inline	bool				NeedsInvalidation(bool accessed);
+
 protected:
 			TranslationMapPhysicalPageMapper* fPageMapper;
 			int					fInvalidPagesCount;
 			addr_t				fInvalidPages[PAGE_INVALIDATE_CACHE_SIZE];
+			CPUSet				fStaleTLBCPUs;
 			bool				fIsKernelMap;
 };
 
 
+void	x86_vm_translation_map_init_post_area();
+
+
 void
 X86VMTranslationMap::InvalidatePage(addr_t address)
 {
@@ -51,4 +61,17 @@ X86VMTranslationMap::InvalidatePage(addr_t address)
 }
 
 
+/*!	Returns whether the entry for an address has to be invalidated, when it
+	is changed. \a accessed is the state of the entry's accessed flag.
+	The map must be locked.
+*/
+bool
+X86VMTranslationMap::NeedsInvalidation(bool accessed)
+{
+	// Only an entry that has been accessed can be in any TLB -- unless we
+	// have cleared its accessed flag without invalidating it.
+	return accessed || MayHaveStaleEntries();
+}
+
+
 #endif	// KERNEL_ARCH_X86_X86_VM_TRANSLATION_MAP_H
@@ -33,8 +33,8 @@
 
 
 // TODO: this is a naive but growing implementation to test the API:
-//	block reading/writing is not at all optimized for speed, it will
-//	just read and write single blocks.
+//	runs of adjacent blocks are read and written back using a single vectored
+//	request, but there is no real read-ahead heuristic yet.
 // TODO: the retrieval/copy of the original data could be delayed until the
 //		new data must be written, ie. in low memory situations.
 
@@ -58,6 +58,11 @@
 
 static const bigtime_t kTransactionIdleTime = 2000000LL;
 	// a transaction is considered idle after 2 seconds of inactivity
+static const size_t kReadAroundBlocks = 16;
+	// on a cache miss, up to this many uncached blocks (including the
+	// requested one) are read in with a single request
+static const int32 kMaxYoungUnusedBlocksSkipped = 32;
+	// how many out of order unused blocks RemoveUnusedBlocks() tolerates
 
 
 namespace {
@@ -90,6 +95,8 @@ struct cached_block {
 	void*			compare;
 #endif
 	int32			ref_count;
+		// Must only be changed atomically; it may only be raised from zero
+		// and dropped to zero with the cache lock held, though.
 	int32			last_accessed;
 	bool			busy_reading : 1;
 	bool			busy_writing : 1;
@@ -197,6 +204,18 @@ struct BlockHash {
 
 typedef BOpenHashTable<BlockHash> BlockTable;
 
+static const uint32 kBlockHashShards = 16;
+	// must be a power of two
+
+struct block_hash_shard {
+	rw_lock			lock;
+		// Only protects the structure of the table, and the unused flag of
+		// its blocks, against lockless lookups; inserting and removing blocks
+		// also requires the cache lock.
+	BlockTable		table;
+	int32			lockless_hits;
+};
+
 
 struct TransactionHash {
 	typedef int32				KeyType;
@@ -216,7 +235,7 @@ typedef BOpenHashTable<TransactionHash> TransactionTable;
 
 
 struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
-	BlockTable*		hash;
+	block_hash_shard* hash_shards;
 	mutex			lock;
 	const int		fd;
 	off_t			max_blocks;
@@ -243,6 +262,8 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 	uint32			num_dirty_blocks;
 	const bool		read_only;
 
+	int32			lock_contention;
+
 	NotificationList pending_notifications;
 	ConditionVariable condition_variable;
 
@@ -258,6 +279,13 @@ struct block_cache : DoublyLinkedListLinkImpl<block_cache> {
 	cached_block*	NewBlock(off_t blockNumber);
 	void			FreeBlockParentData(cached_block* block);
 
+	block_hash_shard& HashShardFor(off_t blockNumber) const;
+	cached_block*	LookupBlock(off_t blockNumber) const;
+	void			InsertBlock(cached_block* block);
+	void			UnhashBlock(cached_block* block);
+	void			MarkUsed(cached_block* block);
+	bool			RemoveUnusedBlock(cached_block* block);
+
 	void			RemoveUnusedBlocks(int32 count, int32 minSecondsOld = 0);
 	void			RemoveBlock(cached_block* block);
 	void			DiscardBlock(cached_block* block);
@@ -296,6 +324,7 @@ public:
 									cache_transaction* transaction = NULL);
 			bool				Add(cache_transaction* transaction,
 									bool& hasLeftOvers);
+			bool				AddRun(cached_block* block);
 
 			status_t			Write(cache_transaction* transaction = NULL,
 									bool canUnlock = true);
@@ -1234,6 +1263,37 @@ BlockWriter::Add(cache_transaction* transaction, bool& hasLeftOvers)
 }
 
 
+/*!	Adds the specified block to the to be written array, together with all
+	blocks adjacent to it that can be written back as well, so that the whole
+	run ends up in a single write request.
+	If no more blocks can be added, false is returned, otherwise true.
+*/
+bool
+BlockWriter::AddRun(cached_block* block)
+{
+	// find the start of the run
+	off_t blockNumber = block->block_number;
+	while (blockNumber > 0) {
+		cached_block* previous = fCache->LookupBlock(blockNumber - 1);
+		if (previous == NULL || !previous->CanBeWritten())
+			break;
+
+		blockNumber--;
+	}
+
+	for (; blockNumber < fCache->max_blocks; blockNumber++) {
+		cached_block* next = fCache->LookupBlock(blockNumber);
+		if (next == NULL || !next->CanBeWritten())
+			break;
+
+		if (!Add(next))
+			return false;
+	}
+
+	return true;
+}
+
+
 /*! Cache must be locked when calling this method, but it will be unlocked
 	while the blocks are written back.
 */
@@ -1476,7 +1536,7 @@ BlockPrefetcher::~BlockPrefetcher()
 /*!	Allocates cached_block objects in preparation for prefetching.
 	@return If an error is returned, then no blocks have been allocated.
 	@post Blocks have been constructed (including allocating the current_data member)
-	but current_data is uninitialized.
+	but current_data is uninitialized. They are marked busy reading.
 */
 status_t
 BlockPrefetcher::Allocate()
@@ -1496,7 +1556,7 @@ BlockPrefetcher::Allocate()
 				B_PRIdOFF ")", blockNumIter, fCache->max_blocks - 1);
 			return B_BAD_VALUE;
 		}
-		cached_block* block = fCache->hash->Lookup(blockNumIter);
+		cached_block* block = fCache->LookupBlock(blockNumIter);
 		if (block != NULL) {
 			// truncate the request
 			TRACE(("BlockPrefetcher::Allocate: found an existing block (%" B_PRIdOFF ")\n",
@@ -1511,10 +1571,14 @@ BlockPrefetcher::Allocate()
 	for (size_t i = 0; i < finalNumBlocks; ++i) {
 		cached_block* block = fCache->NewBlock(fBlockNumber + i);
 		if (block == NULL) {
-			_RemoveAllocated(0, i);
+			_RemoveAllocated(i, i);
 			return B_NO_MEMORY;
 		}
-		fCache->hash->Insert(block);
+
+		// Mark the block busy before it becomes visible, so that lockless
+		// lookups cannot get a reference to it before it has been read.
+		mark_block_busy_reading(fCache, block);
+		fCache->InsertBlock(block);
 
 		block->unused = true;
 		fCache->unused_blocks.Add(block);
@@ -1542,7 +1606,6 @@ BlockPrefetcher::ReadAsync(MutexLocker& cacheLocker)
 	for (size_t i = 0; i < fNumAllocated; ++i) {
 		vecs[i].base = reinterpret_cast<generic_addr_t>(fBlocks[i]->current_data);
 		vecs[i].length = blockSize;
-		mark_block_busy_reading(fCache, fBlocks[i]);
 	}
 
 	IORequest* request = new IORequest;
@@ -1613,16 +1676,19 @@ BlockPrefetcher::_RemoveAllocated(size_t unbusyCount, size_t removeCount)
 
 	ASSERT_LOCKED_MUTEX(&fCache->lock);
 
-	for (size_t i = 0; i < unbusyCount; ++i)
-		mark_block_unbusy_reading(fCache, fBlocks[i]);
-
+	// Remove the blocks from the hash while they are still busy, so that no
+	// lockless lookup can get a reference to them in the meantime
 	for (size_t i = 0; i < removeCount; ++i) {
 		ASSERT(fBlocks[i]->is_dirty == false && fBlocks[i]->unused == true);
 
-		fCache->unused_blocks.Remove(fBlocks[i]);
-		fCache->unused_block_count--;
+		fCache->RemoveUnusedBlock(fBlocks[i]);
+	}
+
+	for (size_t i = 0; i < unbusyCount; ++i)
+		mark_block_unbusy_reading(fCache, fBlocks[i]);
 
-		fCache->RemoveBlock(fBlocks[i]);
+	for (size_t i = 0; i < removeCount; ++i) {
+		fCache->FreeBlock(fBlocks[i]);
 		fBlocks[i] = NULL;
 	}
 
@@ -1639,7 +1705,7 @@ BlockPrefetcher::_RemoveAllocated(size_t unbusyCount, size_t removeCount)
 block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 		bool readOnly)
 	:
-	hash(NULL),
+	hash_shards(NULL),
 	fd(_fd),
 	max_blocks(numBlocks),
 	block_size(blockSize),
@@ -1655,7 +1721,8 @@ block_cache::block_cache(int _fd, off_t numBlocks, size_t blockSize,
 	last_block_write(0),
 	last_block_write_duration(0),
 	num_dirty_blocks(0),
-	read_only(readOnly)
+	read_only(readOnly),
+	lock_contention(0)
 {
 }
 
@@ -1666,7 +1733,12 @@ block_cache::~block_cache()
 	unregister_low_resource_handler(&_LowMemoryHandler, this);
 
 	delete transaction_hash;
-	delete hash;
+
+	if (hash_shards != NULL) {
+		for (uint32 i = 0; i < kBlockHashShards; i++)
+			rw_lock_destroy(&hash_shards[i].lock);
+		delete[] hash_shards;
+	}
 
 	delete_object_cache(buffer_cache);
 
@@ -1687,10 +1759,19 @@ block_cache::Init()
 	if (buffer_cache == NULL)
 		return B_NO_MEMORY;
 
-	hash = new BlockTable();
-	if (hash == NULL || hash->Init(1024) != B_OK)
+	hash_shards = new(std::nothrow) block_hash_shard[kBlockHashShards];
+	if (hash_shards == NULL)
 		return B_NO_MEMORY;
 
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		rw_lock_init(&hash_shards[i].lock, "block cache hash");
+		hash_shards[i].lockless_hits = 0;
+	}
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		if (hash_shards[i].table.Init(1024 / kBlockHashShards) != B_OK)
+			return B_NO_MEMORY;
+	}
+
 	transaction_hash = new(std::nothrow) TransactionTable();
 	if (transaction_hash == NULL || transaction_hash->Init(16) != B_OK)
 		return B_NO_MEMORY;
@@ -1808,17 +1889,121 @@ block_cache::FreeBlockParentData(cached_block* block)
 }
 
 
+/*!	Returns the hash shard responsible for \a blockNumber. Neighboring
+	blocks are spread over different shards, so that sequential access to
+	metadata does not keep hitting the same lock.
+*/
+block_hash_shard&
+block_cache::HashShardFor(off_t blockNumber) const
+{
+	uint64 hash = (uint64)blockNumber * 0x9e3779b97f4a7c15ULL;
+	return hash_shards[(hash >> 32) & (kBlockHashShards - 1)];
+}
+
+
+/*!	Looks up the block \a blockNumber. The cache must be locked; since
+	changing the hash tables requires that lock as well, no shard needs to be
+	locked here.
+*/
+cached_block*
+block_cache::LookupBlock(off_t blockNumber) const
+{
+	return HashShardFor(blockNumber).table.Lookup(blockNumber);
+}
+
+
+/*!	Inserts the \a block into the hash table. The cache must be locked. */
+void
+block_cache::InsertBlock(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+
+	block_hash_shard& shard = HashShardFor(block->block_number);
+	WriteLocker _(shard.lock);
+	shard.table.Insert(block);
+}
+
+
+/*!	Removes the \a block from the hash table. The cache must be locked. */
+void
+block_cache::UnhashBlock(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+
+	block_hash_shard& shard = HashShardFor(block->block_number);
+	WriteLocker _(shard.lock);
+	shard.table.Remove(block);
+}
+
+
+/*!	Removes the \a block from the unused list. The cache must be locked.
+	Clearing the unused flag needs the shard's write lock, as
+	get_cached_block_lockless() relies on it not changing while it holds the
+	read lock.
+*/
+void
+block_cache::MarkUsed(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+	ASSERT(block->unused);
+
+	WriteLocker _(HashShardFor(block->block_number).lock);
+	block->unused = false;
+	unused_blocks.Remove(block);
+	unused_block_count--;
+}
+
+
+/*!	Removes the unused \a block from the unused list, and, unless someone
+	acquired a lockless reference to it in the meantime, from the hash table
+	as well.
+	Returns \c false if the block is still referenced; it is then put back
+	into the unused list once its last reference is released.
+	The cache must be locked.
+*/
+bool
+block_cache::RemoveUnusedBlock(cached_block* block)
+{
+	ASSERT_LOCKED_MUTEX(&lock);
+	ASSERT(block->unused);
+
+	block_hash_shard& shard = HashShardFor(block->block_number);
+	WriteLocker _(shard.lock);
+
+	block->unused = false;
+	unused_blocks.Remove(block);
+	unused_block_count--;
+
+	if (atomic_get(&block->ref_count) != 0)
+		return false;
+
+	shard.table.Remove(block);
+	return true;
+}
+
+
 void
 block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 {
 	TRACE(("block_cache: remove up to %" B_PRId32 " unused blocks\n", count));
 
+	int32 youngBlocksSkipped = 0;
 	for (block_list::Iterator iterator = unused_blocks.GetIterator();
 			cached_block* block = iterator.Next();) {
 		if (minSecondsOld >= block->LastAccess()) {
-			// The list is sorted by last access
-			break;
+			// The list is sorted by last access, except for blocks that have
+			// been reused without locking the cache. Move those back to the
+			// end, where they belong, and give up after a few of them in a
+			// row, as the rest of the list is most likely even younger.
+			if (++youngBlocksSkipped > kMaxYoungUnusedBlocksSkipped)
+				break;
+
+			unused_blocks.Remove(block);
+			unused_blocks.Add(block);
+			continue;
 		}
+		youngBlocksSkipped = 0;
+
 		if (block->busy_reading || block->busy_writing)
 			continue;
 
@@ -1835,9 +2020,10 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 		}
 
 		// remove block from lists
-		iterator.Remove();
-		unused_block_count--;
-		RemoveBlock(block);
+		if (!RemoveUnusedBlock(block))
+			continue;
+
+		FreeBlock(block);
 
 		if (--count <= 0)
 			break;
@@ -1848,7 +2034,7 @@ block_cache::RemoveUnusedBlocks(int32 count, int32 minSecondsOld)
 void
 block_cache::RemoveBlock(cached_block* block)
 {
-	hash->Remove(block);
+	UnhashBlock(block);
 	FreeBlock(block);
 }
 
@@ -1938,12 +2124,10 @@ block_cache::_GetUnusedBlock()
 			BlockWriter::WriteBlock(this, block);
 
 		// remove block from lists
-		iterator.Remove();
-		unused_block_count--;
-		hash->Remove(block);
+		if (!RemoveUnusedBlock(block))
+			continue;
 
 		ASSERT(block->original_data == NULL && block->parent_data == NULL);
-		block->unused = false;
 
 		// TODO: see if compare data is handled correctly here!
 #if BLOCK_CACHE_DEBUG_CHANGED
@@ -2059,6 +2243,104 @@ wait_for_busy_writing_blocks(block_cache* cache)
 }
 
 
+/*!	Locks the cache, and keeps track of how often that lock was contended.
+*/
+static void
+lock_block_cache(block_cache* cache)
+{
+	if (mutex_trylock(&cache->lock) == B_OK)
+		return;
+
+	atomic_add(&cache->lock_contention, 1);
+	mutex_lock(&cache->lock);
+}
+
+
+/*!	Tries to acquire a reference to the block \a blockNumber without locking
+	the cache. This works for blocks that are already referenced by someone
+	else, and for unused blocks; in the latter case, the block stays in the
+	unused list until the cache is locked the next time (see
+	block_cache::RemoveUnusedBlock(), and put_cached_block()).
+	Blocks that are busy being read in, or that are part of a transaction
+	without being referenced are left to the locked path.
+	Returns \c NULL if the caller needs to go the locked path instead.
+*/
+static cached_block*
+get_cached_block_lockless(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	return NULL;
+#else
+	block_hash_shard& shard = cache->HashShardFor(blockNumber);
+	ReadLocker hashLocker(shard.lock);
+
+	cached_block* block = shard.table.Lookup(blockNumber);
+	if (block == NULL)
+		return NULL;
+
+	int32 refCount = atomic_get(&block->ref_count);
+	while (true) {
+		// The unused flag cannot be cleared while we hold the shard lock
+		if ((refCount < 1 && !block->unused) || block->busy_reading
+			|| block->discard) {
+			return NULL;
+		}
+
+		int32 previous = atomic_test_and_set(&block->ref_count, refCount + 1,
+			refCount);
+		if (previous == refCount)
+			break;
+
+		refCount = previous;
+	}
+
+	block->last_accessed = system_time() / 1000000L;
+	atomic_add(&shard.lockless_hits, 1);
+
+	return block;
+#endif
+}
+
+
+/*!	Tries to release a reference to the block \a blockNumber without locking
+	the cache. This only works if it's not the last reference to the block,
+	or if the block is still in the unused list, as it was acquired by
+	get_cached_block_lockless().
+	Returns \c false if the caller needs to go the locked path instead.
+*/
+static bool
+put_cached_block_lockless(block_cache* cache, off_t blockNumber)
+{
+#if BLOCK_CACHE_DEBUG_CHANGED
+	return false;
+#else
+	block_hash_shard& shard = cache->HashShardFor(blockNumber);
+	ReadLocker hashLocker(shard.lock);
+
+	cached_block* block = shard.table.Lookup(blockNumber);
+	if (block == NULL)
+		return false;
+
+	int32 refCount = atomic_get(&block->ref_count);
+	while (true) {
+		// The unused flag cannot be cleared while we hold the shard lock
+		if (refCount < 1 || (refCount == 1 && !block->unused))
+			return false;
+
+		int32 previous = atomic_test_and_set(&block->ref_count, refCount - 1,
+			refCount);
+		if (previous == refCount)
+			break;
+
+		refCount = previous;
+	}
+
+	TB(Put(cache, block));
+	return true;
+#endif
+}
+
+
 /*!	Removes a reference from the specified \a block. If this was the last
 	reference, the block is moved into the unused list.
 	In low memory situations, it will also free some blocks from that list,
@@ -2088,16 +2370,20 @@ put_cached_block(block_cache* cache, cached_block* block)
 		return;
 	}
 
-	if (--block->ref_count == 0
+	if (atomic_add(&block->ref_count, -1) == 1
 		&& block->transaction == NULL && block->previous_transaction == NULL) {
 		// This block is not used anymore, and not part of any transaction
 		block->is_writing = false;
 
 		if (block->discard) {
 			cache->RemoveBlock(block);
+		} else if (block->unused) {
+			// The reference was acquired without locking, and the block is
+			// still in the unused list; just update its position there
+			cache->unused_blocks.Remove(block);
+			cache->unused_blocks.Add(block);
 		} else {
 			// put this block in the list of unused blocks
-			ASSERT(!block->unused);
 			block->unused = true;
 
 			ASSERT(block->original_data == NULL && block->parent_data == NULL);
@@ -2116,7 +2402,7 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 			blockNumber, cache->max_blocks - 1);
 	}
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->LookupBlock(blockNumber);
 	if (block != NULL)
 		put_cached_block(cache, block);
 	else {
@@ -2125,6 +2411,102 @@ put_cached_block(block_cache* cache, off_t blockNumber)
 }
 
 
+/*!	Reads the newly allocated \a block from disk. Any directly following
+	blocks that are not yet cached are read in with the same request (up to
+	kReadAroundBlocks in total), and are put into the unused list afterwards.
+	You need to have the cache locked when calling this function; it will be
+	unlocked while the blocks are read in.
+	If reading \a block fails, it is removed from the cache again.
+*/
+static status_t
+read_cached_block_run(block_cache* cache, cached_block* block)
+{
+	const size_t blockSize = cache->block_size;
+	const off_t blockNumber = block->block_number;
+
+	size_t maxCount = 1;
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE) == B_NO_LOW_RESOURCE) {
+		maxCount = kReadAroundBlocks;
+		if ((off_t)maxCount > cache->max_blocks - blockNumber)
+			maxCount = cache->max_blocks - blockNumber;
+	}
+
+	cached_block* run[kReadAroundBlocks];
+	iovec vecs[kReadAroundBlocks];
+
+	// collect the uncached blocks following the requested one
+	run[0] = block;
+	size_t count = 1;
+	for (; count < maxCount; count++) {
+		if (cache->LookupBlock(blockNumber + count) != NULL)
+			break;
+
+		cached_block* next = cache->NewBlock(blockNumber + count);
+		if (next == NULL)
+			break;
+
+		// NewBlock() might have temporarily unlocked the cache
+		if (cache->LookupBlock(blockNumber + count) != NULL) {
+			cache->FreeBlock(next);
+			break;
+		}
+
+		cache->InsertBlock(next);
+		run[count] = next;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		mark_block_busy_reading(cache, run[i]);
+		vecs[i].iov_base = run[i]->current_data;
+		vecs[i].iov_len = blockSize;
+	}
+
+	mutex_unlock(&cache->lock);
+
+	ssize_t bytesRead = readv_pos(cache->fd, blockNumber * blockSize, vecs,
+		count);
+	status_t error = errno;
+
+	mutex_lock(&cache->lock);
+
+	size_t blocksRead = bytesRead > 0 ? bytesRead / blockSize : 0;
+
+	// the read-around blocks are not referenced by anyone
+	for (size_t i = 1; i < count; i++) {
+		cached_block* next = run[i];
+		mark_block_unbusy_reading(cache, next);
+
+		if (i >= blocksRead || next->discard) {
+			cache->RemoveBlock(next);
+			continue;
+		}
+
+		TB(Read(cache, next));
+		next->last_accessed = system_time() / 1000000L;
+		next->unused = true;
+		cache->unused_blocks.Add(next);
+		cache->unused_block_count++;
+	}
+
+	mark_block_unbusy_reading(cache, block);
+
+	if (blocksRead < 1) {
+		cache->RemoveBlock(block);
+		TB(Error(cache, blockNumber, "read failed", bytesRead));
+
+		TRACE_ALWAYS("could not read block %" B_PRIdOFF ": bytesRead: %zd,"
+			" error: %s\n", blockNumber, bytesRead, strerror(error));
+		if (error == B_OK)
+			return B_IO_ERROR;
+		return error;
+	}
+	TB(Read(cache, block));
+
+	return B_OK;
+}
+
+
 /*!	Retrieves the block \a blockNumber from the hash table, if it's already
 	there, or reads it from the disk.
 	You need to have the cache locked when calling this function.
@@ -2149,7 +2531,7 @@ get_cached_block(block_cache* cache, off_t blockNumber, bool* _allocated,
 	}
 
 retry:
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->LookupBlock(blockNumber);
 	*_allocated = false;
 
 	if (block == NULL) {
@@ -2158,7 +2540,7 @@ retry:
 		if (block == NULL)
 			return B_NO_MEMORY;
 
-		cache->hash->Insert(block);
+		cache->InsertBlock(block);
 		*_allocated = true;
 	} else if (block->busy_reading) {
 		// The block is currently busy_reading - wait and try again later
@@ -2171,39 +2553,17 @@ retry:
 
 	if (block->unused) {
 		//TRACE(("remove block %" B_PRIdOFF " from unused\n", blockNumber));
-		block->unused = false;
-		cache->unused_blocks.Remove(block);
-		cache->unused_block_count--;
+		cache->MarkUsed(block);
 	}
 
 	if (*_allocated && readBlock) {
 		// read block into cache
-		int32 blockSize = cache->block_size;
-
-		mark_block_busy_reading(cache, block);
-		mutex_unlock(&cache->lock);
-
-		ssize_t bytesRead = read_pos(cache->fd, blockNumber * blockSize,
-			block->current_data, blockSize);
-
-		mutex_lock(&cache->lock);
-		if (bytesRead < blockSize) {
-			cache->RemoveBlock(block);
-			TB(Error(cache, blockNumber, "read failed", bytesRead));
-
-			status_t error = errno;
-			TRACE_ALWAYS("could not read block %" B_PRIdOFF ": bytesRead: %zd,"
-				" error: %s\n", blockNumber, bytesRead, strerror(error));
-			if (error == B_OK)
-				return B_IO_ERROR;
-			return error;
-		}
-		TB(Read(cache, block));
-
-		mark_block_unbusy_reading(cache, block);
+		status_t status = read_cached_block_run(cache, block);
+		if (status != B_OK)
+			return status;
 	}
 
-	block->ref_count++;
+	atomic_add(&block->ref_count, 1);
 	block->last_accessed = system_time() / 1000000L;
 
 	*_block = block;
@@ -2483,7 +2843,7 @@ dump_cache(int argc, char** argv)
 	off_t blockNumber = -1;
 	if (i + 1 < argc) {
 		blockNumber = parse_expression(argv[i + 1]);
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->LookupBlock(blockNumber);
 		if (block != NULL)
 			dump_block_long(block);
 		else
@@ -2502,6 +2862,13 @@ dump_cache(int argc, char** argv)
 		cache->busy_reading_waiters ? "has" : "no");
 	kprintf(" busy_writing: %" B_PRIu32 ", %s waiters\n", cache->busy_writing_count,
 		cache->busy_writing_waiters ? "has" : "no");
+	kprintf(" lock contention: %" B_PRId32 "\n", cache->lock_contention);
+	kprintf(" lockless hits per hash shard:\n");
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		block_hash_shard& shard = cache->hash_shards[i];
+		kprintf("  %2" B_PRIu32 ": %10" B_PRId32 " hits, %6" B_PRIuSIZE
+			" blocks\n", i, shard.lockless_hits, shard.table.CountElements());
+	}
 
 	if (!cache->pending_notifications.IsEmpty()) {
 		kprintf(" pending notifications:\n");
@@ -2543,19 +2910,21 @@ dump_cache(int argc, char** argv)
 	uint32 count = 0;
 	uint32 dirty = 0;
 	uint32 discarded = 0;
-	BlockTable::Iterator iterator(cache->hash);
-	while (iterator.HasNext()) {
-		cached_block* block = iterator.Next();
-		if (showBlocks)
-			dump_block(block);
-
-		if (block->is_dirty)
-			dirty++;
-		if (block->discard)
-			discarded++;
-		if (block->ref_count)
-			referenced++;
-		count++;
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		BlockTable::Iterator iterator(&cache->hash_shards[i].table);
+		while (iterator.HasNext()) {
+			cached_block* block = iterator.Next();
+			if (showBlocks)
+				dump_block(block);
+
+			if (block->is_dirty)
+				dirty++;
+			if (block->discard)
+				discarded++;
+			if (block->ref_count)
+				referenced++;
+			count++;
+		}
 	}
 
 	kprintf(" %" B_PRIu32 " blocks total, %" B_PRIu32 " dirty, %" B_PRIu32
@@ -2851,13 +3220,17 @@ block_notifier_and_writer(void* /*data*/)
 			if (cache->num_dirty_blocks) {
 				// This cache is not using transactions, we'll scan the blocks
 				// directly
-				BlockTable::Iterator iterator(cache->hash);
-
-				while (iterator.HasNext()) {
-					cached_block* block = iterator.Next();
-					if (block->CanBeWritten() && !writer.Add(block)) {
-						hasMoreBlocks = true;
-						break;
+				for (uint32 i = 0; i < kBlockHashShards && !hasMoreBlocks;
+						i++) {
+					BlockTable::Iterator iterator(
+						&cache->hash_shards[i].table);
+
+					while (iterator.HasNext()) {
+						cached_block* block = iterator.Next();
+						if (block->CanBeWritten() && !writer.AddRun(block)) {
+							hasMoreBlocks = true;
+							break;
+						}
 					}
 				}
 			} else {
@@ -3634,7 +4007,7 @@ cache_has_block_in_transaction(void* _cache, int32 id, off_t blockNumber)
 	block_cache* cache = (block_cache*)_cache;
 	TransactionLocker locker(cache);
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->LookupBlock(blockNumber);
 
 	return (block != NULL && block->transaction != NULL
 		&& block->transaction->id == id);
@@ -3664,11 +4037,18 @@ block_cache_delete(void* _cache, bool allowWrites)
 
 	// free all blocks
 
-	cached_block* block = cache->hash->Clear(true);
-	while (block != NULL) {
-		cached_block* next = block->next;
-		cache->FreeBlock(block);
-		block = next;
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		block_hash_shard& shard = cache->hash_shards[i];
+
+		rw_lock_write_lock(&shard.lock);
+		cached_block* block = shard.table.Clear(true);
+		rw_lock_write_unlock(&shard.lock);
+
+		while (block != NULL) {
+			cached_block* next = block->next;
+			cache->FreeBlock(block);
+			block = next;
+		}
 	}
 
 	// free all transactions (they will all be aborted)
@@ -3715,12 +4095,14 @@ block_cache_sync(void* _cache)
 	MutexLocker locker(&cache->lock);
 
 	BlockWriter writer(cache);
-	BlockTable::Iterator iterator(cache->hash);
+	for (uint32 i = 0; i < kBlockHashShards; i++) {
+		BlockTable::Iterator iterator(&cache->hash_shards[i].table);
 
-	while (iterator.HasNext()) {
-		cached_block* block = iterator.Next();
-		if (block->CanBeWritten())
-			writer.Add(block);
+		while (iterator.HasNext()) {
+			cached_block* block = iterator.Next();
+			if (block->CanBeWritten())
+				writer.Add(block);
+		}
 	}
 
 	status_t status = writer.Write();
@@ -3753,7 +4135,7 @@ block_cache_sync_etc(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (; numBlocks > 0; numBlocks--, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->LookupBlock(blockNumber);
 		if (block == NULL)
 			continue;
 
@@ -3787,7 +4169,7 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 	BlockWriter writer(cache);
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->LookupBlock(blockNumber);
 		if (block != NULL && block->previous_transaction != NULL)
 			writer.Add(block);
 	}
@@ -3799,17 +4181,17 @@ block_cache_discard(void* _cache, off_t blockNumber, size_t numBlocks)
 		// reset blockNumber to its original value
 
 	for (size_t i = 0; i < numBlocks; i++, blockNumber++) {
-		cached_block* block = cache->hash->Lookup(blockNumber);
+		cached_block* block = cache->LookupBlock(blockNumber);
 		if (block == NULL)
 			continue;
 
 		ASSERT(block->previous_transaction == NULL);
 
-		if (block->unused) {
-			cache->unused_blocks.Remove(block);
-			cache->unused_block_count--;
-			cache->RemoveBlock(block);
+		if (block->unused && cache->RemoveUnusedBlock(block)) {
+			cache->FreeBlock(block);
 		} else {
+			// If the block was unused, someone got a reference to it
+			// without locking the cache; it's no longer in the unused list.
 			if (block->transaction != NULL && block->parent_data != NULL
 				&& block->parent_data != block->current_data) {
 				panic("Discarded block %" B_PRIdOFF " has already been changed in this "
@@ -3900,7 +4282,18 @@ status_t
 block_cache_get_etc(void* _cache, off_t blockNumber, const void** _block)
 {
 	block_cache* cache = (block_cache*)_cache;
-	MutexLocker locker(&cache->lock);
+
+	if (blockNumber >= 0 && blockNumber < cache->max_blocks) {
+		cached_block* block = get_cached_block_lockless(cache, blockNumber);
+		if (block != NULL) {
+			TB(Get(cache, block));
+			*_block = block->current_data;
+			return B_OK;
+		}
+	}
+
+	lock_block_cache(cache);
+	MutexLocker locker(&cache->lock, true);
 	bool allocated;
 
 	cached_block* block;
@@ -3947,7 +4340,7 @@ block_cache_set_dirty(void* _cache, off_t blockNumber, bool dirty,
 	block_cache* cache = (block_cache*)_cache;
 	MutexLocker locker(&cache->lock);
 
-	cached_block* block = cache->hash->Lookup(blockNumber);
+	cached_block* block = cache->LookupBlock(blockNumber);
 	if (block == NULL)
 		return B_BAD_VALUE;
 	if (block->is_dirty == dirty) {
@@ -3967,7 +4360,14 @@ void
 block_cache_put(void* _cache, off_t blockNumber)
 {
 	block_cache* cache = (block_cache*)_cache;
-	MutexLocker locker(&cache->lock);
+
+	if (blockNumber >= 0 && blockNumber < cache->max_blocks
+		&& put_cached_block_lockless(cache, blockNumber)) {
+		return;
+	}
+
+	lock_block_cache(cache);
+	MutexLocker locker(&cache->lock, true);
 
 	put_cached_block(cache, blockNumber);
 }
@@ -41,6 +41,16 @@
 
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
+#define READ_AHEAD_STREAMS	4
+
+struct read_ahead_stream {
+	off_t			next_offset;
+		// where the next read of this stream is expected
+	off_t			read_ahead_end;
+		// up to where read-ahead has already been issued
+	uint32			window;
+	bigtime_t		last_used;
+};
 
 struct file_cache_ref {
 	VMCache			*cache;
@@ -51,6 +61,8 @@ struct file_cache_ref {
 		//	write vs. read)
 	int32			last_access_index;
 	uint16			disabled_count;
+	read_ahead_stream streams[READ_AHEAD_STREAMS];
+		// protected by the cache lock
 
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
@@ -107,6 +119,15 @@ static void add_to_iovec(generic_io_vec* vecs, uint32 &index, uint32 max,
 
 static struct cache_module_info* sCacheModule;
 
+static const uint32 kReadAheadWindowLimit = 32 * 1024 * 1024;
+	// upper bound for the windows that can be set via cache_control()
+static uint32 sReadAheadMinWindow = 64 * 1024;
+static uint32 sReadAheadMaxWindow = 1024 * 1024;
+static int64 sSequentialReads;
+static int64 sRandomReads;
+static int64 sReadAheadRequests;
+static int64 sReadAheadBytes;
+
 
 static const uint32 kZeroVecCount = 32;
 static const size_t kZeroVecSize = kZeroVecCount * B_PAGE_SIZE;
@@ -163,6 +184,7 @@ PrecacheIO::Prepare(vm_page_reservation* reservation)
 			PAGE_STATE_CACHED | VM_PAGE_ALLOC_BUSY);
 
 		fCache->InsertPage(page, fOffset + pos);
+		vm_page_check_refault(fCache, page);
 
 		add_to_iovec(fVecs, fVecCount, fPageCount,
 			page->physical_page_number * B_PAGE_SIZE, B_PAGE_SIZE);
@@ -284,6 +306,97 @@ push_access(file_cache_ref* ref, off_t offset, generic_size_t bytes,
 }
 
 
+/*!	Tracks the read streams of the file, and asynchronously reads ahead of
+	those that read sequentially (or with small forward gaps, as in strided
+	access). Every stream starts with a read-ahead window of
+	sReadAheadMinWindow bytes that doubles with each window the reader has
+	caught up with, until sReadAheadMaxWindow is reached. The next window is
+	issued as soon as the reader is in the second half of the current one,
+	so that it never has to wait for the disk.
+	Interleaved readers of the same file are tracked as separate streams, the
+	least recently used stream is replaced on a miss.
+	The cache must not be locked.
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	const uint32 maxWindow = sReadAheadMaxWindow;
+	if (maxWindow == 0
+		|| low_resource_state(B_KERNEL_RESOURCE_PAGES) != B_NO_LOW_RESOURCE)
+		return;
+
+	const uint32 minWindow = min_c(sReadAheadMinWindow, maxWindow);
+	const off_t end = offset + size;
+
+	AutoLocker<VMCache> locker(ref->cache);
+
+	read_ahead_stream* stream = NULL;
+	read_ahead_stream* oldest = &ref->streams[0];
+	for (int32 i = 0; i < READ_AHEAD_STREAMS; i++) {
+		read_ahead_stream& candidate = ref->streams[i];
+		if (candidate.last_used == 0) {
+			oldest = &candidate;
+			continue;
+		}
+
+		off_t gap = max_c(candidate.window, minWindow);
+		if (offset >= candidate.next_offset - B_PAGE_SIZE
+			&& offset <= candidate.next_offset + gap) {
+			stream = &candidate;
+			break;
+		}
+
+		if (oldest->last_used != 0 && candidate.last_used < oldest->last_used)
+			oldest = &candidate;
+	}
+
+	if (stream == NULL) {
+		// start a new stream; unless it starts at the beginning of the file,
+		// we'll only read ahead once it has been confirmed
+		oldest->next_offset = end;
+		oldest->read_ahead_end = end;
+		oldest->window = 0;
+		oldest->last_used = system_time();
+
+		atomic_add64(&sRandomReads, 1);
+		if (offset != 0)
+			return;
+
+		stream = oldest;
+	} else
+		atomic_add64(&sSequentialReads, 1);
+
+	stream->next_offset = end;
+	stream->last_used = system_time();
+
+	if (stream->window == 0) {
+		stream->window = minWindow;
+		stream->read_ahead_end = end;
+	} else if (stream->read_ahead_end < end) {
+		// the reader overtook us
+		stream->window = min_c(stream->window * 2, maxWindow);
+		stream->read_ahead_end = end;
+	} else if (stream->read_ahead_end - end > (off_t)stream->window / 2)
+		return;
+	else
+		stream->window = min_c(stream->window * 2, maxWindow);
+
+	const off_t readAheadOffset = stream->read_ahead_end;
+	const uint32 readAheadSize = stream->window;
+	stream->read_ahead_end += readAheadSize;
+
+	if (readAheadOffset >= ref->cache->virtual_end)
+		return;
+
+	locker.Unlock();
+
+	atomic_add64(&sReadAheadRequests, 1);
+	atomic_add64(&sReadAheadBytes, readAheadSize);
+
+	cache_prefetch_vnode(ref->vnode, readAheadOffset, readAheadSize);
+}
+
+
 static void
 reserve_pages(file_cache_ref* ref, vm_page_reservation* reservation,
 	size_t reservePages, bool isWrite)
@@ -399,6 +512,7 @@ read_into_cache(file_cache_ref* ref, void* cookie, off_t offset,
 			reservation, PAGE_STATE_CACHED | VM_PAGE_ALLOC_BUSY);
 
 		cache->InsertPage(page, offset + pos);
+		vm_page_check_refault(cache, page);
 
 		add_to_iovec(vecs, vecCount, MAX_IO_VECS,
 			page->physical_page_number * B_PAGE_SIZE, B_PAGE_SIZE);
@@ -995,6 +1109,53 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 
 			return status;
 		}
+
+		case CACHE_GET_READ_AHEAD:
+		{
+			if (bufferSize != sizeof(file_cache_read_ahead_info))
+				return B_BAD_VALUE;
+
+			file_cache_read_ahead_info info;
+			info.min_window = sReadAheadMinWindow;
+			info.max_window = sReadAheadMaxWindow;
+			info.sequential_reads = atomic_get64(&sSequentialReads);
+			info.random_reads = atomic_get64(&sRandomReads);
+			info.read_ahead_requests = atomic_get64(&sReadAheadRequests);
+			info.read_ahead_bytes = atomic_get64(&sReadAheadBytes);
+
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(buffer, &info, sizeof(info)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			return B_OK;
+		}
+
+		case CACHE_SET_READ_AHEAD:
+		{
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			file_cache_read_ahead_info info;
+			if (bufferSize != sizeof(file_cache_read_ahead_info))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&info, buffer, sizeof(info)) != B_OK)
+				return B_BAD_ADDRESS;
+
+			// This also keeps the windows from overflowing when they are
+			// rounded up to whole pages below.
+			info.max_window = min_c(info.max_window, kReadAheadWindowLimit);
+			if (info.max_window != 0 && (info.min_window < B_PAGE_SIZE
+					|| info.min_window > info.max_window))
+				return B_BAD_VALUE;
+
+			dprintf("cache_control: set read-ahead window to %" B_PRIu32
+				" - %" B_PRIu32 " bytes\n", info.min_window, info.max_window);
+
+			sReadAheadMinWindow = ROUNDUP(info.min_window, B_PAGE_SIZE);
+			sReadAheadMaxWindow = ROUNDUP(info.max_window, B_PAGE_SIZE);
+			return B_OK;
+		}
 	}
 
 	return B_BAD_HANDLER;
@@ -1021,7 +1182,7 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 	file_cache_ref* ref = ((VMVnodeCache*)cache)->FileCacheRef();
 	off_t fileSize = cache->virtual_end;
 
-	if ((off_t)(offset + size) > fileSize)
+	if (offset < fileSize && (uint64)size > (uint64)(fileSize - offset))
 		size = fileSize - offset;
 
 	// "offset" and "size" are always aligned to B_PAGE_SIZE,
@@ -1151,6 +1312,18 @@ cache_node_launched(size_t argCount, char*  const* args)
 }
 
 
+extern "C" void
+cache_node_read(struct vnode* vnode, dev_t mountID, ino_t vnodeID,
+	off_t offset, size_t size)
+{
+	cache_module_info* module = sCacheModule;
+	if (module == NULL || module->node_read == NULL)
+		return;
+
+	module->node_read(vnode, mountID, vnodeID, offset, size);
+}
+
+
 extern "C" status_t
 file_cache_init_post_boot_device(void)
 {
@@ -1202,6 +1375,7 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	memset(ref->streams, 0, sizeof(ref->streams));
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1365,6 +1539,15 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
+	if (sCacheModule != NULL) {
+		dev_t mountID;
+		ino_t vnodeID;
+		vfs_vnode_to_node_ref(ref->vnode, &mountID, &vnodeID);
+		cache_node_read(ref->vnode, mountID, vnodeID, offset, *_size);
+	}
+
+	read_ahead(ref, offset, *_size);
+
 	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
 }
 
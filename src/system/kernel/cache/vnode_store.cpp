@@ -60,6 +60,8 @@ VMVnodeCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 {
 	generic_size_t bytesUntouched = *_numBytes;
 
+	cache_node_read(fVnode, fDevice, fInode, offset, bytesUntouched);
+
 	status_t status = vfs_read_pages(fVnode, NULL, offset, vecs, count,
 		flags, _numBytes);
 
@@ -788,6 +788,7 @@ IORequest::Init(off_t offset, generic_size_t firstVecOffset,
 	fBuffer->SetVecs(firstVecOffset, lastVecSize, vecs, count, length, flags);
 
 	fOwner = NULL;
+	fScheduledTime = 0;
 	fOffset = offset;
 	fLength = length;
 	fRelativeParentOffset = 0;
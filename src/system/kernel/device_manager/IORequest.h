@@ -231,6 +231,11 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 									{ fOwner = owner; }
 			IORequestOwner*		Owner() const	{ return fOwner; }
 
+			void				SetScheduledTime(bigtime_t time)
+									{ fScheduledTime = time; }
+			bigtime_t			ScheduledTime() const
+									{ return fScheduledTime; }
+
 			status_t			CreateSubRequest(off_t parentOffset,
 									off_t offset, generic_size_t length,
 									IORequest*& subRequest);
@@ -250,6 +255,8 @@ struct IORequest : IORequestChunk, DoublyLinkedListLinkImpl<IORequest> {
 			bool				IsFinished() const
 									{ return fStatus != 1
 										&& fPendingChildren == 0; }
+			bool				HasPendingChildren() const
+									{ return fPendingChildren > 0; }
 			void				NotifyFinished();
 			bool				HasCallbacks() const;
 			void				SetStatusAndNotify(status_t status);
@@ -325,6 +332,7 @@ private:
 
 			mutex				fLock;
 			IORequestOwner*		fOwner;
+			bigtime_t			fScheduledTime;
 			IOBuffer*			fBuffer;
 			off_t				fOffset;
 			generic_size_t		fLength;
@@ -72,3 +72,10 @@ void
 IOScheduler::MediaChanged()
 {
 }
+
+
+void
+IOScheduler::DumpStatistics() const
+{
+	kprintf("  no statistics available\n");
+}
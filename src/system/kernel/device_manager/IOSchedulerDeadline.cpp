@@ -0,0 +1,702 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "IOSchedulerDeadline.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cpu.h>
+#include <smp.h>
+#include <util/AutoLock.h>
+
+#include "IOSchedulerRoster.h"
+
+
+//#define TRACE_IO_SCHEDULER
+#ifdef TRACE_IO_SCHEDULER
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+static const bigtime_t kReadExpire = 500000;
+static const bigtime_t kWriteExpire = 5000000;
+static const int32 kWritesStarved = 16;
+	// number of read operations that may be dispatched while writes are
+	// waiting, before a write is dispatched regardless of its deadline
+
+
+struct IOSchedulerDeadline::SubmissionList {
+	spinlock		lock;
+	IORequestList	requests;
+} CACHE_LINE_ALIGN;
+
+
+IOSchedulerDeadline::IOSchedulerDeadline(DMAResource* resource,
+	int32 queueDepth)
+	:
+	IOScheduler(resource),
+	fSubmissionLists(NULL),
+	fSubmissionListCount(0),
+	fDispatchPending(0),
+	fFinisherThread(-1),
+	fRequestNotifierThread(-1),
+	fQueueDepth(queueDepth),
+	fInFlight(0),
+	fMaxInFlight(0),
+	fWritesStarved(0),
+	fReadExpire(kReadExpire),
+	fWriteExpire(kWriteExpire),
+	fTerminating(false)
+{
+	mutex_init(&fLock, "I/O deadline scheduler");
+	B_INITIALIZE_SPINLOCK(&fFinisherLock);
+
+	fFinishedOperationCondition.Init(this, "I/O finished operation");
+	fFinishedRequestCondition.Init(this, "I/O finished request");
+
+	memset(fRequestCount, 0, sizeof(fRequestCount));
+	memset(fExpiredCount, 0, sizeof(fExpiredCount));
+	memset(fLatencyHistogram, 0, sizeof(fLatencyHistogram));
+	memset(fDepthHistogram, 0, sizeof(fDepthHistogram));
+}
+
+
+IOSchedulerDeadline::~IOSchedulerDeadline()
+{
+	// shutdown threads
+	MutexLocker locker(fLock);
+	InterruptsSpinLocker finisherLocker(fFinisherLock);
+	fTerminating = true;
+
+	fFinishedOperationCondition.NotifyAll();
+	fFinishedRequestCondition.NotifyAll();
+
+	finisherLocker.Unlock();
+	locker.Unlock();
+
+	if (fFinisherThread >= 0)
+		wait_for_thread(fFinisherThread, NULL);
+
+	if (fRequestNotifierThread >= 0)
+		wait_for_thread(fRequestNotifierThread, NULL);
+
+	// destroy our belongings
+	mutex_lock(&fLock);
+	mutex_destroy(&fLock);
+
+	while (IOOperation* operation = fUnusedOperations.RemoveHead())
+		delete operation;
+
+	delete[] fSubmissionLists;
+}
+
+
+status_t
+IOSchedulerDeadline::Init(const char* name)
+{
+	status_t error = IOScheduler::Init(name);
+	if (error != B_OK)
+		return error;
+
+	if (fQueueDepth <= 0) {
+		fQueueDepth = fDMAResource != NULL
+			? fDMAResource->BufferCount() : 16;
+	}
+
+	for (int32 i = 0; i < fQueueDepth; i++) {
+		IOOperation* operation = new(std::nothrow) IOOperation;
+		if (operation == NULL)
+			return B_NO_MEMORY;
+
+		fUnusedOperations.Add(operation);
+	}
+
+	fSubmissionListCount = smp_get_num_cpus();
+	fSubmissionLists
+		= new(std::nothrow) SubmissionList[fSubmissionListCount];
+	if (fSubmissionLists == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < fSubmissionListCount; i++)
+		B_INITIALIZE_SPINLOCK(&fSubmissionLists[i].lock);
+
+	// start threads
+	char buffer[B_OS_NAME_LENGTH];
+	strlcpy(buffer, name, sizeof(buffer));
+	strlcat(buffer, " finisher ", sizeof(buffer));
+	size_t nameLength = strlen(buffer);
+	snprintf(buffer + nameLength, sizeof(buffer) - nameLength, "%" B_PRId32,
+		fID);
+	fFinisherThread = spawn_kernel_thread(&_FinisherThread, buffer,
+		B_NORMAL_PRIORITY + 2, (void *)this);
+	if (fFinisherThread < B_OK)
+		return fFinisherThread;
+
+	strlcpy(buffer, name, sizeof(buffer));
+	strlcat(buffer, " notifier ", sizeof(buffer));
+	nameLength = strlen(buffer);
+	snprintf(buffer + nameLength, sizeof(buffer) - nameLength, "%" B_PRId32,
+		fID);
+	fRequestNotifierThread = spawn_kernel_thread(&_RequestNotifierThread,
+		buffer, B_NORMAL_PRIORITY + 2, (void *)this);
+	if (fRequestNotifierThread < B_OK)
+		return fRequestNotifierThread;
+
+	resume_thread(fFinisherThread);
+	resume_thread(fRequestNotifierThread);
+
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerDeadline::ScheduleRequest(IORequest* request)
+{
+	TRACE("%p->IOSchedulerDeadline::ScheduleRequest(%p)\n", this, request);
+
+	IOBuffer* buffer = request->Buffer();
+
+	if (buffer->IsVirtual()) {
+		status_t status = buffer->LockMemory(request->TeamID(),
+			request->IsWrite());
+		if (status != B_OK) {
+			request->SetStatusAndNotify(status);
+			return status;
+		}
+	}
+
+	request->SetScheduledTime(system_time());
+
+	// The request may already be finished when _Dispatch() returns, so we
+	// have to notify first.
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_SCHEDULED, this,
+		request);
+
+	cpu_status state = disable_interrupts();
+	SubmissionList& list = fSubmissionLists[smp_get_current_cpu()];
+	acquire_spinlock(&list.lock);
+	list.requests.Add(request);
+	release_spinlock(&list.lock);
+	restore_interrupts(state);
+
+	_Dispatch();
+	return B_OK;
+}
+
+
+void
+IOSchedulerDeadline::AbortRequest(IORequest* request, status_t status)
+{
+	MutexLocker locker(fLock);
+	_CollectSubmittedRequests();
+
+	bool notify = _AbortRequest(request);
+
+	locker.Unlock();
+
+	// someone might have failed to get the lock for dispatching meanwhile
+	_Dispatch();
+
+	if (notify)
+		request->SetStatusAndNotify(status);
+}
+
+
+void
+IOSchedulerDeadline::OperationCompleted(IOOperation* operation,
+	status_t status, generic_size_t transferredBytes)
+{
+	InterruptsSpinLocker _(fFinisherLock);
+
+	// finish operation only once
+	if (operation->Status() <= 0)
+		return;
+
+	operation->SetStatus(status, transferredBytes);
+
+	fCompletedOperations.Add(operation);
+	fFinishedOperationCondition.NotifyAll();
+}
+
+
+void
+IOSchedulerDeadline::Dump() const
+{
+	kprintf("IOSchedulerDeadline at %p\n", this);
+	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  queue depth:    %" B_PRId32 "\n", fQueueDepth);
+	kprintf("  in flight:      %" B_PRId32 "\n", fInFlight);
+	kprintf("  read expire:    %" B_PRId64 " us\n", fReadExpire);
+	kprintf("  write expire:   %" B_PRId64 " us\n", fWriteExpire);
+
+	kprintf("  read requests:");
+	for (IORequestList::ConstIterator it = fReadRequests.GetIterator();
+			IORequest* request = it.Next();) {
+		kprintf(" %p", request);
+	}
+	kprintf("\n");
+
+	kprintf("  write requests:");
+	for (IORequestList::ConstIterator it = fWriteRequests.GetIterator();
+			IORequest* request = it.Next();) {
+		kprintf(" %p", request);
+	}
+	kprintf("\n");
+
+	kprintf("  requeued operations:");
+	for (IOOperationList::ConstIterator it = fRequeuedOperations.GetIterator();
+			IOOperation* operation = it.Next();) {
+		kprintf(" %p", operation);
+	}
+	kprintf("\n");
+
+	DumpStatistics();
+}
+
+
+void
+IOSchedulerDeadline::DumpStatistics() const
+{
+	kprintf("  in flight: %" B_PRId32 ", max %" B_PRId32 ", queue depth %"
+		B_PRId32 "\n", fInFlight, fMaxInFlight, fQueueDepth);
+	kprintf("  reads:  %" B_PRIu64 ", %" B_PRIu64 " expired\n",
+		fRequestCount[0], fExpiredCount[0]);
+	kprintf("  writes: %" B_PRIu64 ", %" B_PRIu64 " expired\n",
+		fRequestCount[1], fExpiredCount[1]);
+
+	_DumpHistogram("read latency (us)", fLatencyHistogram[0],
+		LATENCY_BUCKETS);
+	_DumpHistogram("write latency (us)", fLatencyHistogram[1],
+		LATENCY_BUCKETS);
+	_DumpHistogram("queue depth", fDepthHistogram, DEPTH_BUCKETS);
+}
+
+
+/*!	Dispatches as many operations as the queue depth allows. If another
+	thread is already dispatching, it is asked to do another round instead,
+	so submitters never block on each other here.
+*/
+void
+IOSchedulerDeadline::_Dispatch()
+{
+	atomic_set(&fDispatchPending, 1);
+
+	while (atomic_get(&fDispatchPending) != 0) {
+		if (mutex_trylock(&fLock) != B_OK) {
+			// the lock holder will check fDispatchPending after unlocking
+			return;
+		}
+
+		atomic_set(&fDispatchPending, 0);
+
+		if (fTerminating) {
+			mutex_unlock(&fLock);
+			return;
+		}
+
+		_CollectSubmittedRequests();
+
+		IOOperationList operations;
+		IORequest* failedRequest = NULL;
+		status_t failedStatus = B_OK;
+		_PrepareOperations(operations, failedRequest, failedStatus);
+
+		if (failedRequest != NULL) {
+			// there might be more to dispatch
+			atomic_set(&fDispatchPending, 1);
+		}
+
+		mutex_unlock(&fLock);
+
+		if (failedRequest != NULL)
+			failedRequest->SetStatusAndNotify(failedStatus);
+
+		while (IOOperation* operation = operations.RemoveHead()) {
+			TRACE("IOSchedulerDeadline::_Dispatch(): calling callback for "
+				"operation: %p\n", operation);
+
+			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_STARTED,
+				this, operation->Parent(), operation);
+
+			fIOCallback(fIOCallbackData, operation);
+		}
+	}
+}
+
+
+/*!	Moves the requests from the per-CPU submission lists to the read and
+	write lists, ordered by deadline.
+	Must be called with fLock held.
+*/
+void
+IOSchedulerDeadline::_CollectSubmittedRequests()
+{
+	for (int32 i = 0; i < fSubmissionListCount; i++) {
+		SubmissionList& list = fSubmissionLists[i];
+		if (list.requests.IsEmpty())
+			continue;
+
+		IORequestList requests;
+		InterruptsSpinLocker locker(list.lock);
+		requests.TakeFrom(&list.requests);
+		locker.Unlock();
+
+		while (IORequest* request = requests.RemoveHead()) {
+			// Since all requests of a list have the same expiry time, they
+			// almost always go to the end.
+			IORequestList& queue = _RequestList(request);
+			IORequest* before = queue.Tail();
+			while (before != NULL
+				&& before->ScheduledTime() > request->ScheduledTime()) {
+				before = queue.GetPrevious(before);
+			}
+
+			if (before == NULL)
+				queue.InsertBefore(queue.Head(), request);
+			else
+				queue.InsertAfter(before, request);
+		}
+	}
+}
+
+
+/*!	Must be called with fLock held.
+*/
+void
+IOSchedulerDeadline::_PrepareOperations(IOOperationList& operations,
+	IORequest*& _failedRequest, status_t& _failedStatus)
+{
+	// unfinished operations (like the read phase of a partial write) come
+	// first
+	while (fInFlight < fQueueDepth) {
+		IOOperation* operation = fRequeuedOperations.RemoveHead();
+		if (operation == NULL)
+			break;
+
+		operations.Add(operation);
+		fInFlight++;
+		fDepthHistogram[_HistogramBucket(fInFlight, DEPTH_BUCKETS)]++;
+	}
+
+	bigtime_t now = system_time();
+
+	while (fInFlight < fQueueDepth) {
+		IORequest* request = _NextRequest(now);
+		if (request == NULL)
+			break;
+
+		if (request->Status() < B_OK || request->IsPartialTransfer()) {
+			// An operation of this request failed; the request is finished
+			// once its remaining operations are done.
+			_RequestList(request).Remove(request);
+			continue;
+		}
+
+		IOOperation* operation = fUnusedOperations.RemoveHead();
+		if (operation == NULL)
+			break;
+
+		bool firstOperation = request->RemainingBytes() == request->Length();
+
+		status_t status = _PrepareOperation(request, operation);
+		if (status != B_OK) {
+			operation->SetParent(NULL);
+			fUnusedOperations.Add(operation);
+
+			// B_BUSY means some resource (DMABuffers or DMABounceBuffers) was
+			// temporarily unavailable. We'll retry when an operation has
+			// finished.
+			if (status == B_BUSY)
+				break;
+
+			if (_AbortRequest(request)) {
+				_failedRequest = request;
+				_failedStatus = status;
+				break;
+			}
+			continue;
+		}
+
+		if (firstOperation && now > _Deadline(request))
+			fExpiredCount[request->IsWrite() ? 1 : 0]++;
+
+		if (request->RemainingBytes() == 0)
+			_RequestList(request).Remove(request);
+
+		operations.Add(operation);
+		fInFlight++;
+		fDepthHistogram[_HistogramBucket(fInFlight, DEPTH_BUCKETS)]++;
+	}
+
+	if (fInFlight > fMaxInFlight)
+		fMaxInFlight = fInFlight;
+}
+
+
+/*!	Returns the request the next operation should be prepared for.
+	Must be called with fLock held.
+*/
+IORequest*
+IOSchedulerDeadline::_NextRequest(bigtime_t now)
+{
+	IORequest* read = fReadRequests.Head();
+	IORequest* write = fWriteRequests.Head();
+	if (write == NULL)
+		return read;
+	if (read == NULL) {
+		fWritesStarved = 0;
+		return write;
+	}
+
+	bigtime_t writeDeadline = _Deadline(write);
+	if (fWritesStarved >= kWritesStarved
+		|| (writeDeadline <= now && writeDeadline < _Deadline(read))) {
+		fWritesStarved = 0;
+		return write;
+	}
+
+	fWritesStarved++;
+	return read;
+}
+
+
+status_t
+IOSchedulerDeadline::_PrepareOperation(IORequest* request,
+	IOOperation* operation)
+{
+	if (fDMAResource != NULL)
+		return fDMAResource->TranslateNext(request, operation, 0);
+
+	// TODO: If the device has block size restrictions, we might need to use
+	// a bounce buffer.
+	status_t status = operation->Prepare(request);
+	if (status != B_OK)
+		return status;
+
+	operation->SetOriginalRange(request->Offset(), request->Length());
+	request->Advance(request->Length());
+	return B_OK;
+}
+
+
+/*!	Removes the request from the scheduler, so that no further operations
+	are prepared for it. Returns \c true, if no operations of the request are
+	in flight, and the caller has to notify it after unlocking.
+	Must be called with fLock held.
+*/
+bool
+IOSchedulerDeadline::_AbortRequest(IORequest* request)
+{
+	IORequestList& queue = _RequestList(request);
+	if (!queue.Contains(request))
+		return false;
+
+	queue.Remove(request);
+
+	if (!request->HasPendingChildren())
+		return true;
+
+	// let the request end after the part that has been prepared already
+	request->SetTransferredBytes(true, request->TransferredBytes());
+	return false;
+}
+
+
+/*!	Must not be called with fLock held. */
+void
+IOSchedulerDeadline::_FinishOperation(IOOperation* operation,
+	IORequestList& finishedRequests)
+{
+	TRACE("IOSchedulerDeadline::_FinishOperation(): operation: %p\n",
+		operation);
+
+	bool operationFinished = operation->Finish();
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_FINISHED,
+		this, operation->Parent(), operation);
+		// Notify for every time the operation is passed to the I/O hook,
+		// not only when it is fully finished.
+
+	MutexLocker locker(fLock);
+	fInFlight--;
+
+	if (!operationFinished) {
+		TRACE("  operation: %p not finished yet\n", operation);
+		fRequeuedOperations.Add(operation);
+		return;
+	}
+
+	// Notify the request while holding fLock, so that no new operation can
+	// be prepared for it while we look at its state.
+	IORequest* request = operation->Parent();
+	request->OperationFinished(operation);
+
+	// recycle the operation
+	if (fDMAResource != NULL)
+		fDMAResource->RecycleBuffer(operation->Buffer());
+
+	fUnusedOperations.Add(operation);
+
+	if (!request->IsFinished())
+		return;
+
+	if (request->Status() == B_OK && !request->IsPartialTransfer()
+		&& request->RemainingBytes() > 0) {
+		// The request has been processed OK so far, but it isn't really
+		// finished yet.
+		request->SetUnfinished();
+		return;
+	}
+
+	if (request->RemainingBytes() > 0) {
+		// the request failed before all of it could be prepared
+		IORequestList& queue = _RequestList(request);
+		if (queue.Contains(request))
+			queue.Remove(request);
+	}
+
+	int32 direction = request->IsWrite() ? 1 : 0;
+	fRequestCount[direction]++;
+	fLatencyHistogram[direction][_HistogramBucket(
+		system_time() - request->ScheduledTime(), LATENCY_BUCKETS)]++;
+
+	if (request->HasCallbacks()) {
+		// The request has callbacks that may take some time to perform, so
+		// we hand it over to the request notifier.
+		InterruptsSpinLocker finisherLocker(fFinisherLock);
+		fFinishedRequests.Add(request);
+		fFinishedRequestCondition.NotifyAll();
+	} else
+		finishedRequests.Add(request);
+}
+
+
+status_t
+IOSchedulerDeadline::_Finisher()
+{
+	while (true) {
+		InterruptsSpinLocker locker(fFinisherLock);
+
+		IOOperationList operations;
+		operations.TakeFrom(&fCompletedOperations);
+
+		if (operations.IsEmpty()) {
+			if (fTerminating)
+				return B_OK;
+
+			ConditionVariableEntry entry;
+			fFinishedOperationCondition.Add(&entry);
+
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		IORequestList finishedRequests;
+		while (IOOperation* operation = operations.RemoveHead())
+			_FinishOperation(operation, finishedRequests);
+
+		// refill the device queue before notifying the waiters
+		_Dispatch();
+
+		while (IORequest* request = finishedRequests.RemoveHead()) {
+			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+				this, request);
+			request->NotifyFinished();
+		}
+	}
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_FinisherThread(void* _self)
+{
+	IOSchedulerDeadline* self = (IOSchedulerDeadline*)_self;
+	return self->_Finisher();
+}
+
+
+status_t
+IOSchedulerDeadline::_RequestNotifier()
+{
+	while (true) {
+		// We don't use fLock here, so that we never need to dispatch.
+		InterruptsSpinLocker locker(fFinisherLock);
+
+		// get a request
+		IORequest* request = fFinishedRequests.RemoveHead();
+
+		if (request == NULL) {
+			if (fTerminating)
+				return B_OK;
+
+			ConditionVariableEntry entry;
+			fFinishedRequestCondition.Add(&entry);
+
+			locker.Unlock();
+
+			entry.Wait();
+			continue;
+		}
+
+		locker.Unlock();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+			this, request);
+
+		// notify the request
+		request->NotifyFinished();
+	}
+}
+
+
+/*static*/ status_t
+IOSchedulerDeadline::_RequestNotifierThread(void* _self)
+{
+	IOSchedulerDeadline* self = (IOSchedulerDeadline*)_self;
+	return self->_RequestNotifier();
+}
+
+
+/*!	Returns the index of the power of two bucket \a value falls into. */
+/*static*/ int32
+IOSchedulerDeadline::_HistogramBucket(uint64 value, int32 count)
+{
+	int32 bucket = 0;
+	while (value > 1 && bucket < count - 1) {
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+
+/*static*/ void
+IOSchedulerDeadline::_DumpHistogram(const char* name, const uint64* histogram,
+	int32 count)
+{
+	kprintf("  %s:\n", name);
+
+	for (int32 i = 0; i < count; i++) {
+		if (histogram[i] == 0)
+			continue;
+
+		if (i == count - 1) {
+			kprintf("    >= %10" B_PRIu64 ": %" B_PRIu64 "\n", (uint64)1 << i,
+				histogram[i]);
+		} else {
+			kprintf("    <  %10" B_PRIu64 ": %" B_PRIu64 "\n",
+				(uint64)2 << i, histogram[i]);
+		}
+	}
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef IO_SCHEDULER_DEADLINE_H
+#define IO_SCHEDULER_DEADLINE_H
+
+
+#include <KernelExport.h>
+
+#include <condition_variable.h>
+#include <lock.h>
+
+#include "dma_resources.h"
+#include "IOScheduler.h"
+
+
+/*!	An I/O scheduler for devices with deep hardware queues.
+
+	Requests are queued on per-CPU submission lists and are dispatched
+	directly from the submitting thread (or the finisher thread) to the
+	driver, as long as fewer than the queue depth operations are in flight.
+	Reads are preferred over writes, unless a write has passed its deadline,
+	or reads have been dispatched too often while writes were waiting.
+	Operations are not sorted, the device is expected to do that itself.
+
+	The I/O callback may be called from several threads at the same time.
+*/
+class IOSchedulerDeadline : public IOScheduler {
+public:
+								IOSchedulerDeadline(DMAResource* resource,
+									int32 queueDepth = 0);
+	virtual						~IOSchedulerDeadline();
+
+	virtual	status_t			Init(const char* name);
+
+	virtual	status_t			ScheduleRequest(IORequest* request);
+
+	virtual	void				AbortRequest(IORequest* request,
+									status_t status = B_CANCELED);
+	virtual	void				OperationCompleted(IOOperation* operation,
+									status_t status,
+									generic_size_t transferredBytes);
+									// called by the driver when the operation
+									// has been completed successfully or failed
+									// for some reason
+
+	virtual	void				Dump() const;
+	virtual	void				DumpStatistics() const;
+
+private:
+			struct SubmissionList;
+
+			enum {
+				LATENCY_BUCKETS		= 24,
+				DEPTH_BUCKETS		= 10
+			};
+
+			void				_Dispatch();
+			void				_CollectSubmittedRequests();
+			void				_PrepareOperations(IOOperationList& operations,
+									IORequest*& _failedRequest,
+									status_t& _failedStatus);
+			IORequest*			_NextRequest(bigtime_t now);
+			status_t			_PrepareOperation(IORequest* request,
+									IOOperation* operation);
+			bool				_AbortRequest(IORequest* request);
+			void				_FinishOperation(IOOperation* operation,
+									IORequestList& finishedRequests);
+			IORequestList&		_RequestList(IORequest* request)
+									{ return request->IsWrite()
+										? fWriteRequests : fReadRequests; }
+			bigtime_t			_Deadline(IORequest* request) const
+									{ return request->ScheduledTime()
+										+ (request->IsWrite()
+											? fWriteExpire : fReadExpire); }
+
+			status_t			_Finisher();
+	static	status_t			_FinisherThread(void* self);
+			status_t			_RequestNotifier();
+	static	status_t			_RequestNotifierThread(void* self);
+
+	static	int32				_HistogramBucket(uint64 value, int32 count);
+	static	void				_DumpHistogram(const char* name,
+									const uint64* histogram, int32 count);
+
+private:
+			mutex				fLock;
+			spinlock			fFinisherLock;
+			SubmissionList*		fSubmissionLists;
+			int32				fSubmissionListCount;
+			int32				fDispatchPending;
+			thread_id			fFinisherThread;
+			thread_id			fRequestNotifierThread;
+			IORequestList		fReadRequests;
+			IORequestList		fWriteRequests;
+			IORequestList		fFinishedRequests;
+			IOOperationList		fUnusedOperations;
+			IOOperationList		fRequeuedOperations;
+			IOOperationList		fCompletedOperations;
+			ConditionVariable	fFinishedOperationCondition;
+			ConditionVariable	fFinishedRequestCondition;
+			int32				fQueueDepth;
+			int32				fInFlight;
+			int32				fMaxInFlight;
+			int32				fWritesStarved;
+			bigtime_t			fReadExpire;
+			bigtime_t			fWriteExpire;
+	volatile bool				fTerminating;
+
+			// statistics, protected by fLock
+			uint64				fRequestCount[2];
+			uint64				fExpiredCount[2];
+			uint64				fLatencyHistogram[2][LATENCY_BUCKETS];
+			uint64				fDepthHistogram[DEPTH_BUCKETS];
+};
+
+
+#endif	// IO_SCHEDULER_DEADLINE_H
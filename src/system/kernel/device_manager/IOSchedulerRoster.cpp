@@ -7,8 +7,14 @@
 
 #include "IOSchedulerRoster.h"
 
+#include <string.h>
+
+#include <driver_settings.h>
 #include <util/AutoLock.h>
 
+#include "IOSchedulerDeadline.h"
+#include "IOSchedulerSimple.h"
+
 
 /*static*/ IOSchedulerRoster IOSchedulerRoster::sDefaultInstance;
 
@@ -30,6 +36,53 @@ IOSchedulerRoster::~IOSchedulerRoster()
 }
 
 
+/*!	Creates and initializes the I/O scheduler for the device \a name, which
+	is the device's published path.
+	Devices that can have several operations in flight pass their hardware
+	queue depth as \a queueDepth, and get the deadline scheduler, others get
+	the simple one. This can be overridden per device, or by a "default"
+	entry in the "io_scheduler" driver settings, for example:
+		default simple
+		disk/virtual/virtio_block/0/raw deadline
+	A device with a \a queueDepth of \c 0 is never passed more than one
+	operation at a time by the deadline scheduler.
+*/
+status_t
+IOSchedulerRoster::CreateScheduler(DMAResource* resource, const char* name,
+	int32 queueDepth, IOScheduler*& _scheduler)
+{
+	bool deadline = queueDepth > 0;
+
+	if (void* handle = load_driver_settings("io_scheduler")) {
+		const char* type = get_driver_parameter(handle, name, NULL, NULL);
+		if (type == NULL)
+			type = get_driver_parameter(handle, "default", NULL, NULL);
+		if (type != NULL)
+			deadline = strcmp(type, "deadline") == 0;
+
+		unload_driver_settings(handle);
+	}
+
+	IOScheduler* scheduler;
+	if (deadline) {
+		scheduler = new(std::nothrow) IOSchedulerDeadline(resource,
+			max_c(queueDepth, 1));
+	} else
+		scheduler = new(std::nothrow) IOSchedulerSimple(resource);
+	if (scheduler == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = scheduler->Init(name);
+	if (status != B_OK) {
+		delete scheduler;
+		return status;
+	}
+
+	_scheduler = scheduler;
+	return B_OK;
+}
+
+
 void
 IOSchedulerRoster::AddScheduler(IOScheduler* scheduler)
 {
@@ -137,6 +190,35 @@ dump_io_scheduler(int argc, char** argv)
 }
 
 
+static int
+dump_io_scheduler_stats(int argc, char** argv)
+{
+	if (argc > 2) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	if (argc == 2) {
+		IOScheduler* scheduler = (IOScheduler*)parse_expression(argv[1]);
+		kprintf("I/O scheduler %p \"%s\" (%" B_PRId32 ")\n", scheduler,
+			scheduler->Name(), scheduler->ID());
+		scheduler->DumpStatistics();
+		return 0;
+	}
+
+	const IOSchedulerList& schedulers
+		= IOSchedulerRoster::Default()->SchedulerList();
+	for (IOSchedulerList::ConstIterator it = schedulers.GetIterator();
+			IOScheduler* scheduler = it.Next();) {
+		kprintf("I/O scheduler %p \"%s\" (%" B_PRId32 ")\n", scheduler,
+			scheduler->Name(), scheduler->ID());
+		scheduler->DumpStatistics();
+	}
+
+	return 0;
+}
+
+
 static int
 dump_io_request_owner(int argc, char** argv)
 {
@@ -221,6 +303,11 @@ IOSchedulerRoster::Init()
 		"Dump an I/O scheduler",
 		"<scheduler>\n"
 		"Dumps I/O scheduler at address <scheduler>.\n", 0);
+	add_debugger_command_etc("io_scheduler_stats", &dump_io_scheduler_stats,
+		"Dump the statistics of I/O schedulers",
+		"[ <scheduler> ]\n"
+		"Dumps the queue depth and latency statistics of I/O scheduler\n"
+		"<scheduler>, or of all I/O schedulers, if unspecified.\n", 0);
 	add_debugger_command_etc("io_request_owner", &dump_io_request_owner,
 		"Dump an I/O request owner",
 		"<owner>\n"
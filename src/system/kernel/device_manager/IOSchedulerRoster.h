@@ -38,6 +38,10 @@ public:
 									// caller must keep the roster locked,
 									// while accessing the list
 
+			status_t			CreateScheduler(DMAResource* resource,
+									const char* name, int32 queueDepth,
+									IOScheduler*& _scheduler);
+
 			void				AddScheduler(IOScheduler* scheduler);
 			void				RemoveScheduler(IOScheduler* scheduler);
 
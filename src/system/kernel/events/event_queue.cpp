@@ -6,6 +6,8 @@
 
 #include <event_queue.h>
 
+#include <signal.h>
+
 #include <OS.h>
 
 #include <AutoDeleter.h>
@@ -97,7 +99,8 @@ public:
 
 	void				Closed();
 
-	status_t			Select(int32 object, uint16 type, uint32 events, void* userData);
+	status_t			Select(int32 object, uint16 type, uint32 events,
+							void* userData, bool exclusive = false);
 	status_t			Query(int32 object, uint16 type, uint32* selectedEvents, void** userData);
 	status_t			Deselect(int32 object, uint16 type);
 
@@ -209,12 +212,16 @@ EventQueue::Closed()
 
 
 status_t
-EventQueue::Select(int32 object, uint16 type, uint32 events, void* userData)
+EventQueue::Select(int32 object, uint16 type, uint32 events, void* userData,
+	bool exclusive)
 {
 	MutexLocker locker(&fQueueLock);
 
 	select_event* event = _GetEvent(object, type);
 	if (event != NULL) {
+		if (exclusive)
+			return EEXIST;
+
 		if ((event->selected_events | event->behavior)
 				== (USER_EVENTS(events) | B_EVENT_NON_MASKABLE))
 			return B_OK;
@@ -713,3 +720,118 @@ _user_event_queue_wait(int queue, event_wait_info* userInfos, int numInfos,
 
 	return status == B_OK ? result : status;
 }
+
+
+static status_t
+apply_event_queue_change(EventQueue* eventQueue,
+	const event_queue_change& change)
+{
+	switch (change.operation) {
+		case EVENT_QUEUE_CHANGE_ADD:
+		case EVENT_QUEUE_CHANGE_MODIFY:
+			if (change.events <= 0)
+				return B_BAD_VALUE;
+			return eventQueue->Select(change.object, change.type,
+				change.events, change.user_data,
+				change.operation == EVENT_QUEUE_CHANGE_ADD);
+
+		case EVENT_QUEUE_CHANGE_DELETE:
+			return eventQueue->Deselect(change.object, change.type);
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+/*!	Applies the given changes to the queue, and then waits for events like
+	_user_event_queue_wait(), all in one go. The result of each change is
+	stored in its \c status field. If any of them failed, \c B_ERROR is
+	returned without waiting. If \a numInfos is 0, the function doesn't wait
+	at all.
+*/
+ssize_t
+_user_event_queue_submit(int queue, event_queue_change* userChanges,
+	int numChanges, event_wait_info* userInfos, int numInfos, uint32 flags,
+	bigtime_t timeout, const sigset_t* userSigMask)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if (numChanges < 0 || numInfos < 0)
+		return B_BAD_VALUE;
+	if (numChanges > 0
+		&& (userChanges == NULL || !IS_USER_ADDRESS(userChanges))) {
+		return B_BAD_ADDRESS;
+	}
+	if (numInfos > 0 && (userInfos == NULL || !IS_USER_ADDRESS(userInfos)))
+		return B_BAD_ADDRESS;
+
+	sigset_t sigMask;
+	if (userSigMask != NULL
+		&& (!IS_USER_ADDRESS(userSigMask)
+			|| user_memcpy(&sigMask, userSigMask, sizeof(sigMask)) != B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+
+	file_descriptor* descriptor;
+	GET_QUEUE_FD_OR_RETURN(queue, false, descriptor);
+	FileDescriptorPutter _(descriptor);
+
+	EventQueue* eventQueue = (EventQueue*)descriptor->cookie;
+
+	// When the syscall is restarted, the changes have already been applied.
+	if (numChanges > 0 && !syscall_restart_is_restarted()) {
+		BStackOrHeapArray<event_queue_change, 16> changes(numChanges);
+		if (!changes.IsValid())
+			return B_NO_MEMORY;
+
+		if (user_memcpy(changes, userChanges,
+				sizeof(event_queue_change) * numChanges) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+
+		bool failed = false;
+		for (int i = 0; i < numChanges; i++) {
+			changes[i].status = apply_event_queue_change(eventQueue,
+				changes[i]);
+			if (changes[i].status != B_OK)
+				failed = true;
+		}
+
+		if (user_memcpy(userChanges, changes,
+				sizeof(event_queue_change) * numChanges) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+
+		if (failed)
+			return B_ERROR;
+	}
+
+	if (numInfos == 0)
+		return B_OK;
+
+	BStackOrHeapArray<event_wait_info, 16> infos(numInfos);
+	if (!infos.IsValid())
+		return B_NO_MEMORY;
+
+	// Set the new signal mask for the wait. As with poll(), the old one is
+	// restored when the syscall returns, so that a signal it unblocks is
+	// still delivered.
+	if (userSigMask != NULL) {
+		Thread* thread = thread_get_current_thread();
+		sigset_t oldSigMask;
+		sigprocmask(SIG_SETMASK, &sigMask, &oldSigMask);
+		thread->old_sig_block_mask = oldSigMask;
+		thread->flags |= THREAD_FLAGS_OLD_SIGMASK;
+	}
+
+	ssize_t result = eventQueue->Wait(infos, numInfos, flags, timeout);
+	if (result < 0)
+		return syscall_restart_handle_timeout_post(result, timeout);
+
+	if (user_memcpy(userInfos, infos, sizeof(event_wait_info) * result)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
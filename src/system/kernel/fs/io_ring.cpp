@@ -0,0 +1,630 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Asynchronous I/O via a submission and a completion ring shared with
+	userland.
+
+	Userland fills in submission queue entries and announces them by advancing
+	the tail of the submission queue. _user_io_ring_enter() copies the new
+	entries into requests and hands them to a pool of worker threads. The
+	workers are kernel threads that live in the team that created the ring, so
+	they see the same file descriptors and address space as the team itself,
+	and simply execute the entries via the respective _user_*() syscall
+	functions. The results are posted to the completion queue, from which
+	userland can pick them up without entering the kernel.
+*/
+
+
+#include <fs/io_ring.h>
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <AutoDeleter.h>
+#include <Referenceable.h>
+
+#include <condition_variable.h>
+#include <fs/fd.h>
+#include <ksignal.h>
+#include <lock.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <vfs.h>
+#include <vm/vm.h>
+
+
+//#define TRACE_IO_RING
+#ifdef TRACE_IO_RING
+#	define TRACE(x...) dprintf("io_ring: " x)
+#else
+#	define TRACE(x...) do {} while (false)
+#endif
+
+
+struct io_ring_request : DoublyLinkedListLinkImpl<io_ring_request> {
+	io_ring_sqe		sqe;
+};
+
+typedef DoublyLinkedList<io_ring_request> RequestList;
+
+
+class IORing : public BReferenceable {
+public:
+								IORing(team_id team);
+								~IORing();
+
+			status_t			Init(uint32 entries, uint32 workerCount);
+			void				Closed();
+
+			void				GetParams(io_ring_params& params) const;
+
+			status_t			Submit(uint32 toSubmit, uint32& _submitted);
+			status_t			WaitForCompletions(uint32 minComplete,
+									uint32 flags, bigtime_t timeout);
+
+			team_id				Team() const	{ return fTeam; }
+
+private:
+	static	status_t			_WorkerEntry(void* data);
+			void				_Work();
+			int64				_Execute(const io_ring_sqe& sqe);
+			void				_Complete(uint64 userData, int64 result);
+			uint32				_PendingCompletions() const;
+
+private:
+			mutex				fLock;
+			ConditionVariable	fWorkCondition;
+			ConditionVariable	fCompletionCondition;
+			team_id				fTeam;
+			bool				fClosing;
+
+			area_id				fArea;
+			area_id				fUserArea;
+			void*				fUserAddress;
+			io_ring_header*		fHeader;
+			io_ring_sqe*		fSQEs;
+			io_ring_cqe*		fCQEs;
+			uint32				fSQEntries;
+			uint32				fCQEntries;
+			uint32				fSQHead;
+			uint32				fCQTail;
+
+			io_ring_request*	fRequests;
+			RequestList			fFreeRequests;
+			RequestList			fPendingRequests;
+			uint32				fInFlight;
+			uint32				fCompletionWaiters;
+
+			thread_id*			fWorkers;
+			uint32				fWorkerCount;
+};
+
+
+static bool
+current_thread_killed()
+{
+	Thread* thread = thread_get_current_thread();
+	return (thread->AllPendingSignals() & KILL_SIGNALS) != 0;
+}
+
+
+IORing::IORing(team_id team)
+	:
+	fTeam(team),
+	fClosing(false),
+	fArea(-1),
+	fUserArea(-1),
+	fUserAddress(NULL),
+	fHeader(NULL),
+	fSQEs(NULL),
+	fCQEs(NULL),
+	fSQEntries(0),
+	fCQEntries(0),
+	fSQHead(0),
+	fCQTail(0),
+	fRequests(NULL),
+	fInFlight(0),
+	fCompletionWaiters(0),
+	fWorkers(NULL),
+	fWorkerCount(0)
+{
+	mutex_init(&fLock, "io ring");
+	fWorkCondition.Init(this, "io ring work");
+	fCompletionCondition.Init(this, "io ring completion");
+}
+
+
+IORing::~IORing()
+{
+	if (fUserArea >= 0)
+		vm_delete_area(fTeam, fUserArea, true);
+	if (fArea >= 0)
+		delete_area(fArea);
+
+	delete[] fRequests;
+	delete[] fWorkers;
+
+	mutex_destroy(&fLock);
+}
+
+
+status_t
+IORing::Init(uint32 entries, uint32 workerCount)
+{
+	if (entries == 0 || entries > IO_RING_MAX_ENTRIES
+		|| workerCount > IO_RING_MAX_WORKERS) {
+		return B_BAD_VALUE;
+	}
+	if (workerCount == 0)
+		workerCount = IO_RING_DEFAULT_WORKERS;
+
+	// round up to a power of two, so the indices can be masked
+	fSQEntries = 1;
+	while (fSQEntries < entries)
+		fSQEntries <<= 1;
+	fCQEntries = fSQEntries * 2;
+
+	// Since the ring is shared with userland, it must stay mapped in the kernel
+	// address space, which lets us access it without faulting.
+	size_t size = sizeof(io_ring_header) + fSQEntries * sizeof(io_ring_sqe)
+		+ fCQEntries * sizeof(io_ring_cqe);
+	size = ROUNDUP(size, B_PAGE_SIZE);
+
+	void* address;
+	fArea = create_area("io ring", &address, B_ANY_KERNEL_ADDRESS, size,
+		B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	if (fArea < 0)
+		return fArea;
+
+	fHeader = (io_ring_header*)address;
+	fSQEs = (io_ring_sqe*)(fHeader + 1);
+	fCQEs = (io_ring_cqe*)(fSQEs + fSQEntries);
+
+	memset(fHeader, 0, size);
+	fHeader->sq.mask = fSQEntries - 1;
+	fHeader->sq.entries = fSQEntries;
+	fHeader->cq.mask = fCQEntries - 1;
+	fHeader->cq.entries = fCQEntries;
+
+	fUserArea = vm_clone_area(fTeam, "io ring", &fUserAddress, B_ANY_ADDRESS,
+		B_READ_AREA | B_WRITE_AREA | B_KERNEL_AREA, REGION_NO_PRIVATE_MAP,
+		fArea, true);
+	if (fUserArea < 0)
+		return fUserArea;
+
+	// There can't be more requests in flight than completions fit into the
+	// completion queue.
+	fRequests = new(std::nothrow) io_ring_request[fCQEntries];
+	fWorkers = new(std::nothrow) thread_id[workerCount];
+	if (fRequests == NULL || fWorkers == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < fCQEntries; i++)
+		fFreeRequests.Add(&fRequests[i]);
+
+	// spawn the workers
+	status_t status = B_OK;
+	for (; fWorkerCount < workerCount; fWorkerCount++) {
+		char name[B_OS_NAME_LENGTH];
+		snprintf(name, sizeof(name), "io ring %" B_PRId32 " worker",
+			fArea);
+
+		// The workers live in the ring's team, but must leave the team's
+		// signals to its own threads: a pending signal would otherwise
+		// interrupt every blocking operation they execute.
+		ThreadCreationAttributes attributes(&_WorkerEntry, name,
+			B_NORMAL_PRIORITY, this, fTeam);
+		attributes.signal_mask = BLOCKABLE_SIGNALS;
+
+		AcquireReference();
+		thread_id thread = thread_create_thread(attributes, true);
+		if (thread < 0) {
+			ReleaseReference();
+			status = thread;
+			break;
+		}
+
+		fWorkers[fWorkerCount] = thread;
+	}
+
+	// If spawning failed, the workers will exit right away.
+	if (status != B_OK)
+		fClosing = true;
+
+	for (uint32 i = 0; i < fWorkerCount; i++)
+		resume_thread(fWorkers[i]);
+
+	return status;
+}
+
+
+void
+IORing::Closed()
+{
+	MutexLocker locker(fLock);
+	fClosing = true;
+	fWorkCondition.NotifyAll(B_FILE_ERROR);
+	fCompletionCondition.NotifyAll(B_FILE_ERROR);
+	locker.Unlock();
+
+	// Workers might be blocked in an operation that does not complete any
+	// time soon, like accept() or recv(). Kill them the same way the team
+	// does when it is shut down.
+	for (uint32 i = 0; i < fWorkerCount; i++) {
+		Thread* thread = Thread::Get(fWorkers[i]);
+		if (thread == NULL)
+			continue;
+		BReference<Thread> threadReference(thread, true);
+
+		if (thread->team->id != fTeam)
+			continue;
+
+		Signal signal(SIGKILLTHR, SI_USER, B_OK, team_get_kernel_team_id());
+		send_signal_to_thread(thread, signal, B_DO_NOT_RESCHEDULE);
+	}
+}
+
+
+void
+IORing::GetParams(io_ring_params& params) const
+{
+	params.workers = fWorkerCount;
+	params.sq_entries = fSQEntries;
+	params.cq_entries = fCQEntries;
+	params.sqes_offset = (addr_t)fSQEs - (addr_t)fHeader;
+	params.cqes_offset = (addr_t)fCQEs - (addr_t)fHeader;
+	params.area = fUserArea;
+	params.address = fUserAddress;
+}
+
+
+/*!	Moves up to \a toSubmit new entries from the submission queue to the
+	workers. Fewer are submitted, if userland did not provide as many, or if
+	the completion queue could not take the results.
+*/
+status_t
+IORing::Submit(uint32 toSubmit, uint32& _submitted)
+{
+	_submitted = 0;
+
+	MutexLocker locker(fLock);
+
+	if (fClosing)
+		return B_FILE_ERROR;
+
+	// The tail is written by userland, so don't trust it too much.
+	uint32 available = (uint32)atomic_get((int32*)&fHeader->sq.tail) - fSQHead;
+	if (available > fSQEntries)
+		return B_BAD_DATA;
+	if (toSubmit > available)
+		toSubmit = available;
+
+	uint32 submitted = 0;
+	while (submitted < toSubmit
+		&& fInFlight + _PendingCompletions() < fCQEntries) {
+		io_ring_request* request = fFreeRequests.RemoveHead();
+		if (request == NULL)
+			break;
+
+		// copy the entry, userland can change it at any time
+		memcpy(&request->sqe, &fSQEs[fSQHead & (fSQEntries - 1)],
+			sizeof(io_ring_sqe));
+		fSQHead++;
+
+		fPendingRequests.Add(request);
+		fInFlight++;
+		submitted++;
+	}
+
+	if (submitted == 0)
+		return toSubmit > 0 ? B_BUSY : B_OK;
+
+	atomic_set((int32*)&fHeader->sq.head, fSQHead);
+
+	if (submitted == 1)
+		fWorkCondition.NotifyOne();
+	else
+		fWorkCondition.NotifyAll();
+
+	_submitted = submitted;
+	return B_OK;
+}
+
+
+/*!	Waits until at least \a minComplete completions are waiting in the
+	completion queue. Never waits for more completions than could possibly
+	arrive.
+*/
+status_t
+IORing::WaitForCompletions(uint32 minComplete, uint32 flags, bigtime_t timeout)
+{
+	MutexLocker locker(fLock);
+
+	while (true) {
+		if (fClosing)
+			return B_FILE_ERROR;
+
+		uint32 pending = _PendingCompletions();
+		if (pending >= minComplete || pending + fInFlight < minComplete)
+			return B_OK;
+
+		fCompletionWaiters++;
+		status_t status = fCompletionCondition.Wait(&fLock,
+			flags | B_CAN_INTERRUPT, timeout);
+		fCompletionWaiters--;
+
+		if (status != B_OK)
+			return status;
+	}
+}
+
+
+/*static*/ status_t
+IORing::_WorkerEntry(void* data)
+{
+	IORing* ring = (IORing*)data;
+	ring->_Work();
+	ring->ReleaseReference();
+	return B_OK;
+}
+
+
+void
+IORing::_Work()
+{
+	MutexLocker locker(fLock);
+
+	while (!fClosing) {
+		io_ring_request* request = fPendingRequests.RemoveHead();
+		if (request == NULL) {
+			// We're only interrupted when the team is shutting down.
+			if (fWorkCondition.Wait(&fLock, B_KILL_CAN_INTERRUPT)
+					== B_INTERRUPTED) {
+				break;
+			}
+			continue;
+		}
+
+		locker.Unlock();
+
+		int64 result = _Execute(request->sqe);
+		bool killed = current_thread_killed();
+
+		locker.Lock();
+
+		if (!fClosing && !killed)
+			_Complete(request->sqe.user_data, result);
+
+		fFreeRequests.Add(request);
+		fInFlight--;
+
+		if (killed)
+			break;
+	}
+
+	TRACE("worker %" B_PRId32 " exiting\n", thread_get_current_thread_id());
+}
+
+
+/*!	Executes the given entry. Since the worker lives in the ring's team, the
+	syscall functions validate the userland buffers and look up the file
+	descriptors just as if the team had invoked them itself.
+*/
+int64
+IORing::_Execute(const io_ring_sqe& sqe)
+{
+	void* address = (void*)(addr_t)sqe.address;
+	size_t length = (size_t)sqe.length;
+
+	switch (sqe.opcode) {
+		case IO_RING_OP_NOP:
+			return B_OK;
+		case IO_RING_OP_READ:
+			return _user_read(sqe.fd, sqe.offset, address, length);
+		case IO_RING_OP_WRITE:
+			return _user_write(sqe.fd, sqe.offset, address, length);
+		case IO_RING_OP_READV:
+			return _user_readv(sqe.fd, sqe.offset, (const iovec*)address,
+				length);
+		case IO_RING_OP_WRITEV:
+			return _user_writev(sqe.fd, sqe.offset, (const iovec*)address,
+				length);
+		case IO_RING_OP_FSYNC:
+			return _user_fsync(sqe.fd);
+		case IO_RING_OP_ACCEPT:
+			return _user_accept(sqe.fd, (sockaddr*)address,
+				(socklen_t*)(addr_t)sqe.address_length, sqe.flags);
+		case IO_RING_OP_SEND:
+			return _user_send(sqe.fd, address, length, sqe.flags);
+		case IO_RING_OP_RECV:
+			return _user_recv(sqe.fd, address, length, sqe.flags);
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+/*!	Posts a completion. The caller must hold the ring lock. */
+void
+IORing::_Complete(uint64 userData, int64 result)
+{
+	if (_PendingCompletions() >= fCQEntries) {
+		// userland has messed with the completion queue head
+		atomic_add((int32*)&fHeader->cq.overflow, 1);
+		return;
+	}
+
+	io_ring_cqe& cqe = fCQEs[fCQTail & (fCQEntries - 1)];
+	cqe.user_data = userData;
+	cqe.result = result;
+
+	fCQTail++;
+	atomic_set((int32*)&fHeader->cq.tail, fCQTail);
+
+	if (fCompletionWaiters > 0)
+		fCompletionCondition.NotifyAll();
+}
+
+
+/*!	Returns the number of completions userland has not consumed yet. */
+uint32
+IORing::_PendingCompletions() const
+{
+	uint32 pending = fCQTail - (uint32)atomic_get((int32*)&fHeader->cq.head);
+	return pending > fCQEntries ? fCQEntries : pending;
+}
+
+
+//	#pragma mark - File descriptor ops
+
+
+static status_t
+io_ring_close(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	ring->Closed();
+	return B_OK;
+}
+
+
+static void
+io_ring_free(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	ring->ReleaseReference();
+}
+
+
+static struct fd_ops sIORingFDOps = {
+	&io_ring_close,
+	&io_ring_free
+};
+
+
+static status_t
+get_ring_descriptor(int fd, file_descriptor*& descriptor)
+{
+	if (fd < 0)
+		return B_FILE_ERROR;
+
+	descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->ops != &sIORingFDOps) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	return B_OK;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_io_ring_create(uint32 entries, io_ring_params* userParams)
+{
+	if (userParams == NULL || !IS_USER_ADDRESS(userParams))
+		return B_BAD_ADDRESS;
+
+	io_ring_params params;
+	if (user_memcpy(&params, userParams, sizeof(params)) != B_OK)
+		return B_BAD_ADDRESS;
+
+	IORing* ring = new(std::nothrow) IORing(team_get_current_team_id());
+	if (ring == NULL)
+		return B_NO_MEMORY;
+
+	BReference<IORing> ringReference(ring, true);
+
+	status_t status = ring->Init(entries, params.workers);
+	if (status != B_OK) {
+		ring->Closed();
+		return status;
+	}
+
+	ring->GetParams(params);
+	if (user_memcpy(userParams, &params, sizeof(params)) != B_OK) {
+		ring->Closed();
+		return B_BAD_ADDRESS;
+	}
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		ring->Closed();
+		return B_NO_MEMORY;
+	}
+
+	descriptor->ops = &sIORingFDOps;
+	descriptor->cookie = ring;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		ring->Closed();
+		return fd;
+	}
+
+	// the descriptor owns the reference now
+	ringReference.Detach();
+
+	rw_lock_write_lock(&context->lock);
+	fd_set_close_on_exec(context, fd, true);
+	rw_lock_write_unlock(&context->lock);
+
+	return fd;
+}
+
+
+ssize_t
+_user_io_ring_enter(int fd, uint32 toSubmit, uint32 minComplete, uint32 flags,
+	bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	file_descriptor* descriptor;
+	status_t status = get_ring_descriptor(fd, descriptor);
+	if (status != B_OK)
+		return status;
+	FileDescriptorPutter _(descriptor);
+
+	IORing* ring = (IORing*)descriptor->cookie;
+
+	// The workers only have access to the files of the ring's team.
+	if (ring->Team() != team_get_current_team_id())
+		return B_NOT_ALLOWED;
+
+	// When the syscall is restarted, the entries have already been submitted.
+	uint32 submitted = 0;
+	if (toSubmit > 0 && !syscall_restart_is_restarted()) {
+		status = ring->Submit(toSubmit, submitted);
+		if (status != B_OK)
+			return status;
+	}
+
+	if (minComplete == 0)
+		return submitted;
+
+	status = ring->WaitForCompletions(minComplete, flags, timeout);
+	if (status != B_OK) {
+		// Don't lose the number of submitted entries.
+		if (submitted > 0)
+			return submitted;
+		return syscall_restart_handle_timeout_post(status, timeout);
+	}
+
+	return submitted;
+}
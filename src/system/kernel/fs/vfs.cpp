@@ -35,6 +35,7 @@
 #include <AutoDeleterDrivers.h>
 #include <block_cache.h>
 #include <boot/kernel_args.h>
+#include <brw_lock.h>
 #include <debug_heap.h>
 #include <disk_device_manager/KDiskDevice.h>
 #include <disk_device_manager/KDiskDeviceManager.h>
@@ -117,6 +118,13 @@ const static size_t kMaxPathLength = 65536;
 	// The absolute maximum path length (for getcwd() - this is not depending
 	// on PATH_MAX
 
+const static size_t kMaxReadDirStatBufferSize = B_PAGE_SIZE * 2;
+const static uint32 kMaxReadDirStatCount = 128;
+	// limits for a single read_dir_stat() call
+
+const static size_t kCopyFileBufferSize = 256 * 1024;
+	// the kernel buffer used by sendfile() and copy_file_range()
+
 
 typedef DoublyLinkedList<vnode> VnodeList;
 
@@ -216,7 +224,7 @@ struct advisory_locking {
 	Manipulation of the fs_mount structures themselves
 	(and their destruction) requires different locks though.
 */
-static rw_lock sMountLock = RW_LOCK_INITIALIZER("vfs_mount_lock");
+static brw_lock sMountLock = BRW_LOCK_INITIALIZER("vfs_mount_lock");
 
 /*!	\brief Guards mount/unmount operations.
 
@@ -713,7 +721,7 @@ public:
 static struct fs_mount*
 find_mount(dev_t id)
 {
-	ASSERT_READ_LOCKED_RW_LOCK(&sMountLock);
+	ASSERT_READ_LOCKED_BRW_LOCK(&sMountLock);
 
 	return sMountsTable->Lookup(id);
 }
@@ -725,7 +733,7 @@ get_mount(dev_t id, struct fs_mount** _mount)
 	struct fs_mount* mount;
 
 	ReadLocker nodeLocker(sVnodeLock);
-	ReadLocker mountLocker(sMountLock);
+	BigReadLocker mountLocker(sMountLock);
 
 	mount = find_mount(id);
 	if (mount == NULL)
@@ -949,10 +957,10 @@ create_new_vnode_and_lock(dev_t mountID, ino_t vnodeID, struct vnode*& _vnode,
 	}
 
 	// get the mount structure
-	rw_lock_read_lock(&sMountLock);
+	brw_lock_read_lock(&sMountLock);
 	vnode->mount = find_mount(mountID);
 	if (!vnode->mount || vnode->mount->unmounting) {
-		rw_lock_read_unlock(&sMountLock);
+		brw_lock_read_unlock(&sMountLock);
 		rw_lock_write_unlock(&sVnodeLock);
 		object_cache_free(sVnodeCache, vnode, 0);
 		return B_ENTRY_NOT_FOUND;
@@ -962,7 +970,7 @@ create_new_vnode_and_lock(dev_t mountID, ino_t vnodeID, struct vnode*& _vnode,
 	sVnodeTable->Insert(vnode);
 	add_vnode_to_mount_list(vnode, vnode->mount);
 
-	rw_lock_read_unlock(&sMountLock);
+	brw_lock_read_unlock(&sMountLock);
 
 	_vnode = vnode;
 	_nodeCreated = true;
@@ -4098,7 +4106,7 @@ entry_cache_add(dev_t mountID, ino_t dirID, const char* name, ino_t nodeID)
 {
 	// lookup mount -- the caller is required to make sure that the mount
 	// won't go away
-	ReadLocker locker(sMountLock);
+	BigReadLocker locker(sMountLock);
 	struct fs_mount* mount = find_mount(mountID);
 	if (mount == NULL)
 		return B_BAD_VALUE;
@@ -4113,7 +4121,7 @@ entry_cache_add_missing(dev_t mountID, ino_t dirID, const char* name)
 {
 	// lookup mount -- the caller is required to make sure that the mount
 	// won't go away
-	ReadLocker locker(sMountLock);
+	BigReadLocker locker(sMountLock);
 	struct fs_mount* mount = find_mount(mountID);
 	if (mount == NULL)
 		return B_BAD_VALUE;
@@ -4128,7 +4136,7 @@ entry_cache_remove(dev_t mountID, ino_t dirID, const char* name)
 {
 	// lookup mount -- the caller is required to make sure that the mount
 	// won't go away
-	ReadLocker locker(sMountLock);
+	BigReadLocker locker(sMountLock);
 	struct fs_mount* mount = find_mount(mountID);
 	if (mount == NULL)
 		return B_BAD_VALUE;
@@ -5144,7 +5152,7 @@ vfs_get_mount_point(dev_t mountID, dev_t* _mountPointMountID,
 	ino_t* _mountPointNodeID)
 {
 	ReadLocker nodeLocker(sVnodeLock);
-	ReadLocker mountLocker(sMountLock);
+	BigReadLocker mountLocker(sMountLock);
 
 	struct fs_mount* mount = find_mount(mountID);
 	if (mount == NULL)
@@ -6132,6 +6140,96 @@ dir_read(struct io_context* ioContext, struct vnode* vnode, void* cookie,
 }
 
 
+/*!	Reads the stat data of the node a directory entry refers to.
+	If that fails, the stat is cleared except for \c st_dev and \c st_ino,
+	so that the caller can tell the entry apart by its zero \c st_mode.
+*/
+static void
+stat_dir_entry(const struct dirent* entry, struct stat* stat)
+{
+	memset(stat, 0, sizeof(struct stat));
+
+	struct vnode* vnode;
+	if (get_vnode(entry->d_dev, entry->d_ino, &vnode, true, false) == B_OK) {
+		status_t status = vfs_stat_vnode(vnode, stat);
+		put_vnode(vnode);
+		if (status == B_OK)
+			return;
+
+		memset(stat, 0, sizeof(struct stat));
+	}
+
+	stat->st_dev = entry->d_dev;
+	stat->st_ino = entry->d_ino;
+}
+
+
+/*!	Like dir_read(), but also fills in the stat data of every entry read
+	into \a stats, which must have room for \a _count entries.
+	If the file system implements the read_dir_stat() hook, it provides the
+	stat data along with the entries, otherwise every entry's node is looked
+	up and stat'ed.
+	The file system may fill in the stat data from its on-disk structures
+	without loading the nodes. Nodes that are in memory are always stat'ed
+	through their vnode, though, as only they are guaranteed to be current.
+	The file system leaves \c st_mode at \c 0 for entries it could not
+	stat.
+*/
+static status_t
+dir_read_stat(struct io_context* ioContext, struct vnode* vnode, void* cookie,
+	struct dirent* buffer, size_t bufferSize, struct stat* stats,
+	uint32* _count)
+{
+	if (!HAS_FS_CALL(vnode, read_dir))
+		return B_UNSUPPORTED;
+
+	bool fileSystemStats = HAS_FS_CALL(vnode, read_dir_stat);
+	if (fileSystemStats)
+		memset(stats, 0, sizeof(struct stat) * *_count);
+
+	status_t error = fileSystemStats
+		? FS_CALL(vnode, read_dir_stat, cookie, buffer, bufferSize, stats,
+			_count)
+		: FS_CALL(vnode, read_dir, cookie, buffer, bufferSize, _count);
+	if (error != B_OK)
+		return error;
+
+	uint32 count = *_count;
+	for (uint32 i = 0; i < count; i++) {
+		dev_t device = buffer->d_dev;
+		ino_t id = buffer->d_ino;
+
+		error = fix_dirent(vnode, buffer, ioContext);
+		if (error != B_OK)
+			return error;
+
+		bool useFileSystemStat = fileSystemStats && buffer->d_dev == device
+			&& buffer->d_ino == id && stats[i].st_mode != 0;
+		if (useFileSystemStat) {
+			ReadLocker _(&sVnodeLock);
+			useFileSystemStat = lookup_vnode(device, id) == NULL;
+		}
+
+		if (useFileSystemStat) {
+			// the file system's stat is still valid, just complete it like
+			// vfs_stat_vnode() would do
+			stats[i].st_dev = device;
+			stats[i].st_ino = id;
+			if (!S_ISBLK(stats[i].st_mode) && !S_ISCHR(stats[i].st_mode))
+				stats[i].st_rdev = -1;
+		} else {
+			// the entry refers to a covering or covered node, the node is in
+			// use, or the file system could not provide its stat
+			stat_dir_entry(buffer, &stats[i]);
+		}
+
+		buffer = (struct dirent*)((uint8*)buffer + buffer->d_reclen);
+	}
+
+	return B_OK;
+}
+
+
 static status_t
 dir_rewind(struct file_descriptor* descriptor)
 {
@@ -6490,6 +6588,165 @@ common_preallocate(int fd, off_t offset, off_t length, bool kernel)
 }
 
 
+/*!	Copies up to \a length bytes from the regular file \a source at
+	\a sourcePos to \a target at \a targetPos, without the data ever passing
+	through userland.
+	If the target is a file on the same volume as the source, the file system
+	is given the chance to copy the data by itself. Otherwise, or if it does
+	not support that, the data is moved through a kernel buffer, from the
+	source's file cache to the target's file cache or socket buffer. This
+	includes copies between files: the file cache has no interface to hand
+	pages from one cache to another, so they still take one memcpy() each
+	way, but no longer cross into userland.
+	A \a targetPos of -1 means the target has no position (socket, pipe).
+	The positions are advanced by the number of bytes copied.
+	\return The number of bytes copied, or an error code if nothing could be
+		copied.
+*/
+static ssize_t
+copy_file_data(struct file_descriptor* source, off_t& sourcePos,
+	struct file_descriptor* target, off_t& targetPos, size_t length)
+{
+	struct vnode* sourceVnode = source->u.vnode;
+	struct vnode* targetVnode = fd_vnode(target);
+
+	if (length == 0)
+		return 0;
+
+	if (fd_is_file(target) && targetVnode->mount == sourceVnode->mount
+		&& S_ISREG(targetVnode->Type())
+		&& HAS_FS_CALL(sourceVnode, copy_file_range)) {
+		size_t bytesCopied = length;
+		status_t status = FS_CALL(sourceVnode, copy_file_range,
+			source->cookie, sourcePos, targetVnode,
+			target->cookie, targetPos, &bytesCopied);
+		if (status == B_OK) {
+			sourcePos += bytesCopied;
+			targetPos += bytesCopied;
+			return bytesCopied;
+		}
+		if (status != B_UNSUPPORTED)
+			return status;
+	}
+
+	size_t bufferSize = min_c(length, kCopyFileBufferSize);
+	uint8* buffer = (uint8*)malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	// The buffer is a kernel one, so the descriptors must not treat it as
+	// coming from the syscall's caller (pipes would refuse it otherwise).
+	SyscallFlagUnsetter _;
+
+	size_t bytesCopied = 0;
+	status_t status = B_OK;
+
+	while (bytesCopied < length) {
+		size_t bytesRead = min_c(length - bytesCopied, bufferSize);
+		status = source->ops->fd_read(source, sourcePos, buffer, &bytesRead);
+		if (status != B_OK || bytesRead == 0)
+			break;
+
+		size_t bytesWritten = 0;
+		while (bytesWritten < bytesRead) {
+			size_t toWrite = bytesRead - bytesWritten;
+			status = target->ops->fd_write(target, targetPos,
+				buffer + bytesWritten, &toWrite);
+			if (status != B_OK || toWrite == 0)
+				break;
+
+			bytesWritten += toWrite;
+			if (targetPos != -1)
+				targetPos += toWrite;
+		}
+
+		sourcePos += bytesWritten;
+		bytesCopied += bytesWritten;
+
+		if (bytesWritten < bytesRead)
+			break;
+	}
+
+	if (bytesCopied == 0)
+		return status;
+
+	return bytesCopied;
+}
+
+
+static ssize_t
+common_copy_file_range(int sourceFD, off_t* _sourcePos, int targetFD,
+	off_t* _targetPos, size_t length, bool fileTarget, bool kernel)
+{
+	struct io_context* context = get_current_io_context(kernel);
+
+	FileDescriptorPutter source(get_fd(context, sourceFD));
+	FileDescriptorPutter target(get_fd(context, targetFD));
+	if (!source.IsSet() || !target.IsSet())
+		return B_FILE_ERROR;
+
+	if ((source->open_mode & O_RWMASK) == O_WRONLY
+		|| (target->open_mode & O_RWMASK) == O_RDONLY) {
+		return B_FILE_ERROR;
+	}
+
+	// the source must always be a regular file, the target only needs to be
+	// one for copy_file_range()
+	if (!fd_is_file(source.Get()) || !S_ISREG(source->u.vnode->Type()))
+		return B_BAD_VALUE;
+
+	struct vnode* targetVnode = fd_vnode(target.Get());
+	bool regularTarget = fd_is_file(target.Get())
+		&& S_ISREG(targetVnode->Type());
+	if (fileTarget && !regularTarget)
+		return B_BAD_VALUE;
+
+	// A file opened for appending is written at its end, not at the position
+	// the overlap check and the position update below work with.
+	if (regularTarget && (target->open_mode & O_APPEND) != 0)
+		return B_FILE_ERROR;
+
+	if (target->ops->fd_write == NULL)
+		return B_BAD_VALUE;
+
+	off_t sourcePos = _sourcePos != NULL ? *_sourcePos : source->pos;
+	off_t targetPos = _targetPos != NULL ? *_targetPos : target->pos;
+	if (sourcePos < 0 || (_targetPos != NULL && targetPos < 0))
+		return B_BAD_VALUE;
+
+	if (length > SSIZE_MAX)
+		length = SSIZE_MAX;
+	if (length > (uint64)(OFF_MAX - sourcePos))
+		length = OFF_MAX - sourcePos;
+	if (targetPos >= 0 && length > (uint64)(OFF_MAX - targetPos))
+		length = OFF_MAX - targetPos;
+
+	// overlapping ranges within the same file are not supported
+	if (targetVnode == source->u.vnode && sourcePos < targetPos + (off_t)length
+		&& targetPos < sourcePos + (off_t)length) {
+		return B_BAD_VALUE;
+	}
+
+	ssize_t bytesCopied = copy_file_data(source.Get(), sourcePos, target.Get(),
+		targetPos, length);
+	if (bytesCopied < 0)
+		return bytesCopied;
+
+	if (_sourcePos != NULL)
+		*_sourcePos = sourcePos;
+	else
+		source->pos = sourcePos;
+
+	if (_targetPos != NULL)
+		*_targetPos = targetPos;
+	else if (target->pos != -1)
+		target->pos = targetPos;
+
+	return bytesCopied;
+}
+
+
 static status_t
 common_read_link(int fd, char* path, char* buffer, size_t* _bufferSize,
 	bool kernel)
@@ -6735,6 +6992,33 @@ common_path_write_stat(int fd, char* path, bool traverseLeafLink,
 }
 
 
+static ssize_t
+common_read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+	struct stat* stats, uint32 maxCount, bool kernel)
+{
+	FUNCTION(("common_read_dir_stat: fd: %d, buffer %p, bufferSize %" B_PRIuSIZE
+		", stats %p, maxCount %" B_PRIu32 "\n", fd, buffer, bufferSize, stats,
+		maxCount));
+
+	struct io_context* ioContext = get_current_io_context(kernel);
+	FileDescriptorPutter descriptor(get_fd(ioContext, fd));
+	if (!descriptor.IsSet())
+		return B_FILE_ERROR;
+
+	// only real directories have entries that refer to nodes
+	if (descriptor->ops != &sDirectoryOps)
+		return B_NOT_A_DIRECTORY;
+
+	uint32 count = maxCount;
+	status_t status = dir_read_stat(ioContext, descriptor->u.vnode,
+		descriptor->cookie, buffer, bufferSize, stats, &count);
+	if (status != B_OK)
+		return status;
+
+	return count;
+}
+
+
 static int
 attr_dir_open(int fd, char* path, bool traverseLeafLink, bool kernel)
 {
@@ -7578,9 +7862,9 @@ fs_mount(char* path, const char* device, const char* fsName, uint32 flags,
 
 	// insert mount struct into list before we call FS's mount() function
 	// so that vnodes can be created for this mount
-	rw_lock_write_lock(&sMountLock);
+	brw_lock_write_lock(&sMountLock);
 	sMountsTable->Insert(mount);
-	rw_lock_write_unlock(&sMountLock);
+	brw_lock_write_unlock(&sMountLock);
 
 	ino_t rootID;
 
@@ -7701,9 +7985,9 @@ err3:
 	if (coveredNode != NULL)
 		put_vnode(coveredNode);
 err2:
-	rw_lock_write_lock(&sMountLock);
+	brw_lock_write_lock(&sMountLock);
 	sMountsTable->Remove(mount);
-	rw_lock_write_unlock(&sMountLock);
+	brw_lock_write_unlock(&sMountLock);
 err1:
 	delete mount;
 
@@ -7728,7 +8012,7 @@ fs_unmount(char* path, dev_t mountID, uint32 flags, bool kernel)
 	}
 
 	RecursiveLocker mountOpLocker(sMountOpLock);
-	ReadLocker mountLocker(sMountLock);
+	BigReadLocker mountLocker(sMountLock);
 
 	mount = find_mount(path != NULL ? pathVnode->device : mountID);
 	if (mount == NULL) {
@@ -7910,9 +8194,9 @@ fs_unmount(char* path, dev_t mountID, uint32 flags, bool kernel)
 	}
 
 	// remove the mount structure from the hash table
-	rw_lock_write_lock(&sMountLock);
+	brw_lock_write_lock(&sMountLock);
 	sMountsTable->Remove(mount);
-	rw_lock_write_unlock(&sMountLock);
+	brw_lock_write_unlock(&sMountLock);
 
 	mountOpLocker.Unlock();
 
@@ -8078,7 +8362,7 @@ fs_next_device(int32* _cookie)
 	struct fs_mount* mount = NULL;
 	dev_t device = *_cookie;
 
-	rw_lock_read_lock(&sMountLock);
+	brw_lock_read_lock(&sMountLock);
 
 	// Since device IDs are assigned sequentially, this algorithm
 	// does work good enough. It makes sure that the device list
@@ -8098,7 +8382,7 @@ fs_next_device(int32* _cookie)
 	else
 		device = B_BAD_VALUE;
 
-	rw_lock_read_unlock(&sMountLock);
+	brw_lock_read_unlock(&sMountLock);
 
 	return device;
 }
@@ -8441,6 +8725,44 @@ _kern_preallocate(int fd, off_t offset, off_t length)
 }
 
 
+/*!	Copies up to \a length bytes between the regular files \a sourceFD and
+	\a targetFD. If \a sourcePos or \a targetPos are \c NULL, the file
+	position of the respective descriptor is used and advanced, otherwise the
+	given position is used and updated instead.
+	\a flags is reserved and must be 0.
+	\return The number of bytes copied, 0 at the end of the source file, or an
+		error code.
+*/
+ssize_t
+_kern_copy_file_range(int sourceFD, off_t* sourcePos, int targetFD,
+	off_t* targetPos, size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	SyscallFlagUnsetter _;
+	return common_copy_file_range(sourceFD, sourcePos, targetFD, targetPos,
+		length, true, true);
+}
+
+
+/*!	Writes up to \a length bytes of the regular file \a sourceFD to
+	\a targetFD, which can be any writable descriptor, like a socket, except
+	for a regular file opened with \c O_APPEND.
+	If \a sourcePos is \c NULL, the source's file position is used and
+	advanced, otherwise the given position is used and updated instead.
+	\return The number of bytes written, 0 at the end of the source file, or
+		an error code.
+*/
+ssize_t
+_kern_sendfile(int targetFD, int sourceFD, off_t* sourcePos, size_t length)
+{
+	SyscallFlagUnsetter _;
+	return common_copy_file_range(sourceFD, sourcePos, targetFD, NULL, length,
+		false, true);
+}
+
+
 status_t
 _kern_create_dir_entry_ref(dev_t device, ino_t inode, const char* name,
 	int perms)
@@ -8667,6 +8989,55 @@ _kern_read_stat(int fd, const char* path, bool traverseLeafLink,
 }
 
 
+/*!	\brief Reads directory entries together with the stat data of the nodes
+		they refer to.
+
+	Works like _kern_read_dir(), but additionally fills in one stat structure
+	per entry read. Entries whose node could not be stat'ed get a stat with
+	only \c st_dev and \c st_ino set, and a \c st_mode of \c 0.
+
+	\param fd The FD of a directory opened via _kern_open_dir() or similar.
+	\param buffer The buffer the directory entries shall be written into.
+	\param bufferSize The size of \a buffer.
+	\param stats An array of at least \a maxCount stat structures of
+		   \a statSize bytes each.
+	\param statSize The size of a single stat structure in \a stats.
+	\param maxCount The maximal number of entries to be read.
+	\return The number of entries read, or an error code.
+*/
+ssize_t
+_kern_read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+	struct stat* stats, size_t statSize, uint32 maxCount)
+{
+	if (statSize > sizeof(struct stat))
+		return B_BAD_VALUE;
+
+	if (maxCount == 0)
+		return 0;
+
+	if (statSize == sizeof(struct stat)) {
+		return common_read_dir_stat(fd, buffer, bufferSize, stats, maxCount,
+			true);
+	}
+
+	// this supports different stat extensions
+	maxCount = min_c(maxCount, kMaxReadDirStatCount);
+	struct stat* completeStats
+		= (struct stat*)malloc(sizeof(struct stat) * maxCount);
+	if (completeStats == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter statsDeleter(completeStats);
+
+	ssize_t count = common_read_dir_stat(fd, buffer, bufferSize, completeStats,
+		maxCount, true);
+
+	for (ssize_t i = 0; i < count; i++)
+		memcpy((uint8*)stats + i * statSize, &completeStats[i], statSize);
+
+	return count;
+}
+
+
 /*!	\brief Writes stat data of an entity specified by a FD + path pair.
 
 	If only \a fd is given, the stat operation associated with the type
@@ -9326,6 +9697,68 @@ _user_preallocate(int fd, off_t offset, off_t length)
 }
 
 
+ssize_t
+_user_copy_file_range(int sourceFD, off_t* userSourcePos, int targetFD,
+	off_t* userTargetPos, size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	off_t sourcePos;
+	off_t targetPos;
+	if (userSourcePos != NULL && (!IS_USER_ADDRESS(userSourcePos)
+			|| user_memcpy(&sourcePos, userSourcePos, sizeof(off_t)) != B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+	if (userTargetPos != NULL && (!IS_USER_ADDRESS(userTargetPos)
+			|| user_memcpy(&targetPos, userTargetPos, sizeof(off_t)) != B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_copy_file_range(sourceFD,
+		userSourcePos != NULL ? &sourcePos : NULL, targetFD,
+		userTargetPos != NULL ? &targetPos : NULL, length, true, false);
+	if (result <= 0)
+		return result;
+
+	if ((userSourcePos != NULL
+			&& user_memcpy(userSourcePos, &sourcePos, sizeof(off_t)) != B_OK)
+		|| (userTargetPos != NULL
+			&& user_memcpy(userTargetPos, &targetPos, sizeof(off_t)) != B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
+ssize_t
+_user_sendfile(int targetFD, int sourceFD, off_t* userSourcePos,
+	size_t length)
+{
+	off_t sourcePos;
+	if (userSourcePos != NULL && (!IS_USER_ADDRESS(userSourcePos)
+			|| user_memcpy(&sourcePos, userSourcePos, sizeof(off_t)) != B_OK)) {
+		return B_BAD_ADDRESS;
+	}
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_copy_file_range(sourceFD,
+		userSourcePos != NULL ? &sourcePos : NULL, targetFD, NULL, length,
+		false, false);
+	if (result <= 0)
+		return result;
+
+	if (userSourcePos != NULL
+		&& user_memcpy(userSourcePos, &sourcePos, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return result;
+}
+
+
 status_t
 _user_create_dir_entry_ref(dev_t device, ino_t inode, const char* userName,
 	int perms)
@@ -9700,6 +10133,70 @@ _user_read_stat(int fd, const char* userPath, bool traverseLink,
 }
 
 
+ssize_t
+_user_read_dir_stat(int fd, struct dirent* userBuffer, size_t bufferSize,
+	struct stat* userStats, size_t statSize, uint32 maxCount)
+{
+	if (statSize > sizeof(struct stat))
+		return B_BAD_VALUE;
+
+	if (maxCount == 0)
+		return 0;
+
+	if (userBuffer == NULL || !IS_USER_ADDRESS(userBuffer)
+		|| userStats == NULL || !IS_USER_ADDRESS(userStats)) {
+		return B_BAD_ADDRESS;
+	}
+
+	// restrict buffer size and count, and allocate heap buffers
+	if (bufferSize > kMaxReadDirStatBufferSize)
+		bufferSize = kMaxReadDirStatBufferSize;
+	maxCount = min_c(maxCount, kMaxReadDirStatCount);
+
+	struct dirent* buffer = (struct dirent*)malloc(bufferSize);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	struct stat* stats = (struct stat*)malloc(sizeof(struct stat) * maxCount);
+	if (stats == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter statsDeleter(stats);
+
+	ssize_t count = common_read_dir_stat(fd, buffer, bufferSize, stats,
+		maxCount, false);
+	if (count <= 0)
+		return count;
+
+	// copy the entries back -- determine their total size first
+	size_t sizeToCopy = 0;
+	struct dirent* entry = buffer;
+	for (ssize_t i = 0; i < count; i++) {
+		sizeToCopy += entry->d_reclen;
+		entry = (struct dirent*)((uint8*)entry + entry->d_reclen);
+	}
+
+	ASSERT(sizeToCopy <= bufferSize);
+
+	if (user_memcpy(userBuffer, buffer, sizeToCopy) != B_OK)
+		return B_BAD_ADDRESS;
+
+	if (statSize == sizeof(struct stat)) {
+		if (user_memcpy(userStats, stats, sizeof(struct stat) * count) != B_OK)
+			return B_BAD_ADDRESS;
+	} else {
+		for (ssize_t i = 0; i < count; i++) {
+			if (user_memcpy((uint8*)userStats + i * statSize, &stats[i],
+					statSize) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+		}
+	}
+
+	return count;
+}
+
+
 status_t
 _user_write_stat(int fd, const char* userPath, bool traverseLeafLink,
 	const struct stat* userStat, size_t statSize, int statMask)
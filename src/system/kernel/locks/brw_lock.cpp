@@ -0,0 +1,203 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Big reader lock.
+
+	A reader increments the counter of its current CPU and then checks
+	whether a writer is around. A writer first acquires the embedded rw_lock
+	for writing, then announces itself via "writer_count", and finally waits
+	until the sum of the reader counters has dropped to zero. Since both sides
+	write their own variable before reading the other one (with full
+	barriers), either the reader sees the writer and backs out, or the writer
+	sees the reader and waits for it.
+	Readers that back out wait for the writer by read locking the rw_lock.
+*/
+
+
+#include <brw_lock.h>
+
+#include <interrupts.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+
+struct brw_lock_waiter {
+	Thread*			thread;
+};
+
+
+static inline int32*
+current_reader_count(brw_lock* lock)
+{
+	// We might be migrated to another CPU right after looking up the
+	// counter. That's fine, since the counters are only modified atomically
+	// and only their sum matters.
+	return &lock->readers[smp_get_current_cpu()].count;
+}
+
+
+static int32
+count_readers(brw_lock* lock)
+{
+	int32 count = 0;
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++)
+		count += atomic_get(&lock->readers[i].count);
+
+	return count;
+}
+
+
+/*!	Wakes up the writer waiting for the readers to leave, if any.
+*/
+static void
+wake_up_writer(brw_lock* lock)
+{
+	InterruptsSpinLocker locker(lock->waiter_lock);
+
+	if (lock->waiter != NULL) {
+		thread_unblock(lock->waiter->thread, B_OK);
+		lock->waiter = NULL;
+	}
+}
+
+
+/*!	Waits until no reader is left. The caller must have announced itself as
+	writer already.
+*/
+static void
+wait_for_readers(brw_lock* lock)
+{
+	brw_lock_waiter waiter;
+	waiter.thread = thread_get_current_thread();
+
+	while (true) {
+		InterruptsSpinLocker locker(lock->waiter_lock);
+
+		if (count_readers(lock) == 0) {
+			lock->waiter = NULL;
+			return;
+		}
+
+		lock->waiter = &waiter;
+		thread_prepare_to_block(waiter.thread, 0, THREAD_BLOCK_TYPE_RW_LOCK,
+			&lock->lock);
+
+		locker.Unlock();
+
+		thread_block();
+	}
+}
+
+
+// #pragma mark - private API
+
+
+#if KDEBUG
+
+bool
+_brw_lock_is_read_locked(brw_lock* lock)
+{
+	return count_readers(lock) > 0
+		|| lock->lock.holder == thread_get_current_thread_id();
+}
+
+#endif
+
+
+// #pragma mark - public API
+
+
+void
+brw_lock_init(brw_lock* lock, const char* name)
+{
+	brw_lock_init_etc(lock, name, 0);
+}
+
+
+void
+brw_lock_init_etc(brw_lock* lock, const char* name, uint32 flags)
+{
+	rw_lock_init_etc(&lock->lock, name, flags & BRW_LOCK_FLAG_CLONE_NAME);
+	lock->waiter = NULL;
+	B_INITIALIZE_SPINLOCK(&lock->waiter_lock);
+	lock->writer_count = 0;
+
+	for (int32 i = 0; i < SMP_MAX_CPUS; i++)
+		lock->readers[i].count = 0;
+}
+
+
+void
+brw_lock_destroy(brw_lock* lock)
+{
+#if KDEBUG
+	if (count_readers(lock) != 0)
+		panic("brw_lock_destroy(): lock %p is still read locked", lock);
+#endif
+
+	rw_lock_destroy(&lock->lock);
+}
+
+
+status_t
+brw_lock_read_lock(brw_lock* lock)
+{
+	int32* count = current_reader_count(lock);
+	atomic_add(count, 1);
+
+	if (atomic_get(&lock->writer_count) == 0)
+		return B_OK;
+
+	// A writer is active or waiting for the readers to leave. Back out, and
+	// wait for it to finish.
+	atomic_add(count, -1);
+	wake_up_writer(lock);
+
+	status_t status = rw_lock_read_lock(&lock->lock);
+	if (status != B_OK)
+		return status;
+
+	// While we hold the rw_lock, no writer can get in; once we count as
+	// reader, any new writer will wait for us.
+	atomic_add(current_reader_count(lock), 1);
+	rw_lock_read_unlock(&lock->lock);
+
+	return B_OK;
+}
+
+
+void
+brw_lock_read_unlock(brw_lock* lock)
+{
+	atomic_add(current_reader_count(lock), -1);
+
+	if (atomic_get(&lock->writer_count) != 0)
+		wake_up_writer(lock);
+}
+
+
+status_t
+brw_lock_write_lock(brw_lock* lock)
+{
+	status_t status = rw_lock_write_lock(&lock->lock);
+	if (status != B_OK)
+		return status;
+
+	if (atomic_add(&lock->writer_count, 1) == 0)
+		wait_for_readers(lock);
+	// else this is a nested write lock
+
+	return B_OK;
+}
+
+
+void
+brw_lock_write_unlock(brw_lock* lock)
+{
+	atomic_add(&lock->writer_count, -1);
+	rw_lock_write_unlock(&lock->lock);
+}
@@ -27,11 +27,14 @@ static void _mutex_unlock(struct mutex* lock);
 #include <stdlib.h>
 #include <string.h>
 
+#include <cpu.h>
 #include <interrupts.h>
 #include <kernel.h>
 #include <listeners.h>
 #include <scheduling_analysis.h>
+#include <smp.h>
 #include <thread.h>
+#include <util/atomic.h>
 #include <util/AutoLock.h>
 
 
@@ -50,6 +53,72 @@ struct rw_lock_waiter {
 
 #define MUTEX_FLAG_RELEASED		0x2
 
+#if KERNEL_MUTEX_SPINNING
+static bool sMutexSpinningEnabled = true;
+static bigtime_t sMutexSpinLimit = 20;
+	// maximum time (in microseconds) a waiter spins on a contended mutex
+
+struct CACHE_LINE_ALIGN mutex_spin_statistics {
+	int64	attempts;
+	int64	acquired;
+	int64	blocks;
+};
+
+static mutex_spin_statistics sMutexSpinStatistics[SMP_MAX_CPUS];
+	// kept per CPU, so that counting doesn't bounce a shared cache line
+
+
+static inline mutex_spin_statistics&
+mutex_spin_statistics_for_cpu()
+{
+	return sMutexSpinStatistics[smp_get_current_cpu()];
+}
+#endif
+
+#if KERNEL_LOCK_STATISTICS
+#	define LOCK_STATISTICS_WAIT_START(variable) \
+		bigtime_t variable = gLockStatisticsEnabled ? system_time() : 0
+
+static inline void
+rw_lock_statistics_acquired(rw_lock* lock, bool writer, bool contended,
+	bigtime_t waitStart)
+{
+	if (!gLockStatisticsEnabled)
+		return;
+
+	bigtime_t now = system_time();
+	if (writer)
+		lock->acquire_time = now;
+	lock_statistics_acquired((addr_t)lock->name, LOCK_STATISTICS_TYPE_RW_LOCK,
+		lock->name, contended, waitStart != 0 ? now - waitStart : 0);
+}
+
+
+static inline void
+rw_lock_statistics_write_released(rw_lock* lock)
+{
+	bigtime_t acquireTime = lock->acquire_time;
+	if (acquireTime == 0)
+		return;
+
+	lock->acquire_time = 0;
+	if (gLockStatisticsEnabled) {
+		lock_statistics_released((addr_t)lock->name,
+			LOCK_STATISTICS_TYPE_RW_LOCK, system_time() - acquireTime);
+	}
+}
+
+#	define RW_LOCK_STATISTICS_ACQUIRED(lock, writer, contended, waitStart) \
+		rw_lock_statistics_acquired(lock, writer, contended, waitStart)
+#	define RW_LOCK_STATISTICS_WRITE_RELEASED(lock) \
+		rw_lock_statistics_write_released(lock)
+#else
+#	define LOCK_STATISTICS_WAIT_START(variable)	do {} while (false)
+#	define RW_LOCK_STATISTICS_ACQUIRED(lock, writer, contended, waitStart) \
+		do {} while (false)
+#	define RW_LOCK_STATISTICS_WRITE_RELEASED(lock)	do {} while (false)
+#endif
+
 
 int32
 recursive_lock_get_recursion(recursive_lock *lock)
@@ -387,6 +456,9 @@ rw_lock_init(rw_lock* lock, const char* name)
 	lock->active_readers = 0;
 	lock->pending_readers = 0;
 	lock->flags = 0;
+#if KERNEL_LOCK_STATISTICS
+	lock->acquire_time = 0;
+#endif
 
 	T_SCHEDULING_ANALYSIS(InitRWLock(lock, name));
 	NotifyWaitObjectListeners(&WaitObjectListener::RWLockInitialized, lock);
@@ -405,6 +477,9 @@ rw_lock_init_etc(rw_lock* lock, const char* name, uint32 flags)
 	lock->active_readers = 0;
 	lock->pending_readers = 0;
 	lock->flags = flags & RW_LOCK_FLAG_CLONE_NAME;
+#if KERNEL_LOCK_STATISTICS
+	lock->acquire_time = 0;
+#endif
 
 	T_SCHEDULING_ANALYSIS(InitRWLock(lock, name));
 	NotifyWaitObjectListeners(&WaitObjectListener::RWLockInitialized, lock);
@@ -514,9 +589,11 @@ _rw_lock_read_lock(rw_lock* lock)
 	if (oldCount < RW_LOCK_WRITER_COUNT_BASE) {
 		ASSERT_UNLOCKED_RW_LOCK(lock);
 		_rw_lock_set_read_locked(lock);
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, false, 0);
 		return B_OK;
 	}
 #endif
+	LOCK_STATISTICS_WAIT_START(waitStart);
 
 	InterruptsSpinLocker locker(lock->lock);
 
@@ -543,6 +620,7 @@ _rw_lock_read_lock(rw_lock* lock)
 #if KDEBUG_RW_LOCK_DEBUG
 		_rw_lock_set_read_locked(lock);
 #endif
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, false, 0);
 		return B_OK;
 	}
 
@@ -550,6 +628,8 @@ _rw_lock_read_lock(rw_lock* lock)
 
 	// we need to wait
 	status_t status = rw_lock_wait(lock, false, locker);
+	if (status == B_OK)
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, true, waitStart);
 
 #if KDEBUG_RW_LOCK_DEBUG
 	if (status == B_OK)
@@ -575,9 +655,11 @@ _rw_lock_read_lock_with_timeout(rw_lock* lock, uint32 timeoutFlags,
 	if (oldCount < RW_LOCK_WRITER_COUNT_BASE) {
 		ASSERT_UNLOCKED_RW_LOCK(lock);
 		_rw_lock_set_read_locked(lock);
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, false, 0);
 		return B_OK;
 	}
 #endif
+	LOCK_STATISTICS_WAIT_START(waitStart);
 
 	InterruptsSpinLocker locker(lock->lock);
 
@@ -602,6 +684,7 @@ _rw_lock_read_lock_with_timeout(rw_lock* lock, uint32 timeoutFlags,
 #if KDEBUG_RW_LOCK_DEBUG
 		_rw_lock_set_read_locked(lock);
 #endif
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, false, 0);
 		return B_OK;
 	}
 
@@ -633,6 +716,7 @@ _rw_lock_read_lock_with_timeout(rw_lock* lock, uint32 timeoutFlags,
 #if KDEBUG_RW_LOCK_DEBUG
 		_rw_lock_set_read_locked(lock);
 #endif
+		RW_LOCK_STATISTICS_ACQUIRED(lock, false, true, waitStart);
 		return B_OK;
 	}
 
@@ -735,9 +819,12 @@ rw_lock_write_lock(rw_lock* lock)
 		// No-one else held a read or write lock, so it's ours now.
 		lock->holder = thread;
 		lock->owner_count = RW_LOCK_WRITER_COUNT_BASE;
+		RW_LOCK_STATISTICS_ACQUIRED(lock, true, false, 0);
 		return B_OK;
 	}
 
+	LOCK_STATISTICS_WAIT_START(waitStart);
+
 	// We have to wait. If we're the first writer, note the current reader
 	// count.
 	if (oldCount < RW_LOCK_WRITER_COUNT_BASE)
@@ -747,6 +834,7 @@ rw_lock_write_lock(rw_lock* lock)
 	if (status == B_OK) {
 		lock->holder = thread;
 		lock->owner_count = RW_LOCK_WRITER_COUNT_BASE;
+		RW_LOCK_STATISTICS_ACQUIRED(lock, true, true, waitStart);
 	}
 
 	return status;
@@ -770,6 +858,8 @@ _rw_lock_write_unlock(rw_lock* lock)
 	if (lock->owner_count >= RW_LOCK_WRITER_COUNT_BASE)
 		return;
 
+	RW_LOCK_STATISTICS_WRITE_RELEASED(lock);
+
 	// We gave up our last write lock -- clean up and unblock waiters.
 	int32 readerCount = lock->owner_count;
 	lock->holder = -1;
@@ -860,8 +950,14 @@ mutex_init_etc(mutex* lock, const char *name, uint32 flags)
 	lock->holder = -1;
 #else
 	lock->count = 0;
+#	if KERNEL_MUTEX_SPINNING
+	lock->holder = -1;
+#	endif
 #endif
 	lock->flags = flags & MUTEX_FLAG_CLONE_NAME;
+#if KERNEL_LOCK_STATISTICS
+	lock->acquire_time = 0;
+#endif
 
 	T_SCHEDULING_ANALYSIS(InitMutex(lock, name));
 	NotifyWaitObjectListeners(&WaitObjectListener::MutexInitialized, lock);
@@ -919,6 +1015,10 @@ mutex_lock_threads_locked(mutex* lock, InterruptsSpinLocker* locker)
 #else
 	if (atomic_add(&lock->count, -1) < 0)
 		return _mutex_lock(lock, locker);
+#	if KERNEL_MUTEX_SPINNING
+	lock->holder = thread_get_current_thread_id();
+#	endif
+	MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 	return B_OK;
 #endif
 }
@@ -949,6 +1049,8 @@ mutex_transfer_lock(mutex* lock, thread_id thread)
 	if (thread_get_current_thread_id() != lock->holder)
 		panic("mutex_transfer_lock(): current thread is not the lock holder!");
 	lock->holder = thread;
+#elif KERNEL_MUTEX_SPINNING
+	lock->holder = thread;
 #endif
 }
 
@@ -971,6 +1073,114 @@ mutex_switch_from_read_lock(rw_lock* from, mutex* to)
 }
 
 
+#if KERNEL_MUTEX_SPINNING
+
+
+/*!	Returns whether the thread with the given ID is currently running on
+	another CPU. \a cpuHint is the CPU to look at first, it is updated to
+	the CPU the thread was found on.
+*/
+static bool
+mutex_holder_is_running(thread_id holder, int32& cpuHint)
+{
+	int32 cpuCount = smp_get_num_cpus();
+
+	// Thread structures come from an object cache, so a running_thread
+	// pointer that goes stale while we look at it still points to a Thread.
+	// With interrupts disabled that window is only a few instructions wide.
+	cpu_status state = disable_interrupts();
+	int32 currentCPU = smp_get_current_cpu();
+
+	bool running = false;
+	for (int32 i = 0; i < cpuCount; i++) {
+		int32 cpu = (cpuHint + i) % cpuCount;
+		if (cpu == currentCPU)
+			continue;
+
+		Thread* thread = atomic_pointer_get(&gCPU[cpu].running_thread);
+		if (thread != NULL && thread->id == holder) {
+			cpuHint = cpu;
+			running = true;
+			break;
+		}
+	}
+
+	restore_interrupts(state);
+	return running;
+}
+
+
+/*!	Optimistically spins on a contended mutex while its holder is running on
+	another CPU, in the hope that it will be released before the spin limit
+	is reached. The caller must already have accounted for itself as a waiter
+	(i.e. decremented the count in non-KDEBUG builds) and must not hold the
+	mutex' spinlock.
+	Only a mutex that is actually held by another thread is spun on; if it
+	has no holder, the caller acquires it the regular way.
+	Returns \c true, if the calling thread now holds the mutex.
+*/
+static bool
+mutex_spin(mutex* lock)
+{
+	if (!sMutexSpinningEnabled || gKernelStartup || smp_get_num_cpus() < 2
+		|| !are_interrupts_enabled()) {
+		return false;
+	}
+
+	thread_id holder = atomic_get(&lock->holder);
+	if (holder < 0)
+		return false;
+
+	atomic_add64(&mutex_spin_statistics_for_cpu().attempts, 1);
+
+	int32 cpuHint = 0;
+	bigtime_t start = system_time();
+
+	while (true) {
+#if KDEBUG
+		bool released = holder < 0;
+#else
+		bool released
+			= (*(volatile uint8*)&lock->flags & MUTEX_FLAG_RELEASED) != 0;
+#endif
+		if (released) {
+			InterruptsSpinLocker locker(lock->lock);
+#if KDEBUG
+			if (lock->holder < 0) {
+				lock->holder = thread_get_current_thread_id();
+				atomic_add64(&mutex_spin_statistics_for_cpu().acquired, 1);
+				return true;
+			}
+#else
+			if ((lock->flags & MUTEX_FLAG_RELEASED) != 0) {
+				lock->flags &= ~MUTEX_FLAG_RELEASED;
+				lock->holder = thread_get_current_thread_id();
+				atomic_add64(&mutex_spin_statistics_for_cpu().acquired, 1);
+				return true;
+			}
+#endif
+			// someone else was faster
+		}
+
+		// Once threads are queued, the lock will be handed over to them, so
+		// there is no point in spinning any longer. Also give up when the
+		// holder has been preempted or is about to block itself.
+		if (atomic_pointer_get(&lock->waiters) != NULL)
+			return false;
+		if (holder >= 0 && !mutex_holder_is_running(holder, cpuHint))
+			return false;
+		if (system_time() - start > sMutexSpinLimit)
+			return false;
+
+		cpu_pause();
+		holder = atomic_get(&lock->holder);
+	}
+}
+
+
+#endif	// KERNEL_MUTEX_SPINNING
+
+
 KDEBUG_STATIC status_t
 _mutex_lock(mutex* lock, void* _locker)
 {
@@ -981,12 +1191,20 @@ _mutex_lock(mutex* lock, void* _locker)
 	}
 #endif
 
+	LOCK_STATISTICS_WAIT_START(waitStart);
+
 	// lock only, if !lockLocked
 	InterruptsSpinLocker* locker
 		= reinterpret_cast<InterruptsSpinLocker*>(_locker);
 
 	InterruptsSpinLocker lockLocker;
 	if (locker == NULL) {
+#if KERNEL_MUTEX_SPINNING
+		if (mutex_spin(lock)) {
+			MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
+			return B_OK;
+		}
+#endif
 		lockLocker.SetTo(lock->lock, false);
 		locker = &lockLocker;
 	}
@@ -996,6 +1214,7 @@ _mutex_lock(mutex* lock, void* _locker)
 #if KDEBUG
 	if (lock->holder < 0) {
 		lock->holder = thread_get_current_thread_id();
+		MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 		return B_OK;
 	} else if (lock->holder == thread_get_current_thread_id()) {
 		panic("_mutex_lock(): double lock of %p by thread %" B_PRId32, lock,
@@ -1006,6 +1225,10 @@ _mutex_lock(mutex* lock, void* _locker)
 #else
 	if ((lock->flags & MUTEX_FLAG_RELEASED) != 0) {
 		lock->flags &= ~MUTEX_FLAG_RELEASED;
+#	if KERNEL_MUTEX_SPINNING
+		lock->holder = thread_get_current_thread_id();
+#	endif
+		MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
 		return B_OK;
 	}
 #endif
@@ -1026,6 +1249,10 @@ _mutex_lock(mutex* lock, void* _locker)
 	thread_prepare_to_block(waiter.thread, 0, THREAD_BLOCK_TYPE_MUTEX, lock);
 	locker->Unlock();
 
+#if KERNEL_MUTEX_SPINNING
+	atomic_add64(&mutex_spin_statistics_for_cpu().blocks, 1);
+#endif
+
 	status_t error = thread_block();
 #if KDEBUG
 	if (error == B_OK) {
@@ -1035,6 +1262,8 @@ _mutex_lock(mutex* lock, void* _locker)
 		ASSERT(waiter.thread == NULL);
 	}
 #endif
+	if (error == B_OK)
+		MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
 	return error;
 }
 
@@ -1051,6 +1280,8 @@ _mutex_unlock(mutex* lock)
 			thread_get_current_thread_id(), lock, lock->holder);
 		return;
 	}
+
+	MUTEX_STATISTICS_RELEASED(lock);
 #endif
 
 	mutex_waiter* waiter = lock->waiters;
@@ -1066,6 +1297,8 @@ _mutex_unlock(mutex* lock)
 		// cause a race condition, since another locker could think the lock
 		// is not held by anyone.
 		lock->holder = waiter->thread->id;
+#elif KERNEL_MUTEX_SPINNING
+		lock->holder = waiter->thread->id;
 #endif
 
 		// unblock thread
@@ -1091,6 +1324,15 @@ _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 	}
 #endif
 
+	LOCK_STATISTICS_WAIT_START(waitStart);
+
+#if KERNEL_MUTEX_SPINNING
+	if (mutex_spin(lock)) {
+		MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
+		return B_OK;
+	}
+#endif
+
 	InterruptsSpinLocker locker(lock->lock);
 
 	// Might have been released after we decremented the count, but before
@@ -1098,6 +1340,7 @@ _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 #if KDEBUG
 	if (lock->holder < 0) {
 		lock->holder = thread_get_current_thread_id();
+		MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 		return B_OK;
 	} else if (lock->holder == thread_get_current_thread_id()) {
 		panic("_mutex_lock(): double lock of %p by thread %" B_PRId32, lock,
@@ -1108,6 +1351,10 @@ _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 #else
 	if ((lock->flags & MUTEX_FLAG_RELEASED) != 0) {
 		lock->flags &= ~MUTEX_FLAG_RELEASED;
+#	if KERNEL_MUTEX_SPINNING
+		lock->holder = thread_get_current_thread_id();
+#	endif
+		MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
 		return B_OK;
 	}
 #endif
@@ -1128,12 +1375,17 @@ _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 	thread_prepare_to_block(waiter.thread, 0, THREAD_BLOCK_TYPE_MUTEX, lock);
 	locker.Unlock();
 
+#if KERNEL_MUTEX_SPINNING
+	atomic_add64(&mutex_spin_statistics_for_cpu().blocks, 1);
+#endif
+
 	status_t error = thread_block_with_timeout(timeoutFlags, timeout);
 
 	if (error == B_OK) {
 #if KDEBUG
 		ASSERT(lock->holder == waiter.thread->id);
 #endif
+		MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
 	} else {
 		// If the lock was destroyed, our "thread" entry will be NULL.
 		if (waiter.thread == NULL)
@@ -1174,6 +1426,7 @@ _mutex_lock_with_timeout(mutex* lock, uint32 timeoutFlags, bigtime_t timeout)
 #if KDEBUG
 			ASSERT(lock->holder == waiter.thread->id);
 #endif
+			MUTEX_STATISTICS_ACQUIRED(lock, true, waitStart);
 			return B_OK;
 		}
 	}
@@ -1191,6 +1444,7 @@ mutex_trylock(mutex* lock)
 
 	if (lock->holder < 0) {
 		lock->holder = thread_get_current_thread_id();
+		MUTEX_STATISTICS_ACQUIRED(lock, false, 0);
 		return B_OK;
 	} else if (lock->holder == 0) {
 		panic("_mutex_trylock(): using uninitialized lock %p", lock);
@@ -1260,6 +1514,9 @@ dump_mutex_info(int argc, char** argv)
 	kprintf("  holder:          %" B_PRId32 "\n", lock->holder);
 #else
 	kprintf("  count:           %" B_PRId32 "\n", lock->count);
+#	if KERNEL_MUTEX_SPINNING
+	kprintf("  holder:          %" B_PRId32 "\n", lock->holder);
+#	endif
 #endif
 
 	kprintf("  waiting threads:");
@@ -1274,6 +1531,53 @@ dump_mutex_info(int argc, char** argv)
 }
 
 
+#if KERNEL_MUTEX_SPINNING
+
+
+static int
+dump_mutex_spinning(int argc, char** argv)
+{
+	if (argc > 3) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	if (argc >= 2) {
+		if (strcmp(argv[1], "on") == 0)
+			sMutexSpinningEnabled = true;
+		else if (strcmp(argv[1], "off") == 0)
+			sMutexSpinningEnabled = false;
+		else if (strcmp(argv[1], "reset") == 0)
+			memset(sMutexSpinStatistics, 0, sizeof(sMutexSpinStatistics));
+		else if (strcmp(argv[1], "limit") == 0 && argc == 3)
+			sMutexSpinLimit = parse_expression(argv[2]);
+		else {
+			print_debugger_command_usage(argv[0]);
+			return 0;
+		}
+	}
+
+	mutex_spin_statistics total = {};
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		total.attempts += sMutexSpinStatistics[i].attempts;
+		total.acquired += sMutexSpinStatistics[i].acquired;
+		total.blocks += sMutexSpinStatistics[i].blocks;
+	}
+
+	kprintf("mutex spinning:  %s, limit %" B_PRId64 " us\n",
+		sMutexSpinningEnabled ? "enabled" : "disabled", sMutexSpinLimit);
+	kprintf("  spin attempts: %" B_PRId64 "\n", total.attempts);
+	kprintf("  spin acquired: %" B_PRId64 " (%" B_PRId64 " context switches "
+		"avoided)\n", total.acquired, total.acquired * 2);
+	kprintf("  blocked:       %" B_PRId64 "\n", total.blocks);
+
+	return 0;
+}
+
+
+#endif	// KERNEL_MUTEX_SPINNING
+
+
 // #pragma mark -
 
 
@@ -1296,4 +1600,12 @@ lock_debug_init()
 		"Prints info about the specified recursive lock.\n"
 		"  <lock>  - pointer to the recursive lock to print the info for.\n",
 		0);
+#if KERNEL_MUTEX_SPINNING
+	add_debugger_command_etc("mutex_spinning", &dump_mutex_spinning,
+		"Control and show statistics of optimistic mutex spinning",
+		"[ on | off | reset | limit <microseconds> ]\n"
+		"Prints the mutex spinning statistics, after optionally enabling or\n"
+		"disabling spinning, resetting the statistics, or setting the\n"
+		"maximum spin time.\n", 0);
+#endif
 }
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Per lock class contention statistics.
+
+	Mutexes and rw_locks are grouped by the contents of their name, so that
+	locks with cloned names (MUTEX_FLAG_CLONE_NAME) of the same kind share a
+	class; spinlocks, which don't have a name, by the code acquiring them.
+	Since the statistics are updated from within acquire_spinlock(), the
+	class table must not be protected by a lock itself: classes are entered
+	into a fixed size open addressing hash table with atomic operations only,
+	and are never removed.
+*/
+
+
+#include <lock_statistics.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <debug.h>
+#include <elf.h>
+#include <generic_syscall.h>
+#include <kernel.h>
+#include <lock.h>
+#include <util/atomic.h>
+#include <util/AutoLock.h>
+
+
+#if KERNEL_LOCK_STATISTICS
+
+
+static const uint32 kLockClassCount = 2048;
+static const uint32 kMaxProbeCount = 32;
+
+
+struct lock_class {
+	addr_t		key;
+		// the acquiring code for spinlocks, the name's hash otherwise
+	int32		ready;
+		// set once type and name are valid
+	uint32		type;
+	char		name[LOCK_STATISTICS_NAME_LENGTH];
+	int64		acquisitions;
+	int64		contended;
+	int64		total_wait_time;
+	int64		max_wait_time;
+	int64		total_hold_time;
+	int64		max_hold_time;
+};
+
+
+bool gLockStatisticsEnabled = false;
+
+static lock_class sLockClasses[kLockClassCount];
+static int64 sDroppedEvents;
+static mutex sLockStatisticsLock = MUTEX_INITIALIZER("lock statistics");
+	// serializes the syscall users
+
+
+static inline uint32
+lock_class_hash(addr_t key)
+{
+	uint64 value = key;
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	return (uint32)value;
+}
+
+
+/*!	Hashes the part of \a name that fits into a lock_class::name. The result
+	is never 0, since that marks an unused class.
+*/
+static inline addr_t
+lock_class_name_hash(const char* name)
+{
+	uint32 hash = 2166136261U;
+	for (size_t i = 0; i < LOCK_STATISTICS_NAME_LENGTH - 1 && name[i] != '\0';
+			i++) {
+		hash = (hash ^ (uint8)name[i]) * 16777619U;
+	}
+
+	return hash != 0 ? hash : 1;
+}
+
+
+/*!	Looks up the class a lock belongs to, and enters it, if it doesn't exist
+	yet. For mutexes and rw_locks, \a key is the lock's name; the class is
+	found by comparing its contents.
+*/
+static lock_class*
+lookup_lock_class(addr_t key, uint32 type, const char* name)
+{
+	if (key == 0)
+		return NULL;
+
+	if (type != LOCK_STATISTICS_TYPE_SPINLOCK) {
+		name = (const char*)key;
+		key = lock_class_name_hash(name);
+	}
+
+	uint32 hash = lock_class_hash(key);
+	for (uint32 i = 0; i < kMaxProbeCount; i++) {
+		lock_class* lockClass = &sLockClasses[(hash + i) % kLockClassCount];
+
+		addr_t current = (addr_t)atomic_pointer_get((void**)&lockClass->key);
+		if (current == 0) {
+			current = (addr_t)atomic_pointer_test_and_set(
+				(void**)&lockClass->key, (void*)key, (void*)NULL);
+			if (current == 0) {
+				// we entered the class
+				lockClass->type = type;
+				if (name != NULL)
+					strlcpy(lockClass->name, name, sizeof(lockClass->name));
+				atomic_set(&lockClass->ready, 1);
+				return lockClass;
+			}
+		}
+
+		if (current != key)
+			continue;
+
+		if (atomic_get(&lockClass->ready) == 0) {
+			// The class is just being entered. We cannot wait for that here,
+			// so this event gets lost.
+			break;
+		}
+
+		if (lockClass->type == type
+			&& (type == LOCK_STATISTICS_TYPE_SPINLOCK
+				|| strncmp(lockClass->name, name,
+					sizeof(lockClass->name) - 1) == 0)) {
+			return lockClass;
+		}
+	}
+
+	atomic_add64(&sDroppedEvents, 1);
+	return NULL;
+}
+
+
+static inline void
+update_maximum(int64* maximum, int64 value)
+{
+	int64 current = atomic_get64(maximum);
+	while (value > current) {
+		int64 previous = atomic_test_and_set64(maximum, value, current);
+		if (previous == current)
+			break;
+		current = previous;
+	}
+}
+
+
+static void
+reset_lock_classes()
+{
+	for (uint32 i = 0; i < kLockClassCount; i++) {
+		lock_class& lockClass = sLockClasses[i];
+		atomic_set64(&lockClass.acquisitions, 0);
+		atomic_set64(&lockClass.contended, 0);
+		atomic_set64(&lockClass.total_wait_time, 0);
+		atomic_set64(&lockClass.max_wait_time, 0);
+		atomic_set64(&lockClass.total_hold_time, 0);
+		atomic_set64(&lockClass.max_hold_time, 0);
+	}
+
+	atomic_set64(&sDroppedEvents, 0);
+}
+
+
+/*!	Fills in the name of the given class. Spinlock classes are named after
+	the function that acquires them.
+*/
+static void
+get_lock_class_name(const lock_class& lockClass, char* buffer,
+	size_t bufferSize)
+{
+	if (lockClass.type != LOCK_STATISTICS_TYPE_SPINLOCK) {
+		strlcpy(buffer, lockClass.name, bufferSize);
+		return;
+	}
+
+	const char* symbol;
+	const char* image;
+	addr_t baseAddress;
+	bool exactMatch;
+	if (elf_debug_lookup_symbol_address(lockClass.key, &baseAddress, &symbol,
+			&image, &exactMatch) == B_OK && symbol != NULL) {
+		snprintf(buffer, bufferSize, "%s+%#" B_PRIxADDR, symbol,
+			lockClass.key - baseAddress);
+	} else
+		snprintf(buffer, bufferSize, "%#" B_PRIxADDR, lockClass.key);
+}
+
+
+static const char*
+lock_type_name(uint32 type)
+{
+	switch (type) {
+		case LOCK_STATISTICS_TYPE_MUTEX:
+			return "mutex";
+		case LOCK_STATISTICS_TYPE_RW_LOCK:
+			return "rw_lock";
+		case LOCK_STATISTICS_TYPE_SPINLOCK:
+			return "spinlock";
+		default:
+			return "?";
+	}
+}
+
+
+static int
+dump_lock_statistics(int argc, char** argv)
+{
+	int32 count = 20;
+
+	for (int32 i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "on") == 0)
+			gLockStatisticsEnabled = true;
+		else if (strcmp(argv[i], "off") == 0)
+			gLockStatisticsEnabled = false;
+		else if (strcmp(argv[i], "reset") == 0)
+			reset_lock_classes();
+		else {
+			uint64 value;
+			if (!evaluate_debug_expression(argv[i], &value, false))
+				return 0;
+			count = value;
+		}
+	}
+
+	kprintf("lock statistics %s, %" B_PRId64 " events dropped\n",
+		gLockStatisticsEnabled ? "enabled" : "disabled", sDroppedEvents);
+	kprintf("%-8s %-40s %10s %10s %12s %10s %12s %10s\n", "type", "name",
+		"acquired", "contended", "wait total", "wait max", "hold total",
+		"hold max");
+
+	// Print the classes in order of contention. We cannot allocate memory
+	// here, so we just pick the next best one on each iteration.
+	int64 lastContended = INT64_MAX;
+	const lock_class* lastClass = NULL;
+	for (int32 printed = 0; printed < count; printed++) {
+		const lock_class* best = NULL;
+		for (uint32 i = 0; i < kLockClassCount; i++) {
+			const lock_class* lockClass = &sLockClasses[i];
+			if (lockClass->key == 0 || lockClass->acquisitions == 0)
+				continue;
+
+			// skip the ones we have already printed
+			if (lockClass->contended > lastContended
+				|| (lockClass->contended == lastContended
+					&& lockClass <= lastClass)) {
+				continue;
+			}
+
+			if (best == NULL || lockClass->contended > best->contended
+				|| (lockClass->contended == best->contended
+					&& lockClass < best)) {
+				best = lockClass;
+			}
+		}
+
+		if (best == NULL)
+			break;
+
+		char name[LOCK_STATISTICS_NAME_LENGTH];
+		get_lock_class_name(*best, name, sizeof(name));
+
+		kprintf("%-8s %-40.40s %10" B_PRId64 " %10" B_PRId64 " %12"
+			B_PRId64 " %10" B_PRId64 " %12" B_PRId64 " %10" B_PRId64 "\n",
+			lock_type_name(best->type), name, best->acquisitions,
+			best->contended, best->total_wait_time, best->max_wait_time,
+			best->total_hold_time, best->max_hold_time);
+
+		lastContended = best->contended;
+		lastClass = best;
+	}
+
+	return 0;
+}
+
+
+static status_t
+get_lock_statistics(lock_statistics_request* _request)
+{
+	lock_statistics_request request;
+	if (!IS_USER_ADDRESS(_request)
+		|| user_memcpy(&request, _request, sizeof(request)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	if (request.class_count > 0 && !IS_USER_ADDRESS(request.classes))
+		return B_BAD_ADDRESS;
+
+	uint32 filled = 0;
+	uint32 total = 0;
+	for (uint32 i = 0; i < kLockClassCount; i++) {
+		const lock_class& lockClass = sLockClasses[i];
+		if (atomic_pointer_get((void**)&lockClass.key) == NULL
+			|| atomic_get64((int64*)&lockClass.acquisitions) == 0) {
+			continue;
+		}
+
+		total++;
+		if (filled >= request.class_count)
+			continue;
+
+		lock_class_info info;
+		memset(&info, 0, sizeof(info));
+		get_lock_class_name(lockClass, info.name, sizeof(info.name));
+		info.type = lockClass.type;
+		info.acquisitions = lockClass.acquisitions;
+		info.contended = lockClass.contended;
+		info.total_wait_time = lockClass.total_wait_time;
+		info.max_wait_time = lockClass.max_wait_time;
+		info.total_hold_time = lockClass.total_hold_time;
+		info.max_hold_time = lockClass.max_hold_time;
+
+		if (user_memcpy(request.classes + filled, &info, sizeof(info))
+				!= B_OK) {
+			return B_BAD_ADDRESS;
+		}
+		filled++;
+	}
+
+	request.class_count = filled;
+	request.total_class_count = total;
+	request.dropped = atomic_get64(&sDroppedEvents);
+	request.enabled = gLockStatisticsEnabled;
+
+	if (user_memcpy(_request, &request, sizeof(request)) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return B_OK;
+}
+
+
+static status_t
+lock_statistics_syscall(const char* subsystem, uint32 function,
+	void* buffer, size_t bufferSize)
+{
+	if (geteuid() != 0)
+		return B_NOT_ALLOWED;
+
+	MutexLocker locker(sLockStatisticsLock);
+
+	switch (function) {
+		case LOCK_STATISTICS_GET:
+			if (bufferSize != sizeof(lock_statistics_request))
+				return B_BAD_VALUE;
+			return get_lock_statistics((lock_statistics_request*)buffer);
+
+		case LOCK_STATISTICS_RESET:
+			reset_lock_classes();
+			return B_OK;
+
+		case LOCK_STATISTICS_ENABLE:
+			gLockStatisticsEnabled = true;
+			return B_OK;
+
+		case LOCK_STATISTICS_DISABLE:
+			gLockStatisticsEnabled = false;
+			return B_OK;
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+// #pragma mark - kernel private API
+
+
+void
+lock_statistics_acquired(addr_t key, uint32 type, const char* name,
+	bool contended, bigtime_t waitTime)
+{
+	lock_class* lockClass = lookup_lock_class(key, type, name);
+	if (lockClass == NULL)
+		return;
+
+	atomic_add64(&lockClass->acquisitions, 1);
+	if (!contended)
+		return;
+
+	atomic_add64(&lockClass->contended, 1);
+	atomic_add64(&lockClass->total_wait_time, waitTime);
+	update_maximum(&lockClass->max_wait_time, waitTime);
+}
+
+
+void
+lock_statistics_released(addr_t key, uint32 type, bigtime_t holdTime)
+{
+	lock_class* lockClass = lookup_lock_class(key, type, NULL);
+	if (lockClass == NULL)
+		return;
+
+	atomic_add64(&lockClass->total_hold_time, holdTime);
+	update_maximum(&lockClass->max_hold_time, holdTime);
+}
+
+
+status_t
+lock_statistics_init_post_generic_syscalls()
+{
+	add_debugger_command_etc("lockstat", &dump_lock_statistics,
+		"Print lock contention statistics",
+		"[ on | off | reset ] [ <count> ]\n"
+		"Prints the <count> (default 20) most contended lock classes, after\n"
+		"optionally enabling or disabling the collection of the statistics,\n"
+		"or resetting them.\n", 0);
+
+	return register_generic_syscall(LOCK_STATISTICS, &lock_statistics_syscall,
+		0, 0);
+}
+
+
+#endif	// KERNEL_LOCK_STATISTICS
@@ -199,6 +199,9 @@ _start(kernel_args *bootKernelArgs, int currentCPU)
 		TRACE("init generic syscall\n");
 		generic_syscall_init();
 		smp_init_post_generic_syscalls();
+#if KERNEL_LOCK_STATISTICS
+		lock_statistics_init_post_generic_syscalls();
+#endif
 		TRACE("init scheduler\n");
 		scheduler_init();
 		TRACE("init threads\n");
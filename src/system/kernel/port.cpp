@@ -25,6 +25,7 @@
 #include <StackOrHeapArray.h>
 
 #include <arch/int.h>
+#include <brw_lock.h>
 #include <heap.h>
 #include <kernel.h>
 #include <Notifications.h>
@@ -36,6 +37,8 @@
 #include <util/list.h>
 #include <util/iovec_support.h>
 #include <vm/vm.h>
+#include <vm/vm_page.h>
+#include <vm/vm_priv.h>
 #include <wait_for_objects.h>
 
 
@@ -96,6 +99,9 @@ struct port_message : DoublyLinkedListLinkImpl<port_message> {
 	uid_t				sender;
 	gid_t				sender_group;
 	team_id				sender_team;
+	vm_page**			pages;
+		// large messages are stored in pages instead of the buffer, which
+		// then holds the page array
 	char				buffer[0];
 };
 
@@ -445,6 +451,10 @@ static const size_t kBufferGrowRate = kInitialPortBufferSize;
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
 
+// Messages of at least this size are stored in whole pages, which can be
+// passed on to the receiver instead of being copied.
+static const size_t kPageMessageThreshold = 64 * 1024;
+
 static int32 sMaxPorts = 4096;
 static int32 sUsedPorts;
 
@@ -455,7 +465,7 @@ static int32 sTotalSpaceCommited;
 static int32 sWaitingForSpace;
 static port_id sNextPortID = 1;
 static bool sPortsActive = false;
-static rw_lock sPortsLock = RW_LOCK_INITIALIZER("ports list");
+static brw_lock sPortsLock = BRW_LOCK_INITIALIZER("ports list");
 
 enum {
 	kTeamListLockCount = 8
@@ -631,7 +641,7 @@ get_locked_port(port_id id) GCC_2_NRV(portRef)
 	BReference<Port> portRef;
 #endif
 	{
-		ReadLocker portsLocker(sPortsLock);
+		BigReadLocker portsLocker(sPortsLock);
 		portRef.SetTo(sPorts.Lookup(id));
 	}
 
@@ -651,7 +661,7 @@ get_port(port_id id) GCC_2_NRV(portRef)
 #if __GNUC__ >= 3
 	BReference<Port> portRef;
 #endif
-	ReadLocker portsLocker(sPortsLock);
+	BigReadLocker portsLocker(sPortsLock);
 	portRef.SetTo(sPorts.Lookup(id));
 
 	return portRef;
@@ -666,10 +676,80 @@ is_port_closed(Port* port)
 }
 
 
+static page_num_t
+port_message_page_count(port_message* message)
+{
+	return (message->size + B_PAGE_SIZE - 1) / B_PAGE_SIZE;
+}
+
+
+/*!	Allocates a message whose contents are stored in pages. Returns \c NULL,
+	if the memory cannot be reserved right away; the caller should then fall
+	back to a heap allocated message.
+*/
+static port_message*
+allocate_page_message(size_t bufferSize)
+{
+	const page_num_t pageCount = (bufferSize + B_PAGE_SIZE - 1) / B_PAGE_SIZE;
+
+	port_message* message = (port_message*)malloc(sizeof(port_message)
+		+ pageCount * sizeof(vm_page*));
+	if (message == NULL)
+		return NULL;
+
+	if (vm_try_reserve_memory(pageCount * B_PAGE_SIZE, VM_PRIORITY_USER, 0)
+			!= B_OK) {
+		free(message);
+		return NULL;
+	}
+
+	vm_page_reservation reservation;
+	if (!vm_page_try_reserve_pages(&reservation, pageCount,
+			VM_PRIORITY_USER)) {
+		vm_unreserve_memory(pageCount * B_PAGE_SIZE);
+		free(message);
+		return NULL;
+	}
+
+	message->pages = (vm_page**)message->buffer;
+	for (page_num_t i = 0; i < pageCount; i++) {
+		vm_page* page = vm_page_allocate_page(&reservation, PAGE_STATE_WIRED);
+		DEBUG_PAGE_ACCESS_END(page);
+		message->pages[i] = page;
+	}
+
+	vm_page_unreserve_pages(&reservation);
+	return message;
+}
+
+
+static void
+free_message_pages(port_message* message)
+{
+	const page_num_t pageCount = port_message_page_count(message);
+	for (page_num_t i = 0; i < pageCount; i++) {
+		vm_page* page = message->pages[i];
+		if (page == NULL) {
+			// passed on to the receiver
+			continue;
+		}
+
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_free(NULL, page);
+	}
+
+	// Pages that were passed on are covered by the commitment of the
+	// receiving cache, so we give back our reservation in any case.
+	vm_unreserve_memory(pageCount * B_PAGE_SIZE);
+}
+
+
 static void
 put_port_message(port_message* message)
 {
 	const size_t size = sizeof(port_message) + message->size;
+	if (message->pages != NULL)
+		free_message_pages(message);
 	free(message);
 
 	atomic_add(&sTotalSpaceCommited, -size);
@@ -733,7 +813,14 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		}
 
 		// Quota is fulfilled, try to allocate the buffer
-		port_message* message = (port_message*)malloc(size);
+		port_message* message = NULL;
+		if (bufferSize >= kPageMessageThreshold)
+			message = allocate_page_message(bufferSize);
+		if (message == NULL) {
+			message = (port_message*)malloc(size);
+			if (message != NULL)
+				message->pages = NULL;
+		}
 		if (message != NULL) {
 			message->code = code;
 			message->size = bufferSize;
@@ -768,6 +855,76 @@ fill_port_info(Port* port, port_info* info, size_t size)
 }
 
 
+static status_t
+copy_to_port_message(port_message* message, size_t offset, const void* source,
+	size_t size, bool userCopy)
+{
+	if (message->pages == NULL) {
+		if (userCopy)
+			return user_memcpy(message->buffer + offset, source, size);
+
+		memcpy(message->buffer + offset, source, size);
+		return B_OK;
+	}
+
+	while (size > 0) {
+		const vm_page* page = message->pages[offset / B_PAGE_SIZE];
+		const size_t pageOffset = offset % B_PAGE_SIZE;
+		const size_t bytes = std::min(size, B_PAGE_SIZE - pageOffset);
+
+		status_t status = vm_memcpy_to_physical(
+			page->physical_page_number * B_PAGE_SIZE + pageOffset, source,
+			bytes, userCopy);
+		if (status != B_OK)
+			return status;
+
+		source = (const uint8*)source + bytes;
+		offset += bytes;
+		size -= bytes;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Copies the contents of a message stored in pages to \a buffer. If the
+	buffer is a page aligned userland buffer, the pages are moved to the
+	reader's address space instead, if possible. Hence the message must have
+	been dequeued already in this case.
+*/
+static status_t
+copy_from_page_message(port_message* message, void* buffer, size_t size,
+	bool userCopy)
+{
+	size_t offset = 0;
+
+	if (userCopy && size >= kPageMessageThreshold
+		&& ((addr_t)buffer % B_PAGE_SIZE) == 0) {
+		const page_num_t pageCount = size / B_PAGE_SIZE;
+		if (vm_insert_user_pages(buffer, message->pages, pageCount) == B_OK) {
+			memset(message->pages, 0, pageCount * sizeof(vm_page*));
+			offset = pageCount * B_PAGE_SIZE;
+		}
+	}
+
+	while (offset < size) {
+		const vm_page* page = message->pages[offset / B_PAGE_SIZE];
+		const size_t pageOffset = offset % B_PAGE_SIZE;
+		const size_t bytes = std::min(size - offset, B_PAGE_SIZE - pageOffset);
+
+		status_t status = vm_memcpy_from_physical((uint8*)buffer + offset,
+			page->physical_page_number * B_PAGE_SIZE + pageOffset, bytes,
+			userCopy);
+		if (status != B_OK)
+			return status;
+
+		offset += bytes;
+	}
+
+	return B_OK;
+}
+
+
 static ssize_t
 copy_port_message(port_message* message, int32* _code, void* buffer,
 	size_t bufferSize, bool userCopy)
@@ -780,7 +937,12 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 		*_code = message->code;
 
 	if (size > 0) {
-		if (userCopy) {
+		if (message->pages != NULL) {
+			status_t status = copy_from_page_message(message, buffer, size,
+				userCopy);
+			if (status != B_OK)
+				return status;
+		} else if (userCopy) {
 			status_t status = user_memcpy(buffer, message->buffer, size);
 			if (status != B_OK)
 				return status;
@@ -881,7 +1043,7 @@ delete_owned_ports(Team* team)
 
 	// Remove all ports in deletionList from hashes
 	{
-		WriteLocker portsLocker(sPortsLock);
+		BigWriteLocker portsLocker(sPortsLock);
 
 		for (Port* port = (Port*)list_get_first_item(&deletionList);
 			 port != NULL;
@@ -1008,7 +1170,7 @@ create_port(int32 queueLength, const char* name)
 	}
 
 	{
-		WriteLocker locker(sPortsLock);
+		BigWriteLocker locker(sPortsLock);
 
 		// allocate a port ID
 		do {
@@ -1111,7 +1273,7 @@ delete_port(port_id id)
 	// Now remove port physically:
 	// (1/2) Remove from hash tables
 	{
-		WriteLocker portsLocker(sPortsLock);
+		BigWriteLocker portsLocker(sPortsLock);
 
 		sPorts.Remove(portRef);
 		sPortsByName.Remove(portRef);
@@ -1223,7 +1385,7 @@ find_port(const char* name)
 	if (name == NULL)
 		return B_BAD_VALUE;
 
-	ReadLocker locker(sPortsLock);
+	BigReadLocker locker(sPortsLock);
 	Port* port = sPortsByName.Lookup(name);
 		// Since we have sPortsLock and don't return the port itself,
 		// no BReference necessary
@@ -1647,15 +1809,12 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 			if (bytes > bufferSize)
 				bytes = bufferSize;
 
-			if (userCopy) {
-				status_t status = user_memcpy(message->buffer + offset,
-					msgVecs[i].iov_base, bytes);
-				if (status != B_OK) {
-					put_port_message(message);
-					goto error;
-				}
-			} else
-				memcpy(message->buffer + offset, msgVecs[i].iov_base, bytes);
+			status = copy_to_port_message(message, offset, msgVecs[i].iov_base,
+				bytes, userCopy);
+			if (status != B_OK) {
+				put_port_message(message);
+				goto error;
+			}
 
 			bufferSize -= bytes;
 			if (bufferSize == 0)
@@ -1663,6 +1822,24 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 
 			offset += bytes;
 		}
+
+		if (bufferSize > 0 && message->pages != NULL) {
+			// The vectors don't cover the whole message. Don't pass on what
+			// the pages contained before.
+			offset = message->size - bufferSize;
+			while (bufferSize > 0) {
+				const vm_page* page = message->pages[offset / B_PAGE_SIZE];
+				const size_t pageOffset = offset % B_PAGE_SIZE;
+				const size_t bytes = std::min(bufferSize,
+					B_PAGE_SIZE - pageOffset);
+				vm_memset_physical(
+					page->physical_page_number * B_PAGE_SIZE + pageOffset, 0,
+					bytes);
+
+				offset += bytes;
+				bufferSize -= bytes;
+			}
+		}
 	}
 
 	portRef->messages.Add(message);
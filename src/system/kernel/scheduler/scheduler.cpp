@@ -66,6 +66,7 @@ spinlock gSchedulerListenersLock = B_SPINLOCK_INITIALIZER;
 static scheduler_mode_operations* sSchedulerModes[] = {
 	&gSchedulerLowLatencyMode,
 	&gSchedulerPowerSavingMode,
+	&gSchedulerServerMode,
 };
 
 // Since CPU IDs used internally by the kernel bear no relation to the actual
@@ -98,6 +99,7 @@ enqueue(Thread* thread, bool newOne)
 	SCHEDULER_ENTER_FUNCTION();
 
 	ThreadData* threadData = thread->scheduler_data;
+	threadData->UpdateDeadline();
 
 	int32 threadPriority = threadData->GetEffectivePriority();
 	T(EnqueueThread(thread, threadPriority));
@@ -108,6 +110,12 @@ enqueue(Thread* thread, bool newOne)
 		ASSERT(thread->previous_cpu != NULL);
 		ASSERT(threadData->Core() != NULL);
 		targetCPU = &gCPUEntries[thread->previous_cpu->cpu_num];
+	} else if (threadData->IsDeadline()
+		&& threadData->DeadlineCore()->CPUCount() > 0) {
+		// deadline threads stay on the core they have been admitted to, also
+		// while they wait for their next period, so that it can replenish
+		// them
+		targetCore = threadData->DeadlineCore();
 	} else if (gSingleCore) {
 		targetCore = &gCoreEntries[0];
 	} else if (threadData->Core() != NULL
@@ -127,10 +135,12 @@ enqueue(Thread* thread, bool newOne)
 	NotifySchedulerListeners(&SchedulerListener::ThreadEnqueuedInRunQueue,
 		thread);
 
+	// A deadline thread may have to preempt another deadline thread running
+	// with the same effective priority, let the target CPU decide.
 	int32 heapPriority = CPUPriorityHeap::GetKey(targetCPU);
 	if (threadPriority > heapPriority
 		|| (threadPriority == heapPriority && rescheduleNeeded)
-		|| wasRunQueueEmpty) {
+		|| wasRunQueueEmpty || threadData->HasDeadlineBudget()) {
 
 		if (targetCPU->ID() == smp_get_current_cpu()) {
 			gCPU[targetCPU->ID()].invoke_scheduler = true;
@@ -219,6 +229,119 @@ scheduler_set_thread_priority(Thread *thread, int32 priority)
 }
 
 
+/*!	Picks the core with the smallest deadline load per CPU that the thread
+	is allowed to run on, and reserves \a load on it. The thread's current
+	reservation, if any, is not counted against its own core; it is replaced
+	if that core is chosen, and left alone otherwise.
+*/
+static CoreEntry*
+admit_deadline_thread(ThreadData* threadData, int32 load)
+{
+	CPUSet mask = threadData->GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	CoreEntry* oldCore = threadData->DeadlineCore();
+	int32 oldLoad = threadData->DeadlineLoad();
+
+	CoreEntry* chosen = NULL;
+	int32 chosenLoad = 0;
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* core = &gCoreEntries[i];
+		if (core->CPUCount() <= 0
+			|| (useMask && !core->CPUMask().Matches(mask))) {
+			continue;
+		}
+
+		int32 coreLoad = core->DeadlineLoad();
+		if (core == oldCore)
+			coreLoad -= oldLoad;
+		coreLoad /= core->CPUCount();
+		if (chosen == NULL || coreLoad < chosenLoad) {
+			chosen = core;
+			chosenLoad = coreLoad;
+		}
+	}
+
+	if (chosen == NULL || !chosen->AdmitDeadlineThread(load,
+			chosen == oldCore ? oldLoad : 0)) {
+		return NULL;
+	}
+	return chosen;
+}
+
+
+status_t
+scheduler_set_thread_deadline(Thread* thread, bigtime_t runtime,
+	bigtime_t deadline, bigtime_t period)
+{
+	ASSERT(are_interrupts_enabled());
+
+	if (runtime < 0 || deadline < 0 || period < 0)
+		return B_BAD_VALUE;
+
+	int32 load = 0;
+	if (runtime > 0) {
+		if (deadline == 0)
+			deadline = period;
+		if (period < kMinimalDeadlinePeriod || runtime > deadline
+			|| deadline > period) {
+			return B_BAD_VALUE;
+		}
+		load = std::max(int32(runtime * kMaxLoad / deadline), int32(1));
+	}
+
+	InterruptsSpinLocker _(thread->scheduler_lock);
+	SchedulerModeLocker modeLocker;
+
+	SCHEDULER_ENTER_FUNCTION();
+
+	ThreadData* threadData = thread->scheduler_data;
+
+	// The parameters must not change while the thread is in a run queue.
+	bool wasEnqueued = thread->state == B_THREAD_READY
+		&& threadData->Dequeue();
+
+	// The previous reservation is only given up once the new one is in
+	// place, so that a failed admission keeps it.
+	status_t status = B_OK;
+	CoreEntry* core = NULL;
+	if (load > 0) {
+		core = admit_deadline_thread(threadData, load);
+		if (core == NULL)
+			status = B_BUSY;
+	}
+
+	if (status == B_OK) {
+		threadData->ClearDeadline(core != threadData->DeadlineCore());
+		if (core != NULL)
+			threadData->SetDeadline(core, load, runtime, deadline, period);
+	}
+
+	threadData->UpdateDeadline();
+
+	if (wasEnqueued)
+		enqueue(thread, true);
+	else if (thread->state == B_THREAD_RUNNING) {
+		ASSERT(thread->cpu != NULL);
+		CPUEntry* cpu = &gCPUEntries[thread->cpu->cpu_num];
+
+		CoreCPUHeapLocker heapLocker(threadData->Core());
+		cpu->UpdatePriority(threadData->GetEffectivePriority());
+		heapLocker.Unlock();
+
+		// restart the quantum so that the runtime is enforced
+		if (cpu->ID() == smp_get_current_cpu())
+			gCPU[cpu->ID()].invoke_scheduler = true;
+		else {
+			smp_send_ici(cpu->ID(), SMP_MSG_RESCHEDULE, 0, 0, 0, NULL,
+				SMP_MSG_FLAG_ASYNC);
+		}
+	}
+
+	return status;
+}
+
+
 void
 scheduler_reschedule_ici()
 {
@@ -369,6 +492,9 @@ reschedule(int32 nextState)
 						oldThreadData->GetEffectivePriority());
 					putOldThreadAtBack = false;
 				}
+
+				// a throttled deadline thread may have entered a new period
+				oldThreadData->UpdateDeadline();
 			}
 
 			break;
@@ -410,9 +536,15 @@ reschedule(int32 nextState)
 		if (oldThreadShouldMigrate)
 			enqueueOldThread = false;
 
-		nextThreadData
-			= cpu->ChooseNextThread(enqueueOldThread ? oldThreadData : NULL,
-				putOldThreadAtBack);
+		// this CPU would go idle, try to take over work from a busier core
+		nextThreadData = NULL;
+		if (!enqueueOldThread || oldThreadData->IsIdle())
+			nextThreadData = cpu->StealThread();
+
+		if (nextThreadData == NULL) {
+			nextThreadData = cpu->ChooseNextThread(
+				enqueueOldThread ? oldThreadData : NULL, putOldThreadAtBack);
+		}
 
 		if (oldThreadShouldMigrate) {
 			enqueue(oldThread, true);
@@ -548,7 +680,8 @@ status_t
 scheduler_set_operation_mode(scheduler_mode mode)
 {
 	if (mode != SCHEDULER_MODE_LOW_LATENCY
-		&& mode != SCHEDULER_MODE_POWER_SAVING) {
+		&& mode != SCHEDULER_MODE_POWER_SAVING
+		&& mode != SCHEDULER_MODE_SERVER) {
 		return B_BAD_VALUE;
 	}
 
@@ -42,6 +42,16 @@ const int kVeryHighLoad = (kMaxLoad + kHighLoad) / 2;
 
 const int kLoadDifference = kMaxLoad * 20 / 100;
 
+// Threads that ran more recently than this are not stolen by idle CPUs of
+// other cores, their working set is most likely still in the caches.
+const bigtime_t kCacheHotTime = 500;
+
+// Admission control for deadline threads: the sum of runtime / deadline of
+// all deadline threads on a core may not exceed this share of its CPUs.
+const int kMaxDeadlineLoad = kMaxLoad * 90 / 100;
+const int32 kMaxDeadlineThreads = 16;
+const bigtime_t kMinimalDeadlinePeriod = 500;
+
 extern bool gSingleCore;
 extern bool gTrackCoreLoad;
 extern bool gTrackCPULoad;
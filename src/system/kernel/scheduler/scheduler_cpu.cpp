@@ -41,6 +41,7 @@ public:
 	static	void		DumpCoreRunQueue(CoreEntry* core);
 	static	void		DumpCoreLoadHeapEntry(CoreEntry* core);
 	static	void		DumpIdleCoresInPackage(PackageEntry* package);
+	static	void		DumpCPUStealStats(CPUEntry* cpu);
 
 private:
 	struct CoreThreadsData {
@@ -82,7 +83,10 @@ CPUEntry::CPUEntry()
 	fLoad(0),
 	fMeasureActiveTime(0),
 	fMeasureTime(0),
-	fUpdateLoadEvent(false)
+	fUpdateLoadEvent(false),
+	fStealAttempts(0),
+	fThreadsStolen(0),
+	fCacheHotSkips(0)
 {
 	B_INITIALIZE_RW_SPINLOCK(&fSchedulerModeLock);
 	B_INITIALIZE_SPINLOCK(&fQueueLock);
@@ -160,6 +164,48 @@ CoreEntry::PeekThread() const
 }
 
 
+/*!	Removes the highest priority thread that is allowed to run on \a cpu and
+	whose caches are not hot anymore from the core run queue. Only a few
+	threads at the front of the queue are considered.
+*/
+ThreadData*
+CoreEntry::StealThread(CPUEntry* cpu, bool& skippedCacheHot)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	const int32 kMaxStealCandidates = 8;
+
+	bigtime_t now = system_time();
+
+	CoreRunQueueLocker _(this);
+	if (fThreadCount <= fIdleCPUCount)
+		return NULL;
+
+	ThreadRunQueue::ConstIterator iterator = fRunQueue.GetConstIterator();
+	for (int32 i = 0; i < kMaxStealCandidates && iterator.HasNext(); i++) {
+		ThreadData* threadData = iterator.Next();
+
+		// deadline threads are bound to the core they have been admitted to
+		if (threadData->IsDeadline())
+			continue;
+
+		CPUSet mask = threadData->GetCPUMask();
+		if (!mask.IsEmpty() && !mask.GetBit(cpu->ID()))
+			continue;
+
+		if (threadData->IsCacheHot(now)) {
+			skippedCacheHot = true;
+			continue;
+		}
+
+		Remove(threadData);
+		return threadData;
+	}
+
+	return NULL;
+}
+
+
 ThreadData*
 CPUEntry::PeekThread() const
 {
@@ -232,6 +278,21 @@ CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
 
 	CoreRunQueueLocker coreLocker(fCore);
 
+	fCore->ReplenishDeadlineThreads();
+
+	// Deadline threads with runtime left take precedence over all other
+	// threads and are run earliest deadline first.
+	ThreadData* deadlineThread = fCore->PeekDeadlineThread();
+	if (oldThread != NULL && oldThread->HasDeadlineBudget()
+		&& (deadlineThread == NULL
+			|| oldThread->GetDeadline() <= deadlineThread->GetDeadline())) {
+		return oldThread;
+	}
+	if (deadlineThread != NULL) {
+		fCore->RemoveDeadline(deadlineThread);
+		return deadlineThread;
+	}
+
 	ThreadData* sharedThread = fCore->PeekThread();
 	if (sharedThread == NULL && pinnedThread == NULL && oldThread == NULL)
 		return NULL;
@@ -256,6 +317,75 @@ CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
 }
 
 
+/*!	Called by a CPU that is about to go idle. Looks for a thread waiting in
+	the run queue of another, busier core and migrates it to this CPU's core.
+	Cores in the same package are preferred, other packages are only looked
+	at if their cores are overloaded (and never in power saving mode).
+*/
+ThreadData*
+CPUEntry::StealThread()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (gSingleCore)
+		return NULL;
+
+	// only steal if there is nothing else to do
+	CPURunQueueLocker cpuLocker(this);
+	ThreadData* pinnedThread = fRunQueue.PeekMaximum();
+	if (pinnedThread != NULL && !pinnedThread->IsIdle())
+		return NULL;
+	cpuLocker.Unlock();
+
+	CoreRunQueueLocker coreLocker(fCore);
+	if (fCore->PeekThread() != NULL || fCore->PeekDeadlineThread() != NULL)
+		return NULL;
+	coreLocker.Unlock();
+
+	PackageEntry* package = fCore->Package();
+	const bool samePackageOnly = gCurrentModeID == SCHEDULER_MODE_POWER_SAVING;
+
+	for (int32 pass = 0; pass < 2; pass++) {
+		const bool samePackage = pass == 0;
+		if (!samePackage && samePackageOnly)
+			break;
+
+		CoreEntry* victim = NULL;
+		int32 victimThreads = 0;
+		for (int32 i = 0; i < gCoreCount; i++) {
+			CoreEntry* core = &gCoreEntries[i];
+			if (core == fCore || (core->Package() == package) != samePackage)
+				continue;
+			if (!samePackage && core->GetLoad() < kHighLoad)
+				continue;
+
+			int32 pendingThreads = core->PendingThreadCount();
+			if (pendingThreads > victimThreads) {
+				victim = core;
+				victimThreads = pendingThreads;
+			}
+		}
+
+		if (victim == NULL)
+			continue;
+
+		fStealAttempts++;
+
+		bool skippedCacheHot = false;
+		ThreadData* threadData = victim->StealThread(this, skippedCacheHot);
+		if (skippedCacheHot)
+			fCacheHotSkips++;
+		if (threadData != NULL) {
+			threadData->MigrateTo(fCore);
+			fThreadsStolen++;
+			return threadData;
+		}
+	}
+
+	return NULL;
+}
+
+
 void
 CPUEntry::TrackActivity(ThreadData* oldThreadData, ThreadData* nextThreadData)
 {
@@ -306,6 +436,14 @@ CPUEntry::StartQuantumTimer(ThreadData* thread, bool wasPreempted)
 
 	if (!thread->IsIdle()) {
 		bigtime_t quantum = thread->GetQuantumLeft();
+
+		// reschedule when a waiting deadline thread gets its runtime back
+		bigtime_t replenishTime = fCore->NextReplenishTime();
+		if (replenishTime != B_INFINITE_TIMEOUT) {
+			quantum = std::min(quantum,
+				std::max(replenishTime - system_time(), bigtime_t(0)));
+		}
+
 		add_timer(&cpu->quantum_timer, &CPUEntry::_RescheduleEvent, quantum,
 			B_ONE_SHOT_RELATIVE_TIMER);
 	} else if (gTrackCoreLoad) {
@@ -361,11 +499,48 @@ CPUEntry::_RescheduleEvent(timer* /* unused */)
 CPUEntry::_UpdateLoadEvent(timer* /* unused */)
 {
 	CoreEntry::GetCore(smp_get_current_cpu())->ChangeLoad(0);
-	CPUEntry::GetCPU(smp_get_current_cpu())->fUpdateLoadEvent = false;
+
+	CPUEntry* cpu = CPUEntry::GetCPU(smp_get_current_cpu());
+	cpu->fUpdateLoadEvent = false;
+
+	// Let the idle CPU try to steal work from the other cores. Marking it as
+	// preempted makes the scheduler rearm this timer if nothing was stolen.
+	if (cpu->_HasThreadsToSteal()) {
+		get_cpu_struct()->invoke_scheduler = true;
+		get_cpu_struct()->preempted = true;
+	}
 	return B_HANDLED_INTERRUPT;
 }
 
 
+bool
+CPUEntry::_HasThreadsToSteal() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (gSingleCore)
+		return false;
+
+	// same rules as in StealThread()
+	PackageEntry* package = fCore->Package();
+	const bool samePackageOnly = gCurrentModeID == SCHEDULER_MODE_POWER_SAVING;
+
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* core = &gCoreEntries[i];
+		if (core == fCore)
+			continue;
+		if (core->Package() != package
+			&& (samePackageOnly || core->GetLoad() < kHighLoad)) {
+			continue;
+		}
+
+		if (core->PendingThreadCount() > 0)
+			return true;
+	}
+	return false;
+}
+
+
 CPUPriorityHeap::CPUPriorityHeap(int32 cpuCount)
 	:
 	Heap<CPUEntry, int32>(cpuCount)
@@ -405,6 +580,9 @@ CoreEntry::CoreEntry()
 	fCPUCount(0),
 	fIdleCPUCount(0),
 	fThreadCount(0),
+	fNextReplenishTime(B_INFINITE_TIMEOUT),
+	fDeadlineLoad(0),
+	fDeadlineThreadCount(0),
 	fActiveTime(0),
 	fLoad(0),
 	fCurrentLoad(0),
@@ -414,6 +592,7 @@ CoreEntry::CoreEntry()
 {
 	B_INITIALIZE_SPINLOCK(&fCPULock);
 	B_INITIALIZE_SPINLOCK(&fQueueLock);
+	B_INITIALIZE_SPINLOCK(&fDeadlineLock);
 	B_INITIALIZE_SEQLOCK(&fActiveTimeLock);
 	B_INITIALIZE_RW_SPINLOCK(&fLoadLock);
 }
@@ -424,6 +603,10 @@ CoreEntry::Init(int32 id, PackageEntry* package)
 {
 	fCoreID = id;
 	fPackage = package;
+
+	// the heaps must never grow while the scheduler is running
+	new(&fDeadlineQueue) DeadlineHeap(kMaxDeadlineThreads);
+	new(&fReplenishQueue) DeadlineHeap(kMaxDeadlineThreads);
 }
 
 
@@ -434,6 +617,8 @@ CoreEntry::PushFront(ThreadData* thread, int32 priority)
 
 	fRunQueue.PushFront(thread, priority);
 	atomic_add(&fThreadCount, 1);
+
+	_AddThrottled(thread);
 }
 
 
@@ -444,6 +629,8 @@ CoreEntry::PushBack(ThreadData* thread, int32 priority)
 
 	fRunQueue.PushBack(thread, priority);
 	atomic_add(&fThreadCount, 1);
+
+	_AddThrottled(thread);
 }
 
 
@@ -459,6 +646,95 @@ CoreEntry::Remove(ThreadData* thread)
 
 	fRunQueue.Remove(thread);
 	atomic_add(&fThreadCount, -1);
+
+	if (thread->IsThrottled())
+		_RemoveThrottled(thread);
+}
+
+
+void
+CoreEntry::PushDeadline(ThreadData* thread)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(thread->IsEnqueued());
+	fDeadlineQueue.Insert(thread, thread->GetDeadline());
+}
+
+
+void
+CoreEntry::RemoveDeadline(ThreadData* thread)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(thread->IsEnqueued());
+	thread->SetDequeued();
+
+	fDeadlineQueue.ModifyKey(thread, -1);
+	ASSERT(fDeadlineQueue.PeekRoot() == thread);
+	fDeadlineQueue.RemoveRoot();
+}
+
+
+/*!	Moves the deadline threads whose next period has started from the core
+	run queue to the deadline queue. The core run queue lock must be held.
+*/
+void
+CoreEntry::ReplenishDeadlineThreads()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (fReplenishQueue.PeekRoot() == NULL)
+		return;
+
+	bigtime_t now = system_time();
+	while (true) {
+		ThreadData* threadData = fReplenishQueue.PeekRoot();
+		if (threadData == NULL || DeadlineHeap::GetKey(threadData) > now)
+			break;
+
+		threadData->Replenish();
+	}
+}
+
+
+/*!	Reserves \a load (runtime / deadline scaled to kMaxLoad) of this core's
+	capacity for a deadline thread. If the thread already holds a reservation
+	of \a replacedLoad on this core, that one is replaced. Fails if that would
+	overcommit the core, leaving any previous reservation untouched.
+*/
+bool
+CoreEntry::AdmitDeadlineThread(int32 load, int32 replacedLoad)
+{
+	SpinLocker locker(fDeadlineLock);
+
+	ASSERT(fDeadlineLoad >= replacedLoad);
+
+	if (fCPUCount <= 0
+		|| (replacedLoad == 0
+			&& fDeadlineThreadCount >= kMaxDeadlineThreads)
+		|| fDeadlineLoad - replacedLoad + load
+			> kMaxDeadlineLoad * fCPUCount) {
+		return false;
+	}
+
+	fDeadlineLoad += load - replacedLoad;
+	if (replacedLoad == 0)
+		fDeadlineThreadCount++;
+	return true;
+}
+
+
+void
+CoreEntry::ReleaseDeadlineThread(int32 load)
+{
+	SpinLocker locker(fDeadlineLock);
+
+	ASSERT(fDeadlineThreadCount > 0);
+	ASSERT(fDeadlineLoad >= load);
+
+	fDeadlineLoad -= load;
+	fDeadlineThreadCount--;
 }
 
 
@@ -519,6 +795,15 @@ CoreEntry::RemoveCPU(CPUEntry* cpu, ThreadProcessing& threadPostProcessing)
 			threadPostProcessing(threadData);
 		}
 
+		while (fDeadlineQueue.PeekRoot() != NULL) {
+			ThreadData* threadData = fDeadlineQueue.PeekRoot();
+
+			RemoveDeadline(threadData);
+
+			ASSERT(threadData->Core() == NULL);
+			threadPostProcessing(threadData);
+		}
+
 		fThreadCount = 0;
 	}
 
@@ -531,6 +816,50 @@ CoreEntry::RemoveCPU(CPUEntry* cpu, ThreadProcessing& threadPostProcessing)
 }
 
 
+/*!	Deadline threads that have used up their runtime wait in the core run
+	queue for their next period like any other thread. They are also kept
+	in a heap ordered by the period start, so that they can be moved back to
+	the deadline queue in time.
+*/
+void
+CoreEntry::_AddThrottled(ThreadData* thread)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (thread->DeadlineCore() != this || thread->HasDeadlineBudget())
+		return;
+
+	ASSERT(!thread->IsThrottled());
+	fReplenishQueue.Insert(thread, thread->NextDeadlinePeriod());
+	thread->SetThrottled(true);
+
+	_UpdateNextReplenishTime();
+}
+
+
+void
+CoreEntry::_RemoveThrottled(ThreadData* thread)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	fReplenishQueue.ModifyKey(thread, -1);
+	ASSERT(fReplenishQueue.PeekRoot() == thread);
+	fReplenishQueue.RemoveRoot();
+	thread->SetThrottled(false);
+
+	_UpdateNextReplenishTime();
+}
+
+
+void
+CoreEntry::_UpdateNextReplenishTime()
+{
+	ThreadData* threadData = fReplenishQueue.PeekRoot();
+	atomic_set64(&fNextReplenishTime, threadData != NULL
+		? DeadlineHeap::GetKey(threadData) : B_INFINITE_TIMEOUT);
+}
+
+
 void
 CoreEntry::_UpdateLoad(bool forceUpdate)
 {
@@ -739,6 +1068,15 @@ DebugDumper::DumpIdleCoresInPackage(PackageEntry* package)
 }
 
 
+/* static */ void
+DebugDumper::DumpCPUStealStats(CPUEntry* cpu)
+{
+	kprintf("%3" B_PRId32 " %4" B_PRId32 " %11" B_PRId64 " %11" B_PRId64
+		" %11" B_PRId64 "\n", cpu->ID(), cpu->Core()->ID(), cpu->fStealAttempts,
+		cpu->fThreadsStolen, cpu->fCacheHotSkips);
+}
+
+
 /* static */ void
 DebugDumper::_AnalyzeCoreThreads(Thread* thread, void* data)
 {
@@ -805,6 +1143,17 @@ dump_idle_cores(int /* argc */, char** /* argv */)
 }
 
 
+static int
+dump_steal_stats(int /* argc */, char** /* argv */)
+{
+	kprintf("cpu core    attempts      stolen   cache hot\n");
+	for (int32 i = 0; i < smp_get_num_cpus(); i++)
+		DebugDumper::DumpCPUStealStats(&gCPUEntries[i]);
+
+	return 0;
+}
+
+
 void Scheduler::init_debug_commands()
 {
 	new(&sDebugCPUHeap) CPUPriorityHeap(smp_get_num_cpus());
@@ -818,6 +1167,9 @@ void Scheduler::init_debug_commands()
 			"\nList CPUs in CPU priority heap", 0);
 		add_debugger_command_etc("idle_cores", &dump_idle_cores,
 			"List idle cores", "\nList idle cores", 0);
+		add_debugger_command_etc("steal_stats", &dump_steal_stats,
+			"List per CPU work stealing statistics",
+			"\nList per CPU work stealing statistics", 0);
 	}
 }
 
@@ -43,6 +43,12 @@ public:
 						void			Dump() const;
 };
 
+// Deadline threads with runtime left are kept in a per core heap ordered by
+// their absolute deadline. Those that have used up their runtime wait in the
+// core run queue, and in a second heap ordered by the start of their next
+// period.
+typedef Heap<ThreadData, bigtime_t> DeadlineHeap;
+
 class CPUEntry : public HeapLinkImpl<CPUEntry, int32> {
 public:
 										CPUEntry();
@@ -79,6 +85,7 @@ public:
 
 						ThreadData*		ChooseNextThread(ThreadData* oldThread,
 											bool putAtBack);
+						ThreadData*		StealThread();
 
 						void			TrackActivity(ThreadData* oldThreadData,
 											ThreadData* nextThreadData);
@@ -95,6 +102,8 @@ private:
 	static				int32			_RescheduleEvent(timer* /* unused */);
 	static				int32			_UpdateLoadEvent(timer* /* unused */);
 
+						bool			_HasThreadsToSteal() const;
+
 						int32			fCPUNumber;
 						CoreEntry*		fCore;
 
@@ -110,6 +119,10 @@ private:
 
 						bool			fUpdateLoadEvent;
 
+						int64			fStealAttempts;
+						int64			fThreadsStolen;
+						int64			fCacheHotSkips;
+
 						friend class DebugDumper;
 } CACHE_LINE_ALIGN;
 
@@ -141,6 +154,7 @@ public:
 	inline				CPUPriorityHeap*	CPUHeap();
 
 	inline				int32			ThreadCount() const;
+	inline				int32			PendingThreadCount() const;
 
 	inline				void			LockRunQueue();
 	inline				void			UnlockRunQueue();
@@ -151,6 +165,21 @@ public:
 											int32 priority);
 						void			Remove(ThreadData* thread);
 						ThreadData*		PeekThread() const;
+						ThreadData*		StealThread(CPUEntry* cpu,
+											bool& skippedCacheHot);
+
+						void			PushDeadline(ThreadData* thread);
+						void			RemoveDeadline(ThreadData* thread);
+	inline				ThreadData*		PeekDeadlineThread() const;
+
+						bool			AdmitDeadlineThread(int32 load,
+											int32 replacedLoad = 0);
+						void			ReleaseDeadlineThread(int32 load);
+	inline				int32			DeadlineLoad() const
+											{ return fDeadlineLoad; }
+
+						void			ReplenishDeadlineThreads();
+	inline				bigtime_t		NextReplenishTime() const;
 
 	inline				bigtime_t		GetActiveTime() const;
 	inline				void			IncreaseActiveTime(
@@ -176,6 +205,10 @@ public:
 	static inline		CoreEntry*		GetCore(int32 cpu);
 
 private:
+						void			_AddThrottled(ThreadData* thread);
+						void			_RemoveThrottled(ThreadData* thread);
+						void			_UpdateNextReplenishTime();
+
 						void			_UpdateLoad(bool forceUpdate = false);
 
 	static				void			_UnassignThread(Thread* thread,
@@ -194,6 +227,13 @@ private:
 						ThreadRunQueue	fRunQueue;
 						spinlock		fQueueLock;
 
+						DeadlineHeap	fDeadlineQueue;
+						DeadlineHeap	fReplenishQueue;
+						bigtime_t		fNextReplenishTime;
+						int32			fDeadlineLoad;
+						int32			fDeadlineThreadCount;
+						spinlock		fDeadlineLock;
+
 						bigtime_t		fActiveTime;
 	mutable				seqlock			fActiveTimeLock;
 
@@ -355,6 +395,36 @@ CoreEntry::ThreadCount() const
 }
 
 
+inline ThreadData*
+CoreEntry::PeekDeadlineThread() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return fDeadlineQueue.PeekRoot();
+}
+
+
+/*!	Returns when the next deadline thread waiting in the run queue of this
+	core gets its runtime back, or B_INFINITE_TIMEOUT if there is none.
+*/
+inline bigtime_t
+CoreEntry::NextReplenishTime() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return atomic_get64((int64*)&fNextReplenishTime);
+}
+
+
+/*!	Returns the number of threads in the core run queue that cannot be picked
+	up right away by one of the idle CPUs of this core.
+*/
+inline int32
+CoreEntry::PendingThreadCount() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return fThreadCount - fIdleCPUCount;
+}
+
+
 inline void
 CoreEntry::LockRunQueue()
 {
@@ -26,6 +26,8 @@ ThreadData::_InitBase()
 	fWentSleepActive = 0;
 
 	fEnqueued = false;
+	fInDeadlineQueue = false;
+	fThrottled = false;
 	fReady = false;
 
 	fPriorityPenalty = 0;
@@ -39,6 +41,15 @@ ThreadData::_InitBase()
 	fMeasureAvailableActiveTime = 0;
 	fLastMeasureAvailableTime = 0;
 	fMeasureAvailableTime = 0;
+
+	fDeadlineRuntime = 0;
+	fDeadlineRelative = 0;
+	fDeadlinePeriod = 0;
+	fAbsoluteDeadline = 0;
+	fNextDeadlinePeriod = 0;
+	fRuntimeLeft = 0;
+	fDeadlineLoad = 0;
+	fDeadlineCore = NULL;
 }
 
 
@@ -155,6 +166,15 @@ ThreadData::Dump() const
 		fCore != NULL ? fCore->ID() : -1);
 	if (fCore != NULL && HasCacheExpired())
 		kprintf("\tcache affinity has expired\n");
+
+	if (fDeadlineCore != NULL) {
+		kprintf("\tdeadline:\t\t%" B_PRId64 " us runtime, %" B_PRId64
+			" us deadline, %" B_PRId64 " us period (core %" B_PRId32 ")\n",
+			fDeadlineRuntime, fDeadlineRelative, fDeadlinePeriod,
+			fDeadlineCore->ID());
+		kprintf("\tabsolute_deadline:\t%" B_PRId64 " (runtime left: %"
+			B_PRId64 " us)\n", fAbsoluteDeadline, fRuntimeLeft);
+	}
 }
 
 
@@ -200,6 +220,79 @@ ThreadData::ChooseCoreAndCPU(CoreEntry*& targetCore, CPUEntry*& targetCPU)
 }
 
 
+/*!	Makes the thread a deadline thread. The caller must have admitted it on
+	\a core and must make sure it is not in any run queue.
+*/
+void
+ThreadData::SetDeadline(CoreEntry* core, int32 load, bigtime_t runtime,
+	bigtime_t deadline, bigtime_t period)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(!fEnqueued);
+	ASSERT(fDeadlineCore == NULL);
+
+	fDeadlineRuntime = runtime;
+	fDeadlineRelative = deadline;
+	fDeadlinePeriod = period;
+	fDeadlineLoad = load;
+	fDeadlineCore = core;
+
+	// the first period starts with the next UpdateDeadline()
+	fNextDeadlinePeriod = 0;
+	fRuntimeLeft = 0;
+}
+
+
+/*!	Returns the thread to priority based scheduling and gives up its share of
+	its deadline core, unless \a releaseLoad is \c false because the share has
+	already been handed over to new parameters. The thread must not be in any
+	run queue.
+*/
+void
+ThreadData::ClearDeadline(bool releaseLoad)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (fDeadlineCore == NULL)
+		return;
+
+	if (releaseLoad)
+		fDeadlineCore->ReleaseDeadlineThread(fDeadlineLoad);
+
+	fDeadlineCore = NULL;
+	fDeadlineLoad = 0;
+	fRuntimeLeft = 0;
+
+	_ComputeEffectivePriority();
+}
+
+
+/*!	Moves a ready thread that has been removed from the run queue of its core
+	to \a core, transferring its load.
+*/
+void
+ThreadData::MigrateTo(CoreEntry* core)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(!fEnqueued);
+	ASSERT(core != NULL);
+
+	if (fCore == core)
+		return;
+
+	fLoadMeasurementEpoch = core->LoadMeasurementEpoch() - 1;
+	if (fReady) {
+		if (fCore != NULL)
+			fCore->RemoveLoad(fNeededLoad, true);
+		core->AddLoad(fNeededLoad, fLoadMeasurementEpoch, true);
+	}
+
+	fCore = core;
+}
+
+
 bigtime_t
 ThreadData::ComputeQuantum() const
 {
@@ -300,6 +393,8 @@ ThreadData::_ComputeEffectivePriority() const
 
 	if (IsIdle())
 		fEffectivePriority = B_IDLE_PRIORITY;
+	else if (HasDeadlineBudget())
+		fEffectivePriority = B_REAL_TIME_PRIORITY;
 	else if (IsRealTime())
 		fEffectivePriority = GetPriority();
 	else {
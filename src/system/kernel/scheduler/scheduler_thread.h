@@ -19,7 +19,7 @@ namespace Scheduler {
 
 
 struct ThreadData : public DoublyLinkedListLinkImpl<ThreadData>,
-	RunQueueLinkImpl<ThreadData> {
+	RunQueueLinkImpl<ThreadData>, HeapLinkImpl<ThreadData, bigtime_t> {
 private:
 	inline	void		_InitBase();
 
@@ -44,7 +44,24 @@ public:
 	inline	bool		IsRealTime() const;
 	inline	bool		IsIdle() const;
 
+	inline	bool		IsDeadline() const	{ return fDeadlineCore != NULL; }
+	inline	bool		HasDeadlineBudget() const;
+	inline	bigtime_t	GetDeadline() const	{ return fAbsoluteDeadline; }
+	inline	CoreEntry*	DeadlineCore() const	{ return fDeadlineCore; }
+	inline	int32		DeadlineLoad() const	{ return fDeadlineLoad; }
+	inline	void		GetDeadlineParameters(bigtime_t& runtime,
+							bigtime_t& deadline, bigtime_t& period) const;
+	inline	bigtime_t	NextDeadlinePeriod() const
+							{ return fNextDeadlinePeriod; }
+	inline	void		UpdateDeadline();
+	inline	void		Replenish();
+			void		SetDeadline(CoreEntry* core, int32 load,
+							bigtime_t runtime, bigtime_t deadline,
+							bigtime_t period);
+			void		ClearDeadline(bool releaseLoad = true);
+
 	inline	bool		HasCacheExpired() const;
+	inline	bool		IsCacheHot(bigtime_t now) const;
 	inline	CoreEntry*	Rebalance() const;
 
 	inline	int32		GetEffectivePriority() const;
@@ -57,6 +74,7 @@ public:
 
 			bool		ChooseCoreAndCPU(CoreEntry*& targetCore,
 							CPUEntry*& targetCPU);
+			void		MigrateTo(CoreEntry* core);
 
 	inline	void		SetLastInterruptTime(bigtime_t interruptTime)
 							{ fLastInterruptTime = interruptTime; }
@@ -83,6 +101,10 @@ public:
 	inline	bool		IsEnqueued() const	{ return fEnqueued; }
 	inline	void		SetDequeued()	{ fEnqueued = false; }
 
+	inline	bool		IsThrottled() const	{ return fThrottled; }
+	inline	void		SetThrottled(bool throttled)
+							{ fThrottled = throttled; }
+
 	inline	int32		GetLoad() const	{ return fNeededLoad; }
 
 	inline	CoreEntry*	Core() const	{ return fCore; }
@@ -110,6 +132,8 @@ private:
 			bigtime_t	fWentSleepActive;
 
 			bool		fEnqueued;
+			bool		fInDeadlineQueue;
+			bool		fThrottled;
 			bool		fReady;
 
 			Thread*		fThread;
@@ -130,6 +154,15 @@ private:
 			uint32		fLoadMeasurementEpoch;
 
 			CoreEntry*	fCore;
+
+			bigtime_t	fDeadlineRuntime;
+			bigtime_t	fDeadlineRelative;
+			bigtime_t	fDeadlinePeriod;
+			bigtime_t	fAbsoluteDeadline;
+			bigtime_t	fNextDeadlinePeriod;
+			bigtime_t	fRuntimeLeft;
+			int32		fDeadlineLoad;
+			CoreEntry*	fDeadlineCore;
 };
 
 class ThreadProcessing {
@@ -169,6 +202,77 @@ ThreadData::IsIdle() const
 }
 
 
+/*!	Returns whether the thread is a deadline thread that has not used up its
+	runtime in the current period yet. Such threads run before all others,
+	earliest deadline first.
+*/
+inline bool
+ThreadData::HasDeadlineBudget() const
+{
+	return fDeadlineCore != NULL && fRuntimeLeft > 0
+		&& fDeadlineCore->CPUCount() > 0;
+}
+
+
+inline void
+ThreadData::GetDeadlineParameters(bigtime_t& runtime, bigtime_t& deadline,
+	bigtime_t& period) const
+{
+	runtime = fDeadlineRuntime;
+	deadline = fDeadlineRelative;
+	period = fDeadlinePeriod;
+}
+
+
+/*!	Starts a new period for a deadline thread if the current one is over.
+	Must only be called while the thread is not in any run queue.
+*/
+inline void
+ThreadData::UpdateDeadline()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (fDeadlineCore == NULL)
+		return;
+
+	bigtime_t now = system_time();
+	if (now >= fNextDeadlinePeriod) {
+		// If the thread has been sleeping for longer than a whole period,
+		// start the new one now instead of at the end of the previous one.
+		bigtime_t periodStart = fNextDeadlinePeriod;
+		if (now - periodStart >= fDeadlinePeriod)
+			periodStart = now;
+
+		fNextDeadlinePeriod = periodStart + fDeadlinePeriod;
+		fAbsoluteDeadline = periodStart + fDeadlineRelative;
+		fRuntimeLeft = fDeadlineRuntime;
+	}
+
+	_ComputeEffectivePriority();
+}
+
+
+/*!	Starts the next period of a deadline thread that has been waiting in the
+	core run queue with its runtime used up, and moves it over to the
+	deadline queue. The core run queue lock must be held.
+*/
+inline void
+ThreadData::Replenish()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(fThrottled);
+	fCore->Remove(this);
+
+	UpdateDeadline();
+	ASSERT(HasDeadlineBudget());
+
+	fEnqueued = true;
+	fInDeadlineQueue = true;
+	fCore->PushDeadline(this);
+}
+
+
 inline bool
 ThreadData::HasCacheExpired() const
 {
@@ -177,6 +281,14 @@ ThreadData::HasCacheExpired() const
 }
 
 
+inline bool
+ThreadData::IsCacheHot(bigtime_t now) const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return now - std::max(fQuantumStart, fWentSleep) < kCacheHotTime;
+}
+
+
 inline CoreEntry*
 ThreadData::Rebalance() const
 {
@@ -292,6 +404,10 @@ ThreadData::GetQuantumLeft()
 	quantum += stolenTime;
 	quantum = std::max(quantum, gCurrentMode->minimal_quantum);
 
+	// deadline threads must not overrun their runtime
+	if (HasDeadlineBudget())
+		quantum = std::min(quantum, fRuntimeLeft);
+
 	return quantum;
 }
 
@@ -311,6 +427,19 @@ ThreadData::HasQuantumEnded(bool wasPreempted, bool hasYielded)
 
 	bigtime_t timeUsed = system_time() - fQuantumStart;
 	ASSERT(timeUsed >= 0);
+
+	if (HasDeadlineBudget()) {
+		fRuntimeLeft -= timeUsed;
+		if (fRuntimeLeft <= 0) {
+			// runtime exhausted, compete with the other threads using the
+			// static priority until the next period starts
+			fRuntimeLeft = 0;
+			_ComputeEffectivePriority();
+			return true;
+		}
+		return hasYielded || wasPreempted;
+	}
+
 	fTimeUsed += timeUsed;
 
 	bigtime_t timeLeft = ComputeQuantum() - fTimeUsed;
@@ -377,6 +506,8 @@ ThreadData::Dies()
 	if (gTrackCoreLoad)
 		fCore->RemoveLoad(fNeededLoad, true);
 	fReady = false;
+
+	ClearDeadline();
 }
 
 
@@ -401,7 +532,11 @@ ThreadData::PutBack()
 		ASSERT(!fEnqueued);
 		fEnqueued = true;
 
-		fCore->PushFront(this, priority);
+		fInDeadlineQueue = HasDeadlineBudget() && fCore == fDeadlineCore;
+		if (fInDeadlineQueue)
+			fCore->PushDeadline(this);
+		else
+			fCore->PushFront(this, priority);
 	}
 }
 
@@ -449,7 +584,11 @@ ThreadData::Enqueue(bool& wasRunQueueEmpty)
 		ThreadData* top = fCore->PeekThread();
 		wasRunQueueEmpty = (top == NULL || top->IsIdle());
 
-		fCore->PushBack(this, priority);
+		fInDeadlineQueue = HasDeadlineBudget() && fCore == fDeadlineCore;
+		if (fInDeadlineQueue)
+			fCore->PushDeadline(this);
+		else
+			fCore->PushBack(this, priority);
 	}
 }
 
@@ -475,7 +614,10 @@ ThreadData::Dequeue()
 	if (!fEnqueued)
 		return false;
 
-	fCore->Remove(this);
+	if (fInDeadlineQueue)
+		fCore->RemoveDeadline(this);
+	else
+		fCore->Remove(this);
 	ASSERT(!fEnqueued);
 	return true;
 }
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <util/AutoLock.h>
+
+#include "scheduler_common.h"
+#include "scheduler_cpu.h"
+#include "scheduler_modes.h"
+#include "scheduler_profiler.h"
+#include "scheduler_thread.h"
+
+
+using namespace Scheduler;
+
+
+// Server mode trades wake-up latency for throughput: threads keep their
+// core (and its warm caches) for much longer than in low latency mode and
+// are only migrated when the load imbalance is large.
+const bigtime_t kCacheExpire = 250000;
+
+
+static void
+switch_to_mode()
+{
+}
+
+
+static void
+set_cpu_enabled(int32 /* cpu */, bool /* enabled */)
+{
+}
+
+
+static bool
+has_cache_expired(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+	if (threadData->WentSleepActive() == 0)
+		return false;
+	CoreEntry* core = threadData->Core();
+	bigtime_t activeTime = core->GetActiveTime();
+	return activeTime - threadData->WentSleepActive() > kCacheExpire;
+}
+
+
+static CoreEntry*
+choose_core(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	int32 index = 0;
+	CPUSet mask = threadData->GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	CoreEntry* previous = threadData->Core();
+	if (previous != NULL
+		&& (!useMask || previous->CPUMask().Matches(mask))) {
+		// Even if its private caches went cold, the thread's previous core
+		// is still the best choice as long as it is not overloaded.
+		int32 threadLoad = threadData->GetLoad() / previous->CPUCount();
+		if (previous->GetLoad() + threadLoad < kHighLoad)
+			return previous;
+	}
+
+	CoreEntry* core = NULL;
+
+	// prefer an idle core sharing the last level cache with the previous one
+	PackageEntry* package = previous != NULL ? previous->Package() : NULL;
+	if (package != NULL) {
+		do {
+			core = package->GetIdleCore(index++);
+		} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+	}
+
+	if (core == NULL) {
+		// wake new package
+		package = gIdlePackageList.Last();
+		if (package == NULL)
+			package = PackageEntry::GetMostIdlePackage();
+
+		index = 0;
+		if (package != NULL) {
+			do {
+				core = package->GetIdleCore(index++);
+			} while (useMask && core != NULL
+				&& !core->CPUMask().Matches(mask));
+		}
+	}
+
+	if (core == NULL) {
+		ReadSpinLocker coreLocker(gCoreHeapsLock);
+		index = 0;
+		// no idle cores, use least occupied core
+		do {
+			core = gCoreLoadHeap.PeekMinimum(index++);
+		} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+		if (core == NULL) {
+			index = 0;
+			do {
+				core = gCoreHighLoadHeap.PeekMinimum(index++);
+			} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+		}
+	}
+
+	ASSERT(core != NULL);
+	return core;
+}
+
+
+static CoreEntry*
+rebalance(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* core = threadData->Core();
+	ASSERT(core != NULL);
+
+	// Leave the thread alone unless its core is actually busy, the cost of
+	// refilling the caches elsewhere is not worth it otherwise.
+	int32 coreLoad = core->GetLoad();
+	if (coreLoad < kHighLoad)
+		return core;
+
+	// Get the least loaded core.
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+	CPUSet mask = threadData->GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	int32 index = 0;
+	CoreEntry* other;
+	do {
+		other = gCoreLoadHeap.PeekMinimum(index++);
+	} while (useMask && other != NULL && !other->CPUMask().Matches(mask));
+
+	if (other == NULL) {
+		index = 0;
+		do {
+			other = gCoreHighLoadHeap.PeekMinimum(index++);
+		} while (useMask && other != NULL && !other->CPUMask().Matches(mask));
+	}
+	coreLocker.Unlock();
+	ASSERT(other != NULL);
+
+	// Require a much larger imbalance than low latency mode does before
+	// giving up the thread's cache affinity.
+	int32 otherLoad = other->GetLoad();
+	if (other == core || otherLoad + 2 * kLoadDifference >= coreLoad)
+		return core;
+
+	// Prefer staying within the package if that core is good enough.
+	if (other->Package() != core->Package()
+		&& otherLoad + 3 * kLoadDifference >= coreLoad) {
+		return core;
+	}
+
+	int32 difference = coreLoad - otherLoad - 2 * kLoadDifference;
+	ASSERT(difference > 0);
+
+	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
+	return difference >= threadLoad ? other : core;
+}
+
+
+static void
+rebalance_irqs(bool idle)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (idle)
+		return;
+
+	cpu_ent* cpu = get_cpu_struct();
+	CoreEntry* core = CoreEntry::GetCore(cpu->cpu_num);
+
+	// Only move interrupts away from cores that are busy running threads,
+	// so that interrupt handling does not steal their time slices.
+	if (core->GetLoad() < kHighLoad)
+		return;
+
+	SpinLocker locker(cpu->irqs_lock);
+
+	irq_assignment* chosen = NULL;
+	irq_assignment* irq = (irq_assignment*)list_get_first_item(&cpu->irqs);
+
+	while (irq != NULL) {
+		if (chosen == NULL || chosen->load < irq->load)
+			chosen = irq;
+		irq = (irq_assignment*)list_get_next_item(&cpu->irqs, irq);
+	}
+
+	locker.Unlock();
+
+	if (chosen == NULL || chosen->load < kLowLoad)
+		return;
+
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+	CoreEntry* other = gCoreLoadHeap.PeekMinimum();
+	coreLocker.Unlock();
+	if (other == NULL || other == core)
+		return;
+	if (other->GetLoad() + kLoadDifference >= core->GetLoad())
+		return;
+
+	int32 newCPU = other->CPUHeap()->PeekRoot()->ID();
+	assign_io_interrupt_to_cpu(chosen->irq, newCPU);
+}
+
+
+scheduler_mode_operations gSchedulerServerMode = {
+	"server",
+
+	5000,
+	500,
+	{ 2, 10 },
+
+	50000,
+
+	switch_to_mode,
+	set_cpu_enabled,
+	has_cache_expired,
+	choose_core,
+	rebalance,
+	rebalance_irqs,
+};
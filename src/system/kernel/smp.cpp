@@ -26,6 +26,7 @@
 #include <cpu.h>
 #include <generic_syscall.h>
 #include <interrupts.h>
+#include <lock_statistics.h>
 #include <spinlock_contention.h>
 #include <thread.h>
 #include <util/atomic.h>
@@ -214,6 +215,23 @@ update_lock_held(spinlock* lock)
 #endif // B_DEBUG_SPINLOCK_CONTENTION
 
 
+#if KERNEL_LOCK_STATISTICS
+
+
+static inline void
+update_lock_statistics(void* caller, bool contended, bigtime_t waitStart)
+{
+	if (waitStart == 0)
+		return;
+
+	lock_statistics_acquired((addr_t)caller, LOCK_STATISTICS_TYPE_SPINLOCK,
+		NULL, contended, contended ? system_time() - waitStart : 0);
+}
+
+
+#endif	// KERNEL_LOCK_STATISTICS
+
+
 int
 dump_ici_messages(int argc, char** argv)
 {
@@ -317,6 +335,11 @@ try_acquire_spinlock(spinlock* lock)
 	update_lock_contention(lock, system_time());
 #endif
 
+#if KERNEL_LOCK_STATISTICS
+	if (gLockStatisticsEnabled)
+		update_lock_statistics(arch_debug_get_caller(), false, system_time());
+#endif
+
 #if DEBUG_SPINLOCKS
 	push_lock_caller(arch_debug_get_caller(), lock);
 #endif
@@ -338,11 +361,18 @@ acquire_spinlock(spinlock* lock)
 	if (sNumCPUs > 1) {
 #if B_DEBUG_SPINLOCK_CONTENTION
 		const bigtime_t start = system_time();
+#endif
+#if KERNEL_LOCK_STATISTICS
+		const bigtime_t waitStart = gLockStatisticsEnabled ? system_time() : 0;
+		bool contended = false;
 #endif
 		int currentCPU = smp_get_current_cpu();
 		while (1) {
 			uint32 count = 0;
 			while (lock->lock != 0) {
+#if KERNEL_LOCK_STATISTICS
+				contended = true;
+#endif
 				if (++count == SPINLOCK_DEADLOCK_COUNT) {
 #if DEBUG_SPINLOCKS
 					panic("acquire_spinlock(): Failed to acquire spinlock %p "
@@ -361,12 +391,19 @@ acquire_spinlock(spinlock* lock)
 			}
 			if (atomic_get_and_set(&lock->lock, 1) == 0)
 				break;
+#if KERNEL_LOCK_STATISTICS
+			contended = true;
+#endif
 		}
 
 #if B_DEBUG_SPINLOCK_CONTENTION
 		update_lock_contention(lock, start);
 #endif
 
+#if KERNEL_LOCK_STATISTICS
+		update_lock_statistics(arch_debug_get_caller(), contended, waitStart);
+#endif
+
 #if DEBUG_SPINLOCKS
 		push_lock_caller(arch_debug_get_caller(), lock);
 #endif
@@ -3066,6 +3066,11 @@ thread_block_with_timeout(uint32 timeoutFlags, bigtime_t timeout)
 				timerFlags |= B_TIMER_REAL_TIME_BASE;
 		}
 
+		// Unless this is a real-time thread, the timeout doesn't need to be
+		// precise, and may be coalesced with other timers.
+		if (thread->priority < B_FIRST_REAL_TIME_PRIORITY)
+			timerFlags |= B_TIMER_ALLOW_SLACK;
+
 		// install the timer
 		thread->wait.unblock_timer.user_data = thread;
 		add_timer(&thread->wait.unblock_timer, &thread_block_timeout, timeout,
@@ -3632,6 +3637,26 @@ _user_set_thread_priority(thread_id thread, int32 newPriority)
 }
 
 
+status_t
+_user_set_thread_deadline(thread_id id, bigtime_t runtime, bigtime_t deadline,
+	bigtime_t period)
+{
+	// get the thread
+	Thread* thread = Thread::GetAndLock(id);
+	if (thread == NULL)
+		return B_BAD_THREAD_ID;
+	BReference<Thread> threadReference(thread, true);
+	ThreadLocker threadLocker(thread, true);
+
+	// check whether the change is allowed
+	if (thread_is_idle_thread(thread) || !thread_check_permissions(
+			thread_get_current_thread(), thread, false))
+		return B_NOT_ALLOWED;
+
+	return scheduler_set_thread_deadline(thread, runtime, deadline, period);
+}
+
+
 thread_id
 _user_spawn_thread(thread_creation_attributes* userAttributes)
 {
@@ -14,6 +14,8 @@
 
 #include <OS.h>
 
+#include <algorithm>
+
 #include <arch/timer.h>
 #include <boot/kernel_args.h>
 #include <cpu.h>
@@ -23,14 +25,52 @@
 #include <smp.h>
 #include <thread.h>
 #include <util/AutoLock.h>
+#include <util/BitUtils.h>
+
+
+/*!	Pending timers are kept in a hierarchical timing wheel per CPU, so that
+	adding and cancelling a timer does not depend on the number of pending
+	timers.
+
+	The wheel advances in ticks of 2^kWheelTickShift microseconds. Level 0
+	has a slot for each of the next kWheelSlotCount ticks, each higher level
+	a slot for kWheelSlotCount times the range of a lower level slot. When
+	the wheel reaches the start of a higher level slot, its timers are
+	cascaded into the lower levels. The timers of a level 0 slot are moved
+	into the sorted "events" list when the wheel reaches it; only that list
+	is used to fire timers, so they still expire with full precision.
+	Timers too far in the future for the top level wait in an overflow list,
+	which is redistributed once per top level rotation.
+*/
+
+static const uint32 kWheelTickShift = 10;
+static const uint32 kWheelLevelShift = 6;
+static const uint32 kWheelSlotCount = 1 << kWheelLevelShift;
+static const uint32 kWheelSlotMask = kWheelSlotCount - 1;
+static const uint32 kWheelLevelCount = 4;
 
+// timer slack, see apply_timer_slack()
+static const bigtime_t kMinTimerSlack = 64;
+static const bigtime_t kMaxTimerSlack = 4096;
+
+
+struct timer_wheel_level {
+	uint64			occupied;
+		// bitmap of the non-empty slots
+	timer*			slots[kWheelSlotCount];
+};
 
 struct per_cpu_timer_data {
 	spinlock		lock;
 	timer*			events;
+		// sorted list of the timers in the wheel ticks already passed
 	timer*			current_event;
 	int32			current_event_in_progress;
 	bigtime_t		real_time_offset;
+	uint64			wheel_tick;
+		// the next tick to be processed
+	timer_wheel_level wheel[kWheelLevelCount];
+	timer*			overflow;
 };
 
 static per_cpu_timer_data sPerCPU[SMP_MAX_CPUS];
@@ -67,6 +107,13 @@ set_hardware_timer(bigtime_t scheduleTime)
 }
 
 
+static inline uint64
+wheel_tick_for(bigtime_t time)
+{
+	return time > 0 ? (uint64)time >> kWheelTickShift : 0;
+}
+
+
 /*! NOTE: expects the list to be locked. */
 static void
 add_event_to_list(timer* event, timer** list)
@@ -87,24 +134,263 @@ add_event_to_list(timer* event, timer** list)
 }
 
 
+/*!	Removes the given event from the given list, if it is in there.
+	Returns whether it has been found.
+*/
+static bool
+remove_event_from_list(timer* event, timer** list)
+{
+	for (timer** it = list; *it != NULL; it = &(*it)->next) {
+		if (*it == event) {
+			*it = event->next;
+			event->next = NULL;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*!	Adds the event to the wheel, or to the sorted events list, if its tick
+	has already been processed.
+	NOTE: expects the CPU's timer data to be locked.
+*/
 static void
-per_cpu_real_time_clock_changed(void*, int cpu)
+add_event_to_wheel(per_cpu_timer_data& cpuData, timer* event)
 {
-	per_cpu_timer_data& cpuData = sPerCPU[cpu];
-	SpinLocker cpuDataLocker(cpuData.lock);
+	uint64 tick = wheel_tick_for(event->schedule_time);
+	if (tick < cpuData.wheel_tick) {
+		add_event_to_list(event, &cpuData.events);
+		return;
+	}
 
-	bigtime_t realTimeOffset = rtc_boot_time();
-	if (realTimeOffset == cpuData.real_time_offset)
+	uint64 delta = tick - cpuData.wheel_tick;
+	for (uint32 level = 0; level < kWheelLevelCount; level++) {
+		uint32 shift = level * kWheelLevelShift;
+		if ((delta >> shift) >= kWheelSlotCount)
+			continue;
+
+		uint32 slot = (tick >> shift) & kWheelSlotMask;
+		timer_wheel_level& wheelLevel = cpuData.wheel[level];
+		event->next = wheelLevel.slots[slot];
+		wheelLevel.slots[slot] = event;
+		wheelLevel.occupied |= (uint64)1 << slot;
 		return;
+	}
 
-	// The real time offset has changed. We need to update all affected
-	// timers. First find and dequeue them.
-	bigtime_t timeDiff = cpuData.real_time_offset - realTimeOffset;
-	cpuData.real_time_offset = realTimeOffset;
+	event->next = cpuData.overflow;
+	cpuData.overflow = event;
+}
 
-	timer* affectedTimers = NULL;
-	timer** it = &cpuData.events;
-	timer* firstEvent = *it;
+
+/*!	Removes the event from the wheel or the events list.
+	Returns whether it has been found.
+	NOTE: expects the CPU's timer data to be locked.
+*/
+static bool
+remove_event_from_wheel(per_cpu_timer_data& cpuData, timer* event)
+{
+	uint64 tick = wheel_tick_for(event->schedule_time);
+	if (tick < cpuData.wheel_tick)
+		return remove_event_from_list(event, &cpuData.events);
+
+	// The level the event is in depends on when it has been added, but the
+	// slot on each level is determined by its tick.
+	for (uint32 level = 0; level < kWheelLevelCount; level++) {
+		uint32 slot = (tick >> (level * kWheelLevelShift)) & kWheelSlotMask;
+		timer_wheel_level& wheelLevel = cpuData.wheel[level];
+		if ((wheelLevel.occupied & ((uint64)1 << slot)) == 0
+			|| !remove_event_from_list(event, &wheelLevel.slots[slot])) {
+			continue;
+		}
+
+		if (wheelLevel.slots[slot] == NULL)
+			wheelLevel.occupied &= ~((uint64)1 << slot);
+		return true;
+	}
+
+	return remove_event_from_list(event, &cpuData.overflow);
+}
+
+
+/*!	Returns the next tick at which the wheel has to do something, i.e.
+	move a level 0 slot to the events list or cascade a higher level slot.
+	Returns \c UINT64_MAX, if the wheel is empty.
+*/
+static uint64
+next_wheel_tick(const per_cpu_timer_data& cpuData)
+{
+	uint64 tick = cpuData.wheel_tick;
+	uint64 next = UINT64_MAX;
+
+	for (uint32 level = 0; level < kWheelLevelCount; level++) {
+		uint64 occupied = cpuData.wheel[level].occupied;
+		if (occupied == 0)
+			continue;
+
+		// A slot on this level is processed when the wheel reaches its start,
+		// so look for the first occupied one starting at the next boundary.
+		uint32 shift = level * kWheelLevelShift;
+		uint64 base = (tick + ((uint64)1 << shift) - 1) >> shift;
+		uint32 index = base & kWheelSlotMask;
+		if (index != 0)
+			occupied = (occupied >> index) | (occupied << (kWheelSlotCount - index));
+
+		next = std::min(next, (base + __builtin_ctzll(occupied)) << shift);
+	}
+
+	if (cpuData.overflow != NULL) {
+		uint32 shift = kWheelLevelCount * kWheelLevelShift;
+		next = std::min(next,
+			((tick + ((uint64)1 << shift) - 1) >> shift) << shift);
+	}
+
+	return next;
+}
+
+
+/*!	Processes all wheel ticks up to and including \a untilTick, moving the
+	timers expiring in them to the events list.
+	NOTE: expects the CPU's timer data to be locked.
+*/
+static void
+advance_wheel(per_cpu_timer_data& cpuData, uint64 untilTick)
+{
+	while (cpuData.wheel_tick <= untilTick) {
+		uint64 tick = next_wheel_tick(cpuData);
+		if (tick > untilTick) {
+			cpuData.wheel_tick = untilTick + 1;
+			return;
+		}
+
+		cpuData.wheel_tick = tick;
+
+		// redistribute the overflow list once per top level rotation
+		uint32 topShift = kWheelLevelCount * kWheelLevelShift;
+		if ((tick & (((uint64)1 << topShift) - 1)) == 0) {
+			timer* event = cpuData.overflow;
+			cpuData.overflow = NULL;
+			while (event != NULL) {
+				timer* next = event->next;
+				add_event_to_wheel(cpuData, event);
+				event = next;
+			}
+		}
+
+		// cascade the higher level slots starting at this tick
+		for (uint32 level = kWheelLevelCount - 1; level > 0; level--) {
+			uint32 shift = level * kWheelLevelShift;
+			if ((tick & (((uint64)1 << shift) - 1)) != 0)
+				continue;
+
+			uint32 slot = (tick >> shift) & kWheelSlotMask;
+			timer_wheel_level& wheelLevel = cpuData.wheel[level];
+			timer* event = wheelLevel.slots[slot];
+			wheelLevel.slots[slot] = NULL;
+			wheelLevel.occupied &= ~((uint64)1 << slot);
+
+			while (event != NULL) {
+				timer* next = event->next;
+				add_event_to_wheel(cpuData, event);
+				event = next;
+			}
+		}
+
+		// move the level 0 slot to the events list
+		uint32 slot = tick & kWheelSlotMask;
+		timer_wheel_level& wheelLevel = cpuData.wheel[0];
+		timer* event = wheelLevel.slots[slot];
+		wheelLevel.slots[slot] = NULL;
+		wheelLevel.occupied &= ~((uint64)1 << slot);
+
+		while (event != NULL) {
+			timer* next = event->next;
+			add_event_to_list(event, &cpuData.events);
+			event = next;
+		}
+
+		cpuData.wheel_tick = tick + 1;
+	}
+}
+
+
+/*!	Returns the time the hardware timer has to be set to, or
+	\c B_INFINITE_TIMEOUT, if no timers are pending.
+	NOTE: expects the CPU's timer data to be locked.
+*/
+static bigtime_t
+next_timer_deadline(const per_cpu_timer_data& cpuData)
+{
+	bigtime_t deadline = B_INFINITE_TIMEOUT;
+	if (cpuData.events != NULL)
+		deadline = cpuData.events->schedule_time;
+
+	uint64 tick = next_wheel_tick(cpuData);
+	if (tick == UINT64_MAX)
+		return deadline;
+
+	bigtime_t wheelDeadline = (bigtime_t)(tick << kWheelTickShift);
+
+	// If nothing is cascaded at that tick, we know the timers that will be
+	// due then, and don't need to wake up before the first one.
+	uint32 slot = tick & kWheelSlotMask;
+	if (slot != 0 && (cpuData.wheel[0].occupied & ((uint64)1 << slot)) != 0) {
+		wheelDeadline = B_INFINITE_TIMEOUT;
+		for (timer* event = cpuData.wheel[0].slots[slot]; event != NULL;
+				event = event->next) {
+			wheelDeadline = std::min(wheelDeadline,
+				(bigtime_t)event->schedule_time);
+		}
+	}
+
+	return std::min(deadline, wheelDeadline);
+}
+
+
+/*!	Sets the hardware timer to the CPU's next timer, or clears it, if no
+	timers are pending.
+	NOTE: expects the CPU's timer data to be locked, and to be called on that
+	CPU.
+*/
+static void
+update_hardware_timer(const per_cpu_timer_data& cpuData, bigtime_t now)
+{
+	bigtime_t deadline = next_timer_deadline(cpuData);
+	if (deadline == B_INFINITE_TIMEOUT)
+		arch_timer_clear_hardware_timer();
+	else
+		set_hardware_timer(deadline, now);
+}
+
+
+/*!	Allows the expiration of a one-shot timer to be delayed by a small
+	fraction of its timeout, by rounding it up to a multiple of a power of
+	two. Timers with similar timeouts thus expire at the same time and are
+	handled in a single timer interrupt.
+*/
+static bigtime_t
+apply_timer_slack(bigtime_t scheduleTime, bigtime_t now)
+{
+	bigtime_t slack = std::min((scheduleTime - now) / 32, kMaxTimerSlack);
+	if (slack < kMinTimerSlack)
+		return scheduleTime;
+
+	bigtime_t granularity = (bigtime_t)1 << log2((uint32)slack);
+	if (scheduleTime > B_INFINITE_TIMEOUT - granularity)
+		return scheduleTime;
+
+	return (scheduleTime + granularity - 1) & ~(granularity - 1);
+}
+
+
+/*!	Removes all absolute real-time timers from the given list, and prepends
+	them to \a affectedTimers.
+*/
+static void
+remove_real_time_events(timer** list, timer*& affectedTimers)
+{
+	timer** it = list;
 	while (timer* event = *it) {
 		// check whether it's an absolute real-time timer
 		uint32 flags = event->flags;
@@ -120,11 +406,44 @@ per_cpu_real_time_clock_changed(void*, int cpu)
 		event->next = affectedTimers;
 		affectedTimers = event;
 	}
+}
 
-	// update and requeue the affected timers
-	bool firstEventChanged = cpuData.events != firstEvent;
-	firstEvent = cpuData.events;
 
+static void
+per_cpu_real_time_clock_changed(void*, int cpu)
+{
+	per_cpu_timer_data& cpuData = sPerCPU[cpu];
+	SpinLocker cpuDataLocker(cpuData.lock);
+
+	bigtime_t realTimeOffset = rtc_boot_time();
+	if (realTimeOffset == cpuData.real_time_offset)
+		return;
+
+	// The real time offset has changed. We need to update all affected
+	// timers. First find and dequeue them.
+	bigtime_t timeDiff = cpuData.real_time_offset - realTimeOffset;
+	cpuData.real_time_offset = realTimeOffset;
+
+	timer* affectedTimers = NULL;
+	remove_real_time_events(&cpuData.events, affectedTimers);
+	remove_real_time_events(&cpuData.overflow, affectedTimers);
+
+	for (uint32 level = 0; level < kWheelLevelCount; level++) {
+		timer_wheel_level& wheelLevel = cpuData.wheel[level];
+		for (uint32 slot = 0; slot < kWheelSlotCount; slot++) {
+			if (wheelLevel.slots[slot] == NULL)
+				continue;
+
+			remove_real_time_events(&wheelLevel.slots[slot], affectedTimers);
+			if (wheelLevel.slots[slot] == NULL)
+				wheelLevel.occupied &= ~((uint64)1 << slot);
+		}
+	}
+
+	if (affectedTimers == NULL)
+		return;
+
+	// update and requeue the affected timers
 	while (affectedTimers != NULL) {
 		timer* event = affectedTimers;
 		affectedTimers = event->next;
@@ -141,58 +460,81 @@ per_cpu_real_time_clock_changed(void*, int cpu)
 				event->schedule_time = 0;
 		}
 
-		add_event_to_list(event, &cpuData.events);
+		add_event_to_wheel(cpuData, event);
 	}
 
-	firstEventChanged |= cpuData.events != firstEvent;
-
-	// If the first event has changed, reset the hardware timer.
-	if (firstEventChanged)
-		set_hardware_timer(cpuData.events->schedule_time);
+	update_hardware_timer(cpuData, system_time());
 }
 
 
 // #pragma mark - debugging
 
 
+static void
+dump_timer(timer* event)
+{
+	kprintf("  [%9lld] %p: ", (long long)event->schedule_time, event);
+	if ((event->flags & ~B_TIMER_FLAGS) == B_PERIODIC_TIMER)
+		kprintf("periodic %9lld, ", (long long)event->period);
+	else
+		kprintf("one shot,           ");
+
+	kprintf("flags: %#x, user data: %p, callback: %p  ",
+		event->flags, event->user_data, event->hook);
+
+	// look up and print the hook function symbol
+	const char* symbol;
+	const char* imageName;
+	bool exactMatch;
+
+	status_t error = elf_debug_lookup_symbol_address(
+		(addr_t)event->hook, NULL, &symbol, &imageName, &exactMatch);
+	if (error == B_OK && exactMatch) {
+		if (const char* slash = strchr(imageName, '/'))
+			imageName = slash + 1;
+
+		kprintf("   %s:%s", imageName, symbol);
+	}
+
+	kprintf("\n");
+}
+
+
 static int
 dump_timers(int argc, char** argv)
 {
 	int32 cpuCount = smp_get_num_cpus();
 	for (int32 i = 0; i < cpuCount; i++) {
-		kprintf("CPU %" B_PRId32 ":\n", i);
+		per_cpu_timer_data& cpuData = sPerCPU[i];
+		kprintf("CPU %" B_PRId32 ": wheel tick %" B_PRIu64 "\n", i,
+			cpuData.wheel_tick);
 
-		if (sPerCPU[i].events == NULL) {
+		bool empty = cpuData.events == NULL && cpuData.overflow == NULL;
+		for (uint32 level = 0; level < kWheelLevelCount; level++)
+			empty &= cpuData.wheel[level].occupied == 0;
+
+		if (empty) {
 			kprintf("  no timers scheduled\n");
 			continue;
 		}
 
-		for (timer* event = sPerCPU[i].events; event != NULL;
+		for (timer* event = cpuData.events; event != NULL;
 				event = event->next) {
-			kprintf("  [%9lld] %p: ", (long long)event->schedule_time, event);
-			if ((event->flags & ~B_TIMER_FLAGS) == B_PERIODIC_TIMER)
-				kprintf("periodic %9lld, ", (long long)event->period);
-			else
-				kprintf("one shot,           ");
-
-			kprintf("flags: %#x, user data: %p, callback: %p  ",
-				event->flags, event->user_data, event->hook);
-
-			// look up and print the hook function symbol
-			const char* symbol;
-			const char* imageName;
-			bool exactMatch;
-
-			status_t error = elf_debug_lookup_symbol_address(
-				(addr_t)event->hook, NULL, &symbol, &imageName, &exactMatch);
-			if (error == B_OK && exactMatch) {
-				if (const char* slash = strchr(imageName, '/'))
-					imageName = slash + 1;
-
-				kprintf("   %s:%s", imageName, symbol);
+			dump_timer(event);
+		}
+
+		for (uint32 level = 0; level < kWheelLevelCount; level++) {
+			for (uint32 slot = 0; slot < kWheelSlotCount; slot++) {
+				for (timer* event = cpuData.wheel[level].slots[slot];
+						event != NULL; event = event->next) {
+					dump_timer(event);
+				}
 			}
+		}
 
-			kprintf("\n");
+		for (timer* event = cpuData.overflow; event != NULL;
+				event = event->next) {
+			dump_timer(event);
 		}
 	}
 
@@ -251,6 +593,8 @@ timer_interrupt()
 	spinlock* spinlock = &cpuData.lock;
 	acquire_spinlock(spinlock);
 
+	advance_wheel(cpuData, wheel_tick_for(system_time()));
+
 	timer* event = cpuData.events;
 	while (event != NULL && ((bigtime_t)event->schedule_time < system_time())) {
 		// this event needs to happen
@@ -289,16 +633,20 @@ timer_interrupt()
 					- (now - event->schedule_time) % event->period;
 			}
 
-			add_event_to_list(event, &cpuData.events);
+			add_event_to_wheel(cpuData, event);
 		}
 
 		cpuData.current_event = NULL;
+
+		// a hook might have taken a while, so catch up with the wheel
+		advance_wheel(cpuData, wheel_tick_for(system_time()));
 		event = cpuData.events;
 	}
 
 	// setup the next hardware timer
-	if (cpuData.events != NULL)
-		set_hardware_timer(cpuData.events->schedule_time);
+	bigtime_t deadline = next_timer_deadline(cpuData);
+	if (deadline != B_INFINITE_TIMEOUT)
+		set_hardware_timer(deadline);
 
 	release_spinlock(spinlock);
 
@@ -346,11 +694,20 @@ add_timer(timer* event, timer_hook hook, bigtime_t period, int32 flags)
 			event->schedule_time = 0;
 	}
 
-	add_event_to_list(event, &cpuData.events);
+	if ((flags & B_TIMER_ALLOW_SLACK) != 0
+		&& (flags & ~B_TIMER_FLAGS) != B_PERIODIC_TIMER) {
+		event->schedule_time = apply_timer_slack(event->schedule_time,
+			currentTime);
+	}
+
+	bigtime_t previousDeadline = next_timer_deadline(cpuData);
+
+	advance_wheel(cpuData, wheel_tick_for(currentTime));
+	add_event_to_wheel(cpuData, event);
 	event->cpu = currentCPU;
 
-	// if we were stuck at the head of the list, set the hardware timer
-	if (event == cpuData.events)
+	// if we are the next timer to expire, set the hardware timer
+	if ((bigtime_t)event->schedule_time < previousDeadline)
 		set_hardware_timer(event->schedule_time, currentTime);
 
 	return B_OK;
@@ -384,42 +741,22 @@ cancel_timer(timer* event)
 
 	if (event != cpuData.current_event) {
 		// The timer hook is not yet being executed.
-		timer* current = cpuData.events;
-		timer* previous = NULL;
-
-		while (current != NULL) {
-			if (current == event) {
-				// we found it
-				if (previous == NULL)
-					cpuData.events = current->next;
-				else
-					previous->next = current->next;
-				current->next = NULL;
-				// break out of the whole thing
-				break;
-			}
-			previous = current;
-			current = current->next;
-		}
 
 		// If not found, we assume this was a one-shot timer and has already
 		// fired.
-		if (current == NULL)
+		if (!remove_event_from_wheel(cpuData, event))
 			return true;
 
 		// invalidate CPU field
 		event->cpu = 0xffff;
 
 		// If on the current CPU, also reset the hardware timer.
-		// FIXME: Theoretically we should be able to skip this if (previous == NULL).
-		// But it seems adding that causes problems on some systems, possibly due to
-		// some other bug. For now, just reset the hardware timer on every cancellation.
-		if (cpu == smp_get_current_cpu()) {
-			if (cpuData.events == NULL)
-				arch_timer_clear_hardware_timer();
-			else
-				set_hardware_timer(cpuData.events->schedule_time);
-		}
+		// FIXME: Theoretically we should be able to skip this if the event
+		// wasn't the next one to expire. But it seems adding that causes
+		// problems on some systems, possibly due to some other bug. For now,
+		// just reset the hardware timer on every cancellation.
+		if (cpu == smp_get_current_cpu())
+			update_hardware_timer(cpuData, system_time());
 
 		return false;
 	}
@@ -30,6 +30,7 @@
 
 #include <arch_config.h>
 #include <boot_device.h>
+#include <condition_variable.h>
 #include <disk_device_manager/KDiskDevice.h>
 #include <disk_device_manager/KDiskDeviceManager.h>
 #include <disk_device_manager/KDiskSystem.h>
@@ -42,6 +43,7 @@
 #include <heap.h>
 #include <kernel_daemon.h>
 #include <slab/Slab.h>
+#include <smp.h>
 #include <syscalls.h>
 #include <system_info.h>
 #include <thread.h>
@@ -84,6 +86,20 @@
 #define SWAP_BLOCK_SHIFT 5		/* 1 << SWAP_BLOCK_SHIFT == SWAP_BLOCK_PAGES */
 #define SWAP_BLOCK_MASK  (SWAP_BLOCK_PAGES - 1)
 
+// pages compressing to at most this size are kept in memory instead of being
+// written to the swap file
+#define COMPRESSED_SWAP_MAX_SIZE	(B_PAGE_SIZE * 3 / 4)
+#define COMPRESSED_SWAP_HASH_BITS	12
+
+// percentage of the compressed swap size limit above which the writer starts
+// to write back cold pages, and below which it stops again
+#define COMPRESSED_SWAP_HIGH_WATERMARK	90
+#define COMPRESSED_SWAP_LOW_WATERMARK	80
+
+// compressed_swap_entry::flags
+#define COMPRESSED_SWAP_WRITING		0x01
+#define COMPRESSED_SWAP_FREED		0x02
+
 
 static const char* const kDefaultSwapPath = "/var/swap";
 
@@ -141,8 +157,58 @@ struct SwapHashTableDefinition {
 	}
 };
 
+// A swap slot whose contents are kept compressed in memory. The slot itself
+// stays allocated in the swap file, so that the page can be written back at
+// any time.
+struct compressed_swap_entry
+	: DoublyLinkedListLinkImpl<compressed_swap_entry> {
+	compressed_swap_entry*	hash_link;
+	swap_addr_t				slot;
+	uint32					fill;	// pattern of a same-filled page
+	uint16					size;	// compressed size, 0 for same-filled pages
+	uint8					flags;
+	uint8					data[0];
+};
+
+struct CompressedSwapHashDefinition {
+	typedef swap_addr_t KeyType;
+	typedef compressed_swap_entry ValueType;
+
+	size_t HashKey(swap_addr_t key) const
+	{
+		return key;
+	}
+
+	size_t Hash(const compressed_swap_entry* value) const
+	{
+		return value->slot;
+	}
+
+	bool Compare(swap_addr_t key, const compressed_swap_entry* value) const
+	{
+		return value->slot == key;
+	}
+
+	compressed_swap_entry*& GetLink(compressed_swap_entry* value) const
+	{
+		return value->hash_link;
+	}
+};
+
 typedef BOpenHashTable<SwapHashTableDefinition> SwapHashTable;
 typedef DoublyLinkedList<swap_file> SwapFileList;
+typedef BOpenHashTable<CompressedSwapHashDefinition> CompressedSwapHashTable;
+typedef DoublyLinkedList<compressed_swap_entry> CompressedSwapList;
+
+// Scratch buffers for compressing and decompressing pages. There is one set
+// per CPU, so that pages can be (de)compressed concurrently; the lock is only
+// contended if a thread is preempted or migrated while using them.
+struct compressed_swap_buffers {
+	mutex					lock;
+	uint8*					page;
+	uint8*					data;
+	uint16*					match_table;
+};
 
 static SwapHashTable sSwapHashTable;
 static rw_lock sSwapHashLock;
@@ -157,6 +223,29 @@ static mutex sAvailSwapSpaceLock;
 
 static object_cache* sSwapBlockCache;
 
+static bool sCompressedSwapEnabled = false;
+static mutex sCompressedSwapLock;
+	// protects the hash table, the list, and the statistics
+static CompressedSwapHashTable sCompressedSwapHashTable;
+static CompressedSwapList sCompressedSwapList;
+	// coldest entries first
+static ConditionVariable sCompressedSwapWriteBackCondition;
+static sem_id sCompressedSwapWriterSem;
+static compressed_swap_buffers* sCompressedSwapBuffers;
+static uint8* sCompressedSwapWriteBackPage;
+	// only used by the writer thread
+
+static off_t sCompressedSwapLimit;
+static off_t sCompressedSwapSize;
+static uint32 sCompressedSwapPages;
+static uint32 sCompressedSwapSameFilledPages;
+static uint64 sCompressedSwapStored;
+static uint64 sCompressedSwapLoaded;
+static uint64 sCompressedSwapRejected;
+static uint64 sCompressedSwapLimitReached;
+static uint64 sCompressedSwapAllocationFailures;
+static uint64 sCompressedSwapWrittenBack;
+
 
 #if SWAP_TRACING
 namespace SwapTracing {
@@ -229,6 +318,452 @@ private:
 #endif
 
 
+// #pragma mark - compressed swap
+
+
+static inline uint32
+lz4_read32(const uint8* data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+static inline uint32
+lz4_hash(uint32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - COMPRESSED_SWAP_HASH_BITS);
+}
+
+
+static inline uint8*
+lz4_write_length(uint8* output, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*output++ = 255;
+	*output++ = (uint8)length;
+	return output;
+}
+
+
+static inline bool
+lz4_read_length(const uint8*& input, const uint8* inputEnd, size_t& length)
+{
+	uint8 byte;
+	do {
+		if (input == inputEnd)
+			return false;
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+
+/*!	Compresses \a inputSize bytes from \a input into the LZ4 block format.
+	\a matchTable must have room for 1 << COMPRESSED_SWAP_HASH_BITS entries.
+	Returns the compressed size, or 0 if it would exceed \a outputSize.
+*/
+static size_t
+lz4_compress(const uint8* input, size_t inputSize, uint8* output,
+	size_t outputSize, uint16* matchTable)
+{
+	const uint8* inputEnd = input + inputSize;
+	const uint8* anchor = input;
+	uint8* out = output;
+	uint8* outputEnd = output + outputSize;
+
+	memset(matchTable, 0, sizeof(uint16) << COMPRESSED_SWAP_HASH_BITS);
+
+	// The format requires the last match to start at least 12 bytes before
+	// the end of the input, and the last 5 bytes to be literals.
+	if (inputSize > 12) {
+		const uint8* matchStartLimit = inputEnd - 12;
+		const uint8* matchEndLimit = inputEnd - 5;
+		const uint8* current = input + 1;
+
+		while (current < matchStartLimit) {
+			uint32 sequence = lz4_read32(current);
+			uint32 hash = lz4_hash(sequence);
+			const uint8* match = input + matchTable[hash];
+			matchTable[hash] = current - input;
+
+			if (current - match > 0xffff || lz4_read32(match) != sequence) {
+				current++;
+				continue;
+			}
+
+			while (current > anchor && match > input
+				&& current[-1] == match[-1]) {
+				current--;
+				match--;
+			}
+
+			const uint8* matchEnd = current + 4;
+			const uint8* reference = match + 4;
+			while (matchEnd < matchEndLimit && *matchEnd == *reference) {
+				matchEnd++;
+				reference++;
+			}
+
+			size_t literalLength = current - anchor;
+			size_t matchLength = matchEnd - current - 4;
+			if ((size_t)(outputEnd - out) < literalLength + literalLength / 255
+					+ matchLength / 255 + 5) {
+				return 0;
+			}
+
+			uint8* token = out++;
+			*token = (min_c(literalLength, 15) << 4) | min_c(matchLength, 15);
+			if (literalLength >= 15)
+				out = lz4_write_length(out, literalLength - 15);
+			memcpy(out, anchor, literalLength);
+			out += literalLength;
+
+			uint16 offset = current - match;
+			*out++ = offset & 0xff;
+			*out++ = offset >> 8;
+			if (matchLength >= 15)
+				out = lz4_write_length(out, matchLength - 15);
+
+			current = anchor = matchEnd;
+		}
+	}
+
+	size_t literalLength = inputEnd - anchor;
+	if ((size_t)(outputEnd - out) < literalLength + literalLength / 255 + 2)
+		return 0;
+
+	*out++ = min_c(literalLength, 15) << 4;
+	if (literalLength >= 15)
+		out = lz4_write_length(out, literalLength - 15);
+	memcpy(out, anchor, literalLength);
+	out += literalLength;
+
+	return out - output;
+}
+
+
+/*!	Decompresses LZ4 block format data. Returns \c true only if the data was
+	well-formed and decompressed to exactly \a outputSize bytes.
+*/
+static bool
+lz4_decompress(const uint8* input, size_t inputSize, uint8* output,
+	size_t outputSize)
+{
+	const uint8* inputEnd = input + inputSize;
+	uint8* out = output;
+	uint8* outputEnd = output + outputSize;
+
+	while (input < inputEnd) {
+		uint8 token = *input++;
+
+		size_t length = token >> 4;
+		if (length == 15 && !lz4_read_length(input, inputEnd, length))
+			return false;
+		if (length > (size_t)(inputEnd - input)
+			|| length > (size_t)(outputEnd - out)) {
+			return false;
+		}
+
+		memcpy(out, input, length);
+		input += length;
+		out += length;
+
+		// the last sequence consists of literals only
+		if (input == inputEnd)
+			break;
+
+		if (inputEnd - input < 2)
+			return false;
+		size_t offset = input[0] | (input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(out - output))
+			return false;
+
+		length = token & 0xf;
+		if (length == 15 && !lz4_read_length(input, inputEnd, length))
+			return false;
+		length += 4;
+		if (length > (size_t)(outputEnd - out))
+			return false;
+
+		// the match may overlap the output, so copy byte-wise
+		const uint8* match = out - offset;
+		while (length-- > 0)
+			*out++ = *match++;
+	}
+
+	return out == outputEnd;
+}
+
+
+static inline size_t
+compressed_swap_entry_size(compressed_swap_entry* entry)
+{
+	return sizeof(compressed_swap_entry) + entry->size;
+}
+
+
+/*!	Removes the entry from the hash table and the statistics. It is the
+	caller's responsibility to remove it from the list as well.
+	The compressed swap lock must be held.
+*/
+static void
+compressed_swap_unhash(compressed_swap_entry* entry)
+{
+	sCompressedSwapHashTable.RemoveUnchecked(entry);
+	sCompressedSwapSize -= compressed_swap_entry_size(entry);
+	sCompressedSwapPages--;
+	if (entry->size == 0)
+		sCompressedSwapSameFilledPages--;
+}
+
+
+/*!	Removes the entry for the given swap slot, waiting for a write-back of it
+	to finish first. The caller has to free the returned entry.
+	The compressed swap lock must be held.
+*/
+static compressed_swap_entry*
+compressed_swap_remove(swap_addr_t slotIndex)
+{
+	while (true) {
+		compressed_swap_entry* entry
+			= sCompressedSwapHashTable.Lookup(slotIndex);
+		if (entry == NULL)
+			return NULL;
+
+		if ((entry->flags & COMPRESSED_SWAP_WRITING) != 0) {
+			sCompressedSwapWriteBackCondition.Wait(&sCompressedSwapLock);
+			continue;
+		}
+
+		sCompressedSwapList.Remove(entry);
+		compressed_swap_unhash(entry);
+		return entry;
+	}
+}
+
+
+/*!	Returns the current CPU's scratch buffers, locked. */
+static compressed_swap_buffers*
+compressed_swap_lock_buffers()
+{
+	compressed_swap_buffers* buffers
+		= &sCompressedSwapBuffers[smp_get_current_cpu()];
+	mutex_lock(&buffers->lock);
+	return buffers;
+}
+
+
+/*!	Tries to keep the page at \a address compressed in memory instead of
+	writing it to the swap slot \a slotIndex. A previously stored copy of the
+	slot is discarded in either case.
+	Returns \c true, if the page has been stored.
+*/
+static bool
+compressed_swap_store(swap_addr_t slotIndex, generic_addr_t address,
+	bool physical)
+{
+	if (!sCompressedSwapEnabled)
+		return false;
+
+	// Compress the page without holding the global lock
+	compressed_swap_buffers* buffers = compressed_swap_lock_buffers();
+
+	if (physical) {
+		vm_memcpy_from_physical(buffers->page, address, B_PAGE_SIZE, false);
+	} else
+		memcpy(buffers->page, (void*)address, B_PAGE_SIZE);
+
+	// same-filled (mostly zeroed) pages don't need to be compressed at all
+	const uint32* words = (const uint32*)buffers->page;
+	const uint32 fill = words[0];
+	uint32 i = 1;
+	while (i < B_PAGE_SIZE / sizeof(uint32) && words[i] == fill)
+		i++;
+	const bool sameFilled = i == B_PAGE_SIZE / sizeof(uint32);
+
+	size_t size = 0;
+	if (!sameFilled) {
+		size = lz4_compress(buffers->page, B_PAGE_SIZE, buffers->data,
+			COMPRESSED_SWAP_MAX_SIZE, buffers->match_table);
+	}
+
+	// checking the limit without the lock is good enough
+	const bool compressed = sameFilled || size != 0;
+	const bool overLimit = compressed
+		&& sCompressedSwapSize + sizeof(compressed_swap_entry) + size
+			> sCompressedSwapLimit;
+
+	compressed_swap_entry* entry = NULL;
+	if (compressed && !overLimit) {
+		entry = (compressed_swap_entry*)malloc_etc(
+			sizeof(compressed_swap_entry) + size,
+			HEAP_DONT_WAIT_FOR_MEMORY | HEAP_DONT_LOCK_KERNEL_SPACE);
+		if (entry != NULL) {
+			entry->slot = slotIndex;
+			entry->fill = fill;
+			entry->size = size;
+			entry->flags = 0;
+			memcpy(entry->data, buffers->data, size);
+		}
+	}
+
+	mutex_unlock(&buffers->lock);
+
+	MutexLocker locker(sCompressedSwapLock);
+
+	compressed_swap_entry* previous = compressed_swap_remove(slotIndex);
+
+	if (!compressed)
+		sCompressedSwapRejected++;
+	else if (overLimit)
+		sCompressedSwapLimitReached++;
+	else if (entry == NULL)
+		sCompressedSwapAllocationFailures++;
+
+	if (entry != NULL) {
+		sCompressedSwapHashTable.InsertUnchecked(entry);
+		sCompressedSwapList.Add(entry);
+		sCompressedSwapSize += compressed_swap_entry_size(entry);
+		sCompressedSwapPages++;
+		if (size == 0)
+			sCompressedSwapSameFilledPages++;
+		sCompressedSwapStored++;
+	}
+
+	bool startWriter = sCompressedSwapSize
+		> sCompressedSwapLimit / 100 * COMPRESSED_SWAP_HIGH_WATERMARK;
+	locker.Unlock();
+
+	if (startWriter)
+		release_sem_etc(sCompressedSwapWriterSem, 1, B_DO_NOT_RESCHEDULE);
+
+	free(previous);
+	return entry != NULL;
+}
+
+
+/*!	Decompresses the \a size bytes at \a data, or the same-filled page
+	described by \a fill if \a size is 0, into \a buffer, which must be
+	B_PAGE_SIZE bytes large.
+*/
+static void
+compressed_swap_decompress(const uint8* data, uint16 size, uint32 fill,
+	swap_addr_t slotIndex, uint8* buffer)
+{
+	if (size == 0) {
+		uint32* words = (uint32*)buffer;
+		for (uint32 i = 0; i < B_PAGE_SIZE / sizeof(uint32); i++)
+			words[i] = fill;
+		return;
+	}
+
+	if (!lz4_decompress(data, size, buffer, B_PAGE_SIZE)) {
+		panic("compressed swap: corrupt data for swap slot %" B_PRIu32 "\n",
+			slotIndex);
+	}
+}
+
+
+/*!	Reads the page stored for swap slot \a slotIndex, if any, into the given
+	buffer. Returns \c false, if the page has to be read from the swap file.
+*/
+static bool
+compressed_swap_load(swap_addr_t slotIndex, generic_addr_t address,
+	generic_size_t length, bool physical)
+{
+	if (!sCompressedSwapEnabled)
+		return false;
+
+	compressed_swap_buffers* buffers = compressed_swap_lock_buffers();
+	MutexLocker locker(sCompressedSwapLock);
+
+	compressed_swap_entry* entry = sCompressedSwapHashTable.Lookup(slotIndex);
+	if (entry == NULL) {
+		locker.Unlock();
+		mutex_unlock(&buffers->lock);
+		return false;
+	}
+
+	// Only copy the compressed data while holding the global lock, and
+	// decompress it afterwards.
+	const uint16 size = entry->size;
+	const uint32 fill = entry->fill;
+	memcpy(buffers->data, entry->data, size);
+
+	// The page is in memory again, so we only need the copy when the page
+	// is evicted unmodified -- that makes it a good write-back candidate.
+	if ((entry->flags & COMPRESSED_SWAP_WRITING) == 0) {
+		sCompressedSwapList.Remove(entry);
+		sCompressedSwapList.Add(entry, false);
+	}
+
+	sCompressedSwapLoaded++;
+	locker.Unlock();
+
+	compressed_swap_decompress(buffers->data, size, fill, slotIndex,
+		buffers->page);
+
+	length = min_c(length, B_PAGE_SIZE);
+	if (physical)
+		vm_memcpy_to_physical(address, buffers->page, length, false);
+	else
+		memcpy((void*)address, buffers->page, length);
+
+	mutex_unlock(&buffers->lock);
+	return true;
+}
+
+
+static bool
+compressed_swap_contains(swap_addr_t slotIndex)
+{
+	if (!sCompressedSwapEnabled)
+		return false;
+
+	MutexLocker locker(sCompressedSwapLock);
+	return sCompressedSwapHashTable.Lookup(slotIndex) != NULL;
+}
+
+
+/*!	Discards the page stored for the given swap slot, if any.
+	Returns \c true, if the page is currently being written back; the slot
+	must not be freed then, the writer will do that once it is done.
+*/
+static bool
+compressed_swap_free(swap_addr_t slotIndex)
+{
+	if (!sCompressedSwapEnabled)
+		return false;
+
+	MutexLocker locker(sCompressedSwapLock);
+
+	compressed_swap_entry* entry = sCompressedSwapHashTable.Lookup(slotIndex);
+	if (entry == NULL)
+		return false;
+
+	compressed_swap_unhash(entry);
+
+	if ((entry->flags & COMPRESSED_SWAP_WRITING) != 0) {
+		entry->flags |= COMPRESSED_SWAP_FREED;
+		return true;
+	}
+
+	sCompressedSwapList.Remove(entry);
+	locker.Unlock();
+
+	free(entry);
+	return false;
+}
+
+
+// #pragma mark -
+
+
 static int
 dump_swap_info(int argc, char** argv)
 {
@@ -256,6 +791,27 @@ dump_swap_info(int argc, char** argv)
 	kprintf("used:      %9" B_PRIu32 "\n", totalSwapPages - freeSwapPages);
 	kprintf("free:      %9" B_PRIu32 "\n", freeSwapPages);
 
+	if (!sCompressedSwapEnabled)
+		return 0;
+
+	kprintf("\n");
+	kprintf("compressed swap:\n");
+	kprintf("pages:        %9" B_PRIu32 " (%" B_PRIu32 " same-filled)\n",
+		sCompressedSwapPages, sCompressedSwapSameFilledPages);
+	kprintf("size:         %9" B_PRIdOFF " / %" B_PRIdOFF " bytes\n",
+		sCompressedSwapSize, sCompressedSwapLimit);
+	if (sCompressedSwapPages > 0) {
+		kprintf("ratio:        %9" B_PRIdOFF " %%\n",
+			sCompressedSwapSize * 100
+				/ ((off_t)sCompressedSwapPages * B_PAGE_SIZE));
+	}
+	kprintf("stored:       %9" B_PRIu64 "\n", sCompressedSwapStored);
+	kprintf("loaded:       %9" B_PRIu64 "\n", sCompressedSwapLoaded);
+	kprintf("written back: %9" B_PRIu64 "\n", sCompressedSwapWrittenBack);
+	kprintf("rejected:     %9" B_PRIu64 " incompressible, %" B_PRIu64
+		" over limit, %" B_PRIu64 " out of memory\n", sCompressedSwapRejected,
+		sCompressedSwapLimitReached, sCompressedSwapAllocationFailures);
+
 	return 0;
 }
 
@@ -330,9 +886,9 @@ find_swap_file(swap_addr_t slotIndex)
 
 
 static void
-swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
+free_swap_slots(swap_addr_t slotIndex, uint32 count)
 {
-	if (slotIndex == SWAP_SLOT_NONE)
+	if (count == 0)
 		return;
 
 	mutex_lock(&sSwapFileListLock);
@@ -343,6 +899,26 @@ swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 }
 
 
+static void
+swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
+{
+	if (slotIndex == SWAP_SLOT_NONE)
+		return;
+
+	// Slots that are just being written back by the compressed swap writer
+	// are freed by it once it is done.
+	uint32 first = 0;
+	for (uint32 i = 0; i < count; i++) {
+		if (compressed_swap_free(slotIndex + i)) {
+			free_swap_slots(slotIndex + first, i - first);
+			first = i + 1;
+		}
+	}
+
+	free_swap_slots(slotIndex + first, count - first);
+}
+
+
 static off_t
 swap_space_reserve(off_t amount)
 {
@@ -393,6 +969,167 @@ swap_hash_resizer(void*, int)
 }
 
 
+static void
+compressed_swap_hash_resizer(void*, int)
+{
+	MutexLocker locker(sCompressedSwapLock);
+
+	size_t size;
+	void* allocation;
+
+	do {
+		size = sCompressedSwapHashTable.ResizeNeeded();
+		if (size == 0)
+			return;
+
+		locker.Unlock();
+
+		allocation = malloc(size);
+		if (allocation == NULL)
+			return;
+
+		locker.Lock();
+
+	} while (!sCompressedSwapHashTable.Resize(allocation, size));
+}
+
+
+/*!	Writes the coldest compressed pages back to their swap slots whenever the
+	compressed swap store grows beyond its high watermark.
+*/
+static status_t
+compressed_swap_writer(void*)
+{
+	while (true) {
+		acquire_sem(sCompressedSwapWriterSem);
+
+		MutexLocker locker(sCompressedSwapLock);
+
+		while (sCompressedSwapSize
+				> sCompressedSwapLimit / 100 * COMPRESSED_SWAP_LOW_WATERMARK) {
+			compressed_swap_entry* entry = sCompressedSwapList.RemoveHead();
+			if (entry == NULL)
+				break;
+
+			// While it is being written, the entry can neither be replaced
+			// nor freed, so we can safely access it without the lock.
+			entry->flags |= COMPRESSED_SWAP_WRITING;
+			swap_addr_t slotIndex = entry->slot;
+			locker.Unlock();
+
+			compressed_swap_decompress(entry->data, entry->size, entry->fill,
+				slotIndex, sCompressedSwapWriteBackPage);
+
+			swap_file* swapFile = find_swap_file(slotIndex);
+			off_t pos = (off_t)(slotIndex - swapFile->first_slot)
+				* B_PAGE_SIZE;
+
+			generic_io_vec vector;
+			vector.base = (generic_addr_t)sCompressedSwapWriteBackPage;
+			vector.length = B_PAGE_SIZE;
+			generic_size_t length = B_PAGE_SIZE;
+			status_t status = vfs_write_pages(swapFile->vnode,
+				swapFile->cookie, pos, &vector, 1, 0, &length);
+			if (status == B_OK && length != B_PAGE_SIZE)
+				status = B_IO_ERROR;
+
+			locker.Lock();
+
+			entry->flags &= ~COMPRESSED_SWAP_WRITING;
+			bool freed = (entry->flags & COMPRESSED_SWAP_FREED) != 0;
+			if (!freed) {
+				if (status == B_OK) {
+					compressed_swap_unhash(entry);
+					sCompressedSwapWrittenBack++;
+				} else
+					sCompressedSwapList.Add(entry);
+			}
+
+			sCompressedSwapWriteBackCondition.NotifyAll();
+
+			if (freed || status == B_OK) {
+				locker.Unlock();
+
+				free(entry);
+				if (freed)
+					free_swap_slots(slotIndex, 1);
+
+				locker.Lock();
+			}
+
+			if (status != B_OK) {
+				dprintf("compressed swap: failed to write back swap slot %"
+					B_PRIu32 ": %s\n", slotIndex, strerror(status));
+				break;
+			}
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Puts a store of up to \a limit bytes in front of the swap files that
+	keeps pages compressed in memory, as long as they compress well.
+	Compressed pages keep the swap slot they were given, so that they can be
+	written back at any time. This means that the store only works with a
+	swap file, and that it saves swap file I/O, but does not extend the swap
+	space: the number of pages that can be swapped out is still limited by
+	the size of the swap files.
+*/
+static void
+compressed_swap_init(off_t limit)
+{
+	const int32 cpuCount = smp_get_num_cpus();
+	sCompressedSwapBuffers = new(std::nothrow) compressed_swap_buffers[
+		cpuCount];
+	sCompressedSwapWriteBackPage = (uint8*)malloc(B_PAGE_SIZE);
+	if (sCompressedSwapBuffers == NULL || sCompressedSwapWriteBackPage == NULL
+		|| sCompressedSwapHashTable.Init(INITIAL_SWAP_HASH_SIZE) != B_OK) {
+		dprintf("%s: not enough memory for compressed swap\n", __func__);
+		delete[] sCompressedSwapBuffers;
+		free(sCompressedSwapWriteBackPage);
+		return;
+	}
+
+	for (int32 i = 0; i < cpuCount; i++) {
+		compressed_swap_buffers& buffers = sCompressedSwapBuffers[i];
+		mutex_init(&buffers.lock, "compressed swap buffers");
+		buffers.page = (uint8*)malloc(B_PAGE_SIZE);
+		buffers.data = (uint8*)malloc(COMPRESSED_SWAP_MAX_SIZE);
+		buffers.match_table = (uint16*)malloc(
+			sizeof(uint16) << COMPRESSED_SWAP_HASH_BITS);
+		if (buffers.page == NULL || buffers.data == NULL
+			|| buffers.match_table == NULL) {
+			dprintf("%s: not enough memory for compressed swap\n", __func__);
+			return;
+		}
+	}
+
+	mutex_init(&sCompressedSwapLock, "compressed swap");
+	sCompressedSwapWriteBackCondition.Init(&sCompressedSwapList,
+		"compressed swap write back");
+
+	sCompressedSwapWriterSem = create_sem(0, "compressed swap writer");
+	thread_id thread = spawn_kernel_thread(&compressed_swap_writer,
+		"compressed swap writer", B_NORMAL_PRIORITY, NULL);
+	if (sCompressedSwapWriterSem < 0 || thread < 0) {
+		dprintf("%s: failed to start compressed swap writer\n", __func__);
+		return;
+	}
+
+	register_resource_resizer(compressed_swap_hash_resizer, NULL,
+		SWAP_HASH_RESIZE_INTERVAL);
+
+	sCompressedSwapLimit = limit;
+	sCompressedSwapEnabled = true;
+	resume_thread(thread);
+
+	dprintf("%s: up to %" B_PRIdOFF " bytes of swap are kept compressed in "
+		"memory\n", __func__, limit);
+}
+
+
 // #pragma mark -
 
 
@@ -778,13 +1515,22 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 	uint32 flags, generic_size_t* _numBytes)
 {
 	off_t pageIndex = offset >> PAGE_SHIFT;
+	const bool physical = (flags & B_PHYSICAL_IO_REQUEST) != 0;
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+		if (compressed_swap_load(startSlotIndex, vecs[i].base, vecs[i].length,
+				physical)) {
+			j = i + 1;
+			continue;
+		}
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
-			if (slotIndex != startSlotIndex + j - i)
+			if (slotIndex != startSlotIndex + j - i
+				|| compressed_swap_contains(slotIndex)) {
 				break;
+			}
 		}
 
 		T(ReadPage(this, pageIndex, startSlotIndex));
@@ -857,15 +1603,32 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 
 			swap_file* swapFile = find_swap_file(slotIndex);
 
-			off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+			// Only the pages that cannot be kept compressed in memory are
+			// written to the swap file.
+			status_t status = B_OK;
+			page_num_t first = 0;
+			for (page_num_t k = 0; k <= n && status == B_OK; k++) {
+				if (k < n && !compressed_swap_store(slotIndex + k,
+						vectorBase + k * B_PAGE_SIZE,
+						(flags & B_PHYSICAL_IO_REQUEST) != 0)) {
+					continue;
+				}
+
+				if (k > first) {
+					off_t pos = (off_t)(slotIndex + first
+						- swapFile->first_slot) * B_PAGE_SIZE;
 
-			generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
-			generic_io_vec vector[1];
-			vector->base = vectorBase;
-			vector->length = length;
+					generic_size_t length = (phys_addr_t)(k - first)
+						* B_PAGE_SIZE;
+					generic_io_vec vector[1];
+					vector->base = vectorBase + first * B_PAGE_SIZE;
+					vector->length = length;
 
-			status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
-				pos, vector, 1, flags, &length);
+					status = vfs_write_pages(swapFile->vnode,
+						swapFile->cookie, pos, vector, 1, flags, &length);
+				}
+				first = k + 1;
+			}
 			if (status != B_OK) {
 				locker.Lock();
 				fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
@@ -942,6 +1705,12 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 
 	T(WritePage(this, pageIndex, slotIndex));
 
+	if (compressed_swap_store(slotIndex, vecs[0].base,
+			(flags & B_PHYSICAL_IO_REQUEST) != 0)) {
+		callback->IOFinished(B_OK, false, numBytes);
+		return B_OK;
+	}
+
 	// write the page asynchrounously
 	swap_file* swapFile = find_swap_file(slotIndex);
 	off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
@@ -1605,9 +2374,19 @@ swap_init_post_modules()
 	dev_t swapDeviceID = -1;
 	VolumeInfo selectedVolume = {};
 
+	bool compressedSwapEnabled = true;
+	off_t compressedSwapSize = (off_t)vm_page_num_pages() * B_PAGE_SIZE / 5;
+
 	void* settings = load_driver_settings("virtual_memory");
 
 	if (settings != NULL) {
+		compressedSwapEnabled = get_driver_boolean_parameter(settings,
+			"compressed_swap", true, true);
+		const char* compressedSize = get_driver_parameter(settings,
+			"compressed_swap_size", NULL, NULL);
+		if (compressedSize != NULL)
+			compressedSwapSize = atoll(compressedSize);
+
 		// We pass a lot of information on the swap device, this is mostly to
 		// ensure that we are dealing with the same device that was configured.
 
@@ -1765,7 +2544,11 @@ swap_init_post_modules()
 	if (error != B_OK) {
 		dprintf("%s: Failed to add swap file %s: %s\n", __func__, swapPath,
 			strerror(error));
+		return;
 	}
+
+	if (compressedSwapEnabled && compressedSwapSize >= B_PAGE_SIZE)
+		compressed_swap_init(compressedSwapSize);
 }
 
 
@@ -644,6 +644,9 @@ VMCache::Init(const char* name, uint32 cacheType, uint32 allocationFlags)
 	fWiredPagesCount = 0;
 	fFaultCount = 0;
 	fCopiedPagesCount = 0;
+	fWorkingSetGeneration = 0;
+	fWorkingSetPages = 0;
+	fReferencedPages = 0;
 	type = cacheType;
 	fPageEventWaiters = NULL;
 
@@ -922,6 +925,49 @@ VMCache::MoveAllPages(VMCache* fromCache)
 }
 
 
+/*!	Notes that the page daemon found a page of this cache referenced during
+	the given page generation, or that one of its pages refaulted.
+	The cache must be locked.
+*/
+void
+VMCache::AccountReferencedPage(uint32 generation)
+{
+	_UpdateWorkingSet(generation);
+	fReferencedPages++;
+}
+
+
+/*!	Returns the estimated number of pages this cache needs to be resident to
+	avoid refaults, i.e. the number of its pages referenced per page daemon
+	generation, averaged over the recent generations.
+	The cache must be locked.
+*/
+uint32
+VMCache::WorkingSetPages(uint32 generation)
+{
+	_UpdateWorkingSet(generation);
+	return std::max(fWorkingSetPages, fReferencedPages);
+}
+
+
+/*!	Folds the references counted in the last generation the cache has seen
+	into the working set estimate and lets the estimate decay for every
+	generation without any references.
+*/
+void
+VMCache::_UpdateWorkingSet(uint32 generation)
+{
+	uint32 elapsed = generation - fWorkingSetGeneration;
+	if (elapsed == 0)
+		return;
+
+	fWorkingSetPages = (fWorkingSetPages + fReferencedPages) / 2;
+	fWorkingSetPages >>= std::min(elapsed - 1, (uint32)31);
+	fReferencedPages = 0;
+	fWorkingSetGeneration = generation;
+}
+
+
 /*!	Waits until one or more events happened for a given page which belongs to
 	this cache.
 	The cache must be locked. It will be unlocked by the method. \a relock
@@ -1468,6 +1514,9 @@ VMCache::Dump(bool showPages) const
 	kprintf("  virtual_base: 0x%" B_PRIx64 "\n", virtual_base);
 	kprintf("  virtual_end:  0x%" B_PRIx64 "\n", virtual_end);
 	kprintf("  temporary:    %" B_PRIu32 "\n", uint32(temporary));
+	kprintf("  working set:  %" B_PRIu32 " pages (referenced: %" B_PRIu32
+		", generation: %" B_PRIu32 ")\n", fWorkingSetPages, fReferencedPages,
+		fWorkingSetGeneration);
 	kprintf("  lock:         %p\n", &fLock);
 #if KDEBUG
 	kprintf("  lock.holder:  %" B_PRId32 "\n", fLock.holder);
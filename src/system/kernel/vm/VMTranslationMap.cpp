@@ -39,6 +39,50 @@ VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+/*!	Returns the size of the large pages the map can use for user areas, or
+	\c 0, if large pages are not supported.
+	The default implementation returns \c 0.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Maps a large page of LargePageSize() bytes.
+	Both \a virtualAddress and \a physicalAddress must be aligned to the large
+	page size, and nothing must be mapped in the range yet. The map must be
+	locked, and \a reservation must hold as many pages as
+	MaxPagesNeededToMap() requires for the range. The implementation may keep
+	a page table around, so that it can split the large page into regular
+	pages later without having to allocate memory.
+	Afterwards the mapping behaves like LargePageSize() / B_PAGE_SIZE regular
+	mappings; whenever a single one of its pages is unmapped, or changed, the
+	large page is split transparently.
+	The default implementation returns \c B_NOT_SUPPORTED.
+*/
+status_t
+VMTranslationMap::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+/*!	Returns the number of large pages mapped in the range from \a start to
+	(excluding) \a end.
+	The method may be invoked from a KDL command. The default implementation
+	returns \c 0.
+*/
+int32
+VMTranslationMap::CountLargePages(addr_t start, addr_t end)
+{
+	return 0;
+}
+
+
 /*!	Unmaps a range of pages of an area.
 
 	The default implementation just iterates over all virtual pages of the
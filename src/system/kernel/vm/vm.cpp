@@ -256,6 +256,22 @@ static off_t sNeededMemory;
 static uint32 sPageFaults;
 static VMPhysicalPageMapper* sPhysicalPageMapper;
 
+// transparent large pages for anonymous memory
+static const bigtime_t kLargePageBackoff = 1000000;
+	// time to fall back to regular pages after the physical memory turned
+	// out to be too fragmented
+static bool sLargePagesEnabled = true;
+static bigtime_t sLargePageBackoffUntil;
+static int64 sLargePagesMapped;
+static int64 sLargePageFallbacks;
+
+// fault-around for file mappings
+static const uint32 kMaxFaultAroundPages = 64;
+	// keeps the window within a single page table on all architectures
+static uint32 sFaultAroundPages = 16;
+static int64 sFaultAroundFaults;
+static int64 sFaultAroundPagesMapped;
+
 
 // function declarations
 static void delete_area(VMAddressSpace* addressSpace, VMArea* area,
@@ -4079,10 +4095,47 @@ vm_init_post_thread(kernel_args* args)
 status_t
 vm_init_post_modules(kernel_args* args)
 {
+	void* settings = load_driver_settings("virtual_memory");
+	if (settings != NULL) {
+		sLargePagesEnabled = get_driver_boolean_parameter(settings,
+			"transparent_large_pages", true, true);
+
+		const char* faultAround = get_driver_parameter(settings,
+			"fault_around_pages", NULL, NULL);
+		if (faultAround != NULL) {
+			// round down to a power of two, so that the window can be aligned
+			uint32 pages = std::min((uint32)strtoul(faultAround, NULL, 0),
+				kMaxFaultAroundPages);
+			sFaultAroundPages = 1;
+			while (sFaultAroundPages * 2 <= pages)
+				sFaultAroundPages *= 2;
+		}
+
+		unload_driver_settings(settings);
+	}
+
 	return arch_vm_init_post_modules(args);
 }
 
 
+void
+vm_get_large_page_stats(int64* _mapped, int64* _fallbacks)
+{
+	*_mapped = atomic_get64(&sLargePagesMapped);
+	*_fallbacks = atomic_get64(&sLargePageFallbacks);
+}
+
+
+void
+vm_get_fault_around_stats(uint32* _windowPages, int64* _faults,
+	int64* _pagesMapped)
+{
+	*_windowPages = sFaultAroundPages;
+	*_faults = atomic_get64(&sFaultAroundFaults);
+	*_pagesMapped = atomic_get64(&sFaultAroundPagesMapped);
+}
+
+
 void
 permit_page_faults()
 {
@@ -4309,6 +4362,7 @@ fault_get_page(PageFaultContext& context)
 			page = vm_page_allocate_page(&context.reservation,
 				PAGE_STATE_ACTIVE | VM_PAGE_ALLOC_BUSY);
 			cache->InsertPage(page, context.cacheOffset);
+			vm_page_check_refault(cache, page);
 
 			// We need to unlock all caches and the address space while reading
 			// the page in. Keep a reference to the cache around.
@@ -4406,6 +4460,218 @@ fault_get_page(PageFaultContext& context)
 }
 
 
+/*!	Tries to resolve the page fault by mapping a large page that covers
+	\a address. This is done for anonymous memory only, and only if the whole
+	large page range is part of the area and still untouched, i.e. none of its
+	pages exists in the cache or has been swapped out.
+	The address space and the area's top cache must be locked.
+	Returns \c true, if a large page has been mapped. Otherwise the caller
+	has to resolve the fault with a regular page.
+*/
+static bool
+try_map_large_page(PageFaultContext& context, VMArea* area, addr_t address,
+	uint32 protection)
+{
+	VMTranslationMap* map = context.map;
+	const size_t largePageSize = map->LargePageSize();
+	if (!sLargePagesEnabled || largePageSize == 0)
+		return false;
+
+	VMCache* cache = context.topCache;
+	if (area->wiring != B_NO_LOCK || area->page_protections != NULL
+		|| area->cache_type != CACHE_TYPE_RAM || !cache->temporary
+		|| cache->source != NULL
+		|| cache->committed_size < cache->virtual_end - cache->virtual_base) {
+		// Overcommitting caches commit their memory page by page, copy on
+		// write caches need to be able to map their source's pages.
+		return false;
+	}
+
+	const addr_t base = ROUNDDOWN(address, largePageSize);
+	if (base < area->Base()
+		|| base - area->Base() + largePageSize > area->Size()) {
+		return false;
+	}
+
+	if (system_time() < sLargePageBackoffUntil)
+		return false;
+
+	// the whole range must still be untouched
+	const off_t cacheOffset = base - area->Base() + area->cache_offset;
+	const page_num_t pageCount = largePageSize / B_PAGE_SIZE;
+
+	vm_page* page = cache->pages.FindClosest(cacheOffset / B_PAGE_SIZE, true,
+		true);
+	if (page != NULL
+		&& page->cache_offset < (page_num_t)(cacheOffset / B_PAGE_SIZE)
+			+ pageCount) {
+		return false;
+	}
+	for (page_num_t i = 0; i < pageCount; i++) {
+		if (cache->StoreHasPage(cacheOffset + i * B_PAGE_SIZE))
+			return false;
+	}
+
+	physical_address_restrictions restrictions = {};
+	restrictions.alignment = largePageSize;
+	vm_page* firstPage = vm_page_allocate_page_run(PAGE_STATE_ACTIVE
+			| VM_PAGE_ALLOC_CLEAR | VM_PAGE_ALLOC_DONT_WAIT, pageCount,
+		&restrictions, VM_PRIORITY_USER);
+	if (firstPage == NULL) {
+		// Physical memory is too fragmented (or short) -- don't bother trying
+		// again for a while.
+		sLargePageBackoffUntil = system_time() + kLargePageBackoff;
+		atomic_add64(&sLargePageFallbacks, 1);
+		return false;
+	}
+
+	// allocate the mapping objects upfront
+	VMAreaMappings mappings;
+	for (page_num_t i = 0; i < pageCount; i++) {
+		vm_page_mapping* mapping = allocate_page_mapping(
+			firstPage[i].physical_page_number, CACHE_DONT_WAIT_FOR_MEMORY);
+		if (mapping == NULL)
+			break;
+
+		mapping->page = &firstPage[i];
+		mapping->area = area;
+		mappings.Add(mapping);
+	}
+
+	status_t status = B_NO_MEMORY;
+	if (mappings.Count() == (int32)pageCount) {
+		for (page_num_t i = 0; i < pageCount; i++)
+			cache->InsertPage(&firstPage[i], cacheOffset + i * B_PAGE_SIZE);
+
+		map->Lock();
+
+		status = map->MapLargePage(base,
+			firstPage->physical_page_number * B_PAGE_SIZE, protection,
+			area->MemoryType(), &context.reservation);
+		if (status == B_OK) {
+			while (vm_page_mapping* mapping = mappings.RemoveHead()) {
+				mapping->page->mappings.Add(mapping);
+				area->mappings.Add(mapping);
+			}
+			atomic_add(&gMappedPagesCount, pageCount);
+		}
+
+		map->Unlock();
+
+		if (status != B_OK) {
+			for (page_num_t i = 0; i < pageCount; i++)
+				cache->RemovePage(&firstPage[i]);
+		}
+	}
+
+	if (status != B_OK) {
+		while (vm_page_mapping* mapping = mappings.RemoveHead()) {
+			vm_free_page_mapping(mapping->page->physical_page_number, mapping,
+				CACHE_DONT_WAIT_FOR_MEMORY);
+		}
+		for (page_num_t i = 0; i < pageCount; i++)
+			vm_page_free_etc(NULL, &firstPage[i], NULL);
+
+		atomic_add64(&sLargePageFallbacks, 1);
+		return false;
+	}
+
+	for (page_num_t i = 0; i < pageCount; i++)
+		DEBUG_PAGE_ACCESS_END(&firstPage[i]);
+
+	cache->IncrementFaultCount();
+	atomic_add64(&sLargePagesMapped, 1);
+	return true;
+}
+
+
+/*!	Maps the resident pages around \a address that live in the same file
+	cache as the page the fault at \a address has just been resolved with.
+	Accessing them later won't cause faults of their own then. Pages that are
+	busy or shadowed by a page of an upper cache, as well as addresses that
+	are already mapped, are skipped.
+	The window of sFaultAroundPages pages is aligned to its size, so that it
+	lies within the page table of the faulting address and mapping its pages
+	doesn't need any more pages than the fault itself.
+	The address space and all caches from the top cache to the page's cache
+	must be locked.
+*/
+static void
+fault_around(PageFaultContext& context, VMArea* area, addr_t address)
+{
+	VMCache* pageCache = context.page->Cache();
+	const size_t windowSize = (size_t)sFaultAroundPages * B_PAGE_SIZE;
+	if (windowSize <= B_PAGE_SIZE || pageCache->temporary
+		|| area->wiring != B_NO_LOCK) {
+		return;
+	}
+
+	const addr_t start = std::max(ROUNDDOWN(address, windowSize),
+		area->Base());
+	const addr_t last = std::min(ROUNDDOWN(address, windowSize)
+		+ (windowSize - 1), area->Base() + (area->Size() - 1));
+
+	const size_t pageCount = (last - start) / B_PAGE_SIZE + 1;
+
+	uint32 pagesMapped = 0;
+	for (size_t i = 0; i < pageCount; i++) {
+		const addr_t pageAddress = start + i * B_PAGE_SIZE;
+		if (pageAddress == address)
+			continue;
+
+		const off_t cacheOffset = pageAddress - area->Base()
+			+ area->cache_offset;
+
+		// a page in (or swapped out from) an upper cache shadows the file's
+		bool shadowed = false;
+		for (VMCache* cache = context.topCache; cache != pageCache;
+				cache = cache->source) {
+			if (cache->LookupPage(cacheOffset) != NULL
+				|| cache->StoreHasPage(cacheOffset)) {
+				shadowed = true;
+				break;
+			}
+		}
+		if (shadowed)
+			continue;
+
+		vm_page* page = pageCache->LookupPage(cacheOffset);
+		if (page == NULL || page->busy || vm_page_is_dummy(page))
+			continue;
+
+		uint32 protection = get_area_page_protection(area, pageAddress);
+		if ((protection & (B_READ_AREA | B_KERNEL_READ_AREA)) == 0)
+			continue;
+		if (pageCache != context.topCache)
+			protection &= ~(B_WRITE_AREA | B_KERNEL_WRITE_AREA);
+
+		context.map->Lock();
+		phys_addr_t physicalAddress;
+		uint32 flags;
+		bool mapped = context.map->Query(pageAddress, &physicalAddress,
+				&flags) == B_OK
+			&& (flags & PAGE_PRESENT) != 0;
+		context.map->Unlock();
+		if (mapped)
+			continue;
+
+		DEBUG_PAGE_ACCESS_START(page);
+		status_t status = map_page(area, page, pageAddress, protection,
+			&context.reservation);
+		DEBUG_PAGE_ACCESS_END(page);
+		if (status != B_OK)
+			break;
+
+		pagesMapped++;
+	}
+
+	if (pagesMapped > 0) {
+		atomic_add64(&sFaultAroundFaults, 1);
+		atomic_add64(&sFaultAroundPagesMapped, pagesMapped);
+	}
+}
+
+
 /*!	Makes sure the address in the given address space is mapped.
 
 	\param addressSpace The address space.
@@ -4526,6 +4792,13 @@ vm_soft_fault(VMAddressSpace* addressSpace, addr_t originalAddress,
 				break;
 		}
 
+		// Untouched anonymous memory might be mapped with a large page.
+		if (wirePage == NULL
+			&& try_map_large_page(context, area, address, protection)) {
+			status = B_OK;
+			break;
+		}
+
 		// The top most cache has no fault handler, so let's see if the cache or
 		// its sources already have the page we're searching for (we're going
 		// from top to bottom).
@@ -4652,6 +4925,10 @@ vm_soft_fault(VMAddressSpace* addressSpace, addr_t originalAddress,
 		} else if (context.page->State() == PAGE_STATE_INACTIVE)
 			vm_page_set_state(context.page, PAGE_STATE_ACTIVE);
 
+		// map the already resident neighbours of file pages, too
+		if (!isWrite && wirePage == NULL)
+			fault_around(context, area, address);
+
 		// also wire the page, if requested
 		if (wirePage != NULL && status == B_OK) {
 			increment_page_wired_count(context.page);
@@ -5120,6 +5397,82 @@ vm_memcpy_physical_page(phys_addr_t to, phys_addr_t from)
 }
 
 
+/*!	Replaces the memory at the page aligned userland \a address of the
+	current team with the given pages, instead of copying their contents.
+
+	The pages must not belong to a cache, and the caller must not access them
+	anymore, if the function succeeds: they are then owned by the cache of the
+	area. The range must lie within a single writable, unwired area backed by
+	a private anonymous cache that has its memory committed already, so that
+	its commitment covers the new pages. If that is not the case,
+	\c B_NOT_SUPPORTED is returned, and the caller has to copy the data.
+*/
+status_t
+vm_insert_user_pages(void* _address, vm_page** pages, page_num_t count)
+{
+	addr_t address = (addr_t)_address;
+	size_t size = count * B_PAGE_SIZE;
+	if ((address % B_PAGE_SIZE) != 0 || count == 0)
+		return B_BAD_VALUE;
+	if (!is_user_address_range(_address, size))
+		return B_BAD_ADDRESS;
+
+	AddressSpaceWriteLocker locker;
+	do {
+		status_t status = locker.SetTo(team_get_current_team_id());
+		if (status != B_OK)
+			return status;
+	} while (wait_if_address_range_is_wired(locker.AddressSpace(), address,
+			size, &locker));
+
+	VMArea* area = locker.AddressSpace()->LookupArea(address);
+	if (area == NULL || address - area->Base() + size > area->Size())
+		return B_NOT_SUPPORTED;
+	if (area->wiring != B_NO_LOCK || area->page_protections != NULL
+		|| (area->protection & B_WRITE_AREA) == 0
+		|| (area->protection & B_KERNEL_AREA) != 0) {
+		return B_NOT_SUPPORTED;
+	}
+
+	// As in discard_area_range(), nobody else may use the cache.
+	VMCache* cache = vm_area_get_locked_cache(area);
+	if (cache->areas.First() != area || VMArea::CacheList::GetNext(area) != NULL
+		|| !cache->consumers.IsEmpty() || cache->type != CACHE_TYPE_RAM
+		|| cache->CanOvercommit()) {
+		vm_area_put_locked_cache(cache);
+		return B_NOT_SUPPORTED;
+	}
+
+	VMCacheChainLocker cacheChainLocker(cache);
+	cacheChainLocker.LockAllSourceCaches();
+
+	unmap_pages(area, address, size);
+
+	// Since VMCache::Discard() can temporarily drop the lock, we must
+	// unlock all lower caches to prevent locking order inversion.
+	cacheChainLocker.Unlock(cache);
+
+	const off_t cacheOffset = area->cache_offset + (address - area->Base());
+	cache->Discard(cacheOffset, size);
+
+	// The pages are mapped on the next access. They hold data that exists
+	// nowhere else, so they must be written to swap before being reused.
+	for (page_num_t i = 0; i < count; i++) {
+		vm_page* page = pages[i];
+		DEBUG_PAGE_ACCESS_START(page);
+
+		cache->InsertPage(page, cacheOffset + i * B_PAGE_SIZE);
+		page->modified = true;
+		vm_page_set_state(page, PAGE_STATE_MODIFIED);
+
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	cache->ReleaseRefAndUnlock();
+	return B_OK;
+}
+
+
 /** Validate that a memory range is either fully in kernel space, or fully in
  *  userspace */
 static inline bool
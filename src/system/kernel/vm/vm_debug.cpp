@@ -481,6 +481,9 @@ dump_area_struct(VMArea* area, bool mappings)
 	kprintf("cache_offset:\t0x%" B_PRIx64 "\n", area->cache_offset);
 	kprintf("cache_next:\t%p\n", VMArea::CacheList::GetNext(area));
 	kprintf("cache_prev:\t%p\n", VMArea::CacheList::GetPrevious(area));
+	kprintf("large pages:\t%" B_PRId32 "\n",
+		area->address_space->TranslationMap()->CountLargePages(area->Base(),
+			area->Base() + area->Size()));
 
 	VMAreaMappings::Iterator iterator = area->mappings.GetIterator();
 	if (mappings) {
@@ -603,6 +606,21 @@ dump_available_memory(int argc, char** argv)
 {
 	kprintf("Available memory: %" B_PRIdOFF "/%" B_PRIuPHYSADDR " bytes\n",
 		vm_available_memory_debug(), (phys_addr_t)vm_page_num_pages() * B_PAGE_SIZE);
+
+	int64 largePagesMapped;
+	int64 largePageFallbacks;
+	vm_get_large_page_stats(&largePagesMapped, &largePageFallbacks);
+	kprintf("Large pages mapped: %" B_PRId64 ", fallbacks: %" B_PRId64 "\n",
+		largePagesMapped, largePageFallbacks);
+
+	uint32 faultAroundPages;
+	int64 faultAroundFaults;
+	int64 faultAroundPagesMapped;
+	vm_get_fault_around_stats(&faultAroundPages, &faultAroundFaults,
+		&faultAroundPagesMapped);
+	kprintf("Fault-around: window: %" B_PRIu32 " pages, faults: %" B_PRId64
+		", pages mapped ahead (faults avoided): %" B_PRId64 "\n",
+		faultAroundPages, faultAroundFaults, faultAroundPagesMapped);
 	return 0;
 }
 
@@ -23,6 +23,7 @@
 #include <block_cache.h>
 #include <boot/kernel_args.h>
 #include <condition_variable.h>
+#include <driver_settings.h>
 #include <elf.h>
 #include <heap.h>
 #include <kernel.h>
@@ -85,6 +86,15 @@ static uint32 sFreePagesTarget;
 static uint32 sFreeOrCachedPagesTarget;
 static uint32 sInactivePagesTarget;
 
+// Number of pre-cleared pages the page scrubber keeps in the clear queue.
+static uint32 sClearPagesTarget;
+static int32 sPageScrubberPoolFull;
+	// set while the page scrubber waits because the pool is full
+
+static int64 sClearPageHits;
+static int64 sClearPageMisses;
+static int64 sPagesScrubbed;
+
 // Wait interval between page daemon runs.
 static const bigtime_t kIdleScanWaitInterval = 1000000LL;	// 1 sec
 static const bigtime_t kBusyScanWaitInterval = 500000LL;	// 0.5 sec
@@ -100,6 +110,39 @@ static const int32 kPageUsageAdvance = 3;
 // vm_page::usage_count debuff an unaccessed page receives in a scan.
 static const int32 kPageUsageDecline = 1;
 
+// Page reclaim policies of the page daemon.
+enum {
+	PAGE_DAEMON_POLICY_USAGE_COUNT	= 0,
+		// pages age by their usage count (the classic policy)
+	PAGE_DAEMON_POLICY_GENERATIONAL	= 1
+		// pages age by the generation they were last referenced in
+};
+
+static int32 sPageDaemonPolicy = PAGE_DAEMON_POLICY_USAGE_COUNT;
+
+// Number of page generations the generational policy distinguishes. Pages not
+// referenced since the oldest one of them was the youngest are deactivated.
+static const uint32 kPageGenerations = 4;
+
+// The youngest page generation. The page daemon starts a new one whenever it
+// has scanned the complete active queue.
+static uint32 sPageGeneration;
+static uint32 sPagesScannedInGeneration;
+
+// Shadow entries of evicted file pages, used to detect refaults. Each entry
+// holds a tag derived from the page's cache and offset in its upper bits and
+// the generation of the eviction in its lowest byte. The table is lossy:
+// colliding evictions simply replace each other.
+static uint32* sPageShadows;
+static uint32 sPageShadowMask;
+static const uint32 kPageShadowGenerationMask = 0xff;
+static const uint32 kMaxPageShadows = 1024 * 1024;
+
+static int64 sPageShadowsRecorded;
+static int64 sPageRefaults;
+static int64 sPageRefaultsActivated;
+static int64 sPagesProtected;
+
 int32 gMappedPagesCount;
 
 static VMPageQueue sPageQueues[PAGE_STATE_FIRST_UNQUEUED];
@@ -1204,8 +1247,11 @@ dump_page_stats(int argc, char **argv)
 
 	kprintf("\nfree queue: %p, count = %" B_PRIuPHYSADDR "\n", &sFreePageQueue,
 		sFreePageQueue.Count());
-	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n", &sClearPageQueue,
-		sClearPageQueue.Count());
+	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR " (pool target: %"
+		B_PRIu32 ", scrubbed: %" B_PRId64 ", allocation hits: %" B_PRId64
+		", misses: %" B_PRId64 ")\n", &sClearPageQueue,
+		sClearPageQueue.Count(), sClearPagesTarget, sPagesScrubbed,
+		sClearPageHits, sClearPageMisses);
 	kprintf("modified queue: %p, count = %" B_PRIuPHYSADDR " (%" B_PRId32
 		" temporary, %" B_PRIuPHYSADDR " swappable, " "inactive: %"
 		B_PRIuPHYSADDR ")\n", &sModifiedPageQueue, sModifiedPageQueue.Count(),
@@ -1220,6 +1266,41 @@ dump_page_stats(int argc, char **argv)
 }
 
 
+static int
+dump_page_daemon(int argc, char** argv)
+{
+	if (argc > 2) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "usage_count") == 0)
+			sPageDaemonPolicy = PAGE_DAEMON_POLICY_USAGE_COUNT;
+		else if (strcmp(argv[1], "generational") == 0)
+			sPageDaemonPolicy = PAGE_DAEMON_POLICY_GENERATIONAL;
+		else {
+			print_debugger_command_usage(argv[0]);
+			return 0;
+		}
+	}
+
+	kprintf("page daemon policy: %s\n",
+		sPageDaemonPolicy == PAGE_DAEMON_POLICY_GENERATIONAL
+			? "generational" : "usage_count");
+	kprintf("page generation:    %" B_PRIu32 " (%" B_PRIu32 " of %"
+		B_PRIuPHYSADDR " active pages scanned)\n", sPageGeneration,
+		sPagesScannedInGeneration, sActivePageQueue.Count());
+	kprintf("shadow entries:     %" B_PRIu32 "\n",
+		sPageShadows != NULL ? sPageShadowMask + 1 : 0);
+	kprintf("evictions recorded: %" B_PRId64 "\n", sPageShadowsRecorded);
+	kprintf("refaults:           %" B_PRId64 " (%" B_PRId64 " activated)\n",
+		sPageRefaults, sPageRefaultsActivated);
+	kprintf("protected pages:    %" B_PRId64 "\n", sPagesProtected);
+	return 0;
+}
+
+
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 
 static caller_info*
@@ -1751,6 +1832,26 @@ clear_page(struct vm_page *page)
 }
 
 
+/*!	Clears the page for the clear page pool. Unlike clear_page(), which is used
+	when the page is about to be used, the page's contents are kept out of the
+	caches.
+*/
+static void
+scrub_page(struct vm_page *page)
+{
+	addr_t address;
+	void* handle;
+	if (vm_get_physical_page(page->physical_page_number * B_PAGE_SIZE,
+			&address, &handle) != B_OK) {
+		clear_page(page);
+		return;
+	}
+
+	arch_cpu_clear_page_nontemporal((void*)address);
+	vm_put_physical_page(address, handle);
+}
+
+
 static status_t
 mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 {
@@ -1820,9 +1921,9 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 
 /*!
 	This is a background thread that wakes up when its condition is notified
-	and moves some pages from the free queue over to the clear queue.
-	Given enough time, it will clear out all pages from the free queue - we
-	could probably slow it down after having reached a certain threshold.
+	and moves some pages from the free queue over to the clear queue, until
+	the latter contains sClearPagesTarget pages. Once the pool is full, it
+	waits until allocations have drained it to half of that.
 */
 static int32
 page_scrubber(void *unused)
@@ -1835,8 +1936,11 @@ page_scrubber(void *unused)
 	for (;;) {
 		while (sFreePageQueue.Count() == 0
 				|| atomic_get(&sUnreservedFreePages)
-					< (int32)sFreePagesTarget) {
+					< (int32)sFreePagesTarget
+				|| sClearPageQueue.Count() >= sClearPagesTarget) {
 			sFreePageCondition.Add(&entry);
+			if (sClearPageQueue.Count() >= sClearPagesTarget)
+				atomic_set(&sPageScrubberPoolFull, 1);
 			entry.Wait();
 		}
 
@@ -1845,7 +1949,9 @@ page_scrubber(void *unused)
 		// reservation warranty. The following is usually stricter than
 		// necessary, because we don't have information on how many of the
 		// reserved pages have already been allocated.
-		int32 reserved = reserve_some_pages(SCRUB_SIZE,
+		int32 reserved = reserve_some_pages(
+			std::min((uint32)SCRUB_SIZE,
+				(uint32)(sClearPagesTarget - sClearPageQueue.Count())),
 			kPageReserveForPriority[VM_PRIORITY_USER]);
 		if (reserved == 0)
 			continue;
@@ -1878,7 +1984,9 @@ page_scrubber(void *unused)
 
 		// clear them
 		for (int32 i = 0; i < scrubCount; i++)
-			clear_page(page[i]);
+			scrub_page(page[i]);
+
+		atomic_add64(&sPagesScrubbed, scrubCount);
 
 		locker.Lock();
 
@@ -2644,6 +2752,40 @@ find_cached_page_candidate(struct vm_page &marker)
 }
 
 
+static inline uint64
+page_shadow_hash(VMCache* cache, page_num_t cacheOffset)
+{
+	uint64 hash = (uint64)((addr_t)cache >> 4) * 0x9e3779b97f4a7c15ULL;
+	hash ^= (uint64)cacheOffset * 0xc2b2ae3d27d4eb4fULL;
+	return hash ^ (hash >> 29);
+}
+
+
+static inline uint32
+page_shadow_tag(uint64 hash)
+{
+	return (uint32)(hash >> 32) & ~kPageShadowGenerationMask;
+}
+
+
+/*!	Remembers that \a page of the non-temporary \a cache is about to be
+	evicted, so that vm_page_check_refault() can recognize it, should it be
+	read in again.
+	The cache must be locked.
+*/
+static void
+record_page_shadow(VMCache* cache, vm_page* page)
+{
+	if (sPageShadows == NULL || cache->temporary)
+		return;
+
+	uint64 hash = page_shadow_hash(cache, page->cache_offset);
+	atomic_set((int32*)&sPageShadows[hash & sPageShadowMask],
+		(int32)(page_shadow_tag(hash) | (uint8)sPageGeneration));
+	atomic_add64(&sPageShadowsRecorded, 1);
+}
+
+
 static bool
 free_cached_page(vm_page *page, bool dontWait)
 {
@@ -2666,6 +2808,7 @@ free_cached_page(vm_page *page, bool dontWait)
 
 	// we can now steal this page
 
+	record_page_shadow(cache, page);
 	cache->RemovePage(page);
 		// Now the page doesn't have cache anymore, so no one else (e.g.
 		// vm_page_allocate_page_run() can pick it up), since they would be
@@ -2712,10 +2855,59 @@ free_cached_pages(uint32 pagesToFree, bool dontWait)
 }
 
 
+static inline uint32
+page_generation_age(vm_page* page)
+{
+	return std::min((uint32)(uint8)((uint8)sPageGeneration - page->generation),
+		kPageGenerations - 1);
+}
+
+
+/*!	Updates the generation of \a page according to the accessed count the
+	page daemon just retrieved for it. A referenced page joins the youngest
+	generation and is accounted to the working set of its cache. The usage
+	count is kept in sync with the page's age, so that pages of the oldest
+	generation appear unused to code only looking at the former.
+	The page's cache must be locked.
+	\return \c true, if the page isn't part of the oldest generation.
+*/
+static bool
+update_page_generation(VMCache* cache, vm_page* page, int32 accessCount)
+{
+	if (accessCount > 0) {
+		page->generation = (uint8)sPageGeneration;
+		cache->AccountReferencedPage(sPageGeneration);
+	}
+
+	page->usage_count = kPageGenerations - 1 - page_generation_age(page);
+	return page->usage_count > 0;
+}
+
+
+/*!	Accounts \a pagesScanned pages of the active queue the page daemon has
+	just aged. Starts a new page generation once the equivalent of the whole
+	queue has been scanned, or right away, if \a force is \c true.
+	Must only be called by the page daemon.
+*/
+static void
+advance_page_generation(uint32 pagesScanned, bool force)
+{
+	sPagesScannedInGeneration += pagesScanned;
+	if (!force && sPagesScannedInGeneration < sActivePageQueue.Count())
+		return;
+
+	sPagesScannedInGeneration = 0;
+	sPageGeneration++;
+}
+
+
 static void
 idle_scan_active_pages(page_stats& pageStats)
 {
 	VMPageQueue& queue = sActivePageQueue;
+	const bool generational
+		= sPageDaemonPolicy == PAGE_DAEMON_POLICY_GENERATIONAL;
+	uint32 pagesScanned = 0;
 
 	// We want to scan the whole queue in roughly kIdleRunsForFullQueue runs.
 	uint32 maxToScan = queue.Count() / kIdleRunsForFullQueue + 1;
@@ -2751,6 +2943,8 @@ idle_scan_active_pages(page_stats& pageStats)
 
 		DEBUG_PAGE_ACCESS_START(page);
 
+		pagesScanned++;
+
 		// Get the page active/modified flags and update the page's usage count.
 		// We completely unmap inactive temporary pages. This saves us to
 		// iterate through the inactive list as well, since we'll be notified
@@ -2758,31 +2952,43 @@ idle_scan_active_pages(page_stats& pageStats)
 		// We don't remove the mappings of non-temporary pages, since we
 		// wouldn't notice when those would become unused and could thus be
 		// moved to the cached list.
+		// Under the generational policy a page counts as inactive once it
+		// belongs to the oldest generation.
+		bool inUse = generational
+			? page_generation_age(page) < kPageGenerations - 1
+			: page->usage_count > 0;
 		int32 usageCount;
-		if (page->WiredCount() > 0 || page->usage_count > 0 || !cache->temporary)
+		if (page->WiredCount() > 0 || inUse || !cache->temporary)
 			usageCount = vm_clear_page_mapping_accessed_flags(page);
 		else
 			usageCount = vm_remove_all_page_mappings_if_unaccessed(page);
 
-		if (usageCount > 0) {
-			usageCount += page->usage_count + kPageUsageAdvance;
-			if (usageCount > kPageUsageMax)
-				usageCount = kPageUsageMax;
-// TODO: This would probably also be the place to reclaim swap space.
-		} else {
-			usageCount += page->usage_count - (int32)kPageUsageDecline;
-			if (usageCount < 0) {
-				usageCount = 0;
+		if (generational) {
+			if (!update_page_generation(cache, page, usageCount))
 				set_page_state(page, PAGE_STATE_INACTIVE);
+		} else {
+			if (usageCount > 0) {
+				usageCount += page->usage_count + kPageUsageAdvance;
+				if (usageCount > kPageUsageMax)
+					usageCount = kPageUsageMax;
+// TODO: This would probably also be the place to reclaim swap space.
+			} else {
+				usageCount += page->usage_count - (int32)kPageUsageDecline;
+				if (usageCount < 0) {
+					usageCount = 0;
+					set_page_state(page, PAGE_STATE_INACTIVE);
+				}
 			}
-		}
 
-		page->usage_count = usageCount;
+			page->usage_count = usageCount;
+		}
 
 		DEBUG_PAGE_ACCESS_END(page);
 
 		cache->ReleaseRefAndUnlock();
 	}
+
+	advance_page_generation(pagesScanned, false);
 }
 
 
@@ -2800,6 +3006,15 @@ full_scan_inactive_pages(page_stats& pageStats, int32 despairLevel)
 	uint32 pagesToCached = 0;
 	uint32 pagesToModified = 0;
 	uint32 pagesToActive = 0;
+	uint32 pagesProtected = 0;
+
+	// Under the generational policy pages of caches that don't have more
+	// pages than their estimated working set are spared, as long as no one
+	// is actually waiting for memory.
+	const bool generational
+		= sPageDaemonPolicy == PAGE_DAEMON_POLICY_GENERATIONAL;
+	const bool protectWorkingSets = generational
+		&& pageStats.unsatisfiedReservations == 0;
 
 	// Determine how many pages at maximum to send to the modified queue. Since
 	// it is relatively expensive to page out pages, we do that on a grander
@@ -2856,17 +3071,27 @@ full_scan_inactive_pages(page_stats& pageStats, int32 despairLevel)
 			usageCount = vm_remove_all_page_mappings_if_unaccessed(page);
 
 		// update usage count
-		if (usageCount > 0) {
-			usageCount += page->usage_count + kPageUsageAdvance;
-			if (usageCount > kPageUsageMax)
-				usageCount = kPageUsageMax;
+		if (generational) {
+			// Pages only get here after having aged out, so unless they have
+			// been referenced again in the meantime, they are up for eviction.
+			if (usageCount > 0)
+				update_page_generation(cache, page, usageCount);
+			else
+				page->usage_count = 0;
+			usageCount = page->usage_count;
 		} else {
-			usageCount += page->usage_count - (int32)kPageUsageDecline;
-			if (usageCount < 0)
-				usageCount = 0;
-		}
+			if (usageCount > 0) {
+				usageCount += page->usage_count + kPageUsageAdvance;
+				if (usageCount > kPageUsageMax)
+					usageCount = kPageUsageMax;
+			} else {
+				usageCount += page->usage_count - (int32)kPageUsageDecline;
+				if (usageCount < 0)
+					usageCount = 0;
+			}
 
-		page->usage_count = usageCount;
+			page->usage_count = usageCount;
+		}
 
 		// Move to fitting queue or requeue:
 		// * Active mapped pages go to the active queue.
@@ -2885,6 +3110,11 @@ full_scan_inactive_pages(page_stats& pageStats, int32 despairLevel)
 				vm_page_requeue(page, true);
 		} else if (isMapped) {
 			vm_page_requeue(page, true);
+		} else if (protectWorkingSets
+			&& cache->page_count <= cache->WorkingSetPages(sPageGeneration)) {
+			// evicting the page would most likely only cause a refault
+			vm_page_requeue(page, true);
+			pagesProtected++;
 		} else if (!page->modified) {
 			set_page_state(page, PAGE_STATE_CACHED);
 			pagesToFree--;
@@ -2908,11 +3138,14 @@ full_scan_inactive_pages(page_stats& pageStats, int32 despairLevel)
 
 	queueLocker.Unlock();
 
+	if (pagesProtected > 0)
+		atomic_add64(&sPagesProtected, pagesProtected);
+
 	time = system_time() - time;
 	TRACE_DAEMON("  -> inactive scan (%7" B_PRId64 " us): scanned: %7" B_PRIu32
 		", moved: %" B_PRIu32 " -> cached, %" B_PRIu32 " -> modified, %"
-		B_PRIu32 " -> active\n", time, pagesScanned, pagesToCached,
-		pagesToModified, pagesToActive);
+		B_PRIu32 " -> active, protected: %" B_PRIu32 "\n", time, pagesScanned,
+		pagesToCached, pagesToModified, pagesToActive, pagesProtected);
 
 	// wake up the page writer, if we tossed it some pages
 	if (pagesToModified > 0)
@@ -2941,6 +3174,8 @@ full_scan_active_pages(page_stats& pageStats, int32 despairLevel)
 	uint32 pagesAccessed = 0;
 	uint32 pagesToInactive = 0;
 	uint32 pagesScanned = 0;
+	const bool generational
+		= sPageDaemonPolicy == PAGE_DAEMON_POLICY_GENERATIONAL;
 
 	vm_page* nextPage = queue.Head();
 
@@ -2978,22 +3213,32 @@ full_scan_active_pages(page_stats& pageStats, int32 despairLevel)
 		// Get the page active/modified flags and update the page's usage count.
 		int32 usageCount = vm_clear_page_mapping_accessed_flags(page);
 
-		if (usageCount > 0) {
-			usageCount += page->usage_count + kPageUsageAdvance;
-			if (usageCount > kPageUsageMax)
-				usageCount = kPageUsageMax;
-			pagesAccessed++;
-// TODO: This would probably also be the place to reclaim swap space.
-		} else {
-			usageCount += page->usage_count - (int32)kPageUsageDecline;
-			if (usageCount <= 0) {
-				usageCount = 0;
+		if (generational) {
+			if (usageCount > 0)
+				pagesAccessed++;
+			if (!update_page_generation(cache, page, usageCount)) {
 				set_page_state(page, PAGE_STATE_INACTIVE);
 				pagesToInactive++;
+				pagesToDeactivate--;
+			}
+		} else {
+			if (usageCount > 0) {
+				usageCount += page->usage_count + kPageUsageAdvance;
+				if (usageCount > kPageUsageMax)
+					usageCount = kPageUsageMax;
+				pagesAccessed++;
+// TODO: This would probably also be the place to reclaim swap space.
+			} else {
+				usageCount += page->usage_count - (int32)kPageUsageDecline;
+				if (usageCount <= 0) {
+					usageCount = 0;
+					set_page_state(page, PAGE_STATE_INACTIVE);
+					pagesToInactive++;
+				}
 			}
-		}
 
-		page->usage_count = usageCount;
+			page->usage_count = usageCount;
+		}
 
 		DEBUG_PAGE_ACCESS_END(page);
 
@@ -3005,6 +3250,13 @@ full_scan_active_pages(page_stats& pageStats, int32 despairLevel)
 		queue.Remove(&marker);
 	}
 
+	queueLocker.Unlock();
+
+	// If the oldest generation didn't yield enough pages to deactivate, start
+	// a new generation, so that the next scan will find more of them.
+	advance_page_generation(pagesScanned,
+		generational && pagesToDeactivate > 0);
+
 	time = system_time() - time;
 	TRACE_DAEMON("  ->   active scan (%7" B_PRId64 " us): scanned: %7" B_PRIu32
 		", moved: %" B_PRIu32 " -> inactive, encountered %" B_PRIu32 " accessed"
@@ -3506,6 +3758,14 @@ vm_page_init_post_area(kernel_args *args)
 		"search all known address spaces for mappings to that page and print\n"
 		"them.\n", 0);
 	add_debugger_command("page_queue", &dump_page_queue, "Dump page queue");
+	add_debugger_command_etc("page_daemon", &dump_page_daemon,
+		"Dump page daemon statistics or select its reclaim policy",
+		"[ \"usage_count\" | \"generational\" ]\n"
+		"Prints the page daemon's reclaim policy, the current page generation\n"
+		"and the refault statistics. If a policy is given, the page daemon\n"
+		"switches to it. \"usage_count\" ages pages by their usage counts,\n"
+		"\"generational\" by the generation they were last referenced in and\n"
+		"protects the estimated working sets of caches from eviction.\n", 0);
 	add_debugger_command("find_page", &find_page,
 		"Find out which queue a page is actually in");
 
@@ -3552,6 +3812,24 @@ vm_page_init_post_thread(kernel_args *args)
 {
 	new (&sFreePageCondition) ConditionVariable;
 
+	// By default keep 1/16 of the memory pre-cleared.
+	sClearPagesTarget = sNumPages / 16;
+
+	void* settings = load_driver_settings("virtual_memory");
+	if (settings != NULL) {
+		const char* poolSize = get_driver_parameter(settings,
+			"clear_page_pool_size", NULL, NULL);
+		if (poolSize != NULL)
+			sClearPagesTarget = atoll(poolSize) / B_PAGE_SIZE;
+
+		const char* policy = get_driver_parameter(settings,
+			"page_daemon_policy", NULL, NULL);
+		if (policy != NULL && strcmp(policy, "generational") == 0)
+			sPageDaemonPolicy = PAGE_DAEMON_POLICY_GENERATIONAL;
+
+		unload_driver_settings(settings);
+	}
+
 	// create a kernel thread to clear out pages
 
 	thread_id thread = spawn_kernel_thread(&page_scrubber, "page scrubber",
@@ -3566,6 +3844,18 @@ vm_page_init_post_thread(kernel_args *args)
 		B_NORMAL_PRIORITY + 1, NULL);
 	resume_thread(thread);
 
+	// set up refault detection
+
+	uint32 shadowCount = 1024;
+	while (shadowCount < sNumPages / 4 && shadowCount < kMaxPageShadows)
+		shadowCount <<= 1;
+
+	sPageShadows = (uint32*)malloc(shadowCount * sizeof(uint32));
+	if (sPageShadows != NULL) {
+		memset(sPageShadows, 0, shadowCount * sizeof(uint32));
+		sPageShadowMask = shadowCount - 1;
+	}
+
 	// start page daemon
 
 	sPageDaemonCondition.Init("page daemon");
@@ -3711,6 +4001,7 @@ vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
 	page->SetState(pageState);
 	page->busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
 	page->usage_count = 0;
+	page->generation = (uint8)sPageGeneration;
 	page->accessed = false;
 	page->modified = false;
 
@@ -3721,8 +4012,22 @@ vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
 
 	// clear the page, if we had to take it from the free queue and a clear
 	// page was requested
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0 && oldPageState != PAGE_STATE_CLEAR)
-		clear_page(page);
+	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
+		if (oldPageState != PAGE_STATE_CLEAR) {
+			clear_page(page);
+			atomic_add64(&sClearPageMisses, 1);
+		} else
+			atomic_add64(&sClearPageHits, 1);
+	}
+
+	// wake up the page scrubber, if the clear page pool has been drained
+	// sufficiently
+	if (oldPageState == PAGE_STATE_CLEAR
+		&& sClearPageQueue.Count() < sClearPagesTarget / 2
+		&& atomic_get(&sPageScrubberPoolFull) != 0
+		&& atomic_test_and_set(&sPageScrubberPoolFull, 0, 1) == 1) {
+		sFreePageCondition.NotifyAll();
+	}
 
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 	page->allocation_tracking_info.Init(
@@ -3829,6 +4134,7 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 			page.SetState(flags & VM_PAGE_ALLOC_STATE);
 			page.busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
 			page.usage_count = 0;
+			page.generation = (uint8)sPageGeneration;
 			page.accessed = false;
 			page.modified = false;
 		}
@@ -3872,6 +4178,7 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 			page.SetState(flags & VM_PAGE_ALLOC_STATE);
 			page.busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
 			page.usage_count = 0;
+			page.generation = (uint8)sPageGeneration;
 			page.accessed = false;
 			page.modified = false;
 
@@ -3928,7 +4235,9 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 	\param flags Page allocation flags. Encodes the state the function shall
 		set the allocated pages to, whether the pages shall be marked busy
 		(VM_PAGE_ALLOC_BUSY), and whether the pages shall be cleared
-		(VM_PAGE_ALLOC_CLEAR).
+		(VM_PAGE_ALLOC_CLEAR). With VM_PAGE_ALLOC_DONT_WAIT, the function
+		fails instead of waiting for pages to become available, and only
+		considers free pages, but no cached ones.
 	\param length The number of contiguous pages to allocate.
 	\param restrictions Restrictions to the physical addresses of the page run
 		to allocate, including \c low_address, the first acceptable physical
@@ -3980,8 +4289,14 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		boundaryMask = -boundary;
 	}
 
+	const bool dontWait = (flags & VM_PAGE_ALLOC_DONT_WAIT) != 0;
+
 	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, length, priority);
+	if (dontWait) {
+		if (!vm_page_try_reserve_pages(&reservation, length, priority))
+			return NULL;
+	} else
+		vm_page_reserve_pages(&reservation, length, priority);
 
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
 
@@ -3991,6 +4306,8 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	// the first iteration in this case.
 	int32 freePages = sUnreservedFreePages;
 	bool useCached = (freePages > 0) && ((page_num_t)freePages > (length * 2));
+	if (dontWait)
+		useCached = false;
 
 	for (;;) {
 		if (alignmentMask != 0 || boundaryMask != 0) {
@@ -4010,7 +4327,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		}
 
 		if (start + length > end) {
-			if (!useCached) {
+			if (!useCached && !dontWait) {
 				// The first iteration with free pages only was unsuccessful.
 				// Try again also considering cached pages.
 				useCached = true;
@@ -4018,11 +4335,14 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				continue;
 			}
 
-			dprintf("vm_page_allocate_page_run(): Failed to allocate run of "
-				"length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
-				B_PRIuPHYSADDR ") in second iteration (align: %" B_PRIuPHYSADDR
-				" boundary: %" B_PRIuPHYSADDR ")!\n", length, requestedStart,
-				end, restrictions->alignment, restrictions->boundary);
+			if (!dontWait) {
+				dprintf("vm_page_allocate_page_run(): Failed to allocate run "
+					"of length %" B_PRIuPHYSADDR " (%" B_PRIuPHYSADDR " %"
+					B_PRIuPHYSADDR ") in second iteration (align: %"
+					B_PRIuPHYSADDR " boundary: %" B_PRIuPHYSADDR ")!\n", length,
+					requestedStart, end, restrictions->alignment,
+					restrictions->boundary);
+			}
 
 			freeClearQueueLocker.Unlock();
 			vm_page_unreserve_pages(&reservation);
@@ -4126,6 +4446,50 @@ vm_page_set_state(vm_page *page, int pageState)
 }
 
 
+/*!	Checks whether \a page, which has just been inserted into \a cache to be
+	read in from the cache's backing store, has been evicted from it recently.
+	Only pages of non-temporary caches are considered. Under the generational
+	policy a page refaulting within the last generations is accounted to its
+	cache's working set and activated, so that it isn't evicted right away
+	again.
+	The cache must be locked and the caller must have access to the page.
+*/
+void
+vm_page_check_refault(VMCache* cache, vm_page* page)
+{
+	if (sPageShadows == NULL || cache->temporary)
+		return;
+
+	uint64 hash = page_shadow_hash(cache, page->cache_offset);
+	int32* shadow = (int32*)&sPageShadows[hash & sPageShadowMask];
+	uint32 entry = (uint32)atomic_get(shadow);
+	if (entry == 0
+		|| (entry & ~kPageShadowGenerationMask) != page_shadow_tag(hash)) {
+		return;
+	}
+
+	// consume the entry, so that the refault is only counted once
+	if ((uint32)atomic_test_and_set(shadow, 0, (int32)entry) != entry)
+		return;
+
+	atomic_add64(&sPageRefaults, 1);
+
+	uint32 distance = (uint8)((uint8)sPageGeneration - (uint8)entry);
+	if (sPageDaemonPolicy != PAGE_DAEMON_POLICY_GENERATIONAL
+		|| distance >= kPageGenerations) {
+		return;
+	}
+
+	atomic_add64(&sPageRefaultsActivated, 1);
+
+	cache->AccountReferencedPage(sPageGeneration);
+	page->generation = (uint8)sPageGeneration;
+	page->usage_count = kPageGenerations - 1;
+	if (page->State() == PAGE_STATE_CACHED)
+		vm_page_set_state(page, PAGE_STATE_ACTIVE);
+}
+
+
 /*!	Moves a page to either the tail of the head of its current queue,
 	depending on \a tail.
 	The page must have a cache and the cache must be locked!
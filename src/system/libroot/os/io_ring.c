@@ -0,0 +1,131 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <io_ring.h>
+
+#include <unistd.h>
+
+#include <syscalls.h>
+
+
+status_t
+io_ring_init(io_ring* ring, uint32 entries, uint32 workers)
+{
+	io_ring_params params;
+	memset(&params, 0, sizeof(params));
+	params.workers = workers;
+
+	int fd = _kern_io_ring_create(entries, &params);
+	if (fd < 0)
+		return fd;
+
+	ring->fd = fd;
+	ring->header = (io_ring_header*)params.address;
+	ring->sqes = (io_ring_sqe*)((uint8*)params.address + params.sqes_offset);
+	ring->cqes = (io_ring_cqe*)((uint8*)params.address + params.cqes_offset);
+	ring->sq_tail = ring->header->sq.tail;
+	ring->sq_mask = params.sq_entries - 1;
+	ring->cq_mask = params.cq_entries - 1;
+
+	return B_OK;
+}
+
+
+void
+io_ring_exit(io_ring* ring)
+{
+	// the kernel unmaps the shared memory, once all operations are done
+	_kern_close(ring->fd);
+	ring->fd = -1;
+	ring->header = NULL;
+}
+
+
+/*!	Returns a free submission queue entry, or \c NULL, if the queue is full.
+	The entry is only passed to the kernel with the next io_ring_submit().
+*/
+io_ring_sqe*
+io_ring_get_sqe(io_ring* ring)
+{
+	uint32 head = (uint32)atomic_get((int32*)&ring->header->sq.head);
+	if (ring->sq_tail - head > ring->sq_mask)
+		return NULL;
+
+	return &ring->sqes[ring->sq_tail++ & ring->sq_mask];
+}
+
+
+/*!	Submits all prepared entries, and waits until at least \a waitCount
+	completions are available. Returns the number of submitted entries.
+*/
+ssize_t
+io_ring_submit_and_wait(io_ring* ring, uint32 waitCount, uint32 flags,
+	bigtime_t timeout)
+{
+	// publish the new entries -- atomic_set() orders the stores
+	atomic_set((int32*)&ring->header->sq.tail, ring->sq_tail);
+
+	uint32 toSubmit = ring->sq_tail
+		- (uint32)atomic_get((int32*)&ring->header->sq.head);
+	if (toSubmit == 0 && waitCount == 0)
+		return 0;
+
+	return _kern_io_ring_enter(ring->fd, toSubmit, waitCount, flags, timeout);
+}
+
+
+ssize_t
+io_ring_submit(io_ring* ring)
+{
+	return io_ring_submit_and_wait(ring, 0, 0, 0);
+}
+
+
+/*!	Returns the next completion without waiting, or \c B_WOULD_BLOCK, if
+	there is none.
+*/
+status_t
+io_ring_peek_cqe(io_ring* ring, io_ring_cqe** _cqe)
+{
+	uint32 head = ring->header->cq.head;
+	if (head == (uint32)atomic_get((int32*)&ring->header->cq.tail))
+		return B_WOULD_BLOCK;
+
+	*_cqe = &ring->cqes[head & ring->cq_mask];
+	return B_OK;
+}
+
+
+status_t
+io_ring_wait_cqe(io_ring* ring, io_ring_cqe** _cqe)
+{
+	while (true) {
+		status_t status = io_ring_peek_cqe(ring, _cqe);
+		if (status != B_WOULD_BLOCK)
+			return status;
+
+		// The kernel doesn't wait, if there is nothing in flight; we return
+		// B_WOULD_BLOCK in that case.
+		status = _kern_io_ring_enter(ring->fd, 0, 1, 0, 0);
+		if (status == B_INTERRUPTED)
+			continue;
+		if (status < 0)
+			return status;
+
+		return io_ring_peek_cqe(ring, _cqe);
+	}
+}
+
+
+/*!	Releases the completion returned by io_ring_peek_cqe() or
+	io_ring_wait_cqe(), so that its slot can be reused.
+*/
+void
+io_ring_cqe_seen(io_ring* ring, io_ring_cqe* cqe)
+{
+	(void)cqe;
+	atomic_set((int32*)&ring->header->cq.head, ring->header->cq.head + 1);
+}
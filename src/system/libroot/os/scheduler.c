@@ -64,6 +64,14 @@ estimate_max_scheduling_latency(thread_id thread)
 }
 
 
+status_t
+set_thread_deadline(thread_id thread, bigtime_t runtime, bigtime_t deadline,
+	bigtime_t period)
+{
+	return _kern_set_thread_deadline(thread, runtime, deadline, period);
+}
+
+
 status_t
 __set_scheduler_mode(int32 mode)
 {
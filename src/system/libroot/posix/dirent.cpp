@@ -20,6 +20,7 @@
 
 
 #define DIR_BUFFER_SIZE	4096
+#define DIR_STAT_COUNT	64
 
 
 struct __DIR {
@@ -28,6 +29,8 @@ struct __DIR {
 	unsigned short	entries_left;
 	long			seek_position;
 	long			current_position;
+	struct stat*	stats;
+	unsigned short	stat_entries;
 	struct dirent	first_entry;
 };
 
@@ -91,6 +94,7 @@ do_seek_dir(DIR* dir)
 
 		dir->next_entry = 0;
 		dir->entries_left = count;
+		dir->stat_entries = 0;
 	}
 
 	return 0;
@@ -115,11 +119,27 @@ __create_dir_struct(int fd)
 	dir->entries_left = 0;
 	dir->seek_position = 0;
 	dir->current_position = 0;
+	dir->stats = NULL;
+	dir->stat_entries = 0;
 
 	return dir;
 }
 
 
+/*!	Reads up to \a maxCount entries of the directory \a fd into \a buffer,
+	and the stat data of the nodes they refer to into \a stats. Entries
+	whose node could not be stat'ed have a \c st_mode of \c 0.
+	Returns the number of entries read, \c 0 at the end of the directory.
+*/
+ssize_t
+__read_dir_stat(int fd, struct dirent* buffer, size_t bufferSize,
+	struct stat* stats, uint32_t maxCount)
+{
+	RETURN_AND_SET_ERRNO(_kern_read_dir_stat(fd, buffer, bufferSize, stats,
+		sizeof(struct stat), maxCount));
+}
+
+
 // #pragma mark - public API
 
 
@@ -195,6 +215,7 @@ closedir(DIR* dir)
 
 	status = _kern_close(dir->fd);
 
+	free(dir->stats);
 	free(dir);
 
 	RETURN_AND_SET_ERRNO(status);
@@ -237,6 +258,7 @@ readdir(DIR* dir)
 
 	dir->entries_left = count - 1;
 	dir->next_entry = dir->first_entry.d_reclen;
+	dir->stat_entries = 0;
 	dir->seek_position++;
 	dir->current_position++;
 
@@ -244,6 +266,72 @@ readdir(DIR* dir)
 }
 
 
+/*!	Works like readdir(), but also returns the stat data of the node the
+	entry refers to in \a stat. The entries are read from the kernel in
+	batches together with their stat data, so that no additional syscall
+	is needed per entry.
+	If the stat data could not be read, \a stat only has \c st_dev and
+	\c st_ino set, and a \c st_mode of \c 0.
+*/
+struct dirent*
+__readdir_stat(DIR* dir, struct stat* stat)
+{
+	if (dir->seek_position != dir->current_position) {
+		if (do_seek_dir(dir) != 0)
+			return NULL;
+	}
+
+	if (dir->entries_left == 0) {
+		// we need to retrieve new entries together with their stat data
+		if (dir->stats == NULL) {
+			dir->stats
+				= (struct stat*)malloc(sizeof(struct stat) * DIR_STAT_COUNT);
+			if (dir->stats == NULL) {
+				__set_errno(B_NO_MEMORY);
+				return NULL;
+			}
+		}
+
+		ssize_t count = _kern_read_dir_stat(dir->fd, &dir->first_entry,
+			(char*)dir + DIR_BUFFER_SIZE - (char*)&dir->first_entry,
+			dir->stats, sizeof(struct stat), DIR_STAT_COUNT);
+		if (count <= 0) {
+			if (count < 0)
+				__set_errno(count);
+
+			// end of directory
+			return NULL;
+		}
+
+		dir->next_entry = 0;
+		dir->entries_left = count;
+		dir->stat_entries = count;
+	}
+
+	int32 index = dir->stat_entries - dir->entries_left;
+	bool haveStat = dir->stat_entries != 0;
+
+	struct dirent* entry = readdir(dir);
+	if (entry == NULL)
+		return NULL;
+
+	if (haveStat) {
+		memcpy(stat, &dir->stats[index], sizeof(struct stat));
+		return entry;
+	}
+
+	// the entries have been buffered by readdir() already
+	if (_kern_read_stat(dir->fd, entry->d_name, false, stat,
+			sizeof(struct stat)) != B_OK) {
+		memset(stat, 0, sizeof(struct stat));
+		stat->st_dev = entry->d_dev;
+		stat->st_ino = entry->d_ino;
+	}
+
+	return entry;
+}
+
+
 int
 readdir_r(DIR* dir, struct dirent* entry, struct dirent** _result)
 {
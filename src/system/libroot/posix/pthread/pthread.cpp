@@ -376,6 +376,35 @@ pthread_timedjoin_np(pthread_t thread, void** _value, const struct timespec* abs
 }
 
 
+extern "C" int
+pthread_setdeadline_np(pthread_t thread, const struct timespec* runtime,
+	const struct timespec* deadline, const struct timespec* period)
+{
+	// a NULL runtime moves the thread back to priority based scheduling
+	bigtime_t runtimeTime = 0;
+	bigtime_t deadlineTime = 0;
+	bigtime_t periodTime = 0;
+	if (runtime != NULL) {
+		if (period == NULL || !timespec_to_bigtime(*runtime, runtimeTime)
+			|| !timespec_to_bigtime(*period, periodTime)
+			|| (deadline != NULL
+				&& !timespec_to_bigtime(*deadline, deadlineTime))) {
+			return EINVAL;
+		}
+	}
+
+	status_t status = _kern_set_thread_deadline(thread->id, runtimeTime,
+		deadlineTime, periodTime);
+	if (status == B_BAD_THREAD_ID)
+		return ESRCH;
+	if (status == B_BUSY)
+		return EBUSY;
+	if (status < B_OK)
+		return status;
+	return 0;
+}
+
+
 // #pragma mark - Haiku thread API bridge
 
 
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <unistd.h>
+
+#include <errno.h>
+
+#include <errno_private.h>
+#include <syscall_utils.h>
+#include <syscalls.h>
+#include <unistd_private.h>
+
+
+ssize_t
+__copy_file_range(int sourceFD, off_t* sourcePos, int targetFD,
+	off_t* targetPos, size_t length, unsigned int flags)
+{
+	RETURN_AND_SET_ERRNO(_kern_copy_file_range(sourceFD, sourcePos, targetFD,
+		targetPos, length, flags));
+}
+
+
+ssize_t
+__sendfile(int targetFD, int sourceFD, off_t* sourcePos, size_t length)
+{
+	RETURN_AND_SET_ERRNO(_kern_sendfile(targetFD, sourceFD, sourcePos,
+		length));
+}
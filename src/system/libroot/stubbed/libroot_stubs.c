@@ -593,6 +593,7 @@ void __clog10f() {}
 void __clog10l() {}
 void __clogf() {}
 void __clogl() {}
+void __copy_file_range() {}
 void __cpow() {}
 void __cpowf() {}
 void __cpowl() {}
@@ -798,6 +799,8 @@ void __pthread_set_default_priority() {}
 void __pthread_sigmask() {}
 void __pthread_sigmask_beos() {}
 void __random_r() {}
+void __read_dir_stat() {}
+void __readdir_stat() {}
 void __recursive_lock_destroy() {}
 void __recursive_lock_get_recursion() {}
 void __recursive_lock_init() {}
@@ -815,6 +818,7 @@ void __rw_lock_read_unlock() {}
 void __rw_lock_write_lock() {}
 void __rw_lock_write_unlock() {}
 void __seed48_r() {}
+void __sendfile() {}
 void __set_scheduler_mode() {}
 void __set_stack_protection() {}
 void __setjmp_save_sigs() {}
@@ -1011,6 +1015,7 @@ void _kern_clone_area() {}
 void _kern_close() {}
 void _kern_close_port() {}
 void _kern_connect() {}
+void _kern_copy_file_range() {}
 void _kern_cpu_enabled() {}
 void _kern_create_area() {}
 void _kern_create_child_partition() {}
@@ -1040,6 +1045,7 @@ void _kern_entry_ref_to_path() {}
 void _kern_estimate_max_scheduling_latency() {}
 void _kern_event_queue_create() {}
 void _kern_event_queue_select() {}
+void _kern_event_queue_submit() {}
 void _kern_event_queue_wait() {}
 void _kern_exec() {}
 void _kern_exit_team() {}
@@ -1108,6 +1114,8 @@ void _kern_image_relocated() {}
 void _kern_initialize_partition() {}
 void _kern_install_default_debugger() {}
 void _kern_install_team_debugger() {}
+void _kern_io_ring_create() {}
+void _kern_io_ring_enter() {}
 void _kern_ioctl() {}
 void _kern_is_computer_on() {}
 void _kern_kernel_debugger() {}
@@ -1148,6 +1156,7 @@ void _kern_process_info() {}
 void _kern_read() {}
 void _kern_read_attr() {}
 void _kern_read_dir() {}
+void _kern_read_dir_stat() {}
 void _kern_read_fs_info() {}
 void _kern_read_index_stat() {}
 void _kern_read_kernel_image_symbols() {}
@@ -1190,6 +1199,7 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendfile() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
@@ -1210,6 +1220,7 @@ void _kern_set_sem_owner() {}
 void _kern_set_signal_mask() {}
 void _kern_set_signal_stack() {}
 void _kern_set_thread_affinity() {}
+void _kern_set_thread_deadline() {}
 void _kern_set_thread_priority() {}
 void _kern_set_timer() {}
 void _kern_set_timezone() {}
@@ -1821,6 +1832,14 @@ void initstate_r() {}
 void insque() {}
 void install_default_debugger() {}
 void install_team_debugger() {}
+void io_ring_cqe_seen() {}
+void io_ring_exit() {}
+void io_ring_get_sqe() {}
+void io_ring_init() {}
+void io_ring_peek_cqe() {}
+void io_ring_submit() {}
+void io_ring_submit_and_wait() {}
+void io_ring_wait_cqe() {}
 void ioctl() {}
 void is_computer_on() {}
 void is_computer_on_fire() {}
@@ -2188,6 +2207,7 @@ void pthread_self() {}
 void pthread_setcancelstate() {}
 void pthread_setcanceltype() {}
 void pthread_setconcurrency() {}
+void pthread_setdeadline_np() {}
 void pthread_setname_np() {}
 void pthread_setschedparam() {}
 void pthread_setspecific() {}
@@ -2322,6 +2342,7 @@ void set_real_time_clock() {}
 void set_scheduler_mode() {}
 void set_sem_owner() {}
 void set_signal_stack() {}
+void set_thread_deadline() {}
 void set_thread_priority() {}
 void setbuf() {}
 void setbuffer() {}
@@ -444,6 +444,7 @@ void __clog10l() {}
 void __clogf() {}
 void __clogl() {}
 void __cmpdi2() {}
+void __copy_file_range() {}
 void __cp_eh_info() {}
 void __cp_exception_info() {}
 void __cp_pop_exception() {}
@@ -684,6 +685,8 @@ void __pthread_sigmask_beos() {}
 void __pure_virtual() {}
 void __push_heap__H3ZPQ217EnvironmentFilter5EntryZlZQ217EnvironmentFilter5Entry_X01X11X11X21_v() {}
 void __random_r() {}
+void __read_dir_stat() {}
+void __readdir_stat() {}
 void __recursive_lock_destroy() {}
 void __recursive_lock_get_recursion() {}
 void __recursive_lock_init() {}
@@ -716,6 +719,7 @@ void __rw_lock_write_lock() {}
 void __rw_lock_write_unlock() {}
 void __secs_to_tm() {}
 void __seed48_r() {}
+void __sendfile() {}
 void __set_scheduler_mode() {}
 void __set_stack_protection() {}
 void __setjmp_save_sigs() {}
@@ -975,6 +979,7 @@ void _kern_clone_area() {}
 void _kern_close() {}
 void _kern_close_port() {}
 void _kern_connect() {}
+void _kern_copy_file_range() {}
 void _kern_cpu_enabled() {}
 void _kern_create_area() {}
 void _kern_create_child_partition() {}
@@ -1004,6 +1009,7 @@ void _kern_entry_ref_to_path() {}
 void _kern_estimate_max_scheduling_latency() {}
 void _kern_event_queue_create() {}
 void _kern_event_queue_select() {}
+void _kern_event_queue_submit() {}
 void _kern_event_queue_wait() {}
 void _kern_exec() {}
 void _kern_exit_team() {}
@@ -1072,6 +1078,8 @@ void _kern_image_relocated() {}
 void _kern_initialize_partition() {}
 void _kern_install_default_debugger() {}
 void _kern_install_team_debugger() {}
+void _kern_io_ring_create() {}
+void _kern_io_ring_enter() {}
 void _kern_ioctl() {}
 void _kern_is_computer_on() {}
 void _kern_kernel_debugger() {}
@@ -1112,6 +1120,7 @@ void _kern_process_info() {}
 void _kern_read() {}
 void _kern_read_attr() {}
 void _kern_read_dir() {}
+void _kern_read_dir_stat() {}
 void _kern_read_fs_info() {}
 void _kern_read_index_stat() {}
 void _kern_read_kernel_image_symbols() {}
@@ -1154,6 +1163,7 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendfile() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
@@ -1174,6 +1184,7 @@ void _kern_set_sem_owner() {}
 void _kern_set_signal_mask() {}
 void _kern_set_signal_stack() {}
 void _kern_set_thread_affinity() {}
+void _kern_set_thread_deadline() {}
 void _kern_set_thread_priority() {}
 void _kern_set_timer() {}
 void _kern_set_timezone() {}
@@ -1809,6 +1820,14 @@ void insque() {}
 void install_default_debugger() {}
 void install_team_debugger() {}
 void internal_path_for_path__FPcUlPCcT219path_base_directoryT2UlT0Ul() {}
+void io_ring_cqe_seen() {}
+void io_ring_exit() {}
+void io_ring_get_sqe() {}
+void io_ring_init() {}
+void io_ring_peek_cqe() {}
+void io_ring_submit() {}
+void io_ring_submit_and_wait() {}
+void io_ring_wait_cqe() {}
 void ioctl() {}
 void is_computer_on() {}
 void is_computer_on_fire() {}
@@ -2178,6 +2197,7 @@ void pthread_self() {}
 void pthread_setcancelstate() {}
 void pthread_setcanceltype() {}
 void pthread_setconcurrency() {}
+void pthread_setdeadline_np() {}
 void pthread_setname_np() {}
 void pthread_setschedparam() {}
 void pthread_setspecific() {}
@@ -2318,6 +2338,7 @@ void set_scheduler_mode() {}
 void set_sem_owner() {}
 void set_signal_stack() {}
 void set_terminate__FPFv_v() {}
+void set_thread_deadline() {}
 void set_thread_priority() {}
 void set_timezone() {}
 void set_unexpected__FPFv_v() {}
@@ -11,6 +11,7 @@
 #include <file_cache.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -20,11 +21,41 @@ extern const char *__progname;
 void
 usage()
 {
-	fprintf(stderr, "usage: %s [clear | unset | set <module-name>]\n", __progname);
+	fprintf(stderr, "usage: %s [clear | unset | set <module-name>\n"
+		"\t| readahead [<min-window> <max-window>]]\n", __progname);
 	exit(0);
 }
 
 
+static void
+read_ahead(int argc, char **argv)
+{
+	file_cache_read_ahead_info info;
+	status_t status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_GET_READ_AHEAD, &info, sizeof(info));
+	if (status != B_OK) {
+		fprintf(stderr, "%s: getting the read-ahead info failed: %s\n", __progname, strerror(status));
+		return;
+	}
+
+	if (argc > 3) {
+		info.min_window = strtoul(argv[2], NULL, 0);
+		info.max_window = strtoul(argv[3], NULL, 0);
+
+		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_READ_AHEAD, &info, sizeof(info));
+		if (status != B_OK)
+			fprintf(stderr, "%s: setting the read-ahead window failed: %s\n", __progname, strerror(status));
+		return;
+	}
+
+	printf("read-ahead window:   %" B_PRIu32 " - %" B_PRIu32 " bytes%s\n", info.min_window,
+		info.max_window, info.max_window == 0 ? " (disabled)" : "");
+	printf("sequential reads:    %" B_PRIu64 "\n", info.sequential_reads);
+	printf("random reads:        %" B_PRIu64 "\n", info.random_reads);
+	printf("read-ahead requests: %" B_PRIu64 "\n", info.read_ahead_requests);
+	printf("read-ahead bytes:    %" B_PRIu64 "\n", info.read_ahead_bytes);
+}
+
+
 int
 main(int argc, char **argv)
 {
@@ -46,6 +77,8 @@ main(int argc, char **argv)
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, NULL, 0);
 		if (status != B_OK)
 			fprintf(stderr, "%s: unsetting the cache module failed: %s\n", __progname, strerror(status));
+	} else if (!strcmp(argv[1], "readahead")) {
+		read_ahead(argc, argv);
 	} else if (!strcmp(argv[1], "set") && argc > 2) {
 		status = _kern_generic_syscall(CACHE_SYSCALLS, CACHE_SET_MODULE, argv[2], strlen(argv[2]));
 		if (status != B_OK)
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares copying a file with read()/write() against copy_file_range(),
+	verifies the copied data, and sends the file through a pipe with
+	sendfile().
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <unistd_private.h>
+
+
+#define FILE_SIZE		(64 * 1024 * 1024 + 123)
+#define BUFFER_SIZE		(64 * 1024)
+
+
+static const char* kSourcePath = "/boot/home/copy_file_range_test.source";
+static const char* kTargetPath = "/boot/home/copy_file_range_test.target";
+
+
+struct reader_args {
+	int		fd;
+	off_t	bytesRead;
+};
+
+
+static status_t
+pipe_reader(void* _args)
+{
+	reader_args* args = (reader_args*)_args;
+	char buffer[BUFFER_SIZE];
+
+	while (true) {
+		ssize_t bytesRead = read(args->fd, buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+			break;
+		args->bytesRead += bytesRead;
+	}
+
+	return B_OK;
+}
+
+
+static int
+open_target()
+{
+	int fd = open(kTargetPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Could not create target file: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+	return fd;
+}
+
+
+static void
+verify_target(int source, int target)
+{
+	static char sourceBuffer[BUFFER_SIZE];
+	static char targetBuffer[BUFFER_SIZE];
+
+	off_t size = lseek(target, 0, SEEK_END);
+	if (size != FILE_SIZE) {
+		fprintf(stderr, "  target has wrong size %lld\n", (long long)size);
+		exit(1);
+	}
+
+	for (off_t offset = 0; offset < FILE_SIZE; offset += BUFFER_SIZE) {
+		ssize_t bytesRead = pread(source, sourceBuffer, BUFFER_SIZE, offset);
+		if (bytesRead <= 0
+			|| pread(target, targetBuffer, BUFFER_SIZE, offset) != bytesRead
+			|| memcmp(sourceBuffer, targetBuffer, bytesRead) != 0) {
+			fprintf(stderr, "  target differs at offset %lld\n",
+				(long long)offset);
+			exit(1);
+		}
+	}
+}
+
+
+static void
+print_result(const char* kind, bigtime_t time)
+{
+	printf("%-20s %8lld us, %8.1f MB/s\n", kind, (long long)time,
+		FILE_SIZE / (double)time);
+}
+
+
+int
+main()
+{
+	static char buffer[BUFFER_SIZE];
+
+	int source = open(kSourcePath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (source < 0) {
+		fprintf(stderr, "Could not create source file: %s\n",
+			strerror(errno));
+		return 1;
+	}
+
+	for (off_t offset = 0; offset < FILE_SIZE; offset += BUFFER_SIZE) {
+		for (size_t i = 0; i < BUFFER_SIZE; i++)
+			buffer[i] = (char)(offset / BUFFER_SIZE + i);
+
+		size_t size = FILE_SIZE - offset < BUFFER_SIZE
+			? FILE_SIZE - offset : BUFFER_SIZE;
+		write(source, buffer, size);
+	}
+
+	// read() and write()
+
+	int target = open_target();
+	lseek(source, 0, SEEK_SET);
+
+	bigtime_t start = system_time();
+	while (true) {
+		ssize_t bytesRead = read(source, buffer, BUFFER_SIZE);
+		if (bytesRead <= 0)
+			break;
+		write(target, buffer, bytesRead);
+	}
+	print_result("read/write", system_time() - start);
+
+	verify_target(source, target);
+	close(target);
+
+	// copy_file_range(), using and advancing the file positions
+
+	target = open_target();
+	lseek(source, 0, SEEK_SET);
+
+	start = system_time();
+	while (true) {
+		ssize_t bytesCopied = __copy_file_range(source, NULL, target, NULL,
+			FILE_SIZE, 0);
+		if (bytesCopied < 0) {
+			fprintf(stderr, "copy_file_range() failed: %s\n",
+				strerror(errno));
+			return 1;
+		}
+		if (bytesCopied == 0)
+			break;
+	}
+	print_result("copy_file_range", system_time() - start);
+
+	if (lseek(source, 0, SEEK_CUR) != FILE_SIZE
+		|| lseek(target, 0, SEEK_CUR) != FILE_SIZE) {
+		fprintf(stderr, "  file positions were not advanced\n");
+		return 1;
+	}
+	verify_target(source, target);
+
+	// overlapping ranges within the same file must be rejected
+
+	off_t sourcePos = 0;
+	off_t targetPos = 4096;
+	if (__copy_file_range(source, &sourcePos, source, &targetPos, 8192, 0) >= 0
+		|| errno != EINVAL) {
+		fprintf(stderr, "overlapping copy_file_range() was not rejected\n");
+		return 1;
+	}
+
+	close(target);
+
+	// sendfile() into a pipe
+
+	int pipes[2];
+	if (pipe(pipes) != 0) {
+		fprintf(stderr, "Could not create pipe: %s\n", strerror(errno));
+		return 1;
+	}
+
+	reader_args args;
+	args.fd = pipes[0];
+	args.bytesRead = 0;
+
+	thread_id reader = spawn_thread(&pipe_reader, "pipe reader",
+		B_NORMAL_PRIORITY, &args);
+	resume_thread(reader);
+
+	sourcePos = 0;
+	start = system_time();
+	while (sourcePos < FILE_SIZE) {
+		ssize_t bytesSent = __sendfile(pipes[1], source, &sourcePos,
+			FILE_SIZE - sourcePos);
+		if (bytesSent <= 0) {
+			fprintf(stderr, "sendfile() failed: %s\n", strerror(errno));
+			return 1;
+		}
+	}
+	close(pipes[1]);
+
+	status_t result;
+	wait_for_thread(reader, &result);
+	print_result("sendfile (pipe)", system_time() - start);
+
+	if (args.bytesRead != FILE_SIZE) {
+		fprintf(stderr, "  reader got %lld bytes\n",
+			(long long)args.bytesRead);
+		return 1;
+	}
+
+	close(pipes[0]);
+	close(source);
+	unlink(kSourcePath);
+	unlink(kTargetPath);
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A simple fio style benchmark for block devices: it reads from a raw
+	device with a number of threads in parallel, each having one request in
+	flight, so that the number of threads equals the queue depth the driver
+	sees. Only reads are done, so it can be run on any disk.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Drivers.h>
+#include <OS.h>
+
+
+#define MAX_DEPTH	256
+
+
+struct worker_args {
+	int			fd;
+	off_t		size;
+	size_t		blockSize;
+	bool		sequential;
+	int32		index;
+	int32		depth;
+	uint64		operations;
+	int32		errors;
+	bigtime_t	maxLatency;
+};
+
+
+static volatile bool sQuit;
+
+
+static const char* kUsage =
+	"Usage: %s [ <options> ] <raw device>\n"
+	"Options:\n"
+	"  -b <size>   Block size in bytes (default: 4096)\n"
+	"  -d <depth>  Queue depth, ie. the number of threads (default: 1)\n"
+	"  -s          Read sequentially instead of randomly\n"
+	"  -t <secs>   Run time in seconds (default: 10)\n";
+
+
+static status_t
+worker_thread(void* _args)
+{
+	worker_args* args = (worker_args*)_args;
+
+	void* buffer;
+	if (posix_memalign(&buffer, B_PAGE_SIZE, args->blockSize) != 0) {
+		args->errors++;
+		return B_NO_MEMORY;
+	}
+
+	uint64 blockCount = args->size / args->blockSize;
+	uint32 random = (uint32)system_time() + args->index;
+
+	// sequential readers each get their own stripe of the disk
+	uint64 block = blockCount * args->index / args->depth;
+
+	while (!sQuit) {
+		if (args->sequential) {
+			if (++block >= blockCount)
+				block = 0;
+		} else {
+			random = random * 1103515245 + 12345;
+			block = ((uint64)random << 16 ^ random) % blockCount;
+		}
+
+		bigtime_t start = system_time();
+		ssize_t bytesRead = pread(args->fd, buffer, args->blockSize,
+			block * args->blockSize);
+		bigtime_t latency = system_time() - start;
+
+		if (bytesRead != (ssize_t)args->blockSize)
+			args->errors++;
+		if (latency > args->maxLatency)
+			args->maxLatency = latency;
+		args->operations++;
+	}
+
+	free(buffer);
+	return B_OK;
+}
+
+
+int
+main(int argc, char** argv)
+{
+	size_t blockSize = 4096;
+	int32 depth = 1;
+	bool sequential = false;
+	bigtime_t runTime = 10000000;
+
+	int option;
+	while ((option = getopt(argc, argv, "b:d:st:h")) != -1) {
+		switch (option) {
+			case 'b':
+				blockSize = strtoul(optarg, NULL, 0);
+				break;
+			case 'd':
+				depth = strtol(optarg, NULL, 0);
+				break;
+			case 's':
+				sequential = true;
+				break;
+			case 't':
+				runTime = strtol(optarg, NULL, 0) * 1000000LL;
+				break;
+			default:
+				fprintf(stderr, kUsage, argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind + 1 != argc || blockSize == 0 || depth < 1
+		|| depth > MAX_DEPTH || runTime <= 0) {
+		fprintf(stderr, kUsage, argv[0]);
+		return 1;
+	}
+
+	const char* path = argv[optind];
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	off_t size;
+	size_t deviceSize;
+	if (ioctl(fd, B_GET_DEVICE_SIZE, &deviceSize, sizeof(deviceSize)) == 0)
+		size = deviceSize;
+	else {
+		device_geometry geometry;
+		if (ioctl(fd, B_GET_GEOMETRY, &geometry, sizeof(geometry)) != 0) {
+			fprintf(stderr, "Failed to get the size of \"%s\": %s\n", path,
+				strerror(errno));
+			return 1;
+		}
+		size = (off_t)geometry.bytes_per_sector * geometry.sectors_per_track
+			* geometry.cylinder_count * geometry.head_count;
+	}
+
+	if (size < (off_t)blockSize) {
+		fprintf(stderr, "The device is too small.\n");
+		return 1;
+	}
+
+	worker_args args[MAX_DEPTH];
+	thread_id threads[MAX_DEPTH];
+
+	for (int32 i = 0; i < depth; i++) {
+		memset(&args[i], 0, sizeof(worker_args));
+		args[i].fd = fd;
+		args[i].size = size;
+		args[i].blockSize = blockSize;
+		args[i].sequential = sequential;
+		args[i].index = i;
+		args[i].depth = depth;
+
+		threads[i] = spawn_thread(worker_thread, "disk io worker",
+			B_NORMAL_PRIORITY, &args[i]);
+	}
+
+	bigtime_t start = system_time();
+	for (int32 i = 0; i < depth; i++)
+		resume_thread(threads[i]);
+
+	snooze(runTime);
+	sQuit = true;
+
+	uint64 operations = 0;
+	int32 errors = 0;
+	bigtime_t maxLatency = 0;
+	for (int32 i = 0; i < depth; i++) {
+		status_t status;
+		wait_for_thread(threads[i], &status);
+
+		operations += args[i].operations;
+		errors += args[i].errors;
+		if (args[i].maxLatency > maxLatency)
+			maxLatency = args[i].maxLatency;
+	}
+
+	bigtime_t time = system_time() - start;
+	close(fd);
+
+	printf("%s read, %lu bytes, depth %" B_PRId32 ": %.0f IOPS, %.1f MB/s, "
+		"avg latency %.1f us, max %" B_PRId64 " us%s\n",
+		sequential ? "sequential" : "random", blockSize, depth,
+		operations * 1000000.0 / time,
+		(double)operations * blockSize / time,
+		operations > 0 ? (double)time * depth / operations : 0.0, maxLatency,
+		errors != 0 ? ", ERRORS" : "");
+
+	return errors != 0 ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Sends SIGCHLD to the team while an io_ring worker is blocked in a recv
+	operation, and verifies that the operation is not interrupted by it, but
+	completes with the data sent afterwards.
+*/
+
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_ring.h>
+
+
+static const char kMessage[] = "io ring signal test";
+
+static volatile int32 sSignalCount = 0;
+
+
+static void
+signal_handler(int signal)
+{
+	atomic_add(&sSignalCount, 1);
+}
+
+
+static void
+fail(const char* message, status_t status)
+{
+	fprintf(stderr, "%s: %s\n", message, strerror(status));
+	exit(1);
+}
+
+
+int
+main()
+{
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = signal_handler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+		fail("Failed to create the sockets", errno);
+
+	io_ring ring;
+	status_t status = io_ring_init(&ring, 8, 1);
+	if (status != B_OK)
+		fail("Failed to create the ring", status);
+
+	char buffer[sizeof(kMessage)];
+	io_ring_prep_recv(io_ring_get_sqe(&ring), sockets[0], buffer,
+		sizeof(buffer), MSG_WAITALL);
+	if (io_ring_submit(&ring) != 1)
+		fail("Failed to submit the recv", B_ERROR);
+
+	// give the worker time to block in recv()
+	snooze(100000);
+
+	// let a child exit, and send another SIGCHLD directly
+	pid_t child = fork();
+	if (child < 0)
+		fail("Failed to fork", errno);
+	if (child == 0)
+		_exit(0);
+
+	waitpid(child, NULL, 0);
+	kill(getpid(), SIGCHLD);
+
+	snooze(100000);
+
+	io_ring_cqe* cqe;
+	if (io_ring_peek_cqe(&ring, &cqe) == B_OK) {
+		fprintf(stderr, "recv completed early: %s\n",
+			strerror((status_t)cqe->result));
+		return 1;
+	}
+
+	if (send(sockets[1], kMessage, sizeof(kMessage), 0)
+			!= (ssize_t)sizeof(kMessage)) {
+		fail("Failed to send", errno);
+	}
+
+	status = io_ring_wait_cqe(&ring, &cqe);
+	if (status != B_OK)
+		fail("Failed to wait for the completion", status);
+
+	if (cqe->result != (int64)sizeof(kMessage)
+		|| memcmp(buffer, kMessage, sizeof(kMessage)) != 0) {
+		fprintf(stderr, "recv failed: %s\n", cqe->result < 0
+			? strerror((status_t)cqe->result) : "wrong data");
+		return 1;
+	}
+	io_ring_cqe_seen(&ring, cqe);
+
+	if (sSignalCount == 0) {
+		fprintf(stderr, "SIGCHLD has not been delivered to the team\n");
+		return 1;
+	}
+
+	io_ring_exit(&ring);
+	close(sockets[0]);
+	close(sockets[1]);
+
+	printf("recv not interrupted by %" B_PRId32 " SIGCHLD, OK\n",
+		sSignalCount);
+	return 0;
+}
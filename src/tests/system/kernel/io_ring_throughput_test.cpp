@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the throughput of reading and writing a file with blocking
+	pread()/pwrite() calls to doing the same through an io_ring with several
+	requests in flight.
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_ring.h>
+
+
+#define FILE_SIZE		(64 * 1024 * 1024)
+#define MAX_BLOCK_SIZE	(256 * 1024)
+#define QUEUE_DEPTH		32
+#define NOP_COUNT		100000
+
+
+static void
+print_result(const char* kind, size_t blockSize, bigtime_t time,
+	bool failed)
+{
+	printf("%-10s %7lu bytes: %8.1f MB/s, %6.1f us/block%s\n", kind, blockSize,
+		(double)FILE_SIZE / time, (double)time * blockSize / FILE_SIZE,
+		failed ? ", FAILED" : "");
+}
+
+
+static bigtime_t
+blocking_io(int fd, uint8* buffer, size_t blockSize, bool write, bool& failed)
+{
+	bigtime_t start = system_time();
+
+	for (off_t offset = 0; offset < FILE_SIZE; offset += blockSize) {
+		ssize_t bytes = write
+			? pwrite(fd, buffer, blockSize, offset)
+			: pread(fd, buffer, blockSize, offset);
+		if (bytes != (ssize_t)blockSize)
+			failed = true;
+	}
+
+	return system_time() - start;
+}
+
+
+static bigtime_t
+ring_io(io_ring* ring, int fd, uint8* buffers, size_t blockSize, bool write,
+	bool& failed)
+{
+	bigtime_t start = system_time();
+
+	off_t offset = 0;
+	uint32 inFlight = 0;
+	uint32 slot = 0;
+
+	while (offset < FILE_SIZE || inFlight > 0) {
+		// fill the queue
+		while (offset < FILE_SIZE && inFlight < QUEUE_DEPTH) {
+			io_ring_sqe* sqe = io_ring_get_sqe(ring);
+			if (sqe == NULL)
+				break;
+
+			uint8* buffer = buffers + (slot++ % QUEUE_DEPTH) * blockSize;
+			if (write)
+				io_ring_prep_write(sqe, fd, buffer, blockSize, offset);
+			else
+				io_ring_prep_read(sqe, fd, buffer, blockSize, offset);
+			sqe->user_data = offset;
+
+			offset += blockSize;
+			inFlight++;
+		}
+
+		if (io_ring_submit_and_wait(ring, 1, 0, 0) < 0) {
+			failed = true;
+			break;
+		}
+
+		// reap all completions
+		io_ring_cqe* cqe;
+		while (io_ring_peek_cqe(ring, &cqe) == B_OK) {
+			if (cqe->result != (int64)blockSize)
+				failed = true;
+			io_ring_cqe_seen(ring, cqe);
+			inFlight--;
+		}
+	}
+
+	return system_time() - start;
+}
+
+
+static void
+nop_test(io_ring* ring)
+{
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < NOP_COUNT; i += QUEUE_DEPTH) {
+		for (int32 k = 0; k < QUEUE_DEPTH; k++)
+			io_ring_prep_nop(io_ring_get_sqe(ring));
+
+		io_ring_submit_and_wait(ring, QUEUE_DEPTH, 0, 0);
+
+		io_ring_cqe* cqe;
+		while (io_ring_peek_cqe(ring, &cqe) == B_OK)
+			io_ring_cqe_seen(ring, cqe);
+	}
+
+	bigtime_t ringTime = system_time() - start;
+
+	start = system_time();
+	for (int32 i = 0; i < NOP_COUNT; i++)
+		pread(-1, NULL, 0, 0);
+	bigtime_t syscallTime = system_time() - start;
+
+	printf("nop: ring %.3f us/op, syscall %.3f us/op\n",
+		(double)ringTime / NOP_COUNT, (double)syscallTime / NOP_COUNT);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "/tmp/io_ring_throughput_test";
+
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Failed to open \"%s\": %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	uint8* buffers = (uint8*)malloc(MAX_BLOCK_SIZE * QUEUE_DEPTH);
+	if (buffers == NULL) {
+		fprintf(stderr, "Failed to allocate the buffers.\n");
+		return 1;
+	}
+	memset(buffers, 0x55, MAX_BLOCK_SIZE * QUEUE_DEPTH);
+
+	io_ring ring;
+	status_t status = io_ring_init(&ring, QUEUE_DEPTH * 2, 0);
+	if (status != B_OK) {
+		fprintf(stderr, "Failed to create the ring: %s\n", strerror(status));
+		return 1;
+	}
+
+	nop_test(&ring);
+
+	for (size_t blockSize = 4096; blockSize <= MAX_BLOCK_SIZE;
+			blockSize *= 4) {
+		bool failed = false;
+		bigtime_t time = blocking_io(fd, buffers, blockSize, true, failed);
+		print_result("pwrite", blockSize, time, failed);
+
+		failed = false;
+		time = ring_io(&ring, fd, buffers, blockSize, true, failed);
+		print_result("ring write", blockSize, time, failed);
+
+		failed = false;
+		time = blocking_io(fd, buffers, blockSize, false, failed);
+		print_result("pread", blockSize, time, failed);
+
+		failed = false;
+		time = ring_io(&ring, fd, buffers, blockSize, false, failed);
+		print_result("ring read", blockSize, time, failed);
+	}
+
+	io_ring_exit(&ring);
+	close(fd);
+	unlink(path);
+	free(buffers);
+	return 0;
+}
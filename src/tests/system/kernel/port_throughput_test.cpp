@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the port throughput for different message sizes, reading into
+	page aligned buffers (which allows the kernel to pass on the pages of
+	large messages) as well as into unaligned ones (which always copies).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+#define MESSAGE_COUNT	2000
+#define MAX_SIZE		(256 * 1024)
+
+
+struct reader_args {
+	port_id		port;
+	uint8*		buffer;
+	size_t		size;
+	int32		errors;
+};
+
+
+static status_t
+reader_thread(void* _args)
+{
+	reader_args* args = (reader_args*)_args;
+
+	for (int32 i = 0; i < MESSAGE_COUNT; i++) {
+		int32 code;
+		ssize_t bytes = read_port(args->port, &code, args->buffer, args->size);
+		if (bytes != (ssize_t)args->size
+			|| args->buffer[0] != (uint8)code
+			|| args->buffer[args->size - 1] != (uint8)code) {
+			args->errors++;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static void
+run_test(uint8* sendBuffer, uint8* receiveBuffer, size_t size,
+	const char* kind)
+{
+	reader_args args;
+	args.port = create_port(16, "throughput test");
+	args.buffer = receiveBuffer;
+	args.size = size;
+	args.errors = 0;
+
+	thread_id reader = spawn_thread(reader_thread, "reader",
+		B_NORMAL_PRIORITY, &args);
+	resume_thread(reader);
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < MESSAGE_COUNT; i++) {
+		sendBuffer[0] = (uint8)i;
+		sendBuffer[size - 1] = (uint8)i;
+		status_t status = write_port(args.port, i, sendBuffer, size);
+		if (status != B_OK) {
+			fprintf(stderr, "write_port() failed: %s\n", strerror(status));
+			break;
+		}
+	}
+
+	status_t result;
+	wait_for_thread(reader, &result);
+
+	bigtime_t time = system_time() - start;
+	delete_port(args.port);
+
+	printf("%7lu bytes, %-9s: %8.1f MB/s, %6.1f us/message%s\n", size, kind,
+		(double)size * MESSAGE_COUNT / time, (double)time / MESSAGE_COUNT,
+		args.errors != 0 ? ", CORRUPTED" : "");
+}
+
+
+int
+main()
+{
+	uint8* sendBuffer = (uint8*)malloc(MAX_SIZE);
+
+	uint8* alignedBuffer;
+	area_id area = create_area("receive buffer", (void**)&alignedBuffer,
+		B_ANY_ADDRESS, MAX_SIZE + B_PAGE_SIZE, B_NO_LOCK,
+		B_READ_AREA | B_WRITE_AREA);
+	if (sendBuffer == NULL || area < 0) {
+		fprintf(stderr, "Failed to allocate the buffers.\n");
+		return 1;
+	}
+
+	memset(sendBuffer, 0x55, MAX_SIZE);
+	uint8* unalignedBuffer = alignedBuffer + 16;
+
+	for (size_t size = 1024; size <= MAX_SIZE; size *= 4) {
+		run_test(sendBuffer, alignedBuffer, size, "aligned");
+		run_test(sendBuffer, unalignedBuffer, size, "unaligned");
+	}
+
+	delete_area(area);
+	free(sendBuffer);
+	return 0;
+}
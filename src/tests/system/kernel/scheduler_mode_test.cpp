@@ -0,0 +1,176 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Runs the same mixed workload under each scheduler mode: CPU bound
+	threads that repeatedly walk their own working set, and a few threads
+	that sleep briefly and measure how late they are woken up. The total
+	throughput of the CPU bound threads and the wake-up latencies are
+	printed for comparison.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+#include <scheduler.h>
+
+
+#define WORKING_SET_SIZE	(256 * 1024)
+#define MAX_WORKERS			128
+#define LATENCY_THREADS		2
+#define SLEEP_TIME			1000
+
+
+struct worker_args {
+	uint8*			buffer;
+	uint64			rounds;
+};
+
+struct latency_args {
+	bigtime_t		total;
+	bigtime_t		max;
+	int32			count;
+};
+
+
+static const struct {
+	int32		mode;
+	const char*	name;
+} kModes[] = {
+	{ SCHEDULER_MODE_LOW_LATENCY, "low latency" },
+	{ SCHEDULER_MODE_POWER_SAVING, "power saving" },
+	{ SCHEDULER_MODE_SERVER, "server" },
+};
+
+static volatile bool sQuit;
+
+
+static status_t
+worker_thread(void* _args)
+{
+	worker_args* args = (worker_args*)_args;
+
+	while (!sQuit) {
+		for (size_t i = 0; i < WORKING_SET_SIZE; i += 64)
+			args->buffer[i]++;
+		args->rounds++;
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+latency_thread(void* _args)
+{
+	latency_args* args = (latency_args*)_args;
+
+	while (!sQuit) {
+		bigtime_t start = system_time();
+		snooze(SLEEP_TIME);
+		bigtime_t latency = system_time() - start - SLEEP_TIME;
+
+		args->total += latency;
+		if (latency > args->max)
+			args->max = latency;
+		args->count++;
+	}
+
+	return B_OK;
+}
+
+
+static void
+run_test(const char* name, int32 workerCount, bigtime_t runTime)
+{
+	worker_args workers[MAX_WORKERS];
+	thread_id workerThreads[MAX_WORKERS];
+	latency_args latencies[LATENCY_THREADS];
+	thread_id latencyThreads[LATENCY_THREADS];
+
+	sQuit = false;
+
+	for (int32 i = 0; i < workerCount; i++) {
+		workers[i].buffer = (uint8*)malloc(WORKING_SET_SIZE);
+		memset(workers[i].buffer, 0, WORKING_SET_SIZE);
+		workers[i].rounds = 0;
+		workerThreads[i] = spawn_thread(worker_thread, "worker",
+			B_LOW_PRIORITY, &workers[i]);
+	}
+
+	for (int32 i = 0; i < LATENCY_THREADS; i++) {
+		memset(&latencies[i], 0, sizeof(latency_args));
+		latencyThreads[i] = spawn_thread(latency_thread, "latency",
+			B_DISPLAY_PRIORITY, &latencies[i]);
+	}
+
+	for (int32 i = 0; i < workerCount; i++)
+		resume_thread(workerThreads[i]);
+	for (int32 i = 0; i < LATENCY_THREADS; i++)
+		resume_thread(latencyThreads[i]);
+
+	snooze(runTime);
+	sQuit = true;
+
+	uint64 rounds = 0;
+	for (int32 i = 0; i < workerCount; i++) {
+		status_t status;
+		wait_for_thread(workerThreads[i], &status);
+		rounds += workers[i].rounds;
+		free(workers[i].buffer);
+	}
+
+	bigtime_t totalLatency = 0;
+	bigtime_t maxLatency = 0;
+	int32 latencyCount = 0;
+	for (int32 i = 0; i < LATENCY_THREADS; i++) {
+		status_t status;
+		wait_for_thread(latencyThreads[i], &status);
+		totalLatency += latencies[i].total;
+		latencyCount += latencies[i].count;
+		if (latencies[i].max > maxLatency)
+			maxLatency = latencies[i].max;
+	}
+
+	printf("%-13s %10.1f rounds/s, wake-up latency avg %6.1f us, "
+		"max %6" B_PRId64 " us\n", name, rounds * 1000000.0 / runTime,
+		latencyCount > 0 ? (double)totalLatency / latencyCount : 0.0,
+		maxLatency);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	bigtime_t runTime = 5000000;
+	if (argc > 1)
+		runTime = atoi(argv[1]) * 1000000LL;
+
+	system_info info;
+	get_system_info(&info);
+	int32 workerCount = min_c(info.cpu_count * 2, MAX_WORKERS);
+
+	printf("%" B_PRId32 " CPU bound threads, %d latency threads, %" B_PRId64
+		" s per mode\n", workerCount, LATENCY_THREADS, runTime / 1000000);
+
+	int32 previousMode = get_scheduler_mode();
+
+	for (size_t i = 0; i < sizeof(kModes) / sizeof(kModes[0]); i++) {
+		status_t status = set_scheduler_mode(kModes[i].mode);
+		if (status != B_OK) {
+			fprintf(stderr, "Failed to set the %s mode: %s\n", kModes[i].name,
+				strerror(status));
+			continue;
+		}
+
+		run_test(kModes[i].name, workerCount, runTime);
+	}
+
+	set_scheduler_mode(previousMode);
+	return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BlockCacheTests.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fs_cache.h>
+#include <KernelExport.h>
+
+#include <smp.h>
+#include <syscalls.h>
+
+#include "TestThread.h"
+
+
+static const char* kTestFilePath = "/tmp/block_cache_test";
+static const size_t kBlockSize = 4096;
+static const off_t kBlockCount = 1024;
+
+static const int kConcurrentTestTime = 2000000;
+static const int kBenchmarkTime = 500000;
+static const int kMaxThreads = 16;
+
+
+static inline uint32
+next_random(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+
+/*!	Holds a reference to a cached block for its lifetime, so that a failed
+	TEST_ASSERT() does not leak it.
+*/
+class CachedBlock {
+public:
+	CachedBlock()
+		:
+		fCache(NULL),
+		fData(NULL)
+	{
+	}
+
+	CachedBlock(void* cache, off_t blockNumber)
+		:
+		fCache(NULL),
+		fData(NULL)
+	{
+		SetTo(cache, blockNumber);
+	}
+
+	~CachedBlock()
+	{
+		Unset();
+	}
+
+	const uint8* SetTo(void* cache, off_t blockNumber)
+	{
+		Unset();
+
+		fData = (const uint8*)block_cache_get(cache, blockNumber);
+		if (fData != NULL) {
+			fCache = cache;
+			fBlockNumber = blockNumber;
+		}
+		return fData;
+	}
+
+	void Unset()
+	{
+		if (fData != NULL)
+			block_cache_put(fCache, fBlockNumber);
+		fCache = NULL;
+		fData = NULL;
+	}
+
+	const uint8* Data() const
+	{
+		return fData;
+	}
+
+private:
+	void*			fCache;
+	off_t			fBlockNumber;
+	const uint8*	fData;
+};
+
+
+class BlockCacheTest : public StandardTestDelegate {
+public:
+	BlockCacheTest()
+		:
+		fFD(-1),
+		fCache(NULL)
+	{
+	}
+
+	virtual status_t Setup(TestContext& context)
+	{
+		fFD = _kern_open(-1, kTestFilePath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fFD < 0)
+			return fFD;
+
+		// every block is filled with its block number
+		uint8* buffer = (uint8*)malloc(kBlockSize);
+		if (buffer == NULL)
+			return B_NO_MEMORY;
+
+		for (off_t i = 0; i < kBlockCount; i++) {
+			memset(buffer, _Pattern(i), kBlockSize);
+			ssize_t written = _kern_write(fFD, i * kBlockSize, buffer,
+				kBlockSize);
+			if (written != (ssize_t)kBlockSize) {
+				free(buffer);
+				return written < 0 ? written : B_IO_ERROR;
+			}
+		}
+		free(buffer);
+
+		fCache = block_cache_create(fFD, kBlockCount, kBlockSize, true);
+		if (fCache == NULL)
+			return B_NO_MEMORY;
+
+		return B_OK;
+	}
+
+	virtual void Cleanup(TestContext& context, bool setupOK)
+	{
+		if (fCache != NULL)
+			block_cache_delete(fCache, false);
+		if (fFD >= 0) {
+			_kern_close(fFD);
+			_kern_unlink(-1, kTestFilePath);
+		}
+	}
+
+
+	bool TestGetPut(TestContext& context)
+	{
+		for (int32 pass = 0; pass < 2; pass++) {
+			for (off_t i = 0; i < kBlockCount; i++) {
+				CachedBlock block(fCache, i);
+				const uint8* data = block.Data();
+				TEST_ASSERT(data != NULL);
+				TEST_ASSERT_PRINT(data[0] == _Pattern(i)
+						&& data[kBlockSize - 1] == _Pattern(i),
+					"block %" B_PRIdOFF ", pass %" B_PRId32, i, pass);
+			}
+		}
+
+		return true;
+	}
+
+	bool TestNestedGetPut(TestContext& context)
+	{
+		// the first reference is taken on an unused block, the others are
+		// added to an already referenced one
+		{
+			CachedBlock blocks[10];
+			for (int32 i = 0; i < 10; i++)
+				TEST_ASSERT(blocks[i].SetTo(fCache, 7) != NULL);
+		}
+
+		// and the block must still be there afterwards
+		CachedBlock block(fCache, 7);
+		TEST_ASSERT(block.Data() != NULL && block.Data()[0] == _Pattern(7));
+
+		return true;
+	}
+
+	bool TestConcurrentGetPut(TestContext& context)
+	{
+		fTestOK = true;
+		fTestGo = false;
+		fSpread = true;
+		fTestTime = kConcurrentTestTime;
+
+		thread_id threads[8];
+		int threadCount = _SpawnThreads(context, threads, 8,
+			&BlockCacheTest::GetPutThread);
+
+		fTestGo = true;
+		_WaitForThreads(threads, threadCount);
+
+		return fTestOK;
+	}
+
+	/*!	Measures block_cache_get()/block_cache_put() throughput for an
+		increasing number of threads, once with all threads using the same
+		block, and once with every thread using random blocks. There is no
+		pass/fail criterion; the numbers are printed only. The per-shard
+		counters of the cache can be looked at with the "block_cache" KDL
+		command afterwards.
+	*/
+	bool TestGetScaling(TestContext& context)
+	{
+		int cpuCount = smp_get_num_cpus();
+		fTestOK = true;
+		fTestTime = kBenchmarkTime;
+		context.Print("\n    threads   same block       spread  (gets/ms)\n");
+
+		for (int threadCount = 1; threadCount <= kMaxThreads;
+				threadCount *= 2) {
+			if (threadCount > cpuCount && threadCount > 1)
+				break;
+
+			uint64 sameGets = _RunBenchmark(context, threadCount, false);
+			uint64 spreadGets = _RunBenchmark(context, threadCount, true);
+
+			context.Print("    %7d %12" B_PRIu64 " %12" B_PRIu64 "\n",
+				threadCount, sameGets * 1000 / kBenchmarkTime,
+				spreadGets * 1000 / kBenchmarkTime);
+		}
+
+		return fTestOK;
+	}
+
+
+	// thread function wrappers
+
+	void GetPutThread(TestContext& context, void* _index)
+	{
+		if (!_GetPutThread(context, (addr_t)_index))
+			fTestOK = false;
+	}
+
+private:
+	static uint8 _Pattern(off_t blockNumber)
+	{
+		return (uint8)(blockNumber * 7 + 1);
+	}
+
+	int _SpawnThreads(TestContext& context, thread_id* threads, int count,
+		void (BlockCacheTest::*method)(TestContext&, void*))
+	{
+		int i = 0;
+		for (; i < count; i++) {
+			threads[i] = SpawnThread(this, method, "block cache test",
+				B_NORMAL_PRIORITY, (void*)(addr_t)i);
+			if (threads[i] < 0) {
+				fTestOK = false;
+				context.Error("Failed to spawn thread: %s\n",
+					strerror(threads[i]));
+				break;
+			}
+		}
+
+		for (int k = 0; k < i; k++)
+			resume_thread(threads[k]);
+
+		return i;
+	}
+
+	void _WaitForThreads(thread_id* threads, int count)
+	{
+		for (int i = 0; i < count; i++)
+			wait_for_thread(threads[i], NULL);
+	}
+
+	uint64 _RunBenchmark(TestContext& context, int threadCount, bool spread)
+	{
+		fTestGo = false;
+		fSpread = spread;
+		fGetCount = 0;
+
+		thread_id threads[kMaxThreads];
+		threadCount = _SpawnThreads(context, threads, threadCount,
+			&BlockCacheTest::GetPutThread);
+
+		fTestGo = true;
+		_WaitForThreads(threads, threadCount);
+
+		return fGetCount;
+	}
+
+	bool _GetPutThread(TestContext& context, int32 threadIndex)
+	{
+		uint32 random = 0x9e3779b9 * (threadIndex + 1);
+
+		while (!fTestGo) {
+		}
+
+		uint64 gets = 0;
+		bigtime_t startTime = system_time();
+		do {
+			for (int k = 0; fTestOK && k < 1000; k++) {
+				off_t blockNumber = fSpread
+					? next_random(random) % kBlockCount : 0;
+
+				CachedBlock block(fCache, blockNumber);
+				const uint8* data = block.Data();
+				TEST_ASSERT(data != NULL);
+				TEST_ASSERT_PRINT(data[0] == _Pattern(blockNumber),
+					"thread index: %" B_PRId32 ", block %" B_PRIdOFF
+					": %u vs %u", threadIndex, blockNumber, data[0],
+					_Pattern(blockNumber));
+			}
+			gets += 1000;
+		} while (fTestOK && system_time() - startTime < fTestTime);
+
+		atomic_add64((int64*)&fGetCount, gets);
+		return true;
+	}
+
+private:
+			int			fFD;
+			void*		fCache;
+			bigtime_t	fTestTime;
+	volatile bool		fTestGo;
+	volatile bool		fSpread;
+	volatile uint64		fGetCount;
+	volatile bool		fTestOK;
+};
+
+
+TestSuite*
+create_block_cache_test_suite()
+{
+	TestSuite* suite = new(std::nothrow) TestSuite("block_cache");
+
+	ADD_STANDARD_TEST(suite, BlockCacheTest, TestGetPut);
+	ADD_STANDARD_TEST(suite, BlockCacheTest, TestNestedGetPut);
+	ADD_STANDARD_TEST(suite, BlockCacheTest, TestConcurrentGetPut);
+	ADD_STANDARD_TEST(suite, BlockCacheTest, TestGetScaling);
+
+	return suite;
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BLOCK_CACHE_TESTS_H
+#define BLOCK_CACHE_TESTS_H
+
+
+#include "TestSuite.h"
+
+
+TestSuite* create_block_cache_test_suite();
+
+
+#endif	// BLOCK_CACHE_TESTS_H
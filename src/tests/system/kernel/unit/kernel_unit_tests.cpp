@@ -19,7 +19,10 @@
 #include "TestManager.h"
 #include "TestOutput.h"
 
+#include "cache/BlockCacheTests.h"
 #include "lock/LockTestSuite.h"
+#include "timer/TimerTests.h"
+#include "vm/LargePageTests.h"
 
 
 int32 api_version = B_CUR_DRIVER_API_VERSION;
@@ -294,7 +297,10 @@ init_driver(void)
 		return B_NO_MEMORY;
 
 	// register test suites
+	sTestManager->AddTest(create_block_cache_test_suite());
 	sTestManager->AddTest(create_lock_test_suite());
+	sTestManager->AddTest(create_timer_test_suite());
+	sTestManager->AddTest(create_large_page_test_suite());
 
 	return B_OK;
 }
@@ -0,0 +1,274 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BigReaderLockTests.h"
+
+#include <string.h>
+
+#include <brw_lock.h>
+#include <smp.h>
+
+#include "TestThread.h"
+
+
+static const int kConcurrentTestTime = 2000000;
+static const int kBenchmarkTime = 500000;
+static const int kMaxThreads = 16;
+
+
+class BigReaderLockTest : public StandardTestDelegate {
+public:
+	BigReaderLockTest()
+	{
+	}
+
+	virtual status_t Setup(TestContext& context)
+	{
+		brw_lock_init(&fLock, "test big reader lock");
+		rw_lock_init(&fRWLock, "test r/w lock");
+		return B_OK;
+	}
+
+	virtual void Cleanup(TestContext& context, bool setupOK)
+	{
+		brw_lock_destroy(&fLock);
+		rw_lock_destroy(&fRWLock);
+	}
+
+
+	bool TestSimple(TestContext& context)
+	{
+		for (int32 i = 0; i < 3; i++) {
+			TEST_ASSERT(brw_lock_read_lock(&fLock) == B_OK);
+			brw_lock_read_unlock(&fLock);
+
+			TEST_ASSERT(brw_lock_write_lock(&fLock) == B_OK);
+			brw_lock_write_unlock(&fLock);
+		}
+
+		return true;
+	}
+
+	bool TestNestedWrite(TestContext& context)
+	{
+		for (int32 i = 0; i < 10; i++)
+			TEST_ASSERT(brw_lock_write_lock(&fLock) == B_OK);
+
+		for (int32 i = 0; i < 10; i++)
+			brw_lock_write_unlock(&fLock);
+
+		return true;
+	}
+
+	bool TestNestedWriteRead(TestContext& context)
+	{
+		TEST_ASSERT(brw_lock_write_lock(&fLock) == B_OK);
+
+		for (int32 i = 0; i < 10; i++)
+			TEST_ASSERT(brw_lock_read_lock(&fLock) == B_OK);
+
+		for (int32 i = 0; i < 10; i++)
+			brw_lock_read_unlock(&fLock);
+
+		brw_lock_write_unlock(&fLock);
+
+		return true;
+	}
+
+	bool TestConcurrentWriteRead(TestContext& context)
+	{
+		fTestOK = true;
+		fTestGo = false;
+		fLockCount = 0;
+
+		thread_id threads[8];
+		int threadCount = _SpawnThreads(context, threads, 8,
+			&BigReaderLockTest::TestConcurrentWriteReadThread);
+
+		fTestGo = true;
+		_WaitForThreads(threads, threadCount);
+
+		return fTestOK;
+	}
+
+	/*!	Compares the read side throughput of brw_lock and rw_lock for an
+		increasing number of threads. There is no pass/fail criterion; the
+		numbers are printed only.
+	*/
+	bool TestReadScaling(TestContext& context)
+	{
+		int cpuCount = smp_get_num_cpus();
+		fTestOK = true;
+		context.Print("\n    threads      rw_lock     brw_lock  (reads/ms)\n");
+
+		for (int threadCount = 1; threadCount <= kMaxThreads;
+				threadCount *= 2) {
+			if (threadCount > cpuCount && threadCount > 1)
+				break;
+
+			uint64 rwReads = _RunReadBenchmark(context, threadCount,
+				&BigReaderLockTest::RWLockReadThread);
+			uint64 brwReads = _RunReadBenchmark(context, threadCount,
+				&BigReaderLockTest::BigReaderLockReadThread);
+
+			context.Print("    %7d %12" B_PRIu64 " %12" B_PRIu64 "\n",
+				threadCount, rwReads * 1000 / kBenchmarkTime,
+				brwReads * 1000 / kBenchmarkTime);
+		}
+
+		return fTestOK;
+	}
+
+
+	// thread function wrappers
+
+	void TestConcurrentWriteReadThread(TestContext& context, void* _index)
+	{
+		if (!_TestConcurrentWriteReadThread(context, (addr_t)_index))
+			fTestOK = false;
+	}
+
+	void RWLockReadThread(TestContext& context, void* _index)
+	{
+		while (!fTestGo) {
+		}
+
+		uint64 reads = 0;
+		bigtime_t startTime = system_time();
+		do {
+			for (int k = 0; k < 1000; k++) {
+				rw_lock_read_lock(&fRWLock);
+				rw_lock_read_unlock(&fRWLock);
+			}
+			reads += 1000;
+		} while (system_time() - startTime < kBenchmarkTime);
+
+		atomic_add64((int64*)&fReadCount, reads);
+	}
+
+	void BigReaderLockReadThread(TestContext& context, void* _index)
+	{
+		while (!fTestGo) {
+		}
+
+		uint64 reads = 0;
+		bigtime_t startTime = system_time();
+		do {
+			for (int k = 0; k < 1000; k++) {
+				brw_lock_read_lock(&fLock);
+				brw_lock_read_unlock(&fLock);
+			}
+			reads += 1000;
+		} while (system_time() - startTime < kBenchmarkTime);
+
+		atomic_add64((int64*)&fReadCount, reads);
+	}
+
+private:
+	int _SpawnThreads(TestContext& context, thread_id* threads, int count,
+		void (BigReaderLockTest::*method)(TestContext&, void*))
+	{
+		int i = 0;
+		for (; i < count; i++) {
+			threads[i] = SpawnThread(this, method, "brw lock test",
+				B_NORMAL_PRIORITY, (void*)(addr_t)i);
+			if (threads[i] < 0) {
+				fTestOK = false;
+				context.Error("Failed to spawn thread: %s\n",
+					strerror(threads[i]));
+				break;
+			}
+		}
+
+		for (int k = 0; k < i; k++)
+			resume_thread(threads[k]);
+
+		return i;
+	}
+
+	void _WaitForThreads(thread_id* threads, int count)
+	{
+		for (int i = 0; i < count; i++)
+			wait_for_thread(threads[i], NULL);
+	}
+
+	uint64 _RunReadBenchmark(TestContext& context, int threadCount,
+		void (BigReaderLockTest::*method)(TestContext&, void*))
+	{
+		fTestGo = false;
+		fReadCount = 0;
+
+		thread_id threads[kMaxThreads];
+		threadCount = _SpawnThreads(context, threads, threadCount, method);
+
+		fTestGo = true;
+		_WaitForThreads(threads, threadCount);
+
+		return fReadCount;
+	}
+
+	bool _TestConcurrentWriteReadThread(TestContext& context, int32 threadIndex)
+	{
+		if (!fTestOK)
+			return false;
+
+		int bitShift = 8 * threadIndex;
+
+		while (!fTestGo) {
+		}
+
+		bigtime_t startTime = system_time();
+		uint64 iteration = 0;
+		do {
+			for (int k = 0; fTestOK && k < 255; k++) {
+				TEST_ASSERT(brw_lock_read_lock(&fLock) == B_OK);
+				uint64 count = fLockCount;
+				brw_lock_read_unlock(&fLock);
+
+				TEST_ASSERT(brw_lock_write_lock(&fLock) == B_OK);
+				fLockCount += (uint64)1 << bitShift;
+				brw_lock_write_unlock(&fLock);
+
+				int value = (count >> bitShift) & 0xff;
+				TEST_ASSERT_PRINT(value == k,
+					"thread index: %" B_PRId32 ", iteration: %" B_PRId32
+					", value: %d vs %d, count: %#" B_PRIx64, threadIndex,
+					iteration, value, k, count);
+			}
+
+			TEST_ASSERT(brw_lock_write_lock(&fLock) == B_OK);
+			fLockCount -= (uint64)255 << bitShift;
+			brw_lock_write_unlock(&fLock);
+
+			iteration++;
+		} while (fTestOK && system_time() - startTime < kConcurrentTestTime);
+
+		return true;
+	}
+
+private:
+			brw_lock	fLock;
+			rw_lock		fRWLock;
+	volatile bool		fTestGo;
+	volatile uint64		fLockCount;
+	volatile uint64		fReadCount;
+	volatile bool		fTestOK;
+};
+
+
+TestSuite*
+create_brw_lock_test_suite()
+{
+	TestSuite* suite = new(std::nothrow) TestSuite("brw_lock");
+
+	ADD_STANDARD_TEST(suite, BigReaderLockTest, TestSimple);
+	ADD_STANDARD_TEST(suite, BigReaderLockTest, TestNestedWrite);
+	ADD_STANDARD_TEST(suite, BigReaderLockTest, TestNestedWriteRead);
+	ADD_STANDARD_TEST(suite, BigReaderLockTest, TestConcurrentWriteRead);
+	ADD_STANDARD_TEST(suite, BigReaderLockTest, TestReadScaling);
+
+	return suite;
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BIG_READER_LOCK_TESTS_H
+#define BIG_READER_LOCK_TESTS_H
+
+
+#include "TestSuite.h"
+
+
+TestSuite* create_brw_lock_test_suite();
+
+
+#endif	// BIG_READER_LOCK_TESTS_H
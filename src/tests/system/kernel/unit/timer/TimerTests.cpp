@@ -0,0 +1,189 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "TimerTests.h"
+
+#include <stdlib.h>
+
+#include <KernelExport.h>
+
+#include <AutoDeleter.h>
+
+#include <timer.h>
+
+
+static const int32 kOrderCount = 16;
+
+static const int32 kStressCount = 100000;
+static const bigtime_t kStressMinTimeout = 100000;
+static const bigtime_t kStressMaxTimeout = 1000000;
+
+
+class TimerTest : public StandardTestDelegate {
+public:
+	TimerTest()
+	{
+	}
+
+	bool TestOrder(TestContext& context)
+	{
+		timer timers[kOrderCount];
+		fFiredCount = 0;
+
+		// add the timers in reverse order of their expiration
+		bigtime_t base = system_time() + 5000;
+		for (int32 i = 0; i < kOrderCount; i++) {
+			timers[i].user_data = this;
+			add_timer(&timers[i], &_OrderHook, base + (kOrderCount - i) * 1000,
+				B_ONE_SHOT_ABSOLUTE_TIMER);
+		}
+
+		bigtime_t deadline = base + kOrderCount * 1000 + 1000000;
+		while (fFiredCount < kOrderCount && system_time() < deadline)
+			snooze(1000);
+
+		for (int32 i = 0; i < kOrderCount; i++)
+			cancel_timer(&timers[i]);
+
+		TEST_ASSERT(fFiredCount == kOrderCount);
+
+		for (int32 i = 0; i < kOrderCount; i++) {
+			timer* event = fOrder[i];
+			TEST_ASSERT_PRINT(event == &timers[kOrderCount - 1 - i],
+				"position %" B_PRId32 ": timer %" B_PRId32, i,
+				(int32)(event - timers));
+		}
+
+		return true;
+	}
+
+	bool TestCancel(TestContext& context)
+	{
+		timer timers[kOrderCount];
+		fFiredCount = 0;
+
+		// spread the timers over different wheel levels
+		for (int32 i = 0; i < kOrderCount; i++) {
+			timers[i].user_data = this;
+			add_timer(&timers[i], &_CountHook, 50000LL << i,
+				B_ONE_SHOT_RELATIVE_TIMER);
+		}
+
+		int32 notPending = 0;
+		for (int32 i = 0; i < kOrderCount; i++) {
+			if (cancel_timer(&timers[i]))
+				notPending++;
+		}
+
+		snooze(100000);
+		TEST_ASSERT(notPending == 0);
+		TEST_ASSERT(fFiredCount == 0);
+
+		return true;
+	}
+
+	bool TestStress(TestContext& context)
+	{
+		return _Stress(context, 0);
+	}
+
+	bool TestStressSlack(TestContext& context)
+	{
+		return _Stress(context, B_TIMER_ALLOW_SLACK);
+	}
+
+private:
+	/*!	Arms kStressCount timers with random timeouts, cancels every other
+		one, and waits for the rest to fire. The time needed for adding and
+		cancelling is printed.
+	*/
+	bool _Stress(TestContext& context, uint32 flags)
+	{
+		timer* timers = (timer*)malloc(sizeof(timer) * kStressCount);
+		if (timers == NULL) {
+			context.Error("Failed to allocate the timers\n");
+			return false;
+		}
+		MemoryDeleter timersDeleter(timers);
+
+		fFiredCount = 0;
+		uint32 random = 42;
+
+		bigtime_t startTime = system_time();
+		for (int32 i = 0; i < kStressCount; i++) {
+			random = random * 1103515245 + 12345;
+			bigtime_t timeout = kStressMinTimeout
+				+ (random >> 8) % (kStressMaxTimeout - kStressMinTimeout);
+
+			timers[i].user_data = this;
+			add_timer(&timers[i], &_CountHook, timeout,
+				B_ONE_SHOT_RELATIVE_TIMER | flags);
+		}
+		bigtime_t addTime = system_time() - startTime;
+
+		int32 expected = kStressCount;
+		startTime = system_time();
+		for (int32 i = 1; i < kStressCount; i += 2) {
+			if (!cancel_timer(&timers[i]))
+				expected--;
+		}
+		bigtime_t cancelTime = system_time() - startTime;
+
+		bigtime_t deadline = system_time() + kStressMaxTimeout + 2000000;
+		while (fFiredCount < expected && system_time() < deadline)
+			snooze(10000);
+
+		// make sure none is left behind before freeing them
+		for (int32 i = 0; i < kStressCount; i++)
+			cancel_timer(&timers[i]);
+
+		context.Print("\n    %" B_PRId32 " timers%s: add %" B_PRId64
+			" ns/timer, cancel %" B_PRId64 " ns/timer\n", kStressCount,
+			(flags & B_TIMER_ALLOW_SLACK) != 0 ? " (with slack)" : "",
+			addTime * 1000 / kStressCount,
+			cancelTime * 1000 / (kStressCount / 2));
+
+		TEST_ASSERT_PRINT(fFiredCount == expected,
+			"fired: %" B_PRId32 ", expected: %" B_PRId32, fFiredCount,
+			expected);
+
+		return true;
+	}
+
+	static int32 _CountHook(timer* event)
+	{
+		TimerTest* test = (TimerTest*)event->user_data;
+		atomic_add(&test->fFiredCount, 1);
+		return B_HANDLED_INTERRUPT;
+	}
+
+	static int32 _OrderHook(timer* event)
+	{
+		TimerTest* test = (TimerTest*)event->user_data;
+		int32 index = atomic_add(&test->fFiredCount, 1);
+		if (index < kOrderCount)
+			test->fOrder[index] = event;
+		return B_HANDLED_INTERRUPT;
+	}
+
+private:
+	int32				fFiredCount;
+	timer*				fOrder[kOrderCount];
+};
+
+
+TestSuite*
+create_timer_test_suite()
+{
+	TestSuite* suite = new(std::nothrow) TestSuite("timer");
+
+	ADD_STANDARD_TEST(suite, TimerTest, TestOrder);
+	ADD_STANDARD_TEST(suite, TimerTest, TestCancel);
+	ADD_STANDARD_TEST(suite, TimerTest, TestStress);
+	ADD_STANDARD_TEST(suite, TimerTest, TestStressSlack);
+
+	return suite;
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "LargePageTests.h"
+
+#include <KernelExport.h>
+
+#include <arch/vm_translation_map.h>
+#include <vm/vm_page.h>
+#include <vm/vm_priv.h>
+#include <vm/VMTranslationMap.h>
+
+
+static const addr_t kTestAddress = 0x40000000;
+static const int32 kDaemonScans = 4;
+
+
+/*!	Maps a large page in a translation map of its own, and checks which
+	operations keep it intact, and which ones split it up. The map is never
+	activated on any CPU, so the hardware never sets any accessed or dirty
+	flags in it.
+*/
+class LargePageTest : public StandardTestDelegate {
+public:
+	LargePageTest()
+		:
+		fMap(NULL),
+		fPages(NULL),
+		fLargePageSize(0)
+	{
+	}
+
+	virtual status_t Setup(TestContext& context)
+	{
+		status_t status = arch_vm_translation_map_create_map(false, &fMap);
+		if (status != B_OK)
+			return status;
+
+		fLargePageSize = fMap->LargePageSize();
+		if (fLargePageSize == 0)
+			return B_OK;
+
+		physical_address_restrictions restrictions = {};
+		restrictions.alignment = fLargePageSize;
+		fPages = vm_page_allocate_page_run(PAGE_STATE_WIRED
+				| VM_PAGE_ALLOC_CLEAR, fLargePageSize / B_PAGE_SIZE,
+			&restrictions, VM_PRIORITY_SYSTEM);
+		if (fPages == NULL)
+			return B_NO_MEMORY;
+
+		vm_page_reservation reservation;
+		vm_page_reserve_pages(&reservation, fMap->MaxPagesNeededToMap(
+			kTestAddress, kTestAddress + fLargePageSize - 1),
+			VM_PRIORITY_SYSTEM);
+
+		fMap->Lock();
+		status = fMap->MapLargePage(kTestAddress,
+			fPages->physical_page_number * B_PAGE_SIZE,
+			B_READ_AREA | B_WRITE_AREA | B_KERNEL_READ_AREA
+				| B_KERNEL_WRITE_AREA,
+			B_WRITE_BACK_MEMORY, &reservation);
+		fMap->Unlock();
+
+		vm_page_unreserve_pages(&reservation);
+		return status;
+	}
+
+	virtual void Cleanup(TestContext& context, bool setupOK)
+	{
+		if (fMap != NULL) {
+			fMap->Lock();
+			fMap->Unmap(kTestAddress, kTestAddress + fLargePageSize - 1);
+			fMap->Unlock();
+			delete fMap;
+		}
+
+		if (fPages != NULL) {
+			for (page_num_t i = 0; i < fLargePageSize / B_PAGE_SIZE; i++)
+				vm_page_free_etc(NULL, &fPages[i], NULL);
+		}
+	}
+
+
+	/*!	Does what the page daemon does to every page of an active area a few
+		times over: the large page must survive that.
+	*/
+	bool TestDaemonScan(TestContext& context)
+	{
+		if (!_CheckSupported(context))
+			return true;
+
+		for (int32 scan = 0; scan < kDaemonScans; scan++) {
+			for (addr_t offset = 0; offset < fLargePageSize;
+					offset += B_PAGE_SIZE) {
+				bool modified = true;
+				bool accessed = fMap->ClearAccessedAndModified(NULL,
+					kTestAddress + offset, false, modified);
+				TEST_ASSERT(!accessed);
+				TEST_ASSERT(!modified);
+			}
+
+			TEST_ASSERT_PRINT(_CountLargePages() == 1, "scan %" B_PRId32,
+				scan);
+		}
+
+		fMap->Lock();
+		TEST_ASSERT(fMap->ClearFlags(kTestAddress + B_PAGE_SIZE,
+			PAGE_ACCESSED) == B_OK);
+		fMap->Unlock();
+		TEST_ASSERT(_CountLargePages() == 1);
+
+		return _CheckMapping();
+	}
+
+	bool TestProtectWhole(TestContext& context)
+	{
+		if (!_CheckSupported(context))
+			return true;
+
+		fMap->Lock();
+		TEST_ASSERT(fMap->Protect(kTestAddress,
+			kTestAddress + fLargePageSize - 1,
+			B_READ_AREA | B_KERNEL_READ_AREA, B_WRITE_BACK_MEMORY) == B_OK);
+		fMap->Unlock();
+
+		TEST_ASSERT(_CountLargePages() == 1);
+
+		phys_addr_t physicalAddress;
+		uint32 flags;
+		TEST_ASSERT(fMap->Query(kTestAddress, &physicalAddress, &flags)
+			== B_OK);
+		TEST_ASSERT((flags & B_WRITE_AREA) == 0);
+
+		return _CheckMapping();
+	}
+
+	bool TestProtectPartial(TestContext& context)
+	{
+		if (!_CheckSupported(context))
+			return true;
+
+		fMap->Lock();
+		TEST_ASSERT(fMap->Protect(kTestAddress + B_PAGE_SIZE,
+			kTestAddress + 2 * B_PAGE_SIZE - 1,
+			B_READ_AREA | B_KERNEL_READ_AREA, B_WRITE_BACK_MEMORY) == B_OK);
+		fMap->Unlock();
+
+		TEST_ASSERT(_CountLargePages() == 0);
+
+		phys_addr_t physicalAddress;
+		uint32 flags;
+		TEST_ASSERT(fMap->Query(kTestAddress + B_PAGE_SIZE, &physicalAddress,
+			&flags) == B_OK);
+		TEST_ASSERT((flags & B_WRITE_AREA) == 0);
+		TEST_ASSERT(fMap->Query(kTestAddress, &physicalAddress, &flags)
+			== B_OK);
+		TEST_ASSERT((flags & B_WRITE_AREA) != 0);
+
+		return _CheckMapping();
+	}
+
+	bool TestUnmapPartial(TestContext& context)
+	{
+		if (!_CheckSupported(context))
+			return true;
+
+		const addr_t address = kTestAddress + 3 * B_PAGE_SIZE;
+
+		fMap->Lock();
+		TEST_ASSERT(fMap->Unmap(address, address + B_PAGE_SIZE - 1)
+			== B_OK);
+		fMap->Unlock();
+
+		TEST_ASSERT(_CountLargePages() == 0);
+
+		phys_addr_t physicalAddress;
+		uint32 flags;
+		TEST_ASSERT(fMap->Query(address, &physicalAddress, &flags) == B_OK);
+		TEST_ASSERT((flags & PAGE_PRESENT) == 0);
+
+		return true;
+	}
+
+private:
+	bool _CheckSupported(TestContext& context)
+	{
+		if (fLargePageSize != 0)
+			return true;
+
+		context.Print("\n    large pages are not supported, skipped\n");
+		return false;
+	}
+
+	int32 _CountLargePages()
+	{
+		fMap->Lock();
+		int32 count = fMap->CountLargePages(kTestAddress,
+			kTestAddress + fLargePageSize);
+		fMap->Unlock();
+		return count;
+	}
+
+	/*!	Checks that every page still translates to the right physical page.
+	*/
+	bool _CheckMapping()
+	{
+		for (addr_t offset = 0; offset < fLargePageSize;
+				offset += B_PAGE_SIZE) {
+			phys_addr_t physicalAddress;
+			uint32 flags;
+			TEST_ASSERT(fMap->Query(kTestAddress + offset, &physicalAddress,
+				&flags) == B_OK);
+			TEST_ASSERT((flags & PAGE_PRESENT) != 0);
+			TEST_ASSERT_PRINT(physicalAddress
+					== fPages->physical_page_number * B_PAGE_SIZE + offset,
+				"offset %#" B_PRIxADDR, offset);
+		}
+
+		return true;
+	}
+
+private:
+			VMTranslationMap*	fMap;
+			vm_page*			fPages;
+			size_t				fLargePageSize;
+};
+
+
+TestSuite*
+create_large_page_test_suite()
+{
+	TestSuite* suite = new(std::nothrow) TestSuite("large_pages");
+
+	ADD_STANDARD_TEST(suite, LargePageTest, TestDaemonScan);
+	ADD_STANDARD_TEST(suite, LargePageTest, TestProtectWhole);
+	ADD_STANDARD_TEST(suite, LargePageTest, TestProtectPartial);
+	ADD_STANDARD_TEST(suite, LargePageTest, TestUnmapPartial);
+
+	return suite;
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef LARGE_PAGE_TESTS_H
+#define LARGE_PAGE_TESTS_H
+
+
+#include "TestSuite.h"
+
+
+TestSuite* create_large_page_test_suite();
+
+
+#endif	// LARGE_PAGE_TESTS_H
@@ -14,13 +14,14 @@
 #include "fssh_kernel_export.h"
 #include "fssh_lock.h"
 #include "fssh_string.h"
+#include "fssh_uio.h"
 #include "fssh_unistd.h"
 #include "hash.h"
 #include "vfs.h"
 
 // TODO: this is a naive but growing implementation to test the API:
-//	1) block reading/writing is not at all optimized for speed, it will
-//	   just read and write single blocks.
+//	1) runs of adjacent blocks are read and written back using a single
+//	   vectored request, but there is no real read-ahead heuristic yet.
 //	2) the locking could be improved; getting a block should not need to
 //	   wait for blocks to be written
 // TODO: the retrieval/copy of the original data could be delayed until the
@@ -133,6 +134,11 @@ struct block_cache {
 };
 
 static const int32_t kMaxBlockCount = 1024;
+static const int32_t kReadAroundBlocks = 16;
+	// on a cache miss, up to this many uncached blocks (including the
+	// requested one) are read in with a single request
+static const fssh_size_t kMaxWriteRunBlocks = 64;
+	// maximum number of blocks that are written back with a single request
 
 struct cache_listener;
 typedef DoublyLinkedListLink<cache_listener> listener_link;
@@ -165,6 +171,8 @@ struct cache_transaction {
 
 static fssh_status_t write_cached_block(block_cache* cache, cached_block* block,
 	bool deleteTransaction = true);
+static fssh_status_t write_cached_blocks(block_cache* cache,
+	cached_block** blocks, fssh_size_t count, bool deleteTransaction = true);
 
 
 static fssh_mutex sNotificationsLock;
@@ -547,6 +555,7 @@ block_cache::FreeBlock(cached_block* block)
 #endif
 
 	delete block;
+	allocated_block_count--;
 }
 
 
@@ -707,6 +716,74 @@ put_cached_block(block_cache* cache, fssh_off_t blockNumber)
 }
 
 
+/*!	Reads the newly allocated \a block from disk. Any directly following
+	blocks that are not yet cached are read in with the same request (up to
+	kReadAroundBlocks in total), and are put into the unused list afterwards.
+	If reading \a block fails, it is removed from the cache again.
+*/
+static fssh_status_t
+read_cached_block_run(block_cache* cache, cached_block* block)
+{
+	fssh_size_t blockSize = cache->block_size;
+	fssh_off_t blockNumber = block->block_number;
+
+	int32_t maxCount = 1;
+	if (cache->allocated_block_count + kReadAroundBlocks <= kMaxBlockCount) {
+		// only read around if that won't push other blocks out of the cache
+		maxCount = kReadAroundBlocks;
+		if (maxCount > cache->max_blocks - blockNumber)
+			maxCount = cache->max_blocks - blockNumber;
+	}
+
+	cached_block* run[kReadAroundBlocks];
+	fssh_iovec vecs[kReadAroundBlocks];
+
+	// collect the uncached blocks following the requested one
+	run[0] = block;
+	int32_t count = 1;
+	for (; count < maxCount; count++) {
+		fssh_off_t nextNumber = blockNumber + count;
+		if (hash_lookup(cache->hash, &nextNumber) != NULL)
+			break;
+
+		cached_block* next = cache->NewBlock(nextNumber);
+		if (next == NULL)
+			break;
+
+		hash_insert(cache->hash, next);
+		run[count] = next;
+	}
+
+	for (int32_t i = 0; i < count; i++) {
+		vecs[i].iov_base = run[i]->current_data;
+		vecs[i].iov_len = blockSize;
+	}
+
+	fssh_ssize_t bytesRead = fssh_readv_pos(cache->fd, blockNumber * blockSize,
+		vecs, count);
+	int32_t blocksRead = bytesRead > 0 ? bytesRead / blockSize : 0;
+
+	// the read-around blocks are not referenced by anyone
+	for (int32_t i = 1; i < count; i++) {
+		if (i >= blocksRead) {
+			cache->RemoveBlock(run[i]);
+			continue;
+		}
+
+		run[i]->unused = true;
+		cache->unused_blocks.Add(run[i]);
+	}
+
+	if (blocksRead < 1) {
+		cache->RemoveBlock(block);
+		FATAL(("could not read block %" FSSH_B_PRIdOFF "\n", blockNumber));
+		return fssh_errno;
+	}
+
+	return FSSH_B_OK;
+}
+
+
 /*!	Retrieves the block \a blockNumber from the hash table, if it's already
 	there, or reads it from the disk.
 
@@ -741,14 +818,9 @@ get_cached_block(block_cache* cache, fssh_off_t blockNumber, bool* _allocated,
 	}
 
 	if (*_allocated && readBlock) {
-		int32_t blockSize = cache->block_size;
-
-		if (fssh_read_pos(cache->fd, blockNumber * blockSize, block->current_data,
-				blockSize) < blockSize) {
-			cache->RemoveBlock(block);
-			FATAL(("could not read block %" FSSH_B_PRIdOFF "\n", blockNumber));
-			return fssh_errno;
-		}
+		fssh_status_t status = read_cached_block_run(cache, block);
+		if (status != FSSH_B_OK)
+			return status;
 	}
 
 	if (block->unused) {
@@ -879,33 +951,16 @@ get_writable_cached_block(block_cache* cache, fssh_off_t blockNumber,
 }
 
 
-/*!	Writes the specified \a block back to disk. It will always only write back
-	the oldest change of the block if it is part of more than one transaction.
+/*!	Updates the state of the \a block after it has been written back to disk.
 	It will automatically send out TRANSACTION_WRITTEN notices, as well as
 	delete transactions when they are no longer used, and \a deleteTransaction
 	is \c true.
 */
-static fssh_status_t
-write_cached_block(block_cache* cache, cached_block* block,
+static void
+block_written(block_cache* cache, cached_block* block, void* data,
 	bool deleteTransaction)
 {
 	cache_transaction* previous = block->previous_transaction;
-	int32_t blockSize = cache->block_size;
-
-	void* data = previous && block->original_data
-		? block->original_data : block->current_data;
-		// we first need to write back changes from previous transactions
-
-	TRACE(("write_cached_block(block %lld)\n", block->block_number));
-
-	fssh_ssize_t written = fssh_write_pos(cache->fd, block->block_number * blockSize,
-		data, blockSize);
-
-	if (written < blockSize) {
-		FATAL(("could not write back block %" FSSH_B_PRIdOFF " (%s)\n",
-			block->block_number, fssh_strerror(fssh_get_errno())));
-		return FSSH_B_IO_ERROR;
-	}
 
 	if (data == block->current_data)
 		block->is_dirty = false;
@@ -938,11 +993,92 @@ write_cached_block(block_cache* cache, cached_block* block,
 		block->unused = true;
 		cache->unused_blocks.Add(block);
 	}
+}
+
+
+static int
+compare_blocks(const void* _blockA, const void* _blockB)
+{
+	cached_block* blockA = *(cached_block**)_blockA;
+	cached_block* blockB = *(cached_block**)_blockB;
+
+	fssh_off_t diff = blockA->block_number - blockB->block_number;
+	if (diff > 0)
+		return 1;
+
+	return diff < 0 ? -1 : 0;
+}
+
+
+/*!	Writes the specified \a blocks back to disk. The array is sorted in place,
+	and runs of consecutive blocks are written with a single request.
+	It will always only write back the oldest change of a block if it is part
+	of more than one transaction.
+	See block_written() for what happens to the blocks afterwards.
+*/
+static fssh_status_t
+write_cached_blocks(block_cache* cache, cached_block** blocks,
+	fssh_size_t count, bool deleteTransaction)
+{
+	fssh_size_t blockSize = cache->block_size;
+
+	if (count > 1)
+		qsort(blocks, count, sizeof(cached_block*), &compare_blocks);
+
+	fssh_iovec vecs[kMaxWriteRunBlocks];
+
+	for (fssh_size_t i = 0; i < count;) {
+		fssh_size_t runLength = 1;
+		while (i + runLength < count && runLength < kMaxWriteRunBlocks
+			&& blocks[i + runLength]->block_number
+				== blocks[i + runLength - 1]->block_number + 1) {
+			runLength++;
+		}
+
+		for (fssh_size_t j = 0; j < runLength; j++) {
+			cached_block* block = blocks[i + j];
+
+			TRACE(("write_cached_blocks(block %lld)\n", block->block_number));
+
+			vecs[j].iov_base = block->previous_transaction != NULL
+					&& block->original_data != NULL
+				? block->original_data : block->current_data;
+				// we first need to write back changes from previous
+				// transactions
+			vecs[j].iov_len = blockSize;
+		}
+
+		fssh_ssize_t written = fssh_writev_pos(cache->fd,
+			blocks[i]->block_number * blockSize, vecs, runLength);
+
+		if (written < (fssh_ssize_t)(runLength * blockSize)) {
+			FATAL(("could not write back %" FSSH_B_PRIuSIZE " blocks (start "
+				"block %" FSSH_B_PRIdOFF "): %s\n", runLength,
+				blocks[i]->block_number, fssh_strerror(fssh_get_errno())));
+			return FSSH_B_IO_ERROR;
+		}
+
+		for (fssh_size_t j = 0; j < runLength; j++) {
+			block_written(cache, blocks[i + j], vecs[j].iov_base,
+				deleteTransaction);
+		}
+
+		i += runLength;
+	}
 
 	return FSSH_B_OK;
 }
 
 
+/*!	Writes the specified \a block back to disk. See write_cached_blocks(). */
+static fssh_status_t
+write_cached_block(block_cache* cache, cached_block* block,
+	bool deleteTransaction)
+{
+	return write_cached_blocks(cache, &block, 1, deleteTransaction);
+}
+
+
 /*!	Waits until all pending notifications are carried out.
 	Safe to be called from the block writer/notifier thread.
 	You must not hold the \a cache lock when calling this function.
@@ -1002,27 +1138,64 @@ fssh_cache_sync_transaction(void* _cache, int32_t id)
 {
 	block_cache* cache = (block_cache*)_cache;
 	MutexLocker locker(&cache->lock);
-	fssh_status_t status = FSSH_B_ENTRY_NOT_FOUND;
 
 	TRACE(("cache_sync_transaction(id %d)\n", id));
 
+	// collect the remaining dirty blocks of all earlier transactions, so
+	// that they can be written back in their on-disk order
+
+	fssh_size_t count = 0;
 	hash_iterator iterator;
 	hash_open(cache->transaction_hash, &iterator);
 
 	cache_transaction* transaction;
 	while ((transaction = (cache_transaction*)hash_next(
 			cache->transaction_hash, &iterator)) != NULL) {
-		// close all earlier transactions which haven't been closed yet
+		if (transaction->id <= id && !transaction->open)
+			count += transaction->num_blocks;
+	}
 
-		if (transaction->id <= id && !transaction->open) {
-			// write back all of their remaining dirty blocks
-			while (transaction->num_blocks > 0) {
-				status = write_cached_block(cache, transaction->blocks.Head(),
-					false);
-				if (status != FSSH_B_OK)
-					return status;
+	hash_close(cache->transaction_hash, &iterator, false);
+
+	if (count > 0) {
+		cached_block** blocks
+			= (cached_block**)malloc(count * sizeof(cached_block*));
+		if (blocks == NULL)
+			return FSSH_B_NO_MEMORY;
+
+		fssh_size_t index = 0;
+		hash_open(cache->transaction_hash, &iterator);
+
+		while ((transaction = (cache_transaction*)hash_next(
+				cache->transaction_hash, &iterator)) != NULL) {
+			if (transaction->id > id || transaction->open)
+				continue;
+
+			block_list::Iterator blockIterator
+				= transaction->blocks.GetIterator();
+			while (cached_block* block = blockIterator.Next()) {
+				if (index < count)
+					blocks[index++] = block;
 			}
+		}
+
+		hash_close(cache->transaction_hash, &iterator, false);
+
+		fssh_status_t status = write_cached_blocks(cache, blocks, index,
+			false);
+		free(blocks);
+
+		if (status != FSSH_B_OK)
+			return status;
+	}
+
+	// close all earlier transactions which haven't been closed yet
+
+	hash_open(cache->transaction_hash, &iterator);
 
+	while ((transaction = (cache_transaction*)hash_next(
+			cache->transaction_hash, &iterator)) != NULL) {
+		if (transaction->id <= id && !transaction->open) {
 			hash_remove_current(cache->transaction_hash, &iterator);
 			delete_transaction(cache, transaction);
 		}
@@ -1542,6 +1715,15 @@ fssh_block_cache_sync(void* _cache)
 	// transaction or no transaction only
 
 	MutexLocker locker(&cache->lock);
+	if (cache->allocated_block_count == 0)
+		return FSSH_B_OK;
+
+	cached_block** blocks = (cached_block**)malloc(
+		cache->allocated_block_count * sizeof(cached_block*));
+	if (blocks == NULL)
+		return FSSH_B_NO_MEMORY;
+
+	fssh_size_t count = 0;
 	hash_iterator iterator;
 	hash_open(cache->hash, &iterator);
 
@@ -1549,14 +1731,16 @@ fssh_block_cache_sync(void* _cache)
 	while ((block = (cached_block*)hash_next(cache->hash, &iterator)) != NULL) {
 		if (block->previous_transaction != NULL
 			|| (block->transaction == NULL && block->is_dirty)) {
-			fssh_status_t status = write_cached_block(cache, block);
-			if (status != FSSH_B_OK)
-				return status;
+			blocks[count++] = block;
 		}
 	}
 
 	hash_close(cache->hash, &iterator, false);
-	return FSSH_B_OK;
+
+	fssh_status_t status = write_cached_blocks(cache, blocks, count);
+	free(blocks);
+
+	return status;
 }
 
 
@@ -1577,7 +1761,19 @@ fssh_block_cache_sync_etc(void* _cache, fssh_off_t blockNumber,
 
 	MutexLocker locker(&cache->lock);
 
-	for (; numBlocks > 0; numBlocks--, blockNumber++) {
+	fssh_size_t maxCount = numBlocks;
+	if (maxCount > (fssh_size_t)cache->allocated_block_count)
+		maxCount = cache->allocated_block_count;
+	if (maxCount == 0)
+		return FSSH_B_OK;
+
+	cached_block** blocks
+		= (cached_block**)malloc(maxCount * sizeof(cached_block*));
+	if (blocks == NULL)
+		return FSSH_B_NO_MEMORY;
+
+	fssh_size_t count = 0;
+	for (; numBlocks > 0 && count < maxCount; numBlocks--, blockNumber++) {
 		cached_block* block = (cached_block*)hash_lookup(cache->hash,
 			&blockNumber);
 		if (block == NULL)
@@ -1585,13 +1781,14 @@ fssh_block_cache_sync_etc(void* _cache, fssh_off_t blockNumber,
 
 		if (block->previous_transaction != NULL
 			|| (block->transaction == NULL && block->is_dirty)) {
-			fssh_status_t status = write_cached_block(cache, block);
-			if (status != FSSH_B_OK)
-				return status;
+			blocks[count++] = block;
 		}
 	}
 
-	return FSSH_B_OK;
+	fssh_status_t status = write_cached_blocks(cache, blocks, count);
+	free(blocks);
+
+	return status;
 }
 
 